@@ -77,16 +77,13 @@ void ActiveConnect(ArgListType &arg) {  // AT_FUN
       "call @ActiveConnect." << ERR_WHERE;
     exit(EXIT_FAILURE);
   }
-  UIPtnSequence Seq = SystemVar::getSequence(SeqName, FunctionName, ComL);
+  const PackedSequence &Seq = SystemVar::getSequence(SeqName, FunctionName, ComL);
   int SeqSize = Seq.size();
-  UIPtnSequence ReSeq;
-  if (ResetSeq.getValue() != "{zeros}") {
-    ReSeq = SystemVar::getSequence(ResetSeq, FunctionName, ComL);
-  } else {
-    ReSeq.resize(SeqSize, UIVector(0));
-  }
+  const PackedSequence zeros(SeqSize);
+  const PackedSequence &ReSeq = (ResetSeq.getValue() != "{zeros}") ?
+    SystemVar::getSequence(ResetSeq, FunctionName, ComL) : zeros;
   int lastNeuron = 0;
-  for (UIPtnSequenceCIt it = Seq.begin(); it != Seq.end(); it++) {
+  for (PackedSequence::const_iterator it = Seq.begin(); it != Seq.end(); it++) {
     updateMax(lastNeuron, it->back());
   }
   if (EndNeuron.getValue() == -1) {
@@ -112,12 +109,8 @@ void ActiveConnect(ArgListType &arg) {  // AT_FUN
   }
 
   // get externals
-  UIMatrix ExtSeq;
-  if (External.getValue() != "{zeros}") {
-    ExtSeq = SystemVar::getSequence(External, FunctionName, ComL);
-  } else {
-    ExtSeq.resize(SeqSize, UIVector(0));
-  }
+  const PackedSequence &ExtSeq = (External.getValue() != "{zeros}") ?
+    SystemVar::getSequence(External, FunctionName, ComL) : zeros;
 
   // Do the loops
   int NumPats = EndPat.getValue() - StartPat.getValue() + 1;
@@ -128,8 +121,8 @@ void ActiveConnect(ArgListType &arg) {  // AT_FUN
   DataList iNumFired(NumPats);
   DataList PczzV(NumPats);
   int index = 0;
-  UIPtnSequenceCIt SeqConstIterator = Seq.begin();
-  UIPtnSequenceCIt ExtConstIterator = ExtSeq.begin();
+  PackedSequence::const_iterator SeqConstIterator = Seq.begin();
+  PackedSequence::const_iterator ExtConstIterator = ExtSeq.begin();
   UIVector pat_b4;
   if (StartPat.getValue() == 1) {
     pat_b4 = ReSeq.front();
@@ -177,31 +177,35 @@ vector<T> matrixSum(const vector<vector<T> > &toSum) {
   return toReturn;
 }
 
-template <typename T>
-double matrixMean(const vector<vector<T> > &toAvg) {
+// The statistics below take a DataMatrix or a DenseMatrix (anything whose
+// rows have begin(), end() and size())
+template <typename M>
+double matrixMean(const M &toAvg) {
+  typedef typename M::value_type::value_type T;
   return for_each(toAvg.begin(), toAvg.end(), MatrixMeanHelper<T>()).result();
 }
 
-template <typename T>
-double matrixMoment(const vector<vector<T> > &Matrix, const float avg,
-                    const int moment) {
+template <typename M>
+double matrixMoment(const M &Matrix, const float avg, const int moment) {
+  typedef typename M::value_type::value_type T;
   return for_each(Matrix.begin(), Matrix.end(),
                   MatrixMomentHelper<T>(avg, moment)).result();
 }
 
-template <typename T>
-double matrixAvgSS(const vector<vector<T> > &Matrix) {
+template <typename M>
+double matrixAvgSS(const M &Matrix) {
+  typedef typename M::value_type::value_type T;
   return for_each(Matrix.begin(), Matrix.end(), MatrixSSHelper<T>()).result();
 }
 
-template <typename T>
-size_t matrixSize(const vector<vector<T> > &Matrix) {
+template <typename M>
+size_t matrixSize(const M &Matrix) {
   const size_t size = Matrix.size() > 0 ? Matrix.size() * Matrix[0].size() : 0;
   return size;
 }
 
-template <typename T>
-double matrixVar(const vector<vector<T> > &Matrix) {
+template <typename M>
+double matrixVar(const M &Matrix) {
   const double avg = matrixMean(Matrix);
   const size_t size = matrixSize(Matrix);
   // Var = sum((x-mean(x))^2) / (n - 1)
@@ -213,8 +217,8 @@ double matrixVar(const vector<vector<T> > &Matrix) {
   return (matrixAvgSS(Matrix) - avg * avg) * size / (size  - 1);
 }
 
-template <typename T>
-double matrixSkew(const vector<vector<T> > &Matrix) {
+template <typename M>
+double matrixSkew(const M &Matrix) {
   const double avg = matrixMean(Matrix);
   const double var = matrixMoment(Matrix, avg, 2);
   const double moment3 = matrixMoment(Matrix, avg, 3);
@@ -222,8 +226,8 @@ double matrixSkew(const vector<vector<T> > &Matrix) {
   return (moment3 / pow(var, 1.5)) * sqrt(size * (size - 1)) / (size - 2);
 }
 
-template <typename T>
-double matrixKurt(const vector<vector<T> > &Matrix) {
+template <typename M>
+double matrixKurt(const M &Matrix) {
   const double avg = matrixMean(Matrix);
   const double var = matrixMoment(Matrix, avg, 2);
   const double moment4 = matrixMoment(Matrix, avg, 4);
@@ -302,6 +306,19 @@ vector<vector<T> > transposeMatrix(const vector<vector<T> > &toTranspose) {
   return toReturn;
 }
 
+// As above, for patterns: sets only the bits that are on
+inline Sequence transposeMatrix(const Sequence &toTranspose) {
+  const unsigned int oldRowSize = toTranspose.size();
+  Sequence toReturn(findMaxSize(toTranspose), Pattern(oldRowSize));
+  for (unsigned int t = 0; t < oldRowSize; ++t) {
+    const Pattern &src = toTranspose[t];
+    for (Pattern::size_type n = src.findFirst(); n < src.size(); n = src.findNext(n)) {
+      toReturn[n].set(t);
+    }
+  }
+  return toReturn;
+}
+
 // first & last are 1-based, VecIn & toReturn are 0-based
 template<typename T>
 inline vector<T> SubVector(const vector<T> &VecIn, unsigned int first,
@@ -333,6 +350,35 @@ inline vector<vector<T> > SubMatrix(const vector<vector<T> > &mtxIn,
   return toReturn;
 }
 
+// As above, for patterns
+inline Pattern SubVector(const Pattern &VecIn, unsigned int first,
+                         unsigned int last) {
+  unsigned int useLast = last == 0 ? VecIn.size()
+    : min(last, static_cast<unsigned int>(VecIn.size()));
+  Pattern toReturn(useLast - first + 1);
+  for (Pattern::size_type n = VecIn.findFrom(first - 1); n < useLast;
+       n = VecIn.findNext(n)) {
+    toReturn.set(n - first + 1);
+  }
+  return toReturn;
+}
+
+inline Sequence SubMatrix(const Sequence &mtxIn,
+                          unsigned int firstT, unsigned int lastT,
+                          unsigned int firstN, unsigned int lastN) {
+  unsigned int numOldRows = mtxIn.at(0).size();
+  unsigned int numOldCols = mtxIn.size();
+  unsigned int useLastRow = lastT == 0 ? numOldRows : min(lastT, numOldRows);
+  unsigned int useLastCol = lastN == 0 ? numOldCols : min(lastN, numOldCols);
+  unsigned int numRows = useLastRow - firstT + 1;
+  unsigned int numCols = useLastCol - firstN + 1;
+  Sequence toReturn(numRows, Pattern(numCols));
+  for (unsigned int i = firstT-1; i < useLastRow; ++i) {
+    toReturn[i - firstT + 1] = SubVector(mtxIn[i], firstN, useLastCol);
+  }
+  return toReturn;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Some integer functions
 ////////////////////////////////////////////////////////////////////////////////
@@ -718,11 +764,11 @@ inline ostream& operator << (ostream &os, const FlagArg &x) {
   return (os << x.getFlag());
 }
 
-template<typename T>
+template<typename M>
 void setMatrixRange(int &startT, int &endT, int &startN, int &endN,
                     const TArg<int> &StartTime, const TArg<int> &EndTime,
                     const TArg<int> &StartNeuron, const TArg<int> &EndNeuron,
-                    const vector<vector<T> > cfMtx, const CommandLine &ComL,
+                    const M &cfMtx, const CommandLine &ComL,
                     const string &FunctionName) {
   startN = StartNeuron.getValue();
   endN = EndNeuron.getValue();
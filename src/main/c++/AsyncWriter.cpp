@@ -0,0 +1,314 @@
+/***************************************************************************
+ * AsyncWriter.cpp
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#if !defined(ASYNCWRITER_HPP)
+#  include "AsyncWriter.hpp"
+#endif
+
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <map>
+#if !defined(WIN32)
+#  include <unistd.h>
+#endif
+#if defined(MULTITHREAD)
+#  include <pthread.h>
+#endif
+
+#if !defined(OUTPUT_HPP)
+#  include "Output.hpp"
+#endif
+
+using std::ios;
+using std::map;
+using std::ofstream;
+using std::string;
+
+namespace {
+  struct WriteJob {
+    string FileName;
+    string Text;
+    bool Truncate;
+  };
+
+  // The files being written, kept open between writes. Only one thread
+  // uses them at a time.
+  class OpenFiles {
+   public:
+    ~OpenFiles() { closeAll(); }
+
+    bool write(const WriteJob &job) {
+      map<string, ofstream *>::iterator it = Files.find(job.FileName);
+      if (job.Truncate && (it != Files.end())) {
+        delete it->second;
+        Files.erase(it);
+        it = Files.end();
+      }
+      if (it == Files.end()) {
+        if (Files.size() >= AsyncWriter::MaxOpenFiles) closeAll();
+        ofstream *file = job.Truncate ?
+          new ofstream(job.FileName.c_str(), ios::out | ios::binary | ios::trunc) :
+          new ofstream(job.FileName.c_str(), ios::out | ios::binary | ios::app);
+        it = Files.insert(std::make_pair(job.FileName, file)).first;
+      }
+      ofstream &file = *it->second;
+      file.write(job.Text.data(), static_cast<std::streamsize>(job.Text.size()));
+      return static_cast<bool>(file);
+    }
+
+    void closeAll() {
+      for (map<string, ofstream *>::iterator it = Files.begin(); it != Files.end(); ++it) {
+        delete it->second;
+      }
+      Files.clear();
+    }
+
+    // Returns the name of a file that could not be written, if any
+    string flushAll() {
+      string failed;
+      for (map<string, ofstream *>::iterator it = Files.begin(); it != Files.end(); ++it) {
+        if (!it->second->flush() && failed.empty()) failed = it->first;
+      }
+      return failed;
+    }
+
+   private:
+    map<string, ofstream *> Files;
+  };
+
+  void reportFailure(const string &fileName) {
+    CALL_ERROR << "Error in AsyncWriter : Unable to write to " << fileName
+               << ERR_WHERE;
+    exit(EXIT_FAILURE);
+  }
+
+  class WriteService {
+   public:
+    WriteService();
+    ~WriteService();
+    void post(const string &fileName, string &text, const bool truncate);
+    void flush();
+    void forked();
+
+   private:
+    // Writes on the calling thread
+    void writeNow(const string &fileName, string &text, const bool truncate);
+    void flushNow();
+    void startWriter();
+
+    OpenFiles Files;
+    string FailedFile;
+#if defined(MULTITHREAD)
+    static void *writerLoop(void *arg);
+
+    bool Threaded;
+    pthread_t Writer;
+    pthread_mutex_t Lock;
+    pthread_cond_t HasWork;     // signalled when a job is queued
+    pthread_cond_t Progress;    // signalled when a job is done
+    std::deque<WriteJob> Queue;
+    std::size_t QueuedBytes;    // including the job being written
+    bool Busy;
+    bool Quit;
+#endif
+  };
+
+  void WriteService::writeNow(const string &fileName, string &text, const bool truncate) {
+    WriteJob job;
+    job.FileName = fileName;
+    job.Text.swap(text);
+    job.Truncate = truncate;
+    if (!Files.write(job)) reportFailure(fileName);
+  }
+
+  void WriteService::flushNow() {
+    const string failed = Files.flushAll();
+    if (!failed.empty()) reportFailure(failed);
+  }
+
+  WriteService &service() {
+    // Destroyed at exit, which writes out whatever is still queued
+    static WriteService theService;
+    return theService;
+  }
+
+#if defined(MULTITHREAD)
+  WriteService::WriteService() {
+    startWriter();
+  }
+
+  void WriteService::startWriter() {
+    Queue.clear();
+    QueuedBytes = 0;
+    Busy = false;
+    Quit = false;
+    pthread_mutex_init(&Lock, NULL);
+    pthread_cond_init(&HasWork, NULL);
+    pthread_cond_init(&Progress, NULL);
+    // Without a writer thread the writes are just done in post
+    Threaded = (pthread_create(&Writer, NULL, writerLoop, this) == 0);
+  }
+
+  void WriteService::forked() {
+    // The parent flushed before forking, so its writer was waiting for
+    // work with the lock free; the copies of the lock and conditions
+    // are simply started afresh
+    Files.closeAll();
+    startWriter();
+  }
+
+  WriteService::~WriteService() {
+    if (Threaded) {
+      pthread_mutex_lock(&Lock);
+      Quit = true;
+      pthread_cond_signal(&HasWork);
+      pthread_mutex_unlock(&Lock);
+      pthread_join(Writer, NULL);
+    }
+    pthread_cond_destroy(&Progress);
+    pthread_cond_destroy(&HasWork);
+    pthread_mutex_destroy(&Lock);
+  }
+
+  void *WriteService::writerLoop(void *arg) {
+    WriteService &ws = *static_cast<WriteService *>(arg);
+    WriteJob job;
+    pthread_mutex_lock(&ws.Lock);
+    for (;;) {
+      while (ws.Queue.empty() && !ws.Quit) pthread_cond_wait(&ws.HasWork, &ws.Lock);
+      // Anything still queued is written before quitting
+      if (ws.Queue.empty()) break;
+      WriteJob &front = ws.Queue.front();
+      job.FileName.swap(front.FileName);
+      job.Text.swap(front.Text);
+      job.Truncate = front.Truncate;
+      ws.Queue.pop_front();
+      ws.Busy = true;
+      pthread_mutex_unlock(&ws.Lock);
+      const bool wrote = ws.Files.write(job);
+      pthread_mutex_lock(&ws.Lock);
+      ws.Busy = false;
+      ws.QueuedBytes -= job.Text.size();
+      if (!wrote && ws.FailedFile.empty()) ws.FailedFile = job.FileName;
+      pthread_cond_broadcast(&ws.Progress);
+    }
+    pthread_mutex_unlock(&ws.Lock);
+    return NULL;
+  }
+
+  void WriteService::post(const string &fileName, string &text, const bool truncate) {
+    if (!Threaded) {
+      writeNow(fileName, text, truncate);
+      return;
+    }
+    pthread_mutex_lock(&Lock);
+    // Back-pressure: a full queue waits for the writer to catch up
+    while (QueuedBytes >= AsyncWriter::MaxQueuedBytes) {
+      pthread_cond_wait(&Progress, &Lock);
+    }
+    const string failed = FailedFile;
+    if (failed.empty()) {
+      Queue.push_back(WriteJob());
+      WriteJob &job = Queue.back();
+      job.FileName = fileName;
+      job.Text.swap(text);
+      job.Truncate = truncate;
+      QueuedBytes += job.Text.size();
+      pthread_cond_signal(&HasWork);
+    }
+    pthread_mutex_unlock(&Lock);
+    if (!failed.empty()) reportFailure(failed);
+  }
+
+  void WriteService::flush() {
+    if (!Threaded) {
+      flushNow();
+      return;
+    }
+    pthread_mutex_lock(&Lock);
+    while (!Queue.empty() || Busy) pthread_cond_wait(&Progress, &Lock);
+    // The writer is waiting for work, so the files are ours for now
+    const string notFlushed = Files.flushAll();
+    if (FailedFile.empty()) FailedFile = notFlushed;
+    const string failed = FailedFile;
+    pthread_mutex_unlock(&Lock);
+    if (!failed.empty()) reportFailure(failed);
+  }
+#else
+  WriteService::WriteService() { }
+
+  WriteService::~WriteService() { }
+
+  void WriteService::post(const string &fileName, string &text, const bool truncate) {
+    writeNow(fileName, text, truncate);
+  }
+
+  void WriteService::flush() {
+    flushNow();
+  }
+
+  void WriteService::forked() {
+    Files.closeAll();
+  }
+#endif
+}
+
+bool AsyncWriter::canWrite(const string &fileName) {
+#if !defined(WIN32)
+  // A file that is there must be writable; otherwise its directory must
+  // be, for the first write to create it
+  if (access(fileName.c_str(), F_OK) == 0) return access(fileName.c_str(), W_OK) == 0;
+  const string::size_type slash = fileName.rfind('/');
+  const string dir = (slash == string::npos) ? string(".") :
+    (slash == 0) ? string("/") : fileName.substr(0, slash);
+  return access(dir.c_str(), W_OK | X_OK) == 0;
+#else
+  // Opening to append leaves anything already there (or queued) alone
+  ofstream toCheck(fileName.c_str(), ios::out | ios::app);
+  return toCheck.is_open();
+#endif
+}
+
+void AsyncWriter::write(const string &fileName, string &text, const bool truncate) {
+  service().post(fileName, text, truncate);
+  text.clear();
+}
+
+void AsyncWriter::write(const string &fileName, std::ostringstream &text,
+                        const bool truncate) {
+  string toWrite = text.str();
+  text.str("");
+  service().post(fileName, toWrite, truncate);
+}
+
+void AsyncWriter::flush() {
+  service().flush();
+}
+
+void AsyncWriter::empty(const string &fileName) {
+  flush();
+  string nothing;
+  service().post(fileName, nothing, true);
+  flush();
+}
+
+void AsyncWriter::forked() {
+  service().forked();
+}
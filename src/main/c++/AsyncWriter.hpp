@@ -0,0 +1,93 @@
+/***************************************************************************
+ * AsyncWriter.hpp
+ *
+ *  Writes output files off the simulation thread
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+///////////////////////////////////////////////////////////////////////////////
+//
+// static bool canWrite(const std::string &fileName)
+// static void write(const std::string &fileName, std::string &text,
+//                   const bool truncate = false)
+// static void write(const std::string &fileName, std::ostringstream &text,
+//                   const bool truncate = false)
+// static void flush()
+// static void empty(const std::string &fileName)
+// static void forked()
+//
+// write queues text to go on the end of fileName (which is emptied first
+// if truncate is set) and returns without waiting for the disk; text is
+// left empty, ready for the next batch, and an ostringstream keeps its
+// formatting. A string is moved into the queue; an ostringstream's text
+// is copied out of it, so that form is for a line or so at a time. A
+// writer thread takes the queue in order, so the writes to any one file
+// land in the order they were made. It keeps each file open between
+// writes, so appending a line a time step costs no open or close.
+//
+// When more than MaxQueuedBytes are waiting, write blocks until the writer
+// has caught up, which bounds the memory the queue can take.
+//
+// flush returns once everything queued is on disk. It has to be called
+// before reading back (or handing to @System) a file that may have been
+// written this way; the end of the script, and exit(), also flush.
+//
+// empty leaves fileName empty on disk once everything queued for it has
+// been written, dropping the writer's open handle to it, so a later write
+// starts at the beginning of the file.
+//
+// forked is for the child of a fork made straight after a flush: the
+// child has none of the parent's threads, so it starts a writer of its
+// own, and it lets go of the files the parent has open rather than
+// writing through them.
+//
+// canWrite reports whether fileName can be written (it is writable, or it
+// is not there and its directory is) so that callers can give their usual
+// error up front. It neither creates the file nor touches it.
+//
+// In a build without threads the writes happen in write itself, still
+// through the open files.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#if !defined(ASYNCWRITER_HPP)
+#  define ASYNCWRITER_HPP
+
+#  include <cstddef>
+#  include <sstream>
+#  include <string>
+
+class AsyncWriter {
+ public:
+  static const std::size_t MaxQueuedBytes = 64 * 1024 * 1024;
+  // More files than this are closed and reopened as needed
+  static const std::size_t MaxOpenFiles = 128;
+
+  static bool canWrite(const std::string &fileName);
+  static void write(const std::string &fileName, std::string &text,
+                    const bool truncate = false);
+  static void write(const std::string &fileName, std::ostringstream &text,
+                    const bool truncate = false);
+  static void flush();
+  static void empty(const std::string &fileName);
+  static void forked();
+
+ private:
+  AsyncWriter();
+};
+
+#endif  // ASYNCWRITER_HPP
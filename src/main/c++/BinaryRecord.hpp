@@ -0,0 +1,54 @@
+/***************************************************************************
+ * BinaryRecord.hpp
+ *
+ *  The words that SpikeLog and WeightHistory files are made of
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#if !defined(BINARYRECORD_HPP)
+#define BINARYRECORD_HPP
+
+#include <cstring>
+#include <fstream>
+#include <stdint.h>
+#include <string>
+
+// Both files are 32-bit words in the machine's byte order, buffered and
+// handed to the AsyncWriter a block at a time
+namespace BinaryRecord {
+  // Bytes buffered before they are handed to the writer
+  const std::size_t BufferBytes = 1 << 20;
+
+  inline void putWord(std::string &buffer, const uint32_t word) {
+    buffer.append(reinterpret_cast<const char *>(&word), sizeof(word));
+  }
+  inline bool getWord(std::ifstream &in, uint32_t &word) {
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(&word), sizeof(word)));
+  }
+  inline uint32_t floatBits(const float val) {
+    uint32_t bits;
+    std::memcpy(&bits, &val, sizeof(bits));
+    return bits;
+  }
+  inline float bitsFloat(const uint32_t bits) {
+    float val;
+    std::memcpy(&val, &bits, sizeof(val));
+    return val;
+  }
+}
+
+#endif
@@ -29,11 +29,19 @@ using std::pair;
 
 template<class T> class BindList {
  public:
+  // Walks the entries in name order; it->second is (entry, IsReadOnly)
+  typedef typename map<string, pair<T, bool> >::const_iterator const_iterator;
+
   BindList() {}
   ~BindList() {}
-  void insert(const string &k, const T &AddObj,
+  // AddObj may be of any type that can be assigned to a T
+  template<class U>
+  void insert(const string &k, const U &AddObj,
               const bool &IsReadOnly = false) {
-    dataMap[k] = pair<T, bool>(AddObj, IsReadOnly);
+    // Assigned in place: building a pair first would copy AddObj twice
+    pair<T, bool> &entry = dataMap[k];
+    entry.first = AddObj;
+    entry.second = IsReadOnly;
   }
   inline void remove(const string &k) { dataMap.erase(k); }
   inline bool exists(const string &k) const {
@@ -48,6 +56,8 @@ template<class T> class BindList {
   inline bool IsReadOnly(const string &k) const {
     return dataMap.find(k)->second.second;
   }
+  inline const_iterator begin() const { return dataMap.begin(); }
+  inline const_iterator end() const { return dataMap.end(); }
 
  private:
   map<string, pair<T, bool> > dataMap;
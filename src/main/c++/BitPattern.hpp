@@ -0,0 +1,218 @@
+/***************************************************************************
+ * BitPattern.hpp
+ *
+ *  A firing pattern stored one bit per neuron
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#if !defined(BITPATTERN_HPP)
+#define BITPATTERN_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <stdint.h>
+#include <vector>
+
+// BitPattern packs 64 neurons into each word, so a pattern takes an eighth
+// of the memory of a vector<char>, and counting, intersecting and merging
+// patterns work a word at a time. Bits past size() are always zero, which
+// lets count() and operator== look at whole words.
+//
+// The set neurons are walked with
+//   for (n = p.findFirst(); n < p.size(); n = p.findNext(n))
+class BitPattern {
+ public:
+  typedef std::size_t size_type;
+  typedef uint64_t word_type;
+  static const size_type BitsPerWord = 64;
+
+  // What operator[] and at() return on a non-const pattern
+  class reference {
+   public:
+    reference(word_type &word, const word_type mask): Word(word), Mask(mask) {}
+    inline operator bool() const { return (Word & Mask) != 0; }
+    inline reference &operator= (const bool val) {
+      if (val) {
+        Word |= Mask;
+      } else {
+        Word &= ~Mask;
+      }
+      return *this;
+    }
+    inline reference &operator= (const reference &other) {
+      return *this = static_cast<bool>(other);
+    }
+
+   private:
+    word_type &Word;
+    word_type Mask;
+  };
+
+  BitPattern(): NumBits(0) {}
+  explicit BitPattern(const size_type numBits, const bool val = false)
+    : Words(numWordsFor(numBits), val ? ~static_cast<word_type>(0) : 0),
+      NumBits(numBits) {
+    clearTail();
+  }
+
+  inline size_type size() const { return NumBits; }
+  inline bool empty() const { return NumBits == 0; }
+  inline size_type numWords() const { return Words.size(); }
+  inline const word_type *words() const {
+    return Words.empty() ? 0 : &Words[0];
+  }
+
+  inline bool test(const size_type n) const {
+    return (Words[n / BitsPerWord] & bitMask(n)) != 0;
+  }
+  inline void set(const size_type n) { Words[n / BitsPerWord] |= bitMask(n); }
+  inline void reset(const size_type n) {
+    Words[n / BitsPerWord] &= ~bitMask(n);
+  }
+  // Turns every neuron off, keeping the size
+  inline void reset() { std::fill(Words.begin(), Words.end(), 0); }
+
+  inline bool operator[] (const size_type n) const { return test(n); }
+  inline reference operator[] (const size_type n) {
+    return reference(Words[n / BitsPerWord], bitMask(n));
+  }
+  inline bool at(const size_type n) const {
+    checkRange(n);
+    return test(n);
+  }
+  inline reference at(const size_type n) {
+    checkRange(n);
+    return (*this)[n];
+  }
+
+  // Number of neurons on
+  size_type count() const {
+    size_type toReturn = 0;
+    for (size_type w = 0; w < Words.size(); ++w) toReturn += popcount(Words[w]);
+    return toReturn;
+  }
+  // Number of neurons on in both, i.e., (*this & other).count()
+  size_type countAnd(const BitPattern &other) const {
+    const size_type n = std::min(Words.size(), other.Words.size());
+    size_type toReturn = 0;
+    for (size_type w = 0; w < n; ++w) {
+      toReturn += popcount(Words[w] & other.Words[w]);
+    }
+    return toReturn;
+  }
+  bool any() const {
+    for (size_type w = 0; w < Words.size(); ++w) {
+      if (Words[w]) return true;
+    }
+    return false;
+  }
+  inline bool none() const { return !any(); }
+
+  // The first neuron on at or after n, or size() if there is none
+  size_type findFrom(const size_type n) const {
+    if (n >= NumBits) return NumBits;
+    size_type w = n / BitsPerWord;
+    word_type word = Words[w] & (~static_cast<word_type>(0) << (n % BitsPerWord));
+    while (word == 0) {
+      if (++w == Words.size()) return NumBits;
+      word = Words[w];
+    }
+    return w * BitsPerWord + lowestBit(word);
+  }
+  inline size_type findFirst() const { return findFrom(0); }
+  inline size_type findNext(const size_type prev) const {
+    return findFrom(prev + 1);
+  }
+
+  // Both patterns should be the same size; a longer other is cut short
+  BitPattern &operator&= (const BitPattern &other) {
+    const size_type n = std::min(Words.size(), other.Words.size());
+    for (size_type w = 0; w < n; ++w) Words[w] &= other.Words[w];
+    std::fill(Words.begin() + n, Words.end(), 0);
+    return *this;
+  }
+  BitPattern &operator|= (const BitPattern &other) {
+    const size_type n = std::min(Words.size(), other.Words.size());
+    for (size_type w = 0; w < n; ++w) Words[w] |= other.Words[w];
+    clearTail();
+    return *this;
+  }
+
+  inline bool operator== (const BitPattern &other) const {
+    return (NumBits == other.NumBits) && (Words == other.Words);
+  }
+  inline bool operator!= (const BitPattern &other) const {
+    return !(*this == other);
+  }
+  void swap(BitPattern &other) {
+    Words.swap(other.Words);
+    std::swap(NumBits, other.NumBits);
+  }
+
+  static inline size_type popcount(word_type word) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(word);
+#else
+    word -= (word >> 1) & 0x5555555555555555ULL;
+    word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+    word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return static_cast<size_type>((word * 0x0101010101010101ULL) >> 56);
+#endif
+  }
+
+ private:
+  static inline size_type numWordsFor(const size_type numBits) {
+    return (numBits + BitsPerWord - 1) / BitsPerWord;
+  }
+  static inline word_type bitMask(const size_type n) {
+    return static_cast<word_type>(1) << (n % BitsPerWord);
+  }
+  // Only called with word != 0
+  static inline size_type lowestBit(word_type word) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    size_type toReturn = 0;
+    while ((word & 1) == 0) {
+      word >>= 1;
+      ++toReturn;
+    }
+    return toReturn;
+#endif
+  }
+  inline void checkRange(const size_type n) const {
+    if (n >= NumBits) throw std::out_of_range("BitPattern::at");
+  }
+  inline void clearTail() {
+    if (NumBits % BitsPerWord) {
+      Words.back() &= (static_cast<word_type>(1) << (NumBits % BitsPerWord)) - 1;
+    }
+  }
+
+  std::vector<word_type> Words;
+  size_type NumBits;
+};
+
+inline BitPattern operator& (BitPattern lhs, const BitPattern &rhs) {
+  return lhs &= rhs;
+}
+inline BitPattern operator| (BitPattern lhs, const BitPattern &rhs) {
+  return lhs |= rhs;
+}
+
+#endif  // BITPATTERN_HPP
@@ -690,7 +690,7 @@ double Calc::Calculate(const CalcNode * StartNode, CalcNode * &EndNode) {
       string varName = StartNode->next->next->str;
       char varType = SystemVar::GetVarType(varName);
       if ((varType == 'M') || (varType == 'A')) {
-        DataMatrix Matrix =
+        const DenseMatrix &Matrix =
           SystemVar::getMatrixOrAnalysis(varName, FunctionName, ComL);
         return matrixMean(Matrix);
       } else {
@@ -702,7 +702,7 @@ double Calc::Calculate(const CalcNode * StartNode, CalcNode * &EndNode) {
       string varName = StartNode->next->next->str;
       char varType = SystemVar::GetVarType(varName);
       if ((varType == 'M') || (varType == 'A')) {
-        DataMatrix Matrix =
+        const DenseMatrix &Matrix =
           SystemVar::getMatrixOrAnalysis(varName, FunctionName, ComL);
         return matrixVar(Matrix);
       } else {
@@ -714,7 +714,7 @@ double Calc::Calculate(const CalcNode * StartNode, CalcNode * &EndNode) {
       string varName = StartNode->next->next->str;
       char varType = SystemVar::GetVarType(varName);
       if ((varType == 'M') || (varType == 'A')) {
-        DataMatrix Matrix =
+        const DenseMatrix &Matrix =
           SystemVar::getMatrixOrAnalysis(varName, FunctionName, ComL);
         return matrixSkew(Matrix);
       } else {
@@ -726,7 +726,7 @@ double Calc::Calculate(const CalcNode * StartNode, CalcNode * &EndNode) {
       string varName = StartNode->next->next->str;
       char varType = SystemVar::GetVarType(varName);
       if ((varType == 'M') || (varType == 'A')) {
-        DataMatrix Matrix =
+        const DenseMatrix &Matrix =
           SystemVar::getMatrixOrAnalysis(varName, FunctionName, ComL);
         return matrixKurt(Matrix);
       } else {
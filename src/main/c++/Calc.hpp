@@ -27,6 +27,9 @@
 #  if !defined(ARGFUNCTS_HPP)
 #    include "ArgFuncts.hpp"
 #  endif
+#  if !defined(ASYNCWRITER_HPP)
+#    include "AsyncWriter.hpp"
+#  endif
 #  if !defined(NOISE_HPP)
 #    include "Noise.hpp"
 #  endif
@@ -83,6 +86,14 @@ class Calc {
     UserNoise.Reset(seed);
     isNoiseInit = true;
   }
+  // For @SaveState and @LoadState
+  static void SaveUserNoise(SimState &state) {
+    UserNoise.SaveState(state);
+  }
+  static void LoadUserNoise(SimState &state) {
+    UserNoise.LoadState(state);
+    isNoiseInit = UserNoise.Initialized();
+  }
   static string RandomUserSeed() {
     chkNoiseInit();
     return to_string(UserNoise.RandInt(1, 32767));
@@ -163,6 +174,8 @@ void removeNextNode(CalcNode * &CurrentNode, CalcNode * &NextNode);
 /**************************************************************/
 
 inline bool fileExists(const std::string filename) {
+  // A file just saved may still be on its way to the disk
+  AsyncWriter::flush();
   std::ifstream exists(filename.c_str());
   if (!exists) return false;
   exists.close();
@@ -0,0 +1,371 @@
+/***************************************************************************
+ * ChunkedFile.cpp
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#if !defined(CHUNKEDFILE_HPP)
+#  include "ChunkedFile.hpp"
+#endif
+#if !defined(TEXTWRITER_HPP)
+#  include "TextWriter.hpp"
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <stdint.h>
+
+using std::string;
+using std::vector;
+
+namespace {
+  const char ChunkTag[8] = { 'N', 'J', 'C', 'H', 'U', 'N', 'K', '1' };
+  // Longer names mean a corrupt header, not a variable
+  const uint32_t MaxNameSize = 4096;
+
+  template<class T> inline void putRaw(string &out, const T value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+  }
+  inline void putVarint(string &out, const uint32_t value) {
+    PackedSequence::appendVarint(out, value);
+  }
+
+  // Reads from a chunk (or header) held in memory
+  class ByteReader {
+   public:
+    ByteReader(const string &bytes): Pos(bytes.data()), End(bytes.data() + bytes.size()),
+                                     Ok(true) {}
+    template<class T> T raw() {
+      T value = T();
+      if (End - Pos < static_cast<std::ptrdiff_t>(sizeof(T))) {
+        Ok = false;
+      } else {
+        memcpy(&value, Pos, sizeof(T));
+        Pos += sizeof(T);
+      }
+      return value;
+    }
+    uint32_t varint() {
+      uint32_t value = 0;
+      for (unsigned int shift = 0; shift < 35; shift += 7) {
+        if (Pos == End) break;
+        const unsigned char byte = static_cast<unsigned char>(*Pos++);
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return value;
+      }
+      Ok = false;
+      return 0;
+    }
+    inline bool ok() const { return Ok; }
+    inline const char *pos() const { return Pos; }
+
+   private:
+    const char *Pos;
+    const char *End;
+    bool Ok;
+  };
+
+  // The bits of each value XORed with the value above it
+  void encodeMatrixChunk(const DenseMatrix &rows, const unsigned int firstRow,
+                         const unsigned int endRow, string &out) {
+    vector<uint32_t> words;
+    vector<uint32_t> above;
+    for (unsigned int r = firstRow; r < endRow; ++r) {
+      const DenseMatrix::ConstRow row = rows[r];
+      putVarint(out, row.size());
+      if (above.size() < row.size()) above.resize(row.size(), 0);
+      for (unsigned int c = 0; c < row.size(); ++c) {
+        uint32_t bits;
+        const float val = row[c];
+        memcpy(&bits, &val, sizeof(bits));
+        words.push_back(bits ^ above[c]);
+        above[c] = bits;
+      }
+    }
+    // Runs of zero words, then of literal words
+    unsigned int w = 0;
+    while (w < words.size()) {
+      unsigned int zeros = 0;
+      while ((w + zeros < words.size()) && (words[w + zeros] == 0)) ++zeros;
+      w += zeros;
+      unsigned int literals = 0;
+      while ((w + literals < words.size()) && (words[w + literals] != 0)) ++literals;
+      putVarint(out, zeros);
+      putVarint(out, literals);
+      for (unsigned int i = 0; i < literals; ++i) putRaw(out, words[w + i]);
+      w += literals;
+    }
+  }
+
+  bool decodeMatrixChunk(const string &bytes, const unsigned int numRows,
+                         const unsigned int skip, const unsigned int keep,
+                         DenseMatrix &rows) {
+    ByteReader in(bytes);
+    vector<unsigned int> lengths(numRows);
+    unsigned int numWords = 0;
+    for (unsigned int r = 0; r < numRows; ++r) {
+      lengths[r] = in.varint();
+      numWords += lengths[r];
+    }
+    vector<uint32_t> words;
+    words.reserve(numWords);
+    while (in.ok() && (words.size() < numWords)) {
+      const uint32_t zeros = in.varint();
+      const uint32_t literals = in.varint();
+      if (words.size() + zeros + literals > numWords) return false;
+      words.insert(words.end(), zeros, 0);
+      for (uint32_t i = 0; i < literals; ++i) words.push_back(in.raw<uint32_t>());
+    }
+    if (!in.ok()) return false;
+
+    vector<uint32_t> above;
+    unsigned int w = 0;
+    for (unsigned int r = 0; r < numRows; ++r) {
+      if (above.size() < lengths[r]) above.resize(lengths[r], 0);
+      for (unsigned int c = 0; c < lengths[r]; ++c, ++w) above[c] ^= words[w];
+      if ((r >= skip) && (r < skip + keep)) {
+        DenseMatrix::Row row = rows.addRow(lengths[r]);
+        if (!row.empty()) memcpy(row.begin(), &above[0], lengths[r] * sizeof(float));
+      }
+    }
+    return true;
+  }
+
+  // Each pattern as its number of neurons then the bytes PackedSequence
+  // holds it in: the zigzag coded steps between its neurons, in the order
+  // they were given
+  void encodeSequenceChunk(const PackedSequence &seq, const unsigned int firstRow,
+                           const unsigned int endRow, string &out) {
+    for (unsigned int t = firstRow; t < endRow; ++t) {
+      putVarint(out, seq.numSpikes(t));
+      out.append(reinterpret_cast<const char *>(seq.encodedBegin(t)),
+                 reinterpret_cast<const char *>(seq.encodedEnd(t)));
+    }
+  }
+
+  bool decodeSequenceChunk(const string &bytes, const unsigned int numRows,
+                           const unsigned int skip, const unsigned int keep,
+                           PackedSequence &seq) {
+    ByteReader in(bytes);
+    for (unsigned int t = 0; t < numRows; ++t) {
+      const uint32_t numSpikes = in.varint();
+      // Walking the varints checks they all end inside the chunk
+      const char * const first = in.pos();
+      for (uint32_t n = 0; (n < numSpikes) && in.ok(); ++n) in.varint();
+      if (!in.ok()) return false;
+      if ((t >= skip) && (t < skip + keep)) {
+        seq.pushEncoded(reinterpret_cast<const unsigned char *>(first),
+                        reinterpret_cast<const unsigned char *>(in.pos()));
+      }
+    }
+    return true;
+  }
+
+  void putHeader(const ChunkedFile::Info &info, string &out) {
+    out.append(ChunkTag, sizeof(ChunkTag));
+    putRaw<uint32_t>(out, info.Kind);
+    putRaw<uint32_t>(out, info.Name.size());
+    out.append(info.Name);
+    putRaw<uint32_t>(out, info.NumRows);
+    putRaw<uint32_t>(out, info.NumCols);
+    putRaw<uint32_t>(out, info.RowsPerChunk);
+    putRaw<uint32_t>(out, info.NumChunks);
+  }
+
+  // The header and the index of the chunks
+  void putHeaderAndIndex(const ChunkedFile::Info &info, const vector<string> &chunks,
+                         string &header) {
+    putHeader(info, header);
+    const std::size_t indexEntry = sizeof(uint64_t) + sizeof(uint32_t);
+    uint64_t offset = header.size() + chunks.size() * indexEntry;
+    for (vector<string>::const_iterator it = chunks.begin(); it != chunks.end(); ++it) {
+      putRaw<uint64_t>(header, offset);
+      putRaw<uint32_t>(header, it->size());
+      offset += it->size();
+    }
+  }
+
+  // Puts the header and index in front of the chunks
+  void assemble(const ChunkedFile::Info &info, vector<string> &chunks, string &out) {
+    string header;
+    putHeaderAndIndex(info, chunks, header);
+    out.swap(header);
+    for (vector<string>::const_iterator it = chunks.begin(); it != chunks.end(); ++it) {
+      out.append(*it);
+    }
+  }
+
+  void assemble(const ChunkedFile::Info &info, vector<string> &chunks, TextWriter &out) {
+    string header;
+    putHeaderAndIndex(info, chunks, header);
+    out.write(header.data(), header.size());
+    for (vector<string>::iterator it = chunks.begin(); it != chunks.end(); ++it) {
+      out.write(it->data(), it->size());
+      string().swap(*it);
+    }
+  }
+
+  template<class Out>
+  void encodeMatrix(const string &name, const char kind, const DenseMatrix &rows,
+                    const unsigned int rowsPerChunk, Out &out) {
+    ChunkedFile::Info info;
+    info.Kind = kind;
+    info.Name = name;
+    info.NumRows = rows.size();
+    info.NumCols = rows.maxRowSize();
+    info.RowsPerChunk = std::max(rowsPerChunk, 1U);
+    vector<string> chunks;
+    for (unsigned int r = 0; r < info.NumRows; r += info.RowsPerChunk) {
+      chunks.push_back(string());
+      encodeMatrixChunk(rows, r, std::min(r + info.RowsPerChunk, info.NumRows),
+                        chunks.back());
+    }
+    info.NumChunks = chunks.size();
+    assemble(info, chunks, out);
+  }
+
+  template<class Out>
+  void encodeSequence(const string &name, const PackedSequence &seq,
+                      const unsigned int numNeurons, const unsigned int rowsPerChunk,
+                      Out &out) {
+    ChunkedFile::Info info;
+    info.Kind = 'S';
+    info.Name = name;
+    info.NumRows = seq.size();
+    info.NumCols = numNeurons;
+    info.RowsPerChunk = std::max(rowsPerChunk, 1U);
+    vector<string> chunks;
+    for (unsigned int t = 0; t < info.NumRows; t += info.RowsPerChunk) {
+      chunks.push_back(string());
+      encodeSequenceChunk(seq, t, std::min(t + info.RowsPerChunk, info.NumRows),
+                          chunks.back());
+    }
+    info.NumChunks = chunks.size();
+    assemble(info, chunks, out);
+  }
+
+  // The header and index of an open file
+  bool readHeader(std::ifstream &inFile, ChunkedFile::Info &info,
+                  vector<uint64_t> &offsets, vector<uint32_t> &sizes) {
+    char tag[sizeof(ChunkTag)];
+    if (!inFile.read(tag, sizeof(tag)) || !std::equal(tag, tag + sizeof(tag), ChunkTag)) {
+      return false;
+    }
+    uint32_t word[2];
+    if (!inFile.read(reinterpret_cast<char *>(word), sizeof(word))) return false;
+    info.Kind = static_cast<char>(word[0]);
+    if (word[1] > MaxNameSize) return false;
+    info.Name.resize(word[1]);
+    if ((word[1] > 0) && !inFile.read(&info.Name[0], word[1])) return false;
+    uint32_t sizes4[4];
+    if (!inFile.read(reinterpret_cast<char *>(sizes4), sizeof(sizes4))) return false;
+    info.NumRows = sizes4[0];
+    info.NumCols = sizes4[1];
+    info.RowsPerChunk = sizes4[2];
+    info.NumChunks = sizes4[3];
+    if ((info.RowsPerChunk == 0) && (info.NumRows > 0)) return false;
+    // readChunks indexes the chunks by row, so there must be exactly one
+    // for every RowsPerChunk rows
+    const unsigned int numChunks =
+      (info.NumRows == 0) ? 0 : ((info.NumRows - 1) / info.RowsPerChunk + 1);
+    if (info.NumChunks != numChunks) return false;
+    offsets.resize(info.NumChunks);
+    sizes.resize(info.NumChunks);
+    for (unsigned int c = 0; c < info.NumChunks; ++c) {
+      if (!inFile.read(reinterpret_cast<char *>(&offsets[c]), sizeof(uint64_t))
+          || !inFile.read(reinterpret_cast<char *>(&sizes[c]), sizeof(uint32_t))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Calls decode for each chunk holding some of rows first..last
+  template<class Rows, class Decoder>
+  bool readChunks(const string &fileName, const bool wantSequence,
+                  const unsigned int first, const unsigned int last,
+                  Rows &rows, Decoder decode) {
+    std::ifstream inFile(fileName.c_str(), std::ios::in | std::ios::binary);
+    ChunkedFile::Info info;
+    vector<uint64_t> offsets;
+    vector<uint32_t> sizes;
+    if (!readHeader(inFile, info, offsets, sizes)) return false;
+    if ((info.Kind == 'S') != wantSequence) return false;
+    if ((info.NumRows == 0) || (first >= info.NumRows) || (last < first)) return true;
+    const unsigned int lastRow = std::min(last, info.NumRows - 1);
+    string bytes;
+    for (unsigned int c = first / info.RowsPerChunk; c <= lastRow / info.RowsPerChunk; ++c) {
+      const unsigned int chunkFirst = c * info.RowsPerChunk;
+      const unsigned int chunkRows = std::min(info.RowsPerChunk, info.NumRows - chunkFirst);
+      const unsigned int skip = (first > chunkFirst) ? (first - chunkFirst) : 0;
+      const unsigned int keep = std::min(lastRow - chunkFirst + 1, chunkRows) - skip;
+      bytes.resize(sizes[c]);
+      inFile.seekg(static_cast<std::streamoff>(offsets[c]));
+      if ((sizes[c] > 0) && !inFile.read(&bytes[0], sizes[c])) return false;
+      if (!decode(bytes, chunkRows, skip, keep, rows)) return false;
+    }
+    return true;
+  }
+}
+
+void ChunkedFile::encode(const string &name, const char kind, const DenseMatrix &rows,
+                         const unsigned int rowsPerChunk, string &out) {
+  encodeMatrix(name, kind, rows, rowsPerChunk, out);
+}
+
+void ChunkedFile::encode(const string &name, const PackedSequence &seq,
+                         const unsigned int numNeurons, const unsigned int rowsPerChunk,
+                         string &out) {
+  encodeSequence(name, seq, numNeurons, rowsPerChunk, out);
+}
+
+void ChunkedFile::encode(const string &name, const char kind, const DenseMatrix &rows,
+                         const unsigned int rowsPerChunk, TextWriter &out) {
+  encodeMatrix(name, kind, rows, rowsPerChunk, out);
+}
+
+void ChunkedFile::encode(const string &name, const PackedSequence &seq,
+                         const unsigned int numNeurons, const unsigned int rowsPerChunk,
+                         TextWriter &out) {
+  encodeSequence(name, seq, numNeurons, rowsPerChunk, out);
+}
+
+bool ChunkedFile::isChunked(const string &fileName) {
+  std::ifstream inFile(fileName.c_str(), std::ios::in | std::ios::binary);
+  char tag[sizeof(ChunkTag)];
+  return inFile.read(tag, sizeof(tag)) && std::equal(tag, tag + sizeof(tag), ChunkTag);
+}
+
+bool ChunkedFile::readInfo(const string &fileName, Info &info) {
+  std::ifstream inFile(fileName.c_str(), std::ios::in | std::ios::binary);
+  vector<uint64_t> offsets;
+  vector<uint32_t> sizes;
+  return readHeader(inFile, info, offsets, sizes);
+}
+
+bool ChunkedFile::read(const string &fileName, const unsigned int first,
+                       const unsigned int last, DenseMatrix &rows) {
+  rows.clear();
+  return readChunks(fileName, false, first, last, rows, decodeMatrixChunk);
+}
+
+bool ChunkedFile::read(const string &fileName, const unsigned int first,
+                       const unsigned int last, PackedSequence &seq) {
+  seq.clear();
+  return readChunks(fileName, true, first, last, seq, decodeSequenceChunk);
+}
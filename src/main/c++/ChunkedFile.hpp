@@ -0,0 +1,103 @@
+/***************************************************************************
+ * ChunkedFile.hpp
+ *
+ *  A chunked, compressed binary file for sequences and matrices
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+///////////////////////////////////////////////////////////////////////////////
+//
+// @SaveData -chunked writes a sequence, matrix or analysis as a run of
+// chunks of RowsPerChunk rows (time steps) each, every chunk compressed on
+// its own, so @LoadData can read back a range of rows by decoding only the
+// chunks that hold it.
+//
+// The file holds
+//   the 8 byte tag "NJCHUNK1"
+//   the metadata: Kind ('S', 'M' or 'A'), the length of Name and Name,
+//     NumRows, NumCols, RowsPerChunk and NumChunks
+//   the index: the byte offset (64 bit) and size of each chunk
+//   the chunks
+// with the numbers unsigned 32 bit, in the byte order of the machine that
+// wrote them.
+//
+// A sequence chunk gives, for each pattern, the number of neurons firing
+// then the (zigzag coded) steps from one to the next, all as varints (7
+// bits a byte), so a sparse
+// pattern takes a few bytes. A matrix chunk gives the length of each row
+// as a varint, then the bits of each float XORed with the value above it
+// (0 on the chunk's first row), which is zero wherever a value repeats.
+// These words are stored as alternating varint counts of zero words and
+// of literal words, each literal count followed by its words.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#if !defined(CHUNKEDFILE_HPP)
+#  define CHUNKEDFILE_HPP
+
+#  include <string>
+
+#  if !defined(DENSEMATRIX_HPP)
+#    include "DenseMatrix.hpp"
+#  endif
+#  if !defined(PACKEDSEQUENCE_HPP)
+#    include "PackedSequence.hpp"
+#  endif
+
+class TextWriter;
+
+class ChunkedFile {
+ public:
+  struct Info {
+    Info(): Kind('M'), NumRows(0), NumCols(0), RowsPerChunk(0), NumChunks(0) {}
+    char Kind;                    // 'S'equence, 'M'atrix or 'A'nalysis
+    std::string Name;
+    unsigned int NumRows;
+    unsigned int NumCols;         // neurons for a sequence, longest row otherwise
+    unsigned int RowsPerChunk;
+    unsigned int NumChunks;
+  };
+
+  // Encode the whole file into out
+  static void encode(const std::string &name, const char kind, const DenseMatrix &rows,
+                     const unsigned int rowsPerChunk, std::string &out);
+  static void encode(const std::string &name, const PackedSequence &seq,
+                     const unsigned int numNeurons, const unsigned int rowsPerChunk,
+                     std::string &out);
+  // Encode the file onto the end of out. Only the compressed chunks are
+  // held (the index needs their sizes), each let go once it is handed on.
+  static void encode(const std::string &name, const char kind, const DenseMatrix &rows,
+                     const unsigned int rowsPerChunk, TextWriter &out);
+  static void encode(const std::string &name, const PackedSequence &seq,
+                     const unsigned int numNeurons, const unsigned int rowsPerChunk,
+                     TextWriter &out);
+
+  static bool isChunked(const std::string &fileName);
+  static bool readInfo(const std::string &fileName, Info &info);
+  // Read rows first..last (counting from 0, last included, both cut down
+  // to the rows in the file). Return false if the file is not a readable
+  // chunked file of the right kind.
+  static bool read(const std::string &fileName, const unsigned int first,
+                   const unsigned int last, DenseMatrix &rows);
+  static bool read(const std::string &fileName, const unsigned int first,
+                   const unsigned int last, PackedSequence &seq);
+
+ private:
+  ChunkedFile();
+};
+
+#endif  // CHUNKEDFILE_HPP
@@ -36,6 +36,9 @@
 #  include <utility>
 #  include <vector>
 
+#  if !defined(BITPATTERN_HPP)
+#    include "BitPattern.hpp"
+#  endif
 #  if !defined(STRINGUTILS_HPP)
 #    include "utils/StringUtils.hpp"
 #  endif
@@ -56,17 +59,11 @@ inline void updateMax(T &max, const T chk) {
 
 typedef std::pair<unsigned int, unsigned int> UIPair;
 
-#if defined(MEMORY)
-#   define BOOL(X) X
-typedef std::vector<bool> Pattern;
-#else
-#   define BOOL(X) (X != 0)
-typedef std::vector<char> Pattern;
-#endif
+#define BOOL(X) (X)
+// one bit per neuron
+typedef BitPattern Pattern;
 typedef std::vector<float> DataList;
 
-typedef Pattern::iterator PatternIt;
-typedef Pattern::const_iterator PatternCIt;
 typedef DataList::iterator DataListIt;
 typedef DataList::const_iterator DataListCIt;
 
@@ -128,7 +125,7 @@ class xInput {
     : extPtn(Pattern(numNeurons, false)), numOn(0) {}
   inline xInput(const int numNeurons, const Pattern &inPtn):
     extPtn(inPtn), numOn(0) {
-    numOn = inPtn.size() - std::count(inPtn.begin(), inPtn.end(), 0);
+    numOn = inPtn.count();
   };
   inline void initialize(const int numNeurons) {
     numOn = 0;
@@ -165,6 +162,7 @@ class xInput {
   }
   inline int numExternals() const { return numOn; }
   inline Pattern::size_type size() const { return extPtn.size(); }
+  inline const Pattern &pattern() const { return extPtn; }
 
  private:
   Pattern extPtn;
@@ -198,17 +196,20 @@ inline UIVector DataListToUIPtn(const DataList &DLIn) {
   return toReturn;
 }
 
-inline UIVector xInputToUIPtn(const xInput &xIn) {
-  unsigned int ptnSize = xIn.size();
+// The neurons that are on in p
+inline UIVector PtnToUIVector(const Pattern &p) {
   UIVector toReturn(0);
-  for (unsigned int i = 0; i < ptnSize; ++i) {
-    if (xIn[i]) {
-      toReturn.push_back(i);
-    }
+  toReturn.reserve(p.count());
+  for (Pattern::size_type n = p.findFirst(); n < p.size(); n = p.findNext(n)) {
+    toReturn.push_back(n);
   }
   return toReturn;
 }
 
+inline UIVector xInputToUIPtn(const xInput &xIn) {
+  return PtnToUIVector(xIn.pattern());
+}
+
 inline DataMatrix UISeqToMatrix(const UIPtnSequence &seqIn,
                                 unsigned int defaultNi = 0) {
   unsigned int mtxSize = seqIn.size();
@@ -238,19 +239,11 @@ inline Pattern UIVectorToPtn(const UIVector &v, unsigned int defaultNi = 0) {
     : defaultNi;  // assumes v is sorted
   Pattern toReturn(numNeurons, false);
   for (UIVectorCIt it = v.begin(); it != v.end(); ++it) {
-    toReturn[*it] = true;
+    toReturn.set(*it);
   }
   return toReturn;
 }
 
-// Vice-versa of the above
-inline UIVector PtnToUIVector(const Pattern &p) {
-  UIVector toReturn(0);
-  for (unsigned int i = 0; i < p.size(); ++i) {
-    if (p[i]) toReturn.push_back(i);
-  }
-  return toReturn;
-}
 
 // Converts from a list of a list of "neuron numbers" to a list
 // of boolean vectors (Patterns)
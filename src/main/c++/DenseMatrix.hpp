@@ -0,0 +1,359 @@
+/***************************************************************************
+ * DenseMatrix.hpp
+ *
+ *  A matrix of floats kept in one row-major buffer, with strided views
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#if !defined(DENSEMATRIX_HPP)
+#define DENSEMATRIX_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#if !defined(DATATYPES_HPP)
+#  include "DataTypes.hpp"
+#endif
+
+// A read-only window onto a rectangle of floats. Element (r, c) is at
+// base[r * rowStride + c * colStride], so a transpose or a block is just
+// another view of the same buffer.
+class MatrixView {
+ public:
+  typedef unsigned int size_type;
+
+  MatrixView(): Base(0), NumRows(0), NumCols(0), RowStride(0), ColStride(1) {}
+  MatrixView(const float *base, const size_type rows, const size_type cols,
+             const std::ptrdiff_t rowStride, const std::ptrdiff_t colStride = 1)
+    : Base(base), NumRows(rows), NumCols(cols), RowStride(rowStride),
+      ColStride(colStride) {}
+
+  inline size_type rows() const { return NumRows; }
+  inline size_type cols() const { return NumCols; }
+  inline std::ptrdiff_t rowStride() const { return RowStride; }
+  inline std::ptrdiff_t colStride() const { return ColStride; }
+  inline const float *data() const { return Base; }
+  // true when the rows follow one another with no gaps
+  inline bool isContiguous() const {
+    return (ColStride == 1) &&
+      ((NumRows <= 1) || (RowStride == static_cast<std::ptrdiff_t>(NumCols)));
+  }
+
+  inline float operator() (const size_type r, const size_type c) const {
+    return Base[r * RowStride + c * ColStride];
+  }
+
+  inline MatrixView transpose() const {
+    return MatrixView(Base, NumCols, NumRows, ColStride, RowStride);
+  }
+  // numRows x numCols starting at (firstRow, firstCol)
+  inline MatrixView block(const size_type firstRow, const size_type numRows,
+                          const size_type firstCol,
+                          const size_type numCols) const {
+    return MatrixView(Base + firstRow * RowStride + firstCol * ColStride,
+                      numRows, numCols, RowStride, ColStride);
+  }
+  inline DataList copyRow(const size_type r) const {
+    DataList toReturn(NumCols);
+    for (size_type c = 0; c < NumCols; ++c) toReturn[c] = (*this)(r, c);
+    return toReturn;
+  }
+
+ private:
+  const float *Base;
+  size_type NumRows;
+  size_type NumCols;
+  std::ptrdiff_t RowStride;
+  std::ptrdiff_t ColStride;
+};
+
+// DenseMatrix holds what a DataMatrix would, but in a single buffer: row r
+// starts at r * stride(), and rows shorter than the stride are followed by
+// zeros. Rows are handed out as light proxies that read like a DataList, so
+// code written against a DataMatrix (size(), [t][n], ->size(), ->at(n),
+// begin()/end() over rows) compiles unchanged against a DenseMatrix.
+class DenseMatrix {
+ public:
+  typedef unsigned int size_type;
+
+  // One row, standing in for a const DataList &
+  class ConstRow {
+   public:
+    typedef float value_type;
+    typedef const float *const_iterator;
+    typedef DenseMatrix::size_type size_type;
+
+    ConstRow(): First(0), Len(0) {}
+    ConstRow(const float *first, const size_type len): First(first), Len(len) {}
+    // Adaptor for code that needs a DataList of its own
+    inline operator DataList() const { return DataList(First, First + Len); }
+
+    inline size_type size() const { return Len; }
+    inline bool empty() const { return Len == 0; }
+    inline const_iterator begin() const { return First; }
+    inline const_iterator end() const { return First + Len; }
+    inline float front() const { return First[0]; }
+    inline float back() const { return First[Len - 1]; }
+#if defined(CHECK_BOUNDS)
+    inline float operator[] (const size_type n) const { return at(n); }
+#else
+    inline float operator[] (const size_type n) const { return First[n]; }
+#endif
+    inline float at(const size_type n) const {
+      if (n >= Len) throw std::out_of_range("DenseMatrix row index");
+      return First[n];
+    }
+
+   private:
+    const float *First;
+    size_type Len;
+  };
+
+  // One row whose elements may be changed (but not its length)
+  class Row {
+   public:
+    typedef float value_type;
+    typedef float *iterator;
+    typedef DenseMatrix::size_type size_type;
+
+    Row(float *first, const size_type len): First(first), Len(len) {}
+    inline operator ConstRow() const { return ConstRow(First, Len); }
+    inline operator DataList() const { return DataList(First, First + Len); }
+
+    inline size_type size() const { return Len; }
+    inline bool empty() const { return Len == 0; }
+    inline iterator begin() const { return First; }
+    inline iterator end() const { return First + Len; }
+    inline float &front() const { return First[0]; }
+    inline float &back() const { return First[Len - 1]; }
+#if defined(CHECK_BOUNDS)
+    inline float &operator[] (const size_type n) const { return at(n); }
+#else
+    inline float &operator[] (const size_type n) const { return First[n]; }
+#endif
+    inline float &at(const size_type n) const {
+      if (n >= Len) throw std::out_of_range("DenseMatrix row index");
+      return First[n];
+    }
+
+   private:
+    float *First;
+    size_type Len;
+  };
+
+  typedef ConstRow value_type;
+
+  // Walks the rows; it->size() and (*it)[n] work as for a DataMatrixCIt
+  class const_iterator {
+   public:
+    const_iterator(): Mtx(0), Ndx(0) {}
+    const_iterator(const DenseMatrix *mtx, const size_type ndx)
+      : Mtx(mtx), Ndx(ndx) {}
+    inline ConstRow operator* () const { return (*Mtx)[Ndx]; }
+    inline const ConstRow *operator-> () const {
+      Current = (*Mtx)[Ndx];
+      return &Current;
+    }
+    inline const_iterator &operator++ () { ++Ndx; return *this; }
+    inline const_iterator operator++ (int) {
+      const_iterator old = *this;
+      ++Ndx;
+      return old;
+    }
+    inline const_iterator &operator-- () { --Ndx; return *this; }
+    inline const_iterator operator+ (const int n) const {
+      return const_iterator(Mtx, Ndx + n);
+    }
+    inline const_iterator &operator+= (const int n) { Ndx += n; return *this; }
+    inline std::ptrdiff_t operator- (const const_iterator &other) const {
+      return static_cast<std::ptrdiff_t>(Ndx) - other.Ndx;
+    }
+    inline bool operator== (const const_iterator &other) const {
+      return Ndx == other.Ndx;
+    }
+    inline bool operator!= (const const_iterator &other) const {
+      return Ndx != other.Ndx;
+    }
+
+   private:
+    const DenseMatrix *Mtx;
+    size_type Ndx;
+    mutable ConstRow Current;
+  };
+
+  DenseMatrix(): Stride(0) {}
+  DenseMatrix(const size_type rows, const size_type cols,
+              const float value = 0.0f)
+    : Data(static_cast<std::size_t>(rows) * cols, value),
+      Lengths(rows, cols), Stride(cols) {}
+  // Adaptors to and from the vector-of-rows form
+  explicit DenseMatrix(const DataMatrix &mtx): Stride(0) { *this = mtx; }
+  explicit DenseMatrix(const MatrixView &view)
+    : Data(static_cast<std::size_t>(view.rows()) * view.cols()),
+      Lengths(view.rows(), view.cols()), Stride(view.cols()) {
+    for (size_type r = 0; r < view.rows(); ++r) {
+      for (size_type c = 0; c < view.cols(); ++c) {
+        Data[r * Stride + c] = view(r, c);
+      }
+    }
+  }
+  DenseMatrix &operator= (const DataMatrix &mtx) {
+    size_type maxLen = 0;
+    for (DataMatrixCIt it = mtx.begin(); it != mtx.end(); ++it) {
+      maxLen = std::max(maxLen, static_cast<size_type>(it->size()));
+    }
+    Stride = maxLen;
+    Lengths.assign(mtx.size(), 0);
+    Data.assign(static_cast<std::size_t>(mtx.size()) * Stride, 0.0f);
+    for (size_type r = 0; r < mtx.size(); ++r) {
+      Lengths[r] = mtx[r].size();
+      std::copy(mtx[r].begin(), mtx[r].end(), Data.begin() + r * Stride);
+    }
+    return *this;
+  }
+  DataMatrix toDataMatrix() const {
+    DataMatrix toReturn(size());
+    for (size_type r = 0; r < size(); ++r) toReturn[r] = (*this)[r];
+    return toReturn;
+  }
+
+  inline size_type size() const { return Lengths.size(); }
+  inline bool empty() const { return Lengths.empty(); }
+  inline size_type stride() const { return Stride; }
+  inline size_type maxRowSize() const {
+    size_type maxLen = 0;
+    for (size_type r = 0; r < size(); ++r) maxLen = std::max(maxLen, Lengths[r]);
+    return maxLen;
+  }
+  inline bool isRectangular() const {
+    for (size_type r = 1; r < size(); ++r) {
+      if (Lengths[r] != Lengths[0]) return false;
+    }
+    return true;
+  }
+  inline const float *data() const { return Data.empty() ? 0 : &Data[0]; }
+
+  inline ConstRow operator[] (const size_type r) const {
+    return ConstRow(data() + static_cast<std::size_t>(r) * Stride, Lengths[r]);
+  }
+  inline Row operator[] (const size_type r) {
+    return Row(Data.empty() ? 0 : &Data[static_cast<std::size_t>(r) * Stride],
+               Lengths[r]);
+  }
+  inline ConstRow front() const { return (*this)[0]; }
+  inline ConstRow back() const { return (*this)[size() - 1]; }
+  inline const_iterator begin() const { return const_iterator(this, 0); }
+  inline const_iterator end() const { return const_iterator(this, size()); }
+
+  // The whole matrix as rows x maxRowSize(), short rows read as zero-padded
+  inline MatrixView view() const {
+    return MatrixView(data(), size(), maxRowSize(), Stride);
+  }
+
+  void clear() {
+    Data.clear();
+    Lengths.clear();
+    Stride = 0;
+  }
+  void swap(DenseMatrix &other) {
+    Data.swap(other.Data);
+    Lengths.swap(other.Lengths);
+    std::swap(Stride, other.Stride);
+  }
+  // Makes room for rows of up to rowLen elements, numRows in all
+  void reserve(const size_type numRows, const size_type rowLen) {
+    if (rowLen > Stride) restride(rowLen);
+    Data.reserve(static_cast<std::size_t>(numRows) * Stride);
+  }
+  // Appends a row of len zeros and returns it for filling in
+  Row addRow(const size_type len) {
+    if (len > Stride) restride(len);
+    Data.resize(Data.size() + Stride, 0.0f);
+    Lengths.push_back(len);
+    return (*this)[size() - 1];
+  }
+  // row must not be part of this matrix
+  void push_back(const ConstRow &row) {
+    std::copy(row.begin(), row.end(), addRow(row.size()).begin());
+  }
+  void push_back(const DataList &row) {
+    push_back(ConstRow(row.empty() ? 0 : &row[0], row.size()));
+  }
+  // Adds one element to the end of row r. The stride grows geometrically,
+  // so a matrix built a column at a time is not copied for every column.
+  void append(const size_type r, const float value) {
+    if (Lengths[r] == Stride) restride(std::max(2 * Stride, 4U));
+    Data[static_cast<std::size_t>(r) * Stride + Lengths[r]] = value;
+    ++Lengths[r];
+  }
+  // Gives back the spare room left by append
+  void shrinkToFit() {
+    if (maxRowSize() != Stride) restride(maxRowSize());
+  }
+
+ private:
+  void restride(const size_type newStride) {
+    std::vector<float> newData(static_cast<std::size_t>(size()) * newStride,
+                               0.0f);
+    for (size_type r = 0; r < size(); ++r) {
+      const std::size_t keep = std::min(Lengths[r], newStride);
+      std::copy(Data.begin() + r * Stride, Data.begin() + r * Stride + keep,
+                newData.begin() + r * newStride);
+    }
+    Data.swap(newData);
+    Stride = newStride;
+  }
+
+  std::vector<float> Data;
+  std::vector<size_type> Lengths;
+  size_type Stride;
+};
+
+// As UISeqToMatrix(seqIn, defaultNi), row for row
+inline void UISeqToMatrix(const UIPtnSequence &seqIn, DenseMatrix &mtxOut,
+                          const unsigned int defaultNi = 0) {
+  unsigned int maxLen = defaultNi;
+  for (UIPtnSequenceCIt it = seqIn.begin(); it != seqIn.end(); ++it) {
+    if (!it->empty()) updateMax(maxLen, it->back() + 1);
+  }
+  mtxOut.clear();
+  mtxOut.reserve(seqIn.size(), maxLen);
+  for (UIPtnSequenceCIt it = seqIn.begin(); it != seqIn.end(); ++it) {
+    // assumes the pattern is sorted
+    const unsigned int rowLen =
+      std::max(it->empty() ? 0 : (it->back() + 1), defaultNi);
+    DenseMatrix::Row row = mtxOut.addRow(rowLen);
+    for (UIVectorCIt nrn = it->begin(); nrn != it->end(); ++nrn) {
+      row[*nrn] = 1.0f;
+    }
+  }
+}
+
+inline UIPtnSequence MatrixToUISeq(const DenseMatrix &mtxIn) {
+  UIPtnSequence toReturn(mtxIn.size());
+  for (unsigned int t = 0; t < mtxIn.size(); ++t) {
+    const DenseMatrix::ConstRow row = mtxIn[t];
+    for (unsigned int i = 0; i < row.size(); ++i) {
+      if (fabs(row[i]) > verySmallFloat) toReturn[t].push_back(i);
+    }
+  }
+  return toReturn;
+}
+
+#endif  // DENSEMATRIX_HPP
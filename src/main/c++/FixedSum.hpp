@@ -0,0 +1,87 @@
+/***************************************************************************
+ * FixedSum.hpp
+ *
+ *  Sums whose value does not depend on the order in which the terms are
+ *  added, so that bus lines come out the same however the work is split
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#if !defined(FIXEDSUM_HPP)
+#define FIXEDSUM_HPP
+
+#include <cmath>
+#include <stdint.h>
+#include <vector>
+
+// Each term is rounded to a multiple of 2^-32 and added as a 64-bit
+// integer. Integer addition is associative, so any split of the terms
+// among threads or nodes, summed in any order, gives the same bits. The
+// rounding (about 2e-10) is well below a float's precision near 1, and
+// totals of magnitude up to 2^31 fit. The cost is a multiply and a
+// rounding per term and twice the memory of a float bus.
+typedef int64_t FixedSum;
+
+inline FixedSum toFixedSum(const double x) {
+  return static_cast<FixedSum>(std::floor(x * 4294967296.0 + 0.5));
+}
+
+inline float fromFixedSum(const FixedSum x) {
+  return static_cast<float>(static_cast<double>(x) / 4294967296.0);
+}
+
+// Stands in for a DataList bus: bus[i] += x works on either
+class FixedBus {
+ public:
+  class Element {
+   public:
+    explicit Element(FixedSum &sum) : Sum(sum) { }
+    Element &operator+=(const double x) {
+      Sum += toFixedSum(x);
+      return *this;
+    }
+   private:
+    FixedSum &Sum;
+  };
+
+  FixedBus() { }
+  // Sets n elements to zero
+  void assign(const unsigned int n) { Sums.assign(n, 0); }
+  unsigned int size() const { return Sums.size(); }
+  Element operator[](const unsigned int i) { return Element(Sums[i]); }
+  // Adds other's elements first..end-1 into this bus
+  void add(const FixedBus &other, const unsigned int first,
+           const unsigned int end) {
+    for (unsigned int i = first; i < end; ++i) Sums[i] += other.Sums[i];
+  }
+  // As add, but also zeroes other's elements first..end-1
+  void take(FixedBus &other, const unsigned int first, const unsigned int end) {
+    for (unsigned int i = first; i < end; ++i) {
+      Sums[i] += other.Sums[i];
+      other.Sums[i] = 0;
+    }
+  }
+  void copyTo(std::vector<float> &bus) const {
+    bus.resize(Sums.size());
+    for (unsigned int i = 0; i < Sums.size(); ++i) bus[i] = fromFixedSum(Sums[i]);
+  }
+  // For summing over compute nodes
+  std::vector<FixedSum> &getSums() { return Sums; }
+
+ private:
+  std::vector<FixedSum> Sums;
+};
+#endif  // FIXEDSUM_HPP
@@ -23,14 +23,16 @@
 #include <algorithm>
 #include <cstddef>
 #include <functional>
+#include <numeric>
 #include <vector>
 
 template <typename T>
 class MatrixMeanHelper: public std::unary_function<T, void> {
  public:
   MatrixMeanHelper(): denominator(0), numerator(0) { }
-  void operator() (const std::vector<T>& d) {
-    numerator += accumulate(d.begin(), d.end(), T(0));
+  template <class Row>
+  void operator() (const Row& d) {
+    numerator += std::accumulate(d.begin(), d.end(), T(0));
     denominator += d.size();
   }
   long double result() const {
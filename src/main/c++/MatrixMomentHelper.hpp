@@ -24,6 +24,7 @@
 #include <cmath>
 #include <cstddef>
 #include <functional>
+#include <numeric>
 #include <vector>
 
 template <typename T>
@@ -45,8 +46,9 @@ class MatrixMomentHelper: public std::unary_function<T, void> {
  public:
   MatrixMomentHelper(T a, double m)
     : denominator(0), numerator(0), avg(a), moment(m) { }
-  void operator() (const std::vector<T>& d) {
-    numerator += accumulate(d.begin(), d.end(), T(0),
+  template <class Row>
+  void operator() (const Row& d) {
+    numerator += std::accumulate(d.begin(), d.end(), T(0),
                             MatrixMomentInnerHelper<T>(avg, moment));
     denominator += d.size();
   }
@@ -21,6 +21,7 @@
 #define MATRIXSSHELPER_HPP
 
 #include <functional>
+#include <numeric>
 #include <algorithm>
 #include <cstddef>
 #include <cmath>
@@ -40,8 +41,9 @@ template <typename T>
 class MatrixSSHelper: public std::unary_function<T, void> {
  public:
   MatrixSSHelper(): denominator(0), numerator(0) { }
-  void operator() (const std::vector<T>& d) {
-    numerator += accumulate(d.begin(), d.end(), T(0), MatrixSSInnerHelper<T>());
+  template <class Row>
+  void operator() (const Row& d) {
+    numerator += std::accumulate(d.begin(), d.end(), T(0), MatrixSSInnerHelper<T>());
     denominator += d.size();
   }
   long double result() const {
@@ -53,15 +53,24 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdio>
 #include <limits>
 #include <map>
+#include <set>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <vector>
+#if !defined(WIN32)
+#  include <sys/types.h>
+#  include <sys/wait.h>
+#  include <unistd.h>
+#endif
 
 #if defined(TIMING_P2P)
 int trials;
 double total_time;
+double total_overlap;
 #endif
 
 // TIMING_MODE => TIMING_MODE3
@@ -77,6 +86,9 @@ double total_time;
 #if !defined(NEUROJET_HPP)
 #  include "NeuroJet.hpp"
 #endif
+#if !defined(ASYNCWRITER_HPP)
+#  include "AsyncWriter.hpp"
+#endif
 #if !defined(CALC_HPP)
 #  include "Calc.hpp"
 #endif
@@ -86,9 +98,6 @@ double total_time;
 #if !defined(POPULATION_HPP)
 #  include "Population.hpp"
 #endif
-// #if !defined(STATE_HPP)
-// #  include "State.hpp"
-// #endif
 #if !defined(AXONALSYNAPSE_HPP)
 #   include "neural/AxonalSynapse.hpp"
 #endif
@@ -235,6 +244,7 @@ int neurojet_main(int argc, char * argv[]) {
 
   // Parse the input file
   Parser::ParseScript(SystemVar::GetStrVar("InputFile"));
+  AsyncWriter::flush();
 
 #if defined(TIMING_MODE3)
 #   if defined(MULTIPROC)
@@ -258,6 +268,8 @@ int neurojet_main(int argc, char * argv[]) {
                 << ttl_rng_buck_empty << std::endl;
 #endif
 
+  program::Main().printPrefetchStats();
+
 #if defined(RNG_BUCK_TIMING)
   Output::Out() << MSG << "Elapsed total_rng_buck time = "
                 << rng_elapsed_buck / TICKS_PER_SEC << " seconds" << std::endl;
@@ -324,6 +336,15 @@ void InitializeProgram() {
 
   // Set default values
   SystemVar::AddIntVar("seed", 1);
+  SystemVar::AddStrVar("RNGType", "TT800");
+  SystemVar::AddStrVar("NormalMethod", "BoxMuller");
+  SystemVar::AddIntVar("RNGPrefetch", 0);
+  SystemVar::AddIntVar("SpikeExchange", 0);  // MULTIPROC only
+  SystemVar::AddStrVar("Partition", "even");  // MULTIPROC only
+  SystemVar::AddIntVar("Rebalance", 0);       // MULTIPROC only
+  SystemVar::AddIntVar("Threads", 1);
+  SystemVar::AddIntVar("SweepIndex", 0);      // set in @Sweep workers
+  SystemVar::AddIntVar("ReproSum", 0);
   SystemVar::AddIntVar("ni", 3500);
   SystemVar::AddFloatVar("wStart", 0.4f);
   SystemVar::AddFloatVar("ZeroCutOff", 0.001f);
@@ -508,16 +529,22 @@ void InitializeProgram() {
   SystemVar::AddAtFun("ExportVars", ExportVars);
   SystemVar::AddAtFun("FileReset", FileReset);
   SystemVar::AddAtFun("LoadData", LoadData);
+  SystemVar::AddAtFun("LoadState", LoadState);
   SystemVar::AddAtFun("MakeRandSequence", MakeRandSequence);
   SystemVar::AddAtFun("MakeSequence", MakeSequence);
+  SystemVar::AddAtFun("ReadSpikeLog", ReadSpikeLog);
+  SystemVar::AddAtFun("ReadWeightHistory", ReadWeightHistory);
+  SystemVar::AddAtFun("Record", Record);
   SystemVar::AddAtFun("ResetFiring", ResetFiring);
   SystemVar::AddAtFun("SaveData", SaveData);
+  SystemVar::AddAtFun("SaveState", SaveState);
   SystemVar::AddAtFun("SaveWeights", SaveWeights);
   SystemVar::AddAtFun("SeedRNG", SeedRNG);
   SystemVar::AddAtFun("SetLoopVar", SetLoopVar);
   SystemVar::AddAtFun("SetStream", SetStream);
   SystemVar::AddAtFun("SetVar", SetVar);
   SystemVar::AddAtFun("Sim", Sim);
+  SystemVar::AddAtFun("Sweep", Sweep);
   SystemVar::AddAtFun("Test", Test);
   SystemVar::AddAtFun("Train", Train);
 
@@ -656,7 +683,7 @@ void PopulatePopulation(const string& globalProps, const string& neuronProps,
       }
       unsigned int numConnForNeur = 0;
       for (unsigned int j = 0; j < FanInCon[i]; ++j) {
-        if (isLocalNeuron(SHUFFLEIFMULTIPROC(from_string<unsigned int>(cSubVec[j]))))
+        if (isLocalSynapse(SHUFFLEIFMULTIPROC(from_string<unsigned int>(cSubVec[j])), shuffRow))
           ++numConnForNeur;
       }
       inMatrix[shuffRow] = new DendriticSynapse[numConnForNeur];
@@ -664,7 +691,7 @@ void PopulatePopulation(const string& globalProps, const string& neuronProps,
       unsigned int curConnHere = 0;
       for (unsigned int j = 0; j < FanInCon[i]; ++j) {
         unsigned int afferentN = SHUFFLEIFMULTIPROC(from_string<unsigned int>(cSubVec[j])-1);
-        if (isLocalNeuron(afferentN)) {
+        if (isLocalSynapse(afferentN, shuffRow)) {
           dendriticTree[curConnHere].setSrcNeuron(afferentN);
           float affW = from_string<float>(wSubVec[j]);
           dendriticTree[curConnHere].setWeight(affW);
@@ -894,6 +921,16 @@ void CalcDendriticExcitation() {
   enqueueDendriticResponse(dendExc, sumwz_inhdiv, sumwz_inhsub);
 }
 
+// Interneuron excitation for this time step depends only on the last
+// time step's firing and the current input
+void CalcInternrnInhibition(const xInput &curPattern) {
+  for (PopulationIt pIt = Population::Member.begin();
+       pIt != Population::Member.end(); ++pIt) {
+    pIt->calcNewFeedbackInhibition(Fired[justNow]);
+    pIt->calcNewFeedforwardInhibition(curPattern);
+  }
+}
+
 void CalcSomaDecay() {
   // FLEX: Other decay options exist
   for (PopulationCIt PCIt = Population::Member.begin();
@@ -1147,6 +1184,116 @@ void CalcSomaResponse(const xInput &curPattern, DataMatrix &IzhVValues,
   }
 }
 
+// Activates the outgoing synapses of the neurons in FiredArray that are
+// numbered firstN..endN-1, summing into the given buses
+template <class Bus>
+void ActivateFired(const UIVectorDeque &FiredArray, const unsigned int firstN,
+                   const unsigned int endN, Bus &bus, Bus &bus_inhdiv,
+                   Bus &bus_inhsub, Noise &noise) {
+  const bool synStreams = noise.IsCounterBased();
+  for (unsigned int relTime = minAxonalDelay-1; relTime < maxAxonalDelay; ++relTime) {
+    const UIVector &fired = FiredArray[relTime];
+    for (unsigned int i = 0; i < fired.size(); i++) {
+      const unsigned int iFire = fired[i];
+      if ((iFire < firstN) || (iFire >= endN)) continue;
+      AxonalSynapse * axonalSegment = outMatrix[iFire][relTime];
+      const unsigned int lastC = FanOutCon[iFire][relTime];
+      if (synStreams) noise.SetStream(iFire, timeStep, relTime);
+#if defined(MULTIPROC)
+      NeuronWork[iFire] += lastC;
+#endif
+      for (unsigned int c = 0; c < lastC; c++) {
+        axonalSegment[c].activate(bus, bus_inhdiv, bus_inhsub, timeStep, noise);
+      }
+    }
+  }
+}
+
+// State shared by the workers of a threaded CalcSynapticActivation.
+// Worker w activates the synapses of presynaptic neurons
+// FirstNeuron[w]..FirstNeuron[w+1]-1; worker 0 sums straight into sumwz
+// (or the FixedSumwz buses with ReproSum) and the others into their own.
+// The buses last from one time step to the next: they are sized when
+// Threads or ni changes, and SynActReduce leaves them zeroed.
+struct SynActJob {
+  SynActJob() : FiredArray(NULL) { }
+  void resize(const unsigned int numWorkers) {
+    if ((FirstNeuron.size() == numWorkers + 1) && (FirstNeuron.back() == ni)) return;
+    FirstNeuron = partitionEvenly(ni, numWorkers);
+    Bus.assign(numWorkers, DataList());
+    BusInhDiv.assign(numWorkers, DataList());
+    BusInhSub.assign(numWorkers, DataList());
+    Fixed.assign(numWorkers, FixedBus());
+    FixedInhDiv.assign(numWorkers, FixedBus());
+    FixedInhSub.assign(numWorkers, FixedBus());
+    for (unsigned int w = 1; w < numWorkers; ++w) {
+      Bus[w].assign(ni, 0.0f);
+      BusInhDiv[w].assign(ni, 0.0f);
+      BusInhSub[w].assign(ni, 0.0f);
+      Fixed[w].assign(ni);
+      FixedInhDiv[w].assign(ni);
+      FixedInhSub[w].assign(ni);
+    }
+    WorkerNoise.resize(numWorkers);
+  }
+  const UIVectorDeque *FiredArray;
+  UIVector FirstNeuron;
+  DataMatrix Bus;
+  DataMatrix BusInhDiv;
+  DataMatrix BusInhSub;
+  vector<FixedBus> Fixed;
+  vector<FixedBus> FixedInhDiv;
+  vector<FixedBus> FixedInhSub;
+  vector<Noise> WorkerNoise;
+};
+SynActJob SynAct;
+
+void SynActWorker(const unsigned int worker, void *arg) {
+  SynActJob &job = *static_cast<SynActJob *>(arg);
+  Noise &noise = job.WorkerNoise[worker];
+  const unsigned int firstN = job.FirstNeuron[worker];
+  const unsigned int endN = job.FirstNeuron[worker + 1];
+  if (ReproSum) {
+    FixedBus &bus = worker ? job.Fixed[worker] : FixedSumwz;
+    FixedBus &bus_inhdiv = worker ? job.FixedInhDiv[worker] : FixedSumwz_inhdiv;
+    FixedBus &bus_inhsub = worker ? job.FixedInhSub[worker] : FixedSumwz_inhsub;
+    ActivateFired(*job.FiredArray, firstN, endN, bus, bus_inhdiv, bus_inhsub, noise);
+  } else {
+    DataList &bus = worker ? job.Bus[worker] : sumwz;
+    DataList &bus_inhdiv = worker ? job.BusInhDiv[worker] : sumwz_inhdiv;
+    DataList &bus_inhsub = worker ? job.BusInhSub[worker] : sumwz_inhsub;
+    ActivateFired(*job.FiredArray, firstN, endN, bus, bus_inhdiv, bus_inhsub, noise);
+  }
+}
+
+// Adds the other workers' buses into sumwz, each worker taking its own
+// range of postsynaptic neurons and zeroing it for the next time step;
+// the order of the sums is fixed, so results only depend on the number
+// of workers (and not even on that with ReproSum)
+void SynActReduce(const unsigned int worker, void *arg) {
+  SynActJob &job = *static_cast<SynActJob *>(arg);
+  const unsigned int firstN = job.FirstNeuron[worker];
+  const unsigned int endN = job.FirstNeuron[worker + 1];
+  if (ReproSum) {
+    for (unsigned int w = 1; w < job.Fixed.size(); ++w) {
+      FixedSumwz.take(job.Fixed[w], firstN, endN);
+      FixedSumwz_inhdiv.take(job.FixedInhDiv[w], firstN, endN);
+      FixedSumwz_inhsub.take(job.FixedInhSub[w], firstN, endN);
+    }
+    return;
+  }
+  for (unsigned int nrn = firstN; nrn < endN; ++nrn) {
+    for (unsigned int w = 1; w < job.Bus.size(); ++w) {
+      sumwz[nrn] += job.Bus[w][nrn];
+      sumwz_inhdiv[nrn] += job.BusInhDiv[w][nrn];
+      sumwz_inhsub[nrn] += job.BusInhSub[w][nrn];
+      job.Bus[w][nrn] = 0.0f;
+      job.BusInhDiv[w][nrn] = 0.0f;
+      job.BusInhSub[w][nrn] = 0.0f;
+    }
+  }
+}
+
 void CalcSynapticActivation(const UIVectorDeque &FiredArray, const Pattern &inPattern) {
   CalcSynapticActivation(FiredArray, xInput(ni, inPattern));
 }
@@ -1155,6 +1302,7 @@ void CalcSynapticActivation(const UIVectorDeque &FiredArray, const xInput &curPa
   SYNFAILS_DEBUG_MODE_INIT
     // Initialize firing time matrix for Z0
     if (timeStep == 0) {
+      if (!TestUndoAxons.empty()) SaveLastActivates();
       for (unsigned int i = 0; i < ni; i++) {
         DendriticSynapse * dendriticTree = inMatrix[i];
         for (unsigned int c = 0; c < FanInCon[i]; ++c)
@@ -1163,30 +1311,58 @@ void CalcSynapticActivation(const UIVectorDeque &FiredArray, const xInput &curPa
     }
 
   // reset Sumwz's to all zeroes
-  sumwz = DataList(ni, 0.0f);
-  sumwz_inhdiv = DataList(ni, 0.0f);
-  sumwz_inhsub = DataList(ni, 0.0f);
+  sumwz.assign(ni, 0.0f);
+  sumwz_inhdiv.assign(ni, 0.0f);
+  sumwz_inhsub.assign(ni, 0.0f);
+  if (ReproSum) {
+    FixedSumwz.assign(ni);
+    FixedSumwz_inhdiv.assign(ni);
+    FixedSumwz_inhsub.assign(ni);
+  }
 
+  if (!TestUndoAxons.empty()) SaveFiredAxons(FiredArray);
   // RNGs were initiated during CreateNetwork
   InitCurBucketStats();  // Typically does nothing
-  // For each possible time-step back
-  //   #pragma omp parallel for
-  for (unsigned int relTime = minAxonalDelay-1; relTime < maxAxonalDelay; ++relTime) {
-    // for each neuron on this compute node that fired
-    for (unsigned int i = 0; i < FiredArray[relTime].size(); i++) {
-      const int iFire = FiredArray[relTime][i];
-      AxonalSynapse * axonalSegment = outMatrix[iFire][relTime];
-      // for every outgoing connection of this neuron
+  const bool synStreams = DendriticSynapse::SynNoise.IsCounterBased();
+  if (synStreams && (Workers.size() > 1)) {
+    // The workers split the fired neurons between them as the compute
+    // nodes do, each summing into buses of its own
+    SynAct.resize(Workers.size());
+    SynAct.FiredArray = &FiredArray;
+    // Every fired neuron has its own stream, so each worker's Noise only
+    // needs the key to draw the same numbers
+    for (unsigned int w = 0; w < Workers.size(); ++w)
+      SynAct.WorkerNoise[w].ShareStreams(DendriticSynapse::SynNoise);
+    Workers.run(SynActWorker, &SynAct);
+    Workers.run(SynActReduce, &SynAct);
+  } else if (ReproSum) {
+    ActivateFired(FiredArray, 0, ni, FixedSumwz, FixedSumwz_inhdiv,
+                  FixedSumwz_inhsub, DendriticSynapse::SynNoise);
+  } else {
+    // For each possible time-step back
+    //   #pragma omp parallel for
+    for (unsigned int relTime = minAxonalDelay-1; relTime < maxAxonalDelay; ++relTime) {
+      // for each neuron on this compute node that fired
+      for (unsigned int i = 0; i < FiredArray[relTime].size(); i++) {
+        const int iFire = FiredArray[relTime][i];
+        AxonalSynapse * axonalSegment = outMatrix[iFire][relTime];
+        // for every outgoing connection of this neuron
 #if defined(CHECK_BOUNDS)
-      const unsigned int lastC = FanOutCon.at(iFire).at(relTime);
+        const unsigned int lastC = FanOutCon.at(iFire).at(relTime);
 #else
-      const unsigned int lastC = FanOutCon[iFire][relTime];
+        const unsigned int lastC = FanOutCon[iFire][relTime];
 #endif
-      for (unsigned int c = 0; c < lastC; c++) {
-        // Updates sumwz and synpatic information
-        axonalSegment[c].activate(sumwz, sumwz_inhdiv, sumwz_inhsub, timeStep);
-        SYNFAILS_DEBUG_MODE_INC
-          }
+        // Failures of this axonal segment then depend only on who fired when
+        if (synStreams) DendriticSynapse::SynNoise.SetStream(iFire, timeStep, relTime);
+#if defined(MULTIPROC)
+        NeuronWork[iFire] += lastC;
+#endif
+        for (unsigned int c = 0; c < lastC; c++) {
+          // Updates sumwz and synpatic information
+          axonalSegment[c].activate(sumwz, sumwz_inhdiv, sumwz_inhsub, timeStep);
+          SYNFAILS_DEBUG_MODE_INC
+            }
+      }
     }
   }
   UpdateMaxBucketStats();  // Typically does nothing
@@ -1198,11 +1374,26 @@ void CalcSynapticActivation(const UIVectorDeque &FiredArray, const xInput &curPa
     const float ExtExc = PCIt->getNeuronType()->getParameter("ExtExc", SystemVar::GetFloatVar("ExtExc"));
     if (ExtExc > 0) {
       for (unsigned int nrn = PCIt->getFirstNeuron(); nrn <= PCIt->getLastNeuron(); ++nrn) {
-        if (curPattern[nrn])
-          sumwz[nrn] += ExtExc;
+        if (curPattern[nrn]) {
+          if (ReproSum)
+            FixedSumwz[nrn] += ExtExc;
+          else
+            sumwz[nrn] += ExtExc;
+        }
       }
     }
   }
+
+  if (ReproSum) {
+#if defined(PEER_TO_PEER)
+    // Summed over the nodes here, as integers, rather than in Present
+    if (!SpikeExchange)
+      ParallelInfo::sumFixedBuses(FixedSumwz, FixedSumwz_inhdiv, FixedSumwz_inhsub);
+#endif
+    FixedSumwz.copyTo(sumwz);
+    FixedSumwz_inhdiv.copyTo(sumwz_inhdiv);
+    FixedSumwz_inhsub.copyTo(sumwz_inhsub);
+  }
 }
 
 bool chkDataExists(const TArg<string> &DataName, const DataListType newDataType,
@@ -1261,10 +1452,11 @@ void CompPresent(const xInput &curPattern, const bool modifyExcWeights) {
   sumwz_inhdiv = ParallelInfo::rcvSumwz();
   sumwz_inhsub = ParallelInfo::rcvSumwz();
 #  else
-  // Exchange and sum sumwz among nodes
-  sumwz = ParallelInfo::exchangeSumwz(sumwz);
-  sumwz_inhdiv = ParallelInfo::exchangeSumwz(sumwz_inhdiv);
-  sumwz_inhsub = ParallelInfo::exchangeSumwz(sumwz_inhsub);
+  // Exchange and sum sumwz among nodes, decaying the somas meanwhile
+  if (!SpikeExchange && !ReproSum)
+    ParallelInfo::startExchangeSumwz(sumwz, sumwz_inhdiv, sumwz_inhsub);
+  CalcSomaDecay();
+  if (!SpikeExchange && !ReproSum) ParallelInfo::finishExchangeSumwz();
 #  endif
 #endif
 
@@ -1274,7 +1466,9 @@ void CompPresent(const xInput &curPattern, const bool modifyExcWeights) {
   // increment the time step
   ++timeStep;
 
+#if !defined(PEER_TO_PEER)
   CalcSomaDecay();
+#endif
   CalcDendriticToSomaInput(curPattern, true);
 
   // Get ready for firing
@@ -1292,6 +1486,10 @@ void CompPresent(const xInput &curPattern, const bool modifyExcWeights) {
   int TotalNumFired = Fired[justNow].size();
 
   unsigned int numLeft2Fire = numToFire - TotalNumFired;
+#if defined(MULTIPROC)
+  // Only this node's own neurons have complete excitation
+  if (SpikeExchange) ExchangeCandidates(excSort, numLeft2Fire);
+#endif
   float cutOff = selectCutOff(numLeft2Fire, excSort.size(), excSort);
   Threshold = cutOff;
 
@@ -1360,6 +1558,65 @@ void enqueueDendriticResponse(const DataList& dendriticResponse, const DataList&
   }
 }
 
+#if defined(MULTIPROC)
+// The expected work per time step for each neuron's node: one unit for
+// the soma plus the synapses it activates. Normally that is the neuron's
+// fan-out whenever it fires; with SpikeExchange it is the neuron's fan-in
+// whenever its inputs fire.
+vector<double> EstimateNeuronCosts() {
+  const double meanActivity = SystemVar::GetFloatVar("Activity");
+  const double fanOut = SystemVar::GetFloatVar("Con") * ni;
+  vector<double> cost(ni, 1.0 + fanOut * meanActivity);
+  if (SpikeExchange) return cost;
+  for (PopulationCIt PCIt = Population::Member.begin();
+       PCIt != Population::Member.end(); ++PCIt) {
+    const double activity = PCIt->getNeuronType()->getParameter("Activity", meanActivity);
+    for (unsigned int nrn = PCIt->getFirstNeuron(); nrn <= PCIt->getLastNeuron(); ++nrn) {
+      cost[nrn] = 1.0 + fanOut * activity;
+    }
+  }
+  return cost;
+}
+
+// Replaces this node's candidates for competitive firing with those of all
+// nodes. A node only sends the neurons at or above its own cutoff for
+// numLeft2Fire winners; as the network-wide cutoff can be no lower, the
+// winners and the ties at the cutoff are the same as if every neuron had
+// been sent.
+void ExchangeCandidates(vector<IxSumwz> &excSort, const unsigned int numLeft2Fire) {
+  vector<IxSumwz> local;
+  for (unsigned int i = 0; i < excSort.size(); ++i) {
+    if (isLocalNeuron(excSort[i].ix)) local.push_back(excSort[i]);
+  }
+  UIVector ix;
+  vector<double> y;
+  if ((numLeft2Fire > 0) && !local.empty()) {
+    const unsigned int k = min(numLeft2Fire, static_cast<unsigned int>(local.size()));
+    const double localCutOff = selectCutOff(k, local.size(), local);
+    for (unsigned int i = 0; i < local.size(); ++i) {
+      if (local[i].y > localCutOff - verySmallFloat) {
+        ix.push_back(local[i].ix);
+        y.push_back(local[i].y);
+      }
+    }
+  }
+  ParallelInfo::exchangeCandidates(ix, y);
+  excSort.clear();
+  for (unsigned int i = 0; i < ix.size(); ++i) {
+    excSort.push_back(IxSumwz(ix[i], y[i]));
+  }
+}
+
+// Replaces this time step's firing with that decided by each neuron's node
+void ExchangeFired() {
+  Fired[justNow] = ParallelInfo::exchangeFired(FiredHere[justNow]);
+  zi = Pattern(ni, false);
+  for (UIVectorCIt it = Fired[justNow].begin(); it != Fired[justNow].end(); ++it) {
+    zi[*it] = true;
+  }
+}
+#endif
+
 const NeuronType* findNeuronType(const unsigned int nrn) {
   PopulationCIt PCIt = Population::Member.begin();
   for (; PCIt != Population::Member.end(); ++PCIt)
@@ -1403,6 +1660,17 @@ void FireNonTiedNeurons(const unsigned int numLeft2Fire, const vector<IxSumwz> &
   }
 }
 
+// Puts what a memory or ring sink kept into bufferName
+void FinishRecording(Recorder &rec, const string &bufferName) {
+  DenseMatrix kept;
+  if (rec.finish(kept)) {
+    SystemVar::insertData(bufferName, kept, DLT_matrix);
+  } else if (rec.spec().Sink == Recorder::SINK_FILE) {
+    IFROOTNODE Output::Out() << "Recorded " << rec.numKept() << " time steps of "
+                             << bufferName << " to " << rec.spec().FileName << endl;
+  }
+}
+
 void FireSingleNeuron(const int nrn) {
 #if defined(CHECK_BOUNDS)
   zi.at(nrn) = true;
@@ -1458,11 +1726,10 @@ void FireTiedNeurons(const unsigned int numLeft2Fire, const double cutOff,
   }
 }
 
-vector<xInput> GenerateInputSequence(UIPtnSequence &Seq, const float inputNoise, const float exactNoise,
+vector<xInput> GenerateInputSequence(const PackedSequence &Seq, const float inputNoise, const float exactNoise,
                                      int& SumExtFired, int& PatternCount) {
   vector<xInput> seqToReturn;
   if (Seq.size() > 0) {
-    UIVector pat;
     int defPeriod = SystemVar::GetIntVar("Period");
     int Period = defPeriod;
     float defAmplitude = SystemVar::GetFloatVar("Amplitude");
@@ -1473,8 +1740,8 @@ vector<xInput> GenerateInputSequence(UIPtnSequence &Seq, const float inputNoise,
     float Phase = defPhase;
     bool defUseSin = SystemVar::GetIntVar("UseSin");
     bool UseSin = defUseSin;
-    for (UIPtnSequenceCIt it = Seq.begin(); it != Seq.end(); ++it) {
-      pat = *it;
+    for (PackedSequence::const_iterator it = Seq.begin(); it != Seq.end(); ++it) {
+      const UIVector &pat = *it;
       xInput temp_xin(ni);
       if ((pat.size() > 0) && (pat.back() >= ni)) {
         CALL_ERROR << "Input pattern larger than network\n" << ERR_WHERE;
@@ -1537,7 +1804,11 @@ vector<xInput> GenerateInputSequence(UIPtnSequence &Seq, const float inputNoise,
         }
 
         // *Activity = sucRate * (*ParamActivity);
-        for (UIVectorCIt pIt = pat.begin(); pIt != pat.end(); ++pIt) {
+        // Find each input's rate first so the coins can be flipped together
+        vector<float> sucRates(std::max(pat.size(), size_t(1)));
+        vector<int> succeeded(sucRates.size());
+        unsigned int p = 0;
+        for (UIVectorCIt pIt = pat.begin(); pIt != pat.end(); ++pIt, ++p) {
           if (*pIt == nextFirstNeuron) {
             Period = defPeriod; Amplitude = defAmplitude; MidPoint = defMidPoint;
             Phase = defPhase; UseSin = defUseSin;
@@ -1552,7 +1823,12 @@ vector<xInput> GenerateInputSequence(UIPtnSequence &Seq, const float inputNoise,
                                                           PatternCount / static_cast<double>(Period) + Phase, UseSin);
             }
           }
-          if (program::Main().getExtBernoulli(sucRate)) {
+          sucRates[p] = sucRate;
+        }
+        program::Main().getExtBernoulli(&succeeded[0], &sucRates[0], pat.size());
+        p = 0;
+        for (UIVectorCIt pIt = pat.begin(); pIt != pat.end(); ++pIt, ++p) {
+          if (succeeded[p]) {
             ++SumExtFired;
             temp_xin.turnOn(SHUFFLEIFMULTIPROC(*pIt));
           }
@@ -1566,20 +1842,16 @@ vector<xInput> GenerateInputSequence(UIPtnSequence &Seq, const float inputNoise,
   return seqToReturn;
 }
 
-// i.e., ReadWeights
-void GetConnectivity(const string& filename) {
-  /////////////////////////////////////////////////
-  // Read in connections and weights from file,
-  //   allocating memory for both
-  /////////////////////////////////////////////////
+// Builds the synapses from each neuron's fan-in, in the order of a weight
+// file: conn[i] holds the (unshuffled) pre-synaptic neurons of neuron i,
+// wij[i] their weights and, if aij is not empty, aij[i] their axonal
+// delays. Each node keeps only its own synapses.
+void BuildConnectivity(const UIMatrix &conn, const DataMatrix &wij, const UIMatrix &aij) {
   int  TotalNumberOfZeros = 0;
   float TotalSumOfWeights = 0.0;
   float TotalSumOfZeros = 0.0;
 
-  unsigned int fileni;
-  unsigned int tmpThrowAway;
-  float moreTrash;
-  bool fileHasAxonalDelays = false;
+  const bool hasAxonalDelays = !aij.empty();
 
 #if defined(MULTIPROC)
   int P_NumNetworkCon = 0;
@@ -1587,109 +1859,37 @@ void GetConnectivity(const string& filename) {
   unsigned int MaxInputs = 0;
   NumNetworkCon = 0;
 
-  ifstream chkFile(filename.c_str());
-
-  // Read first line (containing number of neurons)
-  read_without_comments(chkFile, fileni);
-  if (fileni != ni) {
-    CALL_ERROR << "Number of neurons in " << filename
-               << " does not agree with number given in script file!" << ERR_WHERE;
-    exit(EXIT_FAILURE);
-  }
-
-  // Read second (non-blank) line - contains number of fan-in connections for each neuron
-  IFROOTNODE Output::Out() << "Reading in number of connections" << std::endl;
   for (unsigned int i = 0; i < ni; i++) {
     int shuffRow = SHUFFLEIFMULTIPROC(i);
-    if (chkFile.eof()) {
-      CALL_ERROR << "Unexpected EOF while reading " << filename
-                 << " during a search for connection numbers." << ERR_WHERE;
-      exit(EXIT_FAILURE);
-    }
-    read_without_comments(chkFile, FanInCon[shuffRow]);
+    FanInCon[shuffRow] = conn[i].size();
     updateMax(MaxInputs, FanInCon[shuffRow]);
 #if defined(MULTIPROC)
-    if (i < ni)
-      P_NumNetworkCon += FanInCon[shuffRow];
+    P_NumNetworkCon += FanInCon[shuffRow];
 #else
     // For MULTIPROC, NumNetworkCon.. are updated later
     NumNetworkCon += FanInCon[shuffRow];
 #endif
   }
 
-  // Read next ni (non-blank) lines - contains pre-synaptic neurons for each neuron
-  IFROOTNODE Output::Out() << "Scanning pre-synaptic neurons" << std::endl;
-  for (unsigned int conRow = 0; conRow < ni; ++conRow) {
-    for (unsigned int cntCol = 0; cntCol < FanInCon[SHUFFLEIFMULTIPROC(conRow)]; ++cntCol) {
-      if (chkFile.eof()) {
-        CALL_ERROR << "Unexpected EOF while reading " << filename
-                   << " during a search for pre-synaptic neurons." << ERR_WHERE;
-        exit(EXIT_FAILURE);
-      }
-      read_without_comments(chkFile, tmpThrowAway);
-    }
-  }
-
-  // Read next ni (non-blank) lines - contains pre-synaptic weights for each neuron
-  IFROOTNODE Output::Out() << "Scanning pre-synaptic neurons" << std::endl;
-  for (unsigned int conRow = 0; conRow < ni; ++conRow) {
-    for (unsigned int cntCol = 0; cntCol < FanInCon[SHUFFLEIFMULTIPROC(conRow)]; ++cntCol) {
-      if (chkFile.eof()) {
-        CALL_ERROR << "Unexpected EOF while reading " << filename
-                   << " during a search for pre-synaptic weights." << ERR_WHERE;
-        exit(EXIT_FAILURE);
-      }
-      read_without_comments(chkFile, moreTrash);
-    }
-  }
-
-  unsigned int delayHere = 1;
-  read_without_comments(chkFile, delayHere);
-  // Look for axonal delays
-  if (!chkFile.eof()) {
-    IFROOTNODE Output::Out() << "Scanning pre-synaptic axonal delays" << std::endl;
+  if (hasAxonalDelays) {
+    bool firstDelay = true;
     for (unsigned int conRow = 0; conRow < ni; ++conRow) {
-      for (unsigned int cntCol = 0; cntCol < FanInCon[SHUFFLEIFMULTIPROC(conRow)]; ++cntCol) {
-        if (chkFile.eof()) {
-          CALL_ERROR << "Unexpected EOF while reading " << filename
-                     << " during a search for axonal delays." << ERR_WHERE;
-          exit(EXIT_FAILURE);
-        }
-        if (!fileHasAxonalDelays) {
-          minAxonalDelay = delayHere;
-          maxAxonalDelay = delayHere;
-          fileHasAxonalDelays = true;
-        } else if (delayHere < minAxonalDelay) {
-          minAxonalDelay = delayHere;
-        } else if (maxAxonalDelay < delayHere) {
-          maxAxonalDelay = delayHere;
+      for (UIVectorCIt it = aij[conRow].begin(); it != aij[conRow].end(); ++it) {
+        if (firstDelay) {
+          minAxonalDelay = *it;
+          maxAxonalDelay = *it;
+          firstDelay = false;
+        } else if (*it < minAxonalDelay) {
+          minAxonalDelay = *it;
+        } else if (maxAxonalDelay < *it) {
+          maxAxonalDelay = *it;
         }
-        read_without_comments(chkFile, delayHere);
       }
     }
   }
 
-  chkFile.close();
-
   FanOutCon.assign(ni, UIVector(maxAxonalDelay, 0));
 
-  ifstream inFile(filename.c_str());
-  ifstream inFileDelays(filename.c_str());  // So we can compare two lines at once
-  if (!inFile) {
-    CALL_ERROR << "Could not open file " << filename << " for reading." << ERR_WHERE;
-    exit(EXIT_FAILURE);
-  }
-
-  // Re-scan the first line (number of neurons)
-  read_without_comments(inFile, tmpThrowAway);
-  read_without_comments(inFileDelays, tmpThrowAway);
-
-  // Re-scan through the second (non-blank line)
-  for (unsigned int i = 0; i < ni; i++) {
-    read_without_comments(inFile, tmpThrowAway);
-    read_without_comments(inFileDelays, tmpThrowAway);
-  }
-
 #if defined(RNG_BUCKET)
   int  rng_max_available =
     ifloor(2.0f * NumNetworkCon / ParallelInfo::getNumNodes()
@@ -1701,63 +1901,41 @@ void GetConnectivity(const string& filename) {
   ParallelRand::RandComm.ResetSeed(specseed);
 #endif
 
-  // Fast forward through inFileDelays pre-synaptic neurons
-  for (unsigned int conRow = 0; conRow < ni; ++conRow)
-    for (unsigned int cntCol = 0; cntCol < FanInCon[SHUFFLEIFMULTIPROC(conRow)]; ++cntCol)
-      read_without_comments(inFileDelays, tmpThrowAway);
-
-  // Fast forward through inFileDelays pre-synaptic weights
-  for (unsigned int conRow = 0; conRow < ni; ++conRow)
-    for (unsigned int cntCol = 0; cntCol < FanInCon[SHUFFLEIFMULTIPROC(conRow)]; ++cntCol)
-      read_without_comments(inFileDelays, moreTrash);
-
   // This is only approximately good, but if more exactness is desired, the
   // axonal delays should be specified in the file
   unsigned int numOccupiedSegments = (maxAxonalDelay - minAxonalDelay + 1);
   unsigned int numSynapsesPerTimeDelay = MaxInputs / numOccupiedSegments;
   unsigned int remSynapsesPerTimeDelay = MaxInputs % numOccupiedSegments;
 
-  // Read in the connections and weights
-  IFROOTNODE Output::Out() << "Reading in connections" << std::endl;
-  UIVector curLine(MaxInputs);
-  UIVector curDelayLine(MaxInputs);
-  UIVector numConn(ni);
-  // Read in the connectivity matrix (cij)
+#if defined(MULTIPROC)
+  int   P_TotalNumberOfZeros = 0;
+  float P_TotalSumOfWeights = 0.0;
+  float P_TotalSumOfZeros = 0.0;
+#endif
+  float zeroCutOff = SystemVar::GetFloatVar("ZeroCutOff");
+
+  // The axonal delay of each local synapse, indexed like inMatrix
+  UIMatrix localDelays(hasAxonalDelays ? ni : 0);
   for (unsigned int conRow = 0; conRow < ni; conRow++) {
-    unsigned int shuffRow = SHUFFLEIFMULTIPROC(conRow);
+    const unsigned int shuffRow = SHUFFLEIFMULTIPROC(conRow);
     unsigned int numConnForNeur = 0;
-    for (unsigned int cntCol = 0; cntCol < FanInCon[shuffRow]; cntCol++) {
-      unsigned int tmpNeuron;
-      unsigned int tmpDelay = 0;
-      read_without_comments(inFile, tmpNeuron);
-      if (fileHasAxonalDelays) {
-        read_without_comments(inFileDelays, tmpDelay);
-        if (tmpDelay < 1) {
-          CALL_ERROR << "Axonal delay from neuron " << (shuffRow+1) << " to "
-            "neuron " << tmpNeuron << " cannot be less than 1 time-step (in "
-                     << filename << ")" << ERR_WHERE;
-          exit(EXIT_FAILURE);
-        }
-      }
-      tmpNeuron = SHUFFLEIFMULTIPROC(tmpNeuron);
-      curLine.at(cntCol) = tmpNeuron;
-      if (fileHasAxonalDelays)
-        curDelayLine.at(cntCol) = tmpDelay;
-      if (isLocalNeuron(tmpNeuron))
+    for (unsigned int col = 0; col < FanInCon[shuffRow]; col++) {
+      if (isLocalSynapse(SHUFFLEIFMULTIPROC(conn[conRow][col]), shuffRow))
         ++numConnForNeur;
     }
     // Allocate memory for columns, now that we know how many fan-in
     // connections there are for each neuron
-    numConn.at(shuffRow) = numConnForNeur;
     inMatrix[shuffRow] = new DendriticSynapse[numConnForNeur];
     DendriticSynapse * dendriticTree = inMatrix[shuffRow];
     unsigned int curConnHere = 0;
     for (unsigned int col = 0; col < FanInCon[shuffRow]; col++) {
-      unsigned int tmpNeuron = curLine[col];
-      if (isLocalNeuron(tmpNeuron)) {
+      const unsigned int tmpNeuron = SHUFFLEIFMULTIPROC(conn[conRow][col]);
+      const float tempweight = wij[conRow][col];
+      if (isLocalSynapse(tmpNeuron, shuffRow)) {
         dendriticTree[curConnHere].setSrcNeuron(tmpNeuron);
-        if (fileHasAxonalDelays) {
-          ++FanOutCon[tmpNeuron][curDelayLine.at(col)-1];
+        if (hasAxonalDelays) {
+          localDelays[shuffRow].push_back(aij[conRow][col]);
+          ++FanOutCon[tmpNeuron][aij[conRow][col]-1];
         } else {
           unsigned int refTime = minAxonalDelay - 1;
           unsigned int toMake = numSynapsesPerTimeDelay;
@@ -1770,34 +1948,8 @@ void GetConnectivity(const string& filename) {
           }
           ++FanOutCon[tmpNeuron][refTime];
         }
-        // We're using the weights as a temporary place to store the index
-        // into the weight file that we should be reading from when we get
-        // to the weights section(wij) of the weight file.
-        dendriticTree[curConnHere].setWeight(static_cast<float>(col));
+        dendriticTree[curConnHere].setWeight(tempweight);
         ++curConnHere;
-      }
-    }
-  }
-
-#if defined(MULTIPROC)
-  int   P_TotalNumberOfZeros = 0;
-  float P_TotalSumOfWeights = 0.0;
-  float P_TotalSumOfZeros = 0.0;
-#endif
-  float zeroCutOff = SystemVar::GetFloatVar("ZeroCutOff");
-
-  IFROOTNODE Output::Out() << "Reading in weights" << std::endl;
-  // Read in the weight matrix (wij)
-  for (unsigned int weightRow = 0; weightRow < ni; weightRow++) {
-    const unsigned int shuffRow = SHUFFLEIFMULTIPROC(weightRow);
-    int curConnHere = 0;
-    for (unsigned int col = 0; col < FanInCon[shuffRow]; col++) {
-      float tempweight;
-      read_without_comments(inFile, tempweight);
-      // The following if statement is always true if !defined(MULTIPROC)
-      if ((numConn[shuffRow] > 0) && (fabs(col - inMatrix[shuffRow][curConnHere].getWeight()) < verySmallFloat)) {
-        inMatrix[shuffRow][curConnHere].setWeight(tempweight);
-        curConnHere++;
 #if defined(MULTIPROC)
         ++NumNetworkCon;
 #endif
@@ -1820,29 +1972,9 @@ void GetConnectivity(const string& filename) {
     // Now set FanInCon to the LOCAL FanInCon(matches SetConnectivity)
     FanInCon[shuffRow] = curConnHere;
   }
-  inFile.close();
-  inFileDelays.close();
 
   IFROOTNODE Output::Out() << "Setting up matrices" << std::endl;
   FillFanOutMatrices();
-  ifstream fanoutFile(filename.c_str());
-  if (fileHasAxonalDelays) {
-    IFROOTNODE Output::Out() << "Reading axonal delays" << std::endl;
-    // Read first line (containing number of neurons)
-    read_without_comments(fanoutFile, tmpThrowAway);
-    // Read through the second (non-blank line)
-    for (unsigned int i = 0; i < ni; i++) {
-      read_without_comments(fanoutFile, tmpThrowAway);
-    }
-    // Fast forward through fanoutFile pre-synaptic neurons
-    for (unsigned int conRow = 0; conRow < ni; ++conRow)
-      for (unsigned int cntCol = 0; cntCol < FanInCon[SHUFFLEIFMULTIPROC(conRow)]; ++cntCol)
-        read_without_comments(fanoutFile, tmpThrowAway);
-    // Fast forward through fanoutFile pre-synaptic weights
-    for (unsigned int conRow = 0; conRow < ni; ++conRow)
-      for (unsigned int cntCol = 0; cntCol < FanInCon[SHUFFLEIFMULTIPROC(conRow)]; ++cntCol)
-        read_without_comments(fanoutFile, moreTrash);
-  }
   IFROOTNODE Output::Out() << "Connecting synapses..." << std::endl;
   UIMatrix ConCount(ni, UIVector(maxAxonalDelay, 0));
   SynapseType const* synType = &SynapseType::Member["default"];
@@ -1851,9 +1983,8 @@ void GetConnectivity(const string& filename) {
     for (unsigned int col = 0; col < FanInCon[faninrow]; col++) {
       const unsigned int fanoutrow = dendriticTree[col].getSrcNeuron();
       unsigned int refTime;
-      if (fileHasAxonalDelays) {
-        read_without_comments(fanoutFile, refTime);
-        --refTime;
+      if (hasAxonalDelays) {
+        refTime = localDelays[faninrow][col] - 1;
       } else {
         refTime = minAxonalDelay-1;
 #if defined(CHECK_BOUNDS)
@@ -1869,7 +2000,6 @@ void GetConnectivity(const string& filename) {
       ++ConCount[fanoutrow][refTime];
     }
   }
-  fanoutFile.close();
   IFROOTNODE Output::Out() << "Calculating averages" << std::endl;
 
   SystemVar::SetFloatVar("AveWij", TotalSumOfWeights /
@@ -1891,6 +2021,101 @@ void GetConnectivity(const string& filename) {
   return;
 }
 
+// i.e., ReadWeights
+void GetConnectivity(const string& filename) {
+  /////////////////////////////////////////////////
+  // Read in connections and weights from file,
+  //   allocating memory for both
+  /////////////////////////////////////////////////
+  unsigned int fileni;
+
+  ifstream inFile(filename.c_str());
+  if (!inFile) {
+    CALL_ERROR << "Could not open file " << filename << " for reading." << ERR_WHERE;
+    exit(EXIT_FAILURE);
+  }
+
+  // Read first line (containing number of neurons)
+  read_without_comments(inFile, fileni);
+  if (fileni != ni) {
+    CALL_ERROR << "Number of neurons in " << filename
+               << " does not agree with number given in script file!" << ERR_WHERE;
+    exit(EXIT_FAILURE);
+  }
+
+  // Read second (non-blank) line - contains number of fan-in connections for each neuron
+  IFROOTNODE Output::Out() << "Reading in number of connections" << std::endl;
+  UIVector numConn(ni);
+  for (unsigned int i = 0; i < ni; i++) {
+    if (inFile.eof()) {
+      CALL_ERROR << "Unexpected EOF while reading " << filename
+                 << " during a search for connection numbers." << ERR_WHERE;
+      exit(EXIT_FAILURE);
+    }
+    read_without_comments(inFile, numConn[i]);
+  }
+
+  // Read next ni (non-blank) lines - contains pre-synaptic neurons for each neuron
+  IFROOTNODE Output::Out() << "Reading in connections" << std::endl;
+  UIMatrix conn(ni);
+  for (unsigned int conRow = 0; conRow < ni; ++conRow) {
+    conn[conRow].resize(numConn[conRow]);
+    for (unsigned int cntCol = 0; cntCol < numConn[conRow]; ++cntCol) {
+      if (inFile.eof()) {
+        CALL_ERROR << "Unexpected EOF while reading " << filename
+                   << " during a search for pre-synaptic neurons." << ERR_WHERE;
+        exit(EXIT_FAILURE);
+      }
+      read_without_comments(inFile, conn[conRow][cntCol]);
+    }
+  }
+
+  // Read next ni (non-blank) lines - contains pre-synaptic weights for each neuron
+  IFROOTNODE Output::Out() << "Reading in weights" << std::endl;
+  DataMatrix wij(ni);
+  for (unsigned int conRow = 0; conRow < ni; ++conRow) {
+    wij[conRow].resize(numConn[conRow]);
+    for (unsigned int cntCol = 0; cntCol < numConn[conRow]; ++cntCol) {
+      if (inFile.eof()) {
+        CALL_ERROR << "Unexpected EOF while reading " << filename
+                   << " during a search for pre-synaptic weights." << ERR_WHERE;
+        exit(EXIT_FAILURE);
+      }
+      read_without_comments(inFile, wij[conRow][cntCol]);
+    }
+  }
+
+  // Look for axonal delays
+  UIMatrix aij;
+  unsigned int delayHere = 1;
+  read_without_comments(inFile, delayHere);
+  if (!inFile.eof()) {
+    IFROOTNODE Output::Out() << "Reading axonal delays" << std::endl;
+    aij.assign(ni, UIVector());
+    for (unsigned int conRow = 0; conRow < ni; ++conRow) {
+      aij[conRow].resize(numConn[conRow]);
+      for (unsigned int cntCol = 0; cntCol < numConn[conRow]; ++cntCol) {
+        if (inFile.eof()) {
+          CALL_ERROR << "Unexpected EOF while reading " << filename
+                     << " during a search for axonal delays." << ERR_WHERE;
+          exit(EXIT_FAILURE);
+        }
+        if (delayHere < 1) {
+          CALL_ERROR << "Axonal delay from neuron " << (conRow+1) << " to "
+            "neuron " << conn[conRow][cntCol] << " cannot be less than 1 time-step (in "
+                     << filename << ")" << ERR_WHERE;
+          exit(EXIT_FAILURE);
+        }
+        aij[conRow][cntCol] = delayHere;
+        read_without_comments(inFile, delayHere);
+      }
+    }
+  }
+  inFile.close();
+
+  BuildConnectivity(conn, wij, aij);
+}
+
 inline void GetNullTimingData() {
 #if defined(RNG_BUCK_TIMING)
   // For comparing against when synFailRate is defined
@@ -1923,35 +2148,41 @@ void InitializeVariables() {
   // First, each node is going to need to know how many neurons it's responsible for.
   // ni is total number of neurons over all nodes
   // numNodes is the number of nodes running this job
-  // we'll divide the neurons equally between nodes, as much as possible, leaving any
-  // remainder to the last node:
+  // by default we'll divide the neurons equally between nodes, as much as possible,
+  // giving any remainder to the first nodes; with Partition set to cost, each node
+  // instead gets about the same estimated work (see EstimateNeuronCosts)
 
   // Calculate which neurons the other nodes are responsible for
 
 #  if defined(PARENT_CHILD)
   unsigned int numNodes = ParallelInfo::getNumNodes() - 1;
-  const unsigned int rank = ParallelInfo::getRank() - 1;
 #  else  // #if defined(PEER_TO_PEER)
   unsigned int numNodes = ParallelInfo::getNumNodes();
-  const unsigned int rank = ParallelInfo::getRank();
 #  endif
-  unsigned int BaseNeuronsPerNode = ni / numNodes;
-  unsigned int RemNeuronsPerNode = ni % numNodes;
-
-  // Root node will be 0
 
-  // StartNeuron is the first neuron that this node is responsible for
-  StartNeuron = rank * BaseNeuronsPerNode;
+#  if defined(PEER_TO_PEER)
+  SpikeExchange = (SystemVar::GetIntVar("SpikeExchange") != 0);
+#  else
+  SpikeExchange = false;
+#  endif
+  NeuronWork.assign(ni, 0.0);
 
-  // EndNeuron is the last neuron that this node is responsible for
-  if (rank < RemNeuronsPerNode) {
-    // The first RemNeuronsPerNode neurons get one extra neuron
-    StartNeuron += rank;
-    EndNeuron = StartNeuron + BaseNeuronsPerNode;
+  // Either the same number of neurons on each node or about the same work
+  UIVector firstNeurons;
+  if (SystemVar::GetStrVar("Partition") == "cost") {
+    firstNeurons = partitionByCost(EstimateNeuronCosts(), numNodes);
   } else {
-    StartNeuron += RemNeuronsPerNode;
-    EndNeuron = StartNeuron + BaseNeuronsPerNode - 1;
+    firstNeurons = partitionEvenly(ni, numNodes);
   }
+#  if defined(PARENT_CHILD)
+  // The root node holds no neurons
+  firstNeurons.insert(firstNeurons.begin(), 0);
+#  endif
+  ParallelInfo::setPartition(firstNeurons);
+
+  // StartNeuron..EndNeuron are the neurons this node is responsible for
+  StartNeuron = firstNeurons[ParallelInfo::getRank()];
+  EndNeuron = firstNeurons[ParallelInfo::getRank() + 1] - 1;
 
 #  if defined(PARENT_CHILD)
   IFROOTNODE {
@@ -1974,8 +2205,14 @@ void InitializeVariables() {
 inline bool isLocalNeuron(const unsigned int nrn) {
   return ((StartNeuron <= nrn) && (nrn <= EndNeuron));
 }
+// A node holds the synapses from its own neurons or, with SpikeExchange,
+// the synapses onto them
+inline bool isLocalSynapse(const unsigned int pre, const unsigned int post) {
+  return isLocalNeuron(SpikeExchange ? post : pre);
+}
 #else
 inline bool isLocalNeuron(const unsigned int nrn) { return true; }
+inline bool isLocalSynapse(const unsigned int pre, const unsigned int post) { return true; }
 #endif
 
 map<string, string> ParseStruct(const string& toParse) {
@@ -2029,10 +2266,10 @@ inline void UpdateBucketStats() {
 #endif
 }
 
-void UpdateBuffers(UIPtnSequence &FiringPtns, UIPtnSequence &ExtPtns,
-                   DataMatrix &BusLines, DataMatrix &IntBusLines,
-                   DataMatrix &KWeights, DataMatrix &Inhibitions, DataMatrix &FBInternrnExcs,
-                   DataMatrix &FFInternrnExcs, DataList &ActVect, DataList &ThreshVect,
+void UpdateBuffers(PackedSequence &FiringPtns, PackedSequence &ExtPtns,
+                   Recorder &BusLines, Recorder &IntBusLines,
+                   Recorder &KWeights, Recorder &Inhibitions, Recorder &FBInternrnExcs,
+                   Recorder &FFInternrnExcs, DataList &ActVect, DataList &ThreshVect,
                    const unsigned int ndx, const xInput &curPattern,
                    const vector<bool> &RecordIdxList) {
   UIVector curFiring(0);     // These will be appended to (push_back)
@@ -2067,12 +2304,13 @@ void UpdateBuffers(UIPtnSequence &FiringPtns, UIPtnSequence &ExtPtns,
   }
   if (RecordIdxList[0]) FiringPtns.push_back(curFiring);
   if (RecordIdxList[1]) ExtPtns.push_back(curExtFiring);
-  if (RecordIdxList[2]) BusLines.push_back(curBusLines);
-  if (RecordIdxList[3]) IntBusLines.push_back(curIntBusLines);
-  if (RecordIdxList[4]) KWeights.push_back(curKWeights);
-  if (RecordIdxList[5]) Inhibitions.push_back(curInhibition);
-  if (RecordIdxList[6]) FBInternrnExcs.push_back(FBInhibs);
-  if (RecordIdxList[7]) FFInternrnExcs.push_back(FFInhibs);
+  // -norecord has already turned these into the none sink
+  BusLines.record(curBusLines);
+  IntBusLines.record(curIntBusLines);
+  KWeights.record(curKWeights);
+  Inhibitions.record(curInhibition);
+  FBInternrnExcs.record(FBInhibs);
+  FFInternrnExcs.record(FFInhibs);
   if (RecordIdxList[8]) ActVect[ndx] = static_cast<float>(Fired[justNow].size()) / ni;
   if (RecordIdxList[9]) ThreshVect[ndx] = Threshold;
 }
@@ -2130,6 +2368,22 @@ void UpdateParams(const string& varName, const string& varValue,
     if (varName == "seed") {
       if (newValue <= 0) throw invalid_argument(varName + " must be positive");
     }
+    if (varName == "RNGPrefetch") {
+      if (newValue < 0) throw invalid_argument(varName + " must be non-negative");
+      // Takes effect at the next CreateNetwork or SeedRNG
+    }
+    if (varName == "Rebalance") {
+      if (newValue < 0) throw invalid_argument(varName + " must be non-negative");
+    }
+    if (varName == "ReproSum") {
+      if ((newValue != 0) && (newValue != 1))
+        throw invalid_argument(varName + " must be 0 or 1");
+      // Takes effect at the next CreateNetwork
+    }
+    if (varName == "Threads") {
+      if (newValue < 1) throw invalid_argument(varName + " must be positive");
+      // Takes effect at the next CreateNetwork
+    }
     if (varName == "NMDArise") {
       if ((newValue < 0) || (newValue > 19)) {
         throw invalid_argument(varName + " must be between zero and 19, inclusive");
@@ -2277,6 +2531,24 @@ void UpdateParams(const string& varName, const string& varValue,
         NeuronType::Member["default"].setThresholdType(tt);
       }
     }
+    else if (varName == "RNGType") {
+      if (program::parseRNGType(varValue) == '\0') {
+        throw invalid_argument(varName + " must be one of (TT800, Philox, Xoshiro)");
+      }
+      // Takes effect at the next CreateNetwork or SeedRNG
+    }
+    else if (varName == "Partition") {
+      if ((varValue != "even") && (varValue != "cost")) {
+        throw invalid_argument(varName + " must be one of (even, cost)");
+      }
+      // Takes effect at the next CreateNetwork
+    }
+    else if (varName == "NormalMethod") {
+      if (program::parseNormalMethod(varValue) == '\0') {
+        throw invalid_argument(varName + " must be one of (BoxMuller, Ziggurat)");
+      }
+      // Takes effect at the next CreateNetwork or SeedRNG
+    }
     else if (varName == "LearningRuleType") {
       LearningRuleType lrt = program::parseLearningRuleType(varValue);
       if (lrt == LRT_Undef) {
@@ -2287,11 +2559,12 @@ void UpdateParams(const string& varName, const string& varValue,
       }
     }
     else if ((varName == "DendriteToSomaFilter") || (varName == "SynapseFilter")) {
-      DataMatrix Matrix = SystemVar::getMatrixOrAnalysis(varValue,
-                                                         FunctionName, CommandLine(FunctionName));
+      const DenseMatrix &Matrix = SystemVar::getMatrixOrAnalysis(varValue,
+                                                                 FunctionName, CommandLine(FunctionName));
       if (Matrix.empty()) throw length_error("Cannot create an empty filter");
-      if (Matrix.size() > 1) Matrix = transposeMatrix(Matrix);
-      DataList filterVals = Matrix.front();
+      // The filter is the first column, or the only row
+      const DataList filterVals = (Matrix.size() > 1) ?
+        Matrix.view().transpose().copyRow(0) : DataList(Matrix.front());
       if (varName == "DendriteToSomaFilter") {
         for (NeuronTypeMapIt it = NeuronType::Member.begin();
              it != NeuronType::Member.end(); ++it) {
@@ -2343,7 +2616,7 @@ inline void UpdateWeights() {
   }
 }
 
-void WriteMATLABHeader(ofstream &MATfile, int mrows, int ncols, int namlen,
+void WriteMATLABHeader(TextWriter &MATfile, int mrows, int ncols, int namlen,
                        bool isSparse, bool isText) {
   const int one = 1;
   const unsigned char *endianesschk = (unsigned char *) &one;
@@ -2365,12 +2638,63 @@ void WriteMATLABHeader(ofstream &MATfile, int mrows, int ncols, int namlen,
   MATfile.write(reinterpret_cast<char *>(&namlen), 4);
 }
 
-// ArGhhh: Record the watched inputs
-inline void RecordSynapticFiring(const int iFire, const string & FileName) {
-  // Find the proper time
-  static float dt = 0.0f;
-  if (fabs(dt) < verySmallFloat) {
-    if (fabs(SystemVar::GetFloatVar("deltaT") + 1.0f) > verySmallFloat) {
+#if defined(MULTIPROC)
+// Repartitions the neurons by the work they actually did over the last
+// numSteps time steps. The root collects every neuron's fan-in and hands
+// all of it back out, and each node rebuilds its synapses under the new
+// partition; this is only safe between trials, when the short-term state
+// has been reset.
+void RebalanceNetwork(const unsigned int numSteps) {
+  vector<double> cost = NeuronWork;
+  for (unsigned int i = StartNeuron; i <= EndNeuron; ++i) cost[i] += numSteps;
+  cost = ParallelInfo::sumCosts(cost);
+  NeuronWork.assign(ni, 0.0);
+
+  const UIVector &curPartition = ParallelInfo::getPartition();
+  const UIVector newPartition = partitionByCost(cost, curPartition.size() - 1);
+  const double curImbalance = partitionImbalance(cost, curPartition);
+  const double newImbalance = partitionImbalance(cost, newPartition);
+  // Not worth the round trip for less than a 5% gain
+  if (newImbalance > 0.95 * curImbalance) return;
+  IFROOTNODE Output::Out() << "Rebalancing nodes: load imbalance " << curImbalance
+                           << " -> " << newImbalance << std::endl;
+
+  const bool withDelays = (maxAxonalDelay > defMaxAxonalDelay);
+  UIMatrix nrnConn;
+  DataMatrix nrnWij;
+  UIMatrix nrnAij;
+  ParallelInfo::gatherFanIn(Shuffle, UnShuffle, FanInCon, inMatrix, FanOutCon,
+                            outMatrix, minAxonalDelay, maxAxonalDelay,
+                            withDelays, nrnConn, nrnWij, nrnAij);
+  ParallelInfo::broadcastFanIn(withDelays, nrnConn, nrnWij, nrnAij);
+
+  for (unsigned int row = 0; row < ni; ++row) {
+    delete[] inMatrix[row];
+    inMatrix[row] = NULL;
+  }
+  for (unsigned int row = StartNeuron; row <= EndNeuron; ++row) {
+    for (unsigned int refTime = minAxonalDelay-1; refTime < maxAxonalDelay; ++refTime) {
+      delete[] outMatrix[row][refTime];
+    }
+    delete[] outMatrix[row];
+    outMatrix[row] = NULL;
+  }
+  FanInCon.assign(ni, 0);
+
+  ParallelInfo::setPartition(newPartition);
+  StartNeuron = newPartition[ParallelInfo::getRank()];
+  EndNeuron = newPartition[ParallelInfo::getRank() + 1] - 1;
+  BuildConnectivity(nrnConn, nrnWij, nrnAij);
+  // The weights are no longer where CollectWeights found them
+  WijHistoryLayout = ParallelInfo::FanInLayout();
+}
+#endif
+
+// The time between time steps, as -cellrec reports it
+float CellRecordingDt() {
+  static float dt = 0.0f;
+  if (fabs(dt) < verySmallFloat) {
+    if (fabs(SystemVar::GetFloatVar("deltaT") + 1.0f) > verySmallFloat) {
       dt = SystemVar::GetFloatVar("deltaT");
     } else if (fabs(SystemVar::GetFloatVar("alpha") + 1.0f) > verySmallFloat) {
       dt = -100.0f * log(SystemVar::GetFloatVar("alpha"));
@@ -2380,39 +2704,156 @@ inline void RecordSynapticFiring(const int iFire, const string & FileName) {
       exit(EXIT_FAILURE);
     }
   }
+  return dt;
+}
+
+// The time step -cellrec times are measured from: the first one recorded
+int &CellRecordingOrigin() {
+  static int origin = -1;
+  return origin;
+}
+
+// Whether -cellrec counts the synapse as active this time step
+inline bool IsRecordedActive(const DendriticSynapse &synapse) {
+  // This attempts to account for failure
+  // If the second firing happens within NMDArise time from previous firing,
+  // and the second firing is a failure, this code will unfortunately
+  // result in counting it as the proper firing.
+  // This behavior is consistent with the behavior of the NeuroJet.
+  return (synapse.getLastActivate() - timeStep <= static_cast<int>(synapse.getSynapseType()->getNMDArise())) &&
+    (zi[synapse.getSrcNeuron()]);
+}
+
+// ArGhhh: Record the watched inputs
+inline void RecordSynapticFiring(const int iFire, const string & FileName) {
+  // Find the proper time
+  const float dt = CellRecordingDt();
   // Output in the format of <time> (<weight> <synapse>)* -1 \n
-  ofstream OutFile(FileName.c_str(), std::ios::app);
-  if (OutFile == NULL) {
+  static std::set<string> checkedFiles;
+  if (checkedFiles.insert(FileName).second && !AsyncWriter::canWrite(FileName)) {
     CALL_ERROR << "Error in RecordSynapticFiring: Could not open file "
                << FileName << " for writing" << ERR_WHERE;
     exit(EXIT_FAILURE);
   }
-  static int startTime = timeStep;
+  static std::ostringstream OutFile;
+  int &startTime = CellRecordingOrigin();
+  if (startTime < 0) startTime = timeStep;
   // Output::Out()<<"dt = "<<dt<<endl;
   OutFile << (timeStep - startTime) * dt << " ";
 
   DendriticSynapse * dendriticTree = inMatrix[iFire];
   for (unsigned int c = 0; c < FanInCon[iFire]; c++) {
-    // This attempts to account for failure
-    // If the second firing happens within NMDArise time from previous firing,
-    // and the second firing is a failure, this code will unfortunately
-    // result in counting it as the proper firing.
-    // This behavior is consistent with the behavior of the NeuroJet.
     const DendriticSynapse& synapse = dendriticTree[c];
-    if ((synapse.getLastActivate() - timeStep <= static_cast<int>(synapse.getSynapseType()->getNMDArise())) &&
-        (zi[synapse.getSrcNeuron()]))
+    if (IsRecordedActive(synapse))
       OutFile << synapse.getWeight() << " " << synapse.getSrcNeuron() << " ";
   }
   OutFile << "-1" << endl;
+  AsyncWriter::write(FileName, OutFile);
+}
+
+// Starts a -spikelog run for @Train or @Test
+void OpenSpikeLog(SpikeLog &spikeLog, const string &fileName, const StrArgList &cells,
+                  const bool logSynapses, const string &FunctionName,
+                  const CommandLine &ComL) {
+  if (!AsyncWriter::canWrite(fileName)) {
+    CALL_ERROR << "Error in " << FunctionName << " : Could not open file "
+               << fileName << " for writing" << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+  SpikeLog::Header header;
+  header.NumNeurons = ni;
+  header.HasSynapses = logSynapses;
+  header.FirstStep = timeStep;
+  // The first time step logged is the next one
+  int &origin = CellRecordingOrigin();
+  if (origin < 0) origin = timeStep + 1;
+  header.Origin = origin;
+  // dt is only needed to give the times of -cellrec
+  if (logSynapses) header.Dt = CellRecordingDt();
+  for (unsigned int i = 0; i < cells.size(); ++i) {
+    const int neuron = atoi(cells[i].c_str());
+    if ((neuron < 0) || (neuron >= static_cast<int>(ni))) {
+      CALL_ERROR << "Error in " << FunctionName << " : -spikecells neuron "
+                 << cells[i] << " is not between 0 and " << (ni - 1) << ERR_WHERE;
+      ComL.DisplayHelp(Output::Err());
+      exit(EXIT_FAILURE);
+    }
+    header.Cells.push_back(neuron);
+  }
+  spikeLog.open(fileName, header);
+}
+
+// Starts a -wijhist run for @Train, unless the last one is for the same
+// file, threshold and network, which then goes on
+void OpenWeightHistory(const string &fileName, const float threshold,
+                       const string &FunctionName, const CommandLine &ComL) {
+  UIVector fanIn;
+  UIVector sources;
+  DataList weights;
+  CollectWeights(fanIn, sources, weights);
+  IFROOTNODE {
+    if (WijHistory.isOpen() && (WijHistory.fileName() == fileName)
+        && (WijHistory.threshold() == threshold) && WijHistory.sameNetwork(fanIn, sources)) {
+      return;
+    }
+    if (!AsyncWriter::canWrite(fileName)) {
+      CALL_ERROR << "Error in " << FunctionName << " : Could not open file "
+                 << fileName << " for writing" << ERR_WHERE;
+      ComL.DisplayHelp(Output::Err());
+      exit(EXIT_FAILURE);
+    }
+    WijHistory.open(fileName, threshold, fanIn, sources, weights);
+  }
+}
+
+// Adds the weights that have changed to the -wijhist run, whose
+// connections OpenWeightHistory has already collected
+void SnapshotWeights(const int step) {
+  static DataList weights;  // kept so that its memory is reused
+  CollectWeightValues(weights);
+  IFROOTNODE WijHistory.snapshot(SystemVar::GetIntVar("TrainingCount"), step, weights);
+}
+
+// Logs the spikes of this time step, and the active synapses onto the
+// logged neurons if asked for
+void LogSpikes(SpikeLog &spikeLog) {
+  spikeLog.beginStep(timeStep);
+  const UIVector &cells = spikeLog.header().Cells;
+  if (cells.empty()) {
+    for (Pattern::size_type n = zi.findFirst(); n < zi.size(); n = zi.findNext(n)) {
+      spikeLog.spike(n);
+    }
+  } else {
+    for (UIVectorCIt it = cells.begin(); it != cells.end(); ++it) {
+      if (zi[*it]) spikeLog.spike(*it);
+    }
+  }
+  if (!spikeLog.header().HasSynapses) return;
+  const unsigned int numCells = cells.empty() ? ni : cells.size();
+  for (unsigned int i = 0; i < numCells; ++i) {
+    const unsigned int iFire = cells.empty() ? i : cells[i];
+    const DendriticSynapse *dendriticTree = inMatrix[iFire];
+    unsigned int numActive = 0;
+    for (unsigned int c = 0; c < FanInCon[iFire]; ++c) {
+      if (IsRecordedActive(dendriticTree[c])) ++numActive;
+    }
+    spikeLog.cell(iFire, numActive);
+    for (unsigned int c = 0; c < FanInCon[iFire]; ++c) {
+      const DendriticSynapse &synapse = dendriticTree[c];
+      if (IsRecordedActive(synapse)) {
+        spikeLog.synapse(synapse.getSrcNeuron(), synapse.getWeight());
+      }
+    }
+  }
 }
 
 void Present(const xInput &curPattern, DataMatrix &IzhVValues, DataMatrix &IzhUValues,
              const bool modifyInhWeights, const bool modifyExcWeights) {
-  for (PopulationIt pIt = Population::Member.begin();
-       pIt != Population::Member.end(); ++pIt) {
-    pIt->calcNewFeedbackInhibition(Fired[justNow]);
-    pIt->calcNewFeedforwardInhibition(curPattern);
-  }
+#if !defined(PEER_TO_PEER)
+  // Peer-to-peer nodes do this while sumwz is exchanged
+  CalcInternrnInhibition(curPattern);
+#endif
 
 #   if defined(TIMING_MODE)
   clock_t t1 = clock();
@@ -2434,8 +2875,9 @@ void Present(const xInput &curPattern, DataMatrix &IzhVValues, DataMatrix &IzhUV
   }
 
 #if defined(TIMING_P2P)
-  int elapsed, start;
+  int elapsed, start, overlap;
   elapsed = 0;
+  overlap = 0;
   start = rdtsc();
 #endif
 
@@ -2447,17 +2889,28 @@ void Present(const xInput &curPattern, DataMatrix &IzhVValues, DataMatrix &IzhUV
     ParallelInfo::sendSumwz(sumwz_inhsub);
   }
 #elif defined(PEER_TO_PEER)
-  // Exchange and sum sumwz among nodes
-  sumwz = ParallelInfo::exchangeSumwz(sumwz);
-  sumwz_inhdiv = ParallelInfo::exchangeSumwz(sumwz_inhdiv);
-  sumwz_inhsub = ParallelInfo::exchangeSumwz(sumwz_inhsub);
+  // Exchange and sum sumwz among nodes. Neither the interneurons nor the
+  // soma decay need the sums, so they are computed while it completes.
+  if (!SpikeExchange && !ReproSum)
+    ParallelInfo::startExchangeSumwz(sumwz, sumwz_inhdiv, sumwz_inhsub);
+#  if defined(TIMING_P2P)
+  overlap = rdtsc();
+#  endif
+  CalcInternrnInhibition(curPattern);
+  CalcSomaDecay();
+#  if defined(TIMING_P2P)
+  overlap = rdtsc() - overlap;
+#  endif
+  if (!SpikeExchange && !ReproSum) ParallelInfo::finishExchangeSumwz();
 #endif
 
 #if defined(TIMING_P2P)
   elapsed = rdtsc() - start;
   Output::Out() << "Elapsed exchange time = " << elapsed * 1.0 / TICKS_PER_SEC
-                << " seconds" << endl;
+                << " seconds (" << overlap * 1.0 / TICKS_PER_SEC
+                << " overlapped)" << endl;
   total_time += elapsed * 1.0 / TICKS_PER_SEC;
+  total_overlap += overlap * 1.0 / TICKS_PER_SEC;
   trials++;
 #endif
 
@@ -2477,17 +2930,23 @@ void Present(const xInput &curPattern, DataMatrix &IzhVValues, DataMatrix &IzhUV
     FiredHere.push_front(UIVector(0));
 
     // chug the zi data into fired arrays
-    for (unsigned int i = 0; i < ni; i++) {
-      if (zi[i]) FireSingleNeuron(i);
+    for (Pattern::size_type i = zi.findFirst(); i < zi.size(); i = zi.findNext(i)) {
+      FireSingleNeuron(i);
     }
     calcNeuronData = false;
   }
 #endif
   if (calcNeuronData) {
     CalcDendriticExcitation();
+#if !defined(PEER_TO_PEER)
     CalcSomaDecay();
+#endif
     CalcDendriticToSomaInput(curPattern, false);
     CalcSomaResponse(curPattern, IzhVValues, IzhUValues);
+#if defined(PEER_TO_PEER)
+    // Only this node's own neurons had complete excitation
+    if (SpikeExchange) ExchangeFired();
+#endif
   }
 
 #if defined(PARENT_CHILD)
@@ -2901,8 +3360,12 @@ void ResetSTM() {
   memset(VarKConductanceArray, ZERO, ni * sizeof(float));
   // Reset current timestep to Z0
   timeStep = 0;
+  // Counter-based synaptic failures are addressed by time step, so move
+  // on to a new key rather than replaying the previous trial's failures
+  if (DendriticSynapse::SynNoise.IsCounterBased()) DendriticSynapse::SynNoise.NextEpoch();
   const float IzhvStart = SystemVar::GetFloatVar("IzhvStart");
   const float IzhuStart = SystemVar::GetFloatVar("IzhuStart");
+  if (!TestUndoAxons.empty()) SaveLastActivates();
   for (unsigned int i = 0; i < ni; i++) {
     DendriticSynapse * dendriticTree = inMatrix[i];
     for (unsigned int c = 0; c < FanInCon[i]; ++c)
@@ -2970,9 +3433,9 @@ void ResetSTM() {
     Output::Out() << "Resetting with pattern" << std::endl;
     string ResetPattern = SystemVar::GetStrVar("ResetPattern");
     // Copy input information into time = 0
-    UIPtnSequence Seq = SystemVar::getSequence(ResetPattern, FunctionName, ComL);
-    for (UIPtnSequenceCIt it = Seq.begin(); it != Seq.end(); it++) {
-      const UIVector pat = *it;
+    const PackedSequence &Seq = SystemVar::getSequence(ResetPattern, FunctionName, ComL);
+    for (PackedSequence::const_iterator it = Seq.begin(); it != Seq.end(); it++) {
+      const UIVector &pat = *it;
       // Fire the Z0 neurons
       zi = Pattern(ni, false);
       Fired.pop_back();
@@ -3003,6 +3466,123 @@ void ResetSTM() {
   Output::Out() << "Reset done." << std::endl;
 }
 
+// The outgoing synapses of a neuron, as they were before TestUndo
+// started changing them
+class AxonUndo : public UndoLog::Entry {
+ public:
+  explicit AxonUndo(const unsigned int nrn) {
+    for (unsigned int relTime = 0; relTime < maxAxonalDelay; ++relTime) {
+      const AxonalSynapse *axonalSegment = outMatrix[nrn][relTime];
+      for (unsigned int c = 0; c < FanOutCon[nrn][relTime]; ++c) {
+        Synapses.push_back(&axonalSegment[c].getDendritic());
+        Activities.push_back(DendriticSynapse::Activity());
+        Synapses.back()->getActivity(Activities.back(), History);
+      }
+    }
+  }
+  void undo() {
+    const unsigned int *history = History.empty() ? NULL : &History[0];
+    for (unsigned int i = 0; i < Synapses.size(); ++i) {
+      Synapses[i]->setActivity(Activities[i], history);
+      history += Activities[i].HistorySize;
+    }
+  }
+ private:
+  vector<DendriticSynapse *> Synapses;
+  vector<DendriticSynapse::Activity> Activities;
+  UIVector History;
+};
+
+// The last two activations of every synapse, which is all a reset changes
+class LastActivateUndo : public UndoLog::Entry {
+ public:
+  LastActivateUndo() {
+    Times.reserve(2 * NumNetworkCon);
+    for (unsigned int i = 0; i < ni; i++) {
+      const DendriticSynapse *dendriticTree = inMatrix[i];
+      for (unsigned int c = 0; c < FanInCon[i]; ++c) {
+        Times.push_back(dendriticTree[c].getLastActivate());
+        Times.push_back(dendriticTree[c].getPrevLastActivate());
+      }
+    }
+  }
+  void undo() {
+    vector<int>::const_iterator it = Times.begin();
+    for (unsigned int i = 0; i < ni; i++) {
+      DendriticSynapse *dendriticTree = inMatrix[i];
+      for (unsigned int c = 0; c < FanInCon[i]; ++c, it += 2) {
+        dendriticTree[c].restoreLastActivate(*it, *(it + 1));
+      }
+    }
+  }
+ private:
+  vector<int> Times;
+};
+
+// Saves the outgoing synapses of the neurons in FiredArray that TestUndo
+// does not hold yet, before CalcSynapticActivation activates them
+void SaveFiredAxons(const UIVectorDeque &FiredArray) {
+  for (unsigned int relTime = minAxonalDelay-1; relTime < maxAxonalDelay; ++relTime) {
+    const UIVector &fired = FiredArray[relTime];
+    for (unsigned int i = 0; i < fired.size(); i++) {
+      const unsigned int iFire = fired[i];
+      if (!TestUndoAxons[iFire]) {
+        TestUndoAxons[iFire] = true;
+        TestUndo.add(new AxonUndo(iFire));
+      }
+    }
+  }
+}
+
+// Saves the last activations of every synapse before they are reset. A
+// reset changes nothing else, so once they are saved (the oldest values
+// being the ones put back) later resets need not save them again.
+void SaveLastActivates() {
+  if (TestUndoLastActivates) return;
+  TestUndoLastActivates = true;
+  TestUndo.add(new LastActivateUndo());
+}
+
+// Starts TestUndo for @Test, saving the interneurons and, with allState,
+// the rest of what the network changes as it runs: the synapses are only
+// saved as the test first changes them (see SaveFiredAxons), the rest,
+// whose size goes with the number of neurons, straight away. The random
+// number generators go on as they would have.
+void StartTestUndo(const bool allState) {
+  TestUndo.start();
+  for (PopulationIt pIt = Population::Member.begin();
+       pIt != Population::Member.end(); ++pIt) {
+    pIt->saveInhState(TestUndo);
+  }
+  TestUndoAxons.clear();
+  TestUndoLastActivates = false;
+  if (!allState) return;
+  TestUndo.save(timeStep);
+  TestUndo.save(TotalNumTied);
+  TestUndo.save(TrainingNetwork);
+  TestUndo.save(zi);
+  TestUndo.save(Threshold);
+  TestUndo.save(Inhibition, ni);
+  TestUndo.save(VarKConductanceArray, ni);
+  TestUndo.save(sumwz);
+  TestUndo.save(sumwz_inhdiv);
+  TestUndo.save(sumwz_inhsub);
+  TestUndo.save(dendExc);
+  TestUndo.save(somaExc);
+  TestUndo.save(dendriteQueue);
+  TestUndo.save(dendriteQueue_inhdiv);
+  TestUndo.save(dendriteQueue_inhsub);
+  TestUndo.save(IzhV);
+  TestUndo.save(IzhU);
+  TestUndo.save(Fired);
+#if defined(MULTIPROC)
+  TestUndo.save(FiredHere);
+  TestUndo.save(NeuronWork);
+#endif
+  TestUndo.save(CellRecordingOrigin());
+  TestUndoAxons.assign(ni, false);
+}
+
 void SetConnectivity(const int &AllowSelf, const char &dType,
                      const float &p1, const float &p2,
                      const float &p3, const float &p4) {
@@ -3013,9 +3593,13 @@ void SetConnectivity(const int &AllowSelf, const char &dType,
 
   IFROOTNODE Output::Out() << "Setting up the connections" << flush;
 
-  int  NumNeuronsHere = EndNeuron - StartNeuron + 1;
-  const unsigned int NumCon = iround(SystemVar::GetFloatVar("Con") * NumNeuronsHere);
-  NumNetworkCon = ni * NumCon;
+  // Normally a node connects its own neurons to every neuron. With
+  // SpikeExchange it instead connects every neuron to its own neurons.
+  const unsigned int firstIn = SPIKEEXCHANGE ? 0 : StartNeuron;
+  const unsigned int lastIn = SPIKEEXCHANGE ? ni - 1 : EndNeuron;
+  const unsigned int NumCon = iround(SystemVar::GetFloatVar("Con") * (lastIn - firstIn + 1));
+  const unsigned int NumRowsHere = SPIKEEXCHANGE ? EndNeuron - StartNeuron + 1 : ni;
+  NumNetworkCon = NumRowsHere * NumCon;
 #if defined(RNG_BUCKET)
   int  rng_max_available = iround(2 * NumCon * SystemVar::GetFloatVar("Activity"));
   Output::Out() << "rng_max_available = " << rng_max_available << std::endl;
@@ -3027,8 +3611,8 @@ void SetConnectivity(const int &AllowSelf, const char &dType,
 
   for (unsigned int i = 0; i < ni; i++) {
     // Set up number of connections for each neuron
-    FanInCon[i] = NumCon;
-    inMatrix[i] = new DendriticSynapse[NumCon];
+    FanInCon[i] = (SPIKEEXCHANGE && !isLocalNeuron(i)) ? 0 : NumCon;
+    inMatrix[i] = new DendriticSynapse[FanInCon[i]];
   }
 
   bool isPointDist = (dType != 'u') && (dType != 'n');
@@ -3039,18 +3623,40 @@ void SetConnectivity(const int &AllowSelf, const char &dType,
   float zeroCutOff = SystemVar::GetFloatVar("ZeroCutOff");
   const unsigned int lastAxonalDelay = maxAxonalDelay - 1;
   const unsigned int firstAxonalDelay = minAxonalDelay - 1;
+  // Candidate inputs and uniform weights are drawn in blocks. Both are
+  // consumed in the same order as one draw at a time, so the network
+  // does not change. Candidates carry over from one neuron to the next;
+  // each neuron uses exactly NumCon weights.
+  vector<int> candidates(std::max(NumCon, 1U));
+  unsigned int nextCandidate = candidates.size();
+  vector<double> weights(std::max(NumCon, 1U));
+#if defined(MULTIPROC)
+  // Without SpikeExchange each node draws its own share of every fan-in
+  const unsigned int connectSub = SpikeExchange ? 0 : ParallelInfo::getRank();
+#else
+  const unsigned int connectSub = 0;
+#endif
   for (unsigned int n = 0; n < ni; n++) {
     if (OneThird && n && !(n % OneThird)) {
       Output::Out() << "." << flush;
     }
+    if (FanInCon[n] == 0) continue;
     unsigned int numOccupiedSegments = (maxAxonalDelay - minAxonalDelay + 1);
     unsigned int numSynapsesPerTimeDelay = NumCon / numOccupiedSegments;
     unsigned int remSynapsesPerTimeDelay = NumCon % numOccupiedSegments;
     NumMade = 0;
+    if (program::Main().setConnectStream(n, connectSub)) nextCandidate = candidates.size();
+    if (dType == 'u' && NumCon > 0) {
+      program::Main().getWeightUniform(&weights[0], NumCon, p1, p2);
+    }
     while (NumMade < NumCon) {
       found = false;
-      const unsigned int NeuronIn
-        = program::Main().getConnectNoise(StartNeuron, EndNeuron);
+      if (nextCandidate == candidates.size()) {
+        program::Main().getConnectNoise(&candidates[0], candidates.size(),
+                                        firstIn, lastIn);
+        nextCandidate = 0;
+      }
+      const unsigned int NeuronIn = candidates[nextCandidate++];
 
       // Check for self connections
       if (!AllowSelf && (n == NeuronIn)) continue;
@@ -3072,12 +3678,9 @@ void SetConnectivity(const int &AllowSelf, const char &dType,
       if (isPointDist) {
         tempweight = p1;
       } else if (dType == 'u') {
-        tempweight = program::Main().getWeightUniform(p1, p2);
+        tempweight = weights[NumMade];
       } else if (dType == 'n') {
-        tempweight = program::Main().getWeightNormal(p1, p2);
-        while ((tempweight < p3) || (tempweight > p4)) {
-          tempweight = program::Main().getWeightNormal(p1, p2);
-        }
+        tempweight = program::Main().getWeightTruncNormal(p1, p2, p3, p4);
       }
       inMatrix[n][NumMade].setWeight(static_cast<float>(tempweight));
 
@@ -3251,10 +3854,10 @@ void CreateNeuronType(ArgListType& arg) {  // AT_FUN
     curMember->setParameter(Params[i], Params[i+1]);
     const string varName = Params[i];
     if (varName == "DendriteToSomaFilter") {
-      DataMatrix Matrix = SystemVar::getMatrixOrAnalysis(Params[i+1],
-                                                         FunctionName, CommandLine(FunctionName));
-      if (Matrix.size() > 1) Matrix = transposeMatrix(Matrix);
-      DataList filterVals = Matrix.front();
+      const DenseMatrix &Matrix = SystemVar::getMatrixOrAnalysis(Params[i+1],
+                                                                 FunctionName, CommandLine(FunctionName));
+      const DataList filterVals = (Matrix.size() > 1) ?
+        Matrix.view().transpose().copyRow(0) : DataList(Matrix.front());
       curMember->loadDTSFilterValues(filterVals);
     } else if (varName == "IzhType") {
       vector<float> result = assignIzhParams(ucase(Params[i+1]));
@@ -3386,6 +3989,7 @@ void CreateNetwork (ArgListType& arg) {  // AT_FUN
       Output::Out() << "Using Weight File: " << SystemVar::GetStrVar("ReadWeights") << std::endl;
     }
     const string filename = SystemVar::GetStrVar("ReadWeights");
+    AsyncWriter::flush();
     if (isNJNetworkFileType(filename)) {
       // Katharina Dobs' program is NJNetwork
       ReadNJNetworkFile(filename);
@@ -3452,6 +4056,20 @@ void CreateNetwork (ArgListType& arg) {  // AT_FUN
 
   TotalNumTied = 0;
 
+  // Worker threads need every fired neuron's synaptic failures to come
+  // from a stream of its own, or the draws would depend on the threads
+  const int numThreads = SystemVar::GetIntVar("Threads");
+  if ((numThreads > 1) && !DendriticSynapse::SynNoise.IsCounterBased()) {
+    Output::Err() << "Warning: Threads needs RNGType Philox; running with "
+                     "one thread" << std::endl;
+    Workers.resize(1);
+  } else if (!Workers.resize(numThreads)) {
+    Output::Err() << "Warning: only " << Workers.size() << " of " << numThreads
+                  << " threads could be started" << std::endl;
+  }
+
+  ReproSum = (SystemVar::GetIntVar("ReproSum") != 0);
+
   ResetSTM();  // Sets timeStep = 0
 }
 
@@ -3571,8 +4189,9 @@ void CopyData (ArgListType& arg) {  // AT_FUN
   }
   ComL.Process(arg, Output::Err());
 
-  // Get the old data
-  DataMatrix OldMat;
+  // Get the old data; stored matrices and analyses are read in place
+  DenseMatrix convertedMat;
+  const DenseMatrix *OldMat = &convertedMat;
   const string dataName = OldMatName.getValue();
   int OldMatSize;
   int IsOldSeq = false;
@@ -3580,17 +4199,17 @@ void CopyData (ArgListType& arg) {  // AT_FUN
   string oldType;  // for messages
   if (oldVarType == 'S') {
     const int ni = SystemVar::GetIntVar("ni");
-    OldMat = UISeqToMatrix(SystemVar::getSequence(OldMatName, FunctionName, ComL), ni);
+    UISeqToMatrix(SystemVar::getSequence(OldMatName, FunctionName, ComL), convertedMat, ni);
     IsOldSeq = true;
     oldType = "sequence";
   } else if (oldVarType == 'M') {
-    OldMat = SystemVar::getMatrix(OldMatName, FunctionName, ComL);
+    OldMat = &SystemVar::getMatrix(OldMatName, FunctionName, ComL);
     oldType = "matrix";
   } else if (oldVarType == 'A') {
-    OldMat = SystemVar::getAnalysis(OldMatName, FunctionName, ComL);
+    OldMat = &SystemVar::getAnalysis(OldMatName, FunctionName, ComL);
     oldType = "analysis";
   } else if (oldVarType == 'f') {
-    OldMat.push_back(CalcFn(dataName));
+    convertedMat.push_back(CalcFn(dataName));
     oldType = "function";
   } else {
     CALL_ERROR << "Error in " << FunctionName << " : Sequence "
@@ -3599,10 +4218,10 @@ void CopyData (ArgListType& arg) {  // AT_FUN
     exit(EXIT_FAILURE);
   }
 
-  OldMatSize = OldMat.size();
+  OldMatSize = OldMat->size();
   int startT, endT, startN, endN;
   setMatrixRange(startT, endT, startN, endN, StartPat, EndPat,
-                 StartNeuron, EndNeuron, OldMat, ComL, FunctionName);
+                 StartNeuron, EndNeuron, *OldMat, ComL, FunctionName);
 
   DataListType newDataType;
   string newType;  // for messages
@@ -3618,7 +4237,7 @@ void CopyData (ArgListType& arg) {  // AT_FUN
   // set up memory appropriately and copy
   float **TempMat;
 
-  TempMat = Convert2Mat(OldMat, startT, endT, startN, endN, Transpose.getValue(), static_cast<float>(PadVal.getValue()));
+  TempMat = Convert2Mat(*OldMat, startT, endT, startN, endN, Transpose.getValue(), static_cast<float>(PadVal.getValue()));
   if (Noisy.getValue()) {
     if (Transpose.getValue()) {
       Output::Out() << "(transposed, pad = " << PadVal.getValue() << ") ";
@@ -3686,12 +4305,9 @@ void CopyData (ArgListType& arg) {  // AT_FUN
 
   // NumBits relies on transpose swap already happening, if appropriate
   int  NumBits = endN - startN + 1;
-  DataMatrix NewDataMatrix;
+  DenseMatrix NewDataMatrix(NumPats, NumBits);
   for (int i = 0; i < NumPats; i++) {
-    // The iterator constructor appears to want start to end+1, not
-    // start to end. Gotta love it.
-    DataList temp_dl(&TempMat[i][0], &TempMat[i][NumBits]);
-    NewDataMatrix.push_back(temp_dl);
+    copy(&TempMat[i][0], &TempMat[i][NumBits], NewDataMatrix[i].begin());
   }
   SystemVar::insertData(DataName, NewDataMatrix, newDataType);
   delMatrix(TempMat, NumPats);
@@ -3745,6 +4361,60 @@ void ExportVars (ArgListType& arg) {  // AT_FUN
   SystemVar::exportVars(FileName.getValue());
 }
 
+// Loads patterns (rows) startPat..endPat (from 1, -1 for the last) of a
+// file written by @SaveData -chunked
+void LoadChunkedData(const TArg<string> &dataName, const string &fileName,
+                     const DataListType dataType, const string &typeName,
+                     const string &subTypeName, const int startPat, const int endPat,
+                     const string &FunctionName, const CommandLine &ComL) {
+  ChunkedFile::Info info;
+  if (!ChunkedFile::readInfo(fileName, info)) {
+    CALL_ERROR << "Error in " << FunctionName << " : Cannot read chunked file "
+               << fileName << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+  const bool isSeqFile = (info.Kind == 'S');
+  if (isSeqFile != (dataType == DLT_sequence)) {
+    CALL_ERROR << "Error in " << FunctionName << " : " << fileName << " holds "
+               << (isSeqFile ? "a sequence" : "a matrix") << ", not a " << typeName
+               << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+  const unsigned int lastPat = (endPat < 0) ? info.NumRows
+    : static_cast<unsigned int>(endPat);
+  if ((startPat < 1) || (static_cast<unsigned int>(startPat) > lastPat)
+      || (lastPat > info.NumRows)) {
+    CALL_ERROR << "Error in " << FunctionName << " : Pattern range invalid : "
+               << startPat << " , " << endPat << " with " << info.NumRows
+               << " patterns in " << fileName << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+  bool foundData = chkDataExists(dataName, dataType, FunctionName, ComL);
+  PackedSequence seq;
+  DenseMatrix rows;
+  const bool readOK = isSeqFile ?
+    ChunkedFile::read(fileName, startPat - 1, lastPat - 1, seq) :
+    ChunkedFile::read(fileName, startPat - 1, lastPat - 1, rows);
+  if (!readOK) {
+    CALL_ERROR << "Error in " << FunctionName << " : Cannot read chunked file "
+               << fileName << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+  Output::Out() << (foundData ? "Replaced " : "Created ") << typeName << " "
+                << dataName.getValue() << " with "
+                << (isSeqFile ? seq.size() : rows.size()) << " "
+                << subTypeName << " " << "from file " << fileName << std::endl;
+  if (isSeqFile) {
+    SystemVar::insertSequence(dataName, seq);
+  } else {
+    SystemVar::insertData(dataName, rows, dataType);
+  }
+}
+
 void LoadData (ArgListType& arg) {  // AT_FUN
   // process the function arguments
   static string FunctionName = "LoadData";
@@ -3754,11 +4424,18 @@ void LoadData (ArgListType& arg) {  // AT_FUN
   static TArg<string> FileName("-from", "file name");
   static TArg<int> LineSize("-buf", "maximum buffer size",
                             iround(2.5 * SystemVar::GetIntVar("ni")));
+  static FlagArg FromRecording("-rec", "-norec",
+                               "file was written by the file sink of @Record", 0);
+  static TArg<int> StartPat("-Pstart", "first pattern (row) {file of @SaveData -chunked}", 1);
+  static TArg<int> EndPat("-Pend", "last pattern (row) {-1 for the last one}", -1);
   static CommandLine ComL(FunctionName);
   if (argunset) {
-    ComL.HelpSet("@LoadData( ... ) loads a file of numbers into memory.\n");
+    ComL.HelpSet("@LoadData( ... ) loads a file of numbers into memory.\n"
+       "\tFiles written by @SaveData -chunked are recognized as such, and\n"
+       "\t-Pstart/-Pend load only that range of their patterns (rows).\n");
     ComL.StrSet(3, &DataName, &DataType, &FileName);
-    ComL.IntSet(1, &LineSize);
+    ComL.IntSet(3, &LineSize, &StartPat, &EndPat);
+    ComL.FlagSet(1, &FromRecording);
     argunset = 0;
   }
   ComL.Process(arg, Output::Err());
@@ -3768,14 +4445,37 @@ void LoadData (ArgListType& arg) {  // AT_FUN
   string newSubType;  // for messages
   readDataType(DataType, newDataType, newType, newSubType, FunctionName, ComL);
 
+  // The file may have been written earlier in the script
+  AsyncWriter::flush();
+  if (FromRecording.getValue()) {
+    bool foundData = chkDataExists(DataName, newDataType, FunctionName, ComL);
+    DenseMatrix recorded;
+    if (!Recorder::readFile(FileName.getValue(), recorded)) {
+      CALL_ERROR << "Error in " << FunctionName << " : Cannot read recording "
+                 << FileName.getValue() << ERR_WHERE;
+      ComL.DisplayHelp(Output::Err());
+      exit(EXIT_FAILURE);
+    }
+    Output::Out() << (foundData ? "Replaced " : "Created ") << newType << " "
+                  << DataName.getValue() << " with " << recorded.size() << " "
+                  << newSubType << " " << "from file " << FileName.getValue() << std::endl;
+    SystemVar::insertData(DataName, recorded, newDataType);
+    return;
+  }
+  if (ChunkedFile::isChunked(FileName.getValue())) {
+    LoadChunkedData(DataName, FileName.getValue(), newDataType, newType, newSubType,
+                    StartPat.getValue(), EndPat.getValue(), FunctionName, ComL);
+    return;
+  }
+
   if (LineSize.getValue() < 1) {
     CALL_ERROR << "Error in " << FunctionName << " : Invalid buffer size : "
                << LineSize.getValue() << ERR_WHERE;
     ComL.DisplayHelp(Output::Err());
     exit(EXIT_FAILURE);
   }
-  ifstream inFile(FileName.getValue().c_str(), ios::in);
-  if (!inFile) {
+  TextLoader inFile(FileName.getValue());
+  if (!inFile.isOpen()) {
     CALL_ERROR << "Error in " << FunctionName << " : Cannot open "
                << FileName.getValue() << ERR_WHERE;
     ComL.DisplayHelp(Output::Err());
@@ -3783,68 +4483,119 @@ void LoadData (ArgListType& arg) {  // AT_FUN
   }
   // set up memory appropriately
   bool foundData = chkDataExists(DataName, newDataType, FunctionName, ComL);
-  DataMatrix NewInMatrix;
-  string ThisFloat = EMPTYSTR;
 
-  // read in data
-  int  PatternCount = 0;
-  string lineBuf;
-  while (std::getline(inFile, lineBuf)) {
-    int  TotalExtracted = lineBuf.size();
-    if (TotalExtracted >= LineSize.getValue() - 1) {
-      CALL_ERROR << "Warning in " << FunctionName
-                 << " : maximum buffersize of " << LineSize.getValue()
-                 << " may be too small for file " << FileName.getValue()
-                 << ERR_WHERE;
-    }
-    // Load the line into the array buffers, counting the number of elements to set.
-    DataList LineData;
-    int  i = 0;
-    if (newDataType == DLT_sequence) {
-      while ((i < TotalExtracted) && (lineBuf[i] != '\0')) {
-        if (isspace(lineBuf[i])) {
-          ++i;
-          continue;
-        }
-        if (lineBuf[i] == '1') {
-          LineData.push_back(1.0f);
-        } else if (lineBuf[i] == '0') {
-          LineData.push_back(0.0f);
-        } else {
-          CALL_ERROR << "Error in " << FunctionName
-                     << " : Unexpected character '"
-                     << lineBuf[i] << "' in file " << FileName.getValue()
-                     << ERR_WHERE;
-          ComL.DisplayHelp(Output::Err());
-          exit(EXIT_FAILURE);
-        }
-        ++i;
-      }
-    } else {
-      while ((i < TotalExtracted) && (lineBuf[i] != '\0')) {
-        if (isspace(lineBuf[i])) {
-          ++i;
-          continue;
-        }
-        ThisFloat = EMPTYSTR;
-        while ((i < TotalExtracted) && !isspace(lineBuf[i])) {
-          ThisFloat += lineBuf[i];
-          i++;
-        }
-        LineData.push_back(from_string<float>(ThisFloat));
-      }
-    }
-    if (LineData.size() > 0) {  // If the line was not empty
-      PatternCount++;
-      NewInMatrix.push_back(LineData);
-    }
+  // read in data, a pattern a line
+  const unsigned int longLine = LineSize.getValue() - 1;
+  const unsigned int numThreads = SystemVar::GetIntVar("Threads");
+  PackedSequence NewSeq;
+  DenseMatrix NewInMatrix;
+  if (newDataType == DLT_sequence) {
+    inFile.readSequence(longLine, numThreads, NewSeq);
+  } else {
+    inFile.readMatrix(longLine, numThreads, NewInMatrix);
+  }
+  for (unsigned int i = 0; i < inFile.numLongLines(); ++i) {
+    CALL_ERROR << "Warning in " << FunctionName
+               << " : maximum buffersize of " << LineSize.getValue()
+               << " may be too small for file " << FileName.getValue()
+               << ERR_WHERE;
+  }
+  if (inFile.hasBadChar()) {
+    CALL_ERROR << "Error in " << FunctionName
+               << " : Unexpected character '"
+               << inFile.badChar() << "' in file " << FileName.getValue()
+               << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
   }
+  const int PatternCount = (newDataType == DLT_sequence) ? NewSeq.size()
+    : NewInMatrix.size();
 
   Output::Out() << (foundData ? "Replaced " : "Created ") << newType << " "
                 << DataName.getValue() << " with " << PatternCount << " "
                 << newSubType << " " << "from file " << FileName.getValue() << std::endl;
   // Add to the list
-  SystemVar::insertData(DataName, NewInMatrix, newDataType);
+  if (newDataType == DLT_sequence) {
+    SystemVar::insertSequence(DataName, NewSeq);
+  } else {
+    SystemVar::insertData(DataName, NewInMatrix, newDataType);
+  }
+}
+
+void LoadState(ArgListType& arg) {  // AT_FUN
+  // process the function arguments
+  static string FunctionName = "LoadState";
+  static int argunset = true;
+  static TArg<string> FileName("-from", "file name", "NeuroJet.state");
+  static CommandLine ComL(FunctionName);
+  if (argunset) {
+    ComL.HelpSet("@LoadState( ... ) carries on from where @SaveState left off.\n"
+                 "\t\t\t The script must first create the same network, with\n"
+                 "\t\t\t @CreateNetwork and any @AddInterneuron, as the one saved.\n");
+    ComL.StrSet(1, &FileName);
+    argunset = false;
+  }
+  ComL.Process(arg, Output::Err());
+
+  if (!program::Main().getNetworkCreated()) {
+    CALL_ERROR << "Error: You must call @CreateNetwork() before you can "
+               << "LoadState." << ERR_WHERE;
+    exit(EXIT_FAILURE);
+  }
+  const string fileName = MULTIPROCFILESUFFIX(FileName.getValue());
+  SimState state;
+  if (!state.read(fileName)) {
+    CALL_ERROR << "Error in " << FunctionName << " : " << fileName
+               << " is not a version " << SimState::Version
+               << " NeuroJet state file" << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+  IFROOTNODE Output::Out() << "Loading state from file " << FileName.getValue() << std::endl;
+
+  // Variables that differ are set as @SetVar would, for what that does to
+  // the network, then all are put back as saved, since setting some of
+  // them changes others
+  StrList changed;
+  state.section("VARS");
+  SystemVar::LoadVarState(state, changed);
+  for (StrListCIt it = changed.begin(); (it != changed.end()) && !state.failed(); ++it) {
+    string value;
+    const char varType = SystemVar::GetVarType(*it);
+    if (varType == 'i') {
+      value = to_string(SystemVar::GetIntVar(*it));
+    } else if (varType == 'f') {
+      TextWriter::appendFloat(SystemVar::GetFloatVar(*it), TextWriter::Shortest, value);
+    } else {
+      value = SystemVar::GetStrVar(*it);
+    }
+    try {
+      UpdateParams(*it, value, FunctionName);
+    }
+    catch(const length_error &e) {
+      CALL_ERROR << "Error in " << FunctionName << " : " << e.what() << ERR_WHERE;
+      exit(EXIT_FAILURE);
+    }
+    catch(const invalid_argument &e) {
+      CALL_ERROR << "Error in " << FunctionName << " : " << e.what() << ERR_WHERE;
+      exit(EXIT_FAILURE);
+    }
+  }
+  state.section("VARS");
+  SystemVar::LoadVarState(state, changed);
+  state.section("DATA");
+  SystemVar::LoadDataState(state);
+  if (!state.atSectionEnd()) state.fail();
+  state.section("RNG");
+  program::Main().loadNoise(state);
+  if (!state.atSectionEnd()) state.fail();
+  LoadNetworkState(state);
+  if (state.failed()) {
+    CALL_ERROR << "Error in " << FunctionName << " : " << fileName
+               << " is damaged or was saved from another network" << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
 }
 
 void MakeRandSequence(ArgListType& arg) {  // AT_FUN
@@ -3919,8 +4670,11 @@ void MakeRandSequence(ArgListType& arg) {  // AT_FUN
     EndNeuron.setValue(0);
   }
 
-  UIPtnSequence NewSequence;
+  PackedSequence NewSequence;
   int  PatternCount = 1;
+  // Holds one pattern's worth of coin flips when not forcing the rate
+  const int numCoins = EndNeuron.getValue() - StartNeuron.getValue() + 1;
+  vector<int> coins(std::max(numCoins, 1));
   for (int i = 0; i < SeqLen.getValue(); i++) {
     UIVector pat(0);
     if (PatternCount >= StartPat.getValue() && PatternCount <= EndPat.getValue()) {
@@ -3947,11 +4701,12 @@ void MakeRandSequence(ArgListType& arg) {  // AT_FUN
             }
           }
         }
-      } else {
+      } else if (numCoins > 0) {
+        program::Main().getExtBernoulli(&coins[0], numCoins, fireProb);
         // StartNeuron and EndNeuron are 1-based, ndx is 0-based
-        for (int j = StartNeuron.getValue()-1; j < EndNeuron.getValue(); j++) {
-          if (program::Main().getExtBernoulli(fireProb))
-            pat.push_back(j);
+        for (int j = 0; j < numCoins; j++) {
+          if (coins[j])
+            pat.push_back(StartNeuron.getValue() - 1 + j);
         }
       }
     }
@@ -4031,7 +4786,7 @@ void MakeSequence(ArgListType& arg) {  // AT_FUN
     exit(EXIT_FAILURE);
   }
 
-  UIPtnSequence NewSequence;
+  PackedSequence NewSequence;
   int  PatternCount = 1;
   int  OnCount = 0;
   int  LastNeuron = 0;
@@ -4121,10 +4876,11 @@ void AppendData (ArgListType& arg) {  // AT_FUN
   bool foundData = chkDataExists(DataName, newDataType, FunctionName, ComL);
   int  PatternCount = 0;
 
-  DataMatrix NewInMatrix;
+  DenseMatrix NewInMatrix;
   for (unsigned int i = 0; i < SeqList.size(); i++) {
-    DataMatrix temp_mat = SystemVar::getData(SeqList[i], FunctionName, ComL);
-    for (DataMatrixCIt it = temp_mat.begin(); it != temp_mat.end(); it++) {
+    DenseMatrix converted;
+    const DenseMatrix &temp_mat = SystemVar::getData(SeqList[i], converted, FunctionName, ComL);
+    for (DenseMatrix::const_iterator it = temp_mat.begin(); it != temp_mat.end(); it++) {
       PatternCount++;
       NewInMatrix.push_back(*it);
     }
@@ -4188,19 +4944,21 @@ void CombineData (ArgListType& arg) {  // AT_FUN
   // doesn't have to be neurons, but this is a good way to think of it
   unsigned int maxNeuron = 0;
   for (unsigned int i = 0; i < SeqList.size(); i++) {
-    DataMatrix tmp = SystemVar::getData(SeqList[i], FunctionName, ComL);
+    DenseMatrix converted;
+    const DenseMatrix &tmp = SystemVar::getData(SeqList[i], converted, FunctionName, ComL);
     updateMax(maxTimeStep, static_cast<unsigned int>(tmp.size()));
     maxNeuron = findMaxSize(tmp, maxNeuron);
   }
 
   DataMatrix BuildMat(maxTimeStep, DataList(maxNeuron));
-  DataMatrix inputData;
+  DenseMatrix converted;
+  const DenseMatrix *inputData;
   // Copy in the first pattern, necessary for AND, ==, etc.
   IFROOTNODE Output::Out() << SeqList[0] << " " << std::flush;
-  inputData = SystemVar::getData(SeqList[0], FunctionName, ComL);
+  inputData = &SystemVar::getData(SeqList[0], converted, FunctionName, ComL);
   DataMatrixIt BuildIt = BuildMat.begin();
-  DataMatrixCIt DMCIt;
-  for (DMCIt = inputData.begin(); DMCIt != inputData.end(); ++DMCIt, ++BuildIt) {
+  DenseMatrix::const_iterator DMCIt;
+  for (DMCIt = inputData->begin(); DMCIt != inputData->end(); ++DMCIt, ++BuildIt) {
     for (unsigned int nrn = 0; nrn < DMCIt->size(); nrn++) {
       BuildIt->at(nrn) = DMCIt->at(nrn);
     }
@@ -4209,14 +4967,14 @@ void CombineData (ArgListType& arg) {  // AT_FUN
   string combineMethod = Method.getValue();
   for (unsigned int ptn = 1; ptn < SeqList.size(); ptn++) {
     IFROOTNODE Output::Out() << SeqList[ptn] << " " << std::flush;
-    inputData = SystemVar::getData(SeqList[ptn], FunctionName, ComL);
+    inputData = &SystemVar::getData(SeqList[ptn], converted, FunctionName, ComL);
 
-    DMCIt = inputData.begin();
+    DMCIt = inputData->begin();
     for (BuildIt = BuildMat.begin(); BuildIt != BuildMat.end(); ++BuildIt) {
       for (unsigned int nrn = 0; nrn < maxNeuron; nrn++) {
         float newbit = BuildIt->at(nrn);
         float nextbit = 0.0f;
-        if ((DMCIt != inputData.end()) && (nrn < DMCIt->size())) {
+        if ((DMCIt != inputData->end()) && (nrn < DMCIt->size())) {
           nextbit = DMCIt->at(nrn);
         }
         if (combineMethod == "|") {
@@ -4283,7 +5041,7 @@ void CombineData (ArgListType& arg) {  // AT_FUN
         }
         BuildIt->at(nrn) = newbit;
       }
-      if (DMCIt != inputData.end()) ++DMCIt;
+      if (DMCIt != inputData->end()) ++DMCIt;
     }
   }
 
@@ -4310,6 +5068,297 @@ void CombineData (ArgListType& arg) {  // AT_FUN
   SystemVar::insertData(DataName, BuildMat, newDataType);
 }
 
+void ReadSpikeLog(ArgListType& arg) {  // AT_FUN
+  // process the function arguments
+  static string FunctionName = "ReadSpikeLog";
+  static int argunset = true;
+  static TArg<string> FileName("-from", "spike log written with -spikelog");
+  static TArg<string> SeqName("-name", "sequence to hold the spikes", "{no name}");
+  static StrArgList CellRecording("-cellrec",
+                                  "# in list (2*# of neurons) and [cell#, filename]* "
+                                  "to write as -cellrec would have", true);
+  static CommandLine ComL(FunctionName);
+  if (argunset) {
+    ComL.HelpSet
+      ("@ReadSpikeLog( ... ) reads a log written by @Train or @Test with -spikelog.\n"
+       "-name makes a sequence with a pattern for each time step logged,\n"
+       "\tholding the logged neurons that fired (empty if none did).\n"
+       "-cellrec writes, for each cell given, the file -cellrec would have\n"
+       "\twritten. The log needs -spikesyn for this.\n");
+    ComL.StrSet(2, &FileName, &SeqName);
+    ComL.StrListSet(1, &CellRecording);
+    argunset = false;
+  }
+  ComL.Process(arg, Output::Err());
+
+  if (CellRecording.size() % 2) {
+    CALL_ERROR << "Error in " << FunctionName << " : Odd number of arguments to "
+      "-cellrec. They are given as pairs of cell,filename." << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+  // The log may have been written earlier in the script
+  AsyncWriter::flush();
+  vector<SpikeLog::Run> runs;
+  if (!SpikeLog::read(FileName.getValue(), runs)) {
+    CALL_ERROR << "Error in " << FunctionName << " : Cannot read spike log "
+               << FileName.getValue() << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+
+  if (SeqName.getValue() != "{no name}") {
+    PackedSequence spikes;
+    UIVector pat;
+    for (vector<SpikeLog::Run>::const_iterator run = runs.begin(); run != runs.end(); ++run) {
+      for (vector<SpikeLog::Step>::const_iterator step = run->Steps.begin();
+           step != run->Steps.end(); ++step) {
+        pat = step->Spikes;
+        std::sort(pat.begin(), pat.end());
+        spikes.push_back(pat);
+      }
+    }
+    bool foundData = SystemVar::GetVarType(SeqName.getValue()) == 'S';
+    SystemVar::insertSequence(SeqName.getValue(), spikes);
+    Output::Out() << (foundData ? "Replaced" : "Created") << " sequence "
+                  << SeqName.getValue() << " with " << spikes.size()
+                  << " patterns from spike log " << FileName.getValue() << std::endl;
+  }
+
+  for (unsigned int i = 0; i < CellRecording.size(); i += 2) {
+    const unsigned int cell = atoi(CellRecording[i].c_str());
+    const string &cellFile = CellRecording[i + 1];
+    for (vector<SpikeLog::Run>::const_iterator run = runs.begin(); run != runs.end(); ++run) {
+      if (!run->Info.HasSynapses) {
+        CALL_ERROR << "Error in " << FunctionName << " : " << FileName.getValue()
+                   << " was not written with -spikesyn" << ERR_WHERE;
+        exit(EXIT_FAILURE);
+      }
+    }
+    if (!AsyncWriter::canWrite(cellFile)) {
+      CALL_ERROR << "Error in " << FunctionName << " : Could not open file "
+                 << cellFile << " for writing" << ERR_WHERE;
+      exit(EXIT_FAILURE);
+    }
+    std::ostringstream cellText;
+    SpikeLog::writeCellText(runs, cell, cellText);
+    AsyncWriter::write(cellFile, cellText, true);
+    Output::Out() << "Wrote the synaptic events of cell " << cell << " to file "
+                  << cellFile << std::endl;
+  }
+}
+
+void ReadWeightHistory(ArgListType& arg) {  // AT_FUN
+  // process the function arguments
+  static string FunctionName = "ReadWeightHistory";
+  static int argunset = true;
+  static TArg<string> FileName("-from", "weight history written with -wijhist");
+  static TArg<int> RunNum("-run", "run of the file {0 gives the last}", 0);
+  static TArg<int> SnapNum("-snapshot", "snapshot of the run {0 gives the weights it "
+                           "started with, -1 the last}", -1);
+  static TArg<string> WijFile("-to", "file for the weights, as @SaveWeights writes them",
+                              "{no file}");
+  static TArg<string> MatName("-name", "matrix to hold the weights", "{no name}");
+  static TArg<int> Precision("-precision", "significant digits of the weights"
+                             " {0 for the fewest that read back exactly}", 15);
+  static FlagArg ListSnaps("-list", "-nolist", "list the snapshots of the run", 0);
+  static CommandLine ComL(FunctionName);
+  if (argunset) {
+    ComL.HelpSet
+      ("@ReadWeightHistory( ... ) reads a history written by @Train with -wijhist.\n"
+       "Each @Train that starts a history adds a run to the file, made of\n"
+       "\tsnapshots numbered from 1 in the order they were taken.\n"
+       "-to writes the weights at the snapshot as @SaveWeights would have.\n"
+       "-name makes a matrix with a row for each neuron and a column for each\n"
+       "\tpre-synaptic neuron, 0 where they are not connected.\n");
+    ComL.StrSet(3, &FileName, &WijFile, &MatName);
+    ComL.IntSet(3, &RunNum, &SnapNum, &Precision);
+    ComL.FlagSet(1, &ListSnaps);
+    argunset = false;
+  }
+  ComL.Process(arg, Output::Err());
+
+  if ((Precision.getValue() < 0) || (Precision.getValue() > TextWriter::MaxPrecision)) {
+    CALL_ERROR << "Error in " << FunctionName << " : -precision must be between 0 and "
+               << TextWriter::MaxPrecision << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+  // The history may have been written earlier in the script
+  IFROOTNODE WijHistory.flush();
+  AsyncWriter::flush();
+  vector<WeightHistory::Run> runs;
+  if (!WeightHistory::read(FileName.getValue(), runs) || runs.empty()) {
+    CALL_ERROR << "Error in " << FunctionName << " : Cannot read weight history "
+               << FileName.getValue() << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+  const int runNum = (RunNum.getValue() == 0) ? runs.size() : RunNum.getValue();
+  if ((runNum < 1) || (runNum > static_cast<int>(runs.size()))) {
+    CALL_ERROR << "Error in " << FunctionName << " : " << FileName.getValue() << " has "
+               << runs.size() << " run(s), not " << RunNum.getValue() << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+  const WeightHistory::Run &run = runs[runNum - 1];
+  const int snapNum = (SnapNum.getValue() == -1) ? run.Snapshots.size() : SnapNum.getValue();
+  if ((snapNum < 0) || (snapNum > static_cast<int>(run.Snapshots.size()))) {
+    CALL_ERROR << "Error in " << FunctionName << " : run " << runNum << " of "
+               << FileName.getValue() << " has " << run.Snapshots.size()
+               << " snapshot(s), not " << SnapNum.getValue() << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+
+  Output::Out() << "Run " << runNum << " of weight history " << FileName.getValue()
+                << " has " << run.Snapshots.size() << " snapshot(s) of "
+                << run.Sources.size() << " weights" << std::endl;
+  if (ListSnaps.getValue()) {
+    for (unsigned int s = 0; s < run.Snapshots.size(); ++s) {
+      const WeightHistory::Snapshot &snap = run.Snapshots[s];
+      Output::Out() << "  " << (s + 1) << " : trial " << snap.Trial << ", time step "
+                    << snap.Step << ", " << snap.Changed.size() << " changed" << std::endl;
+    }
+  }
+
+  DataList weights;
+  WeightHistory::weightsAt(run, snapNum, weights);
+  const unsigned int numNeurons = run.FanIn.size();
+  if (WijFile.getValue() != "{no file}") {
+    if (!AsyncWriter::canWrite(WijFile.getValue())) {
+      CALL_ERROR << "Error in " << FunctionName << " : Unable to open "
+                 << WijFile.getValue() << " for writing" << ERR_WHERE;
+      ComL.DisplayHelp(Output::Err());
+      exit(EXIT_FAILURE);
+    }
+    TextWriter outFile(WijFile.getValue(), true, Precision.getValue());
+    outFile << numNeurons << "\n";
+    for (UIVectorCIt it = run.FanIn.begin(); it != run.FanIn.end(); ++it) {
+      outFile << *it << " ";
+    }
+    outFile << "\n";
+    unsigned int c = 0;
+    for (unsigned int i = 0; i < numNeurons; ++i) {
+      for (unsigned int last = c + run.FanIn[i]; c < last; ++c) {
+        outFile << run.Sources[c] << ' ';
+      }
+      outFile << "\n";
+    }
+    c = 0;
+    for (unsigned int i = 0; i < numNeurons; ++i) {
+      for (unsigned int last = c + run.FanIn[i]; c < last; ++c) {
+        outFile << weights[c] << ' ';
+      }
+      outFile << "\n";
+    }
+    Output::Out() << "Wrote the weights of snapshot " << snapNum << " to file "
+                  << WijFile.getValue() << std::endl;
+  }
+  if (MatName.getValue() != "{no name}") {
+    DataMatrix wij(numNeurons, DataList(numNeurons, 0.0f));
+    unsigned int c = 0;
+    for (unsigned int i = 0; i < numNeurons; ++i) {
+      for (unsigned int last = c + run.FanIn[i]; c < last; ++c) {
+        wij[i][run.Sources[c]] += weights[c];
+      }
+    }
+    bool foundData = SystemVar::GetVarType(MatName.getValue()) == 'M';
+    SystemVar::insertData(MatName.getValue(), wij, DLT_matrix);
+    Output::Out() << (foundData ? "Replaced" : "Created") << " matrix "
+                  << MatName.getValue() << " with the weights of snapshot " << snapNum
+                  << std::endl;
+  }
+}
+
+void Record(ArgListType& arg) {  // AT_FUN
+  // process the function arguments
+  static string FunctionName = "Record";
+  static int argunset = true;
+  static TArg<string> BufferName("-buffer", "buffer name, e.g., TestingBusLines");
+  static TArg<string> Sink("-sink", "where each time step goes {memory,ring,file,none}",
+                           "memory");
+  static TArg<string> FileName("-file", "file name for the file sink", "{no file}");
+  static TArg<int> RingSize("-steps", "time steps the ring sink keeps", 1000);
+  static TArg<int> ChunkSize("-chunk", "time steps the file sink holds before writing",
+                             1024);
+  static TArg<int> Every("-every", "keep every n-th time step", 1);
+  static TArg<int> StartNeuron("-Nstart", "start neuron", 1);
+  static TArg<int> EndNeuron("-Nend", "end neuron {-1 gives end of row}", -1);
+  static CommandLine ComL(FunctionName);
+  if (argunset) {
+    ComL.HelpSet
+      ("@Record( ... ) sets where @Train and @Test put one of their per-time-step\n"
+       "buffers (Training or Testing followed by BusLines, IntBusLines, KWeights,\n"
+       "Inhibitions, FBInternrnExc or FFInternrnExc). The setting lasts until\n"
+       "@Record is called again for that buffer.\n"
+       "memory keeps every time step in the buffer, as without @Record.\n"
+       "ring keeps only the last -steps time steps in the buffer.\n"
+       "file writes the time steps to -file, -chunk at a time, and leaves the\n"
+       "\tbuffer alone; read it back with @LoadData(... -type mat -rec).\n"
+       "none records nothing, as -norecord does.\n"
+       "Only every -every'th time step, and only neurons -Nstart..-Nend, are kept.\n");
+    ComL.StrSet(3, &BufferName, &Sink, &FileName);
+    ComL.IntSet(5, &RingSize, &ChunkSize, &Every, &StartNeuron, &EndNeuron);
+    argunset = false;
+  }
+  ComL.Process(arg, Output::Err());
+
+  static const char *recordable[] = { "BusLines", "IntBusLines", "KWeights",
+                                      "Inhibitions", "FBInternrnExc", "FFInternrnExc" };
+  const string &name = BufferName.getValue();
+  bool isRecordable = false;
+  for (unsigned int i = 0; i < sizeof(recordable) / sizeof(recordable[0]); ++i) {
+    if ((name == string("Training") + recordable[i])
+        || (name == string("Testing") + recordable[i])) {
+      isRecordable = true;
+    }
+  }
+  if (!isRecordable) {
+    CALL_ERROR << "Error in " << FunctionName << " : " << name
+               << " is not a buffer that can be recorded" << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+
+  Recorder::Spec spec;
+  if (Sink.getValue() == "memory") {
+    spec.Sink = Recorder::SINK_MEMORY;
+  } else if (Sink.getValue() == "ring") {
+    spec.Sink = Recorder::SINK_RING;
+  } else if (Sink.getValue() == "file") {
+    spec.Sink = Recorder::SINK_FILE;
+  } else if (Sink.getValue() == "none") {
+    spec.Sink = Recorder::SINK_NONE;
+  } else {
+    CALL_ERROR << "Error in " << FunctionName << " : Unknown sink "
+               << Sink.getValue() << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+  if ((spec.Sink == Recorder::SINK_FILE) && (FileName.getValue() == "{no file}")) {
+    CALL_ERROR << "Error in " << FunctionName << " : The file sink needs -file"
+               << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+  if ((RingSize.getValue() < 1) || (ChunkSize.getValue() < 1) || (Every.getValue() < 1)
+      || (StartNeuron.getValue() < 1)
+      || ((EndNeuron.getValue() != -1) && (EndNeuron.getValue() < StartNeuron.getValue()))) {
+    CALL_ERROR << "Error in " << FunctionName << " : -steps, -chunk and -every must be"
+               << " positive and -Nstart..-Nend a valid range" << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+  spec.RingSize = RingSize.getValue();
+  spec.FileName = MULTIPROCFILESUFFIX(FileName.getValue());
+  spec.ChunkSize = ChunkSize.getValue();
+  spec.Every = Every.getValue();
+  spec.FirstN = StartNeuron.getValue();
+  spec.LastN = EndNeuron.getValue();
+  Recorder::setSpec(name, spec);
+}
+
 void ResetFiring(ArgListType& arg) {  // AT_FUN
   // process the function arguments
   static string FunctionName = "ResetFiring";
@@ -4335,6 +5384,12 @@ void SaveData (ArgListType& arg) {  // AT_FUN
   // DoPad defaults to -nopad (0)
   static FlagArg DoPad ("-pad", "-nopad", "Fill in with zeros", 0);
   static FlagArg MATLABFmt ("-matlab", "-ascii", "Use the MATLAB format", 0);
+  // Chunked defaults to -nochunked (0)
+  static FlagArg Chunked ("-chunked", "-nochunked",
+                          "Use the chunked, compressed format {@LoadData reads it}", 0);
+  static TArg<int> ChunkRows("-chunkrows", "patterns (rows) per chunk", 1024);
+  static TArg<int> Precision("-precision", "significant digits of ascii numbers"
+                             " {0 for the fewest that read back exactly}", 6);
 #if defined(MULTIPROC)
   // NodeNum allows selection of a single node which reports data
   static TArg<int> NodeNum("-node", "node number for reporting(0 is root node)",
@@ -4344,10 +5399,29 @@ void SaveData (ArgListType& arg) {  // AT_FUN
   if (argunset) {
     ComL.HelpSet("@SaveData( ... ) saves data to file.\n");
     ComL.StrSet(2, &DataName, &FileName);
-    ComL.FlagSet(3, &DoPad, &Append, &MATLABFmt);
+    ComL.IntSet(2, &ChunkRows, &Precision);
+    ComL.FlagSet(4, &DoPad, &Append, &MATLABFmt, &Chunked);
     argunset = false;
   }
-  ComL.Process(arg, Output::Err());
+  ComL.Process(arg, Output::Err());
+  if (Chunked.getValue() && (MATLABFmt.getValue() || Append.getValue())) {
+    CALL_ERROR << "Error in " << FunctionName << " : -chunked cannot be used with "
+               << "-matlab or -append" << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+  if ((Precision.getValue() < 0) || (Precision.getValue() > TextWriter::MaxPrecision)) {
+    CALL_ERROR << "Error in " << FunctionName << " : -precision must be between 0 and "
+               << TextWriter::MaxPrecision << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+  if (ChunkRows.getValue() < 1) {
+    CALL_ERROR << "Error in " << FunctionName << " : Invalid -chunkrows : "
+               << ChunkRows.getValue() << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
 
 #if defined(TIMING_MODE)
   int start, finish;
@@ -4365,24 +5439,12 @@ void SaveData (ArgListType& arg) {  // AT_FUN
   // open the file for overwriting
   if (NodeNum.getValue() == static_cast<int>(ParallelInfo::getRank())) {
 #endif
-    ofstream outFile;
+    // Handed to the writer thread a chunk at a time as it is formatted
+    TextWriter text(FileName.getValue(), !Append.getValue(), Precision.getValue());
     int namlen = DataName.getValue().length();
-#if defined(WIN32) || defined(NO_IOS_OPENMODE)
-    ios_base::openmode oFlag = IOS::out;
-#else
-    std::_Ios_Openmode oFlag = IOS::out;
-#endif
-    if (MATLABFmt.getValue())
-      oFlag |= IOS::binary;
-    if (Append.getValue()) {
-      oFlag |= IOS::app;
-    } else {
-      ofstream fset(FileName.getValue().c_str());
-    }
 
     SystemVar::AddSavedFile(FileName.getValue(), DataName.getValue());
-    outFile.open(FileName.getValue().c_str(), oFlag);
-    if (!outFile) {
+    if (!AsyncWriter::canWrite(FileName.getValue())) {
       CALL_ERROR << "Error in " << FunctionName << " : Unable to open "
                  << FileName.getValue() << " for writing" << ERR_WHERE;
       ComL.DisplayHelp(Output::Err());
@@ -4391,25 +5453,48 @@ void SaveData (ArgListType& arg) {  // AT_FUN
 
     const char dataType = SystemVar::GetVarType(DataName.getValue());
 
-    if (dataType == 'S') {
-      UIPtnSequence Seq = SystemVar::getSequence(DataName, FunctionName, ComL);
+    if (Chunked.getValue()) {
+      if (dataType == 'S') {
+        ChunkedFile::encode(DataName.getValue(),
+                            SystemVar::getSequence(DataName, FunctionName, ComL),
+                            ni, ChunkRows.getValue(), text);
+        Output::Out() << "Wrote sequence ";
+      } else if ((dataType == 'M') || (dataType == 'A')) {
+        ChunkedFile::encode(DataName.getValue(), dataType, (dataType == 'M') ?
+                            SystemVar::getMatrix(DataName, FunctionName, ComL) :
+                            SystemVar::getAnalysis(DataName, FunctionName, ComL),
+                            ChunkRows.getValue(), text);
+        Output::Out() << ((dataType == 'M') ? "Wrote matrix " : "Wrote analysis ");
+      } else {
+        CALL_ERROR << "Error in " << FunctionName << " : -chunked needs a sequence, "
+                   << "matrix or analysis, not " << DataName.getValue() << ERR_WHERE;
+        ComL.DisplayHelp(Output::Err());
+        exit(EXIT_FAILURE);
+      }
+      Output::Out() << DataName.getValue() << " to file " << FileName.getValue()
+                    << std::endl;
+    } else if (dataType == 'S') {
+      const PackedSequence *SeqPtr = &SystemVar::getSequence(DataName, FunctionName, ComL);
       // Output the Sequence
+      PackedSequence transposed;
       if (MATLABFmt.getValue() && DoPad.getValue()) {
         // MATLAB's .mat format is column major,
         // whereas MATLAB's ASCII is row major
-        Seq = PtnSeqToUISeq(transposeMatrix(UISeqToPtnSeq(Seq)));
+        transposed = PtnSeqToUISeq(transposeMatrix(UISeqToPtnSeq(*SeqPtr)));
+        SeqPtr = &transposed;
       }
+      const PackedSequence &Seq = *SeqPtr;
       int mrows = Seq.size();
       // int ncols = findMaxSize(Seq);
       int ncols = ni;
       int numPasses = 1;
       if (MATLABFmt.getValue()) {
         if (DoPad.getValue()) {
-          WriteMATLABHeader(outFile, ncols, mrows, namlen, false, false);
+          WriteMATLABHeader(text, ncols, mrows, namlen, false, false);
         } else {
           int numNonZero = 0;
-          for (UIPtnSequenceCIt it = Seq.begin(); it != Seq.end(); it++) {
-            numNonZero += it->size();
+          for (unsigned int t = 0; t < Seq.size(); ++t) {
+            numNonZero += Seq.numSpikes(t);
           }
           UIVector last = (Seq.size() == 0) ? UIVector(0) : Seq.back();
           // If the last neuron of the last pattern isn't set to 1, then set it
@@ -4422,16 +5507,16 @@ void SaveData (ArgListType& arg) {  // AT_FUN
           numPasses = 3;  // one for each "column" (see prior column major discussion)
           // FIXME: Sparse is being set to false because true seems to corrupt
           // the file. Not a big problem, but it would be nice to fix.
-          WriteMATLABHeader(outFile, numNonZero, numPasses, namlen, false, false);
+          WriteMATLABHeader(text, numNonZero, numPasses, namlen, false, false);
         }
-        outFile.write(DataName.getValue().c_str(), namlen);
+        text.write(DataName.getValue().c_str(), namlen);
       }
       for (int pass = 0; pass < numPasses; ++pass) {
         int ElementNum = 1;
-        for (UIPtnSequenceCIt it = Seq.begin(); it != Seq.end(); ++it) {
+        for (PackedSequence::const_iterator it = Seq.begin(); it != Seq.end(); ++it) {
           // Padding changes the output from sparse to full (and pads with
           // zeros if necessary)
-          UIVector pat = *it;
+          const UIVector &pat = *it;
           int lastFired = -1;  // last Neuron we wrote out
           for (UIVectorCIt pIt = pat.begin(); pIt != pat.end(); ++pIt) {
             // Specifying -pad will cause the matrix to be written in full
@@ -4441,13 +5526,13 @@ void SaveData (ArgListType& arg) {  // AT_FUN
               if (MATLABFmt.getValue()) {
                 double toWrite = 0.0L;
                 for (int iPad = 0; iPad < (curNeur-lastFired-1); ++iPad)
-                  outFile.write(reinterpret_cast<char *>(&toWrite), 8);
+                  text.write(reinterpret_cast<char *>(&toWrite), 8);
                 toWrite = 1.0L;
-                outFile.write(reinterpret_cast<char *>(&toWrite), 8);
+                text.write(reinterpret_cast<char *>(&toWrite), 8);
               } else {
                 for (int iPad = 0; iPad < (curNeur-lastFired-1); ++iPad)
-                  outFile << "0 ";
-                outFile << "1 ";
+                  text << "0 ";
+                text << "1 ";
               }
             } else {
               // This format might look weird and inefficient, but it is
@@ -4458,18 +5543,18 @@ void SaveData (ArgListType& arg) {  // AT_FUN
                 switch (pass) {
                 case 0:
                   toWrite = static_cast<double>(ElementNum);
-                  outFile.write(reinterpret_cast<char *>(&toWrite), 8);
+                  text.write(reinterpret_cast<char *>(&toWrite), 8);
                   break;
                 case 1:
                   toWrite = static_cast<double>(curNeur+1);
-                  outFile.write(reinterpret_cast<char *>(&toWrite), 8);
+                  text.write(reinterpret_cast<char *>(&toWrite), 8);
                   break;
                 case 2:
                   toWrite = static_cast<double>(1);
-                  outFile.write(reinterpret_cast<char *>(&toWrite), 8);
+                  text.write(reinterpret_cast<char *>(&toWrite), 8);
                 }
               } else {
-                outFile << ElementNum << " " << (curNeur+1) << " 1\n";
+                text << ElementNum << " " << (curNeur+1) << " 1\n";
               }
             }
             lastFired = curNeur;
@@ -4478,13 +5563,13 @@ void SaveData (ArgListType& arg) {  // AT_FUN
             for (int i = lastFired+1; i < ncols; ++i) {
               if (MATLABFmt.getValue()) {
                 double toWrite = 0.0L;
-                outFile.write(reinterpret_cast<char *>(&toWrite), 8);
+                text.write(reinterpret_cast<char *>(&toWrite), 8);
               } else {
-                outFile << "0 ";
+                text << "0 ";
               }
             }
             if (!MATLABFmt.getValue()) {
-              outFile << "\n";
+              text << "\n";
             }
           }
           ElementNum++;
@@ -4501,69 +5586,61 @@ void SaveData (ArgListType& arg) {  // AT_FUN
             switch (pass) {
             case 0:
               toWrite = static_cast<double>(mrows);
-              outFile.write(reinterpret_cast<char *>(&toWrite), 8);
+              text.write(reinterpret_cast<char *>(&toWrite), 8);
               break;
             case 1:
               toWrite = static_cast<double>(ncols);
-              outFile.write(reinterpret_cast<char *>(&toWrite), 8);
+              text.write(reinterpret_cast<char *>(&toWrite), 8);
               break;
             case 2:
               toWrite = static_cast<double>(0);
-              outFile.write(reinterpret_cast<char *>(&toWrite), 8);
+              text.write(reinterpret_cast<char *>(&toWrite), 8);
             }
           } else {
-            outFile << mrows << " " << ncols << " 0\n";
+            text << mrows << " " << ncols << " 0\n";
           }
         }
       }
       Output::Out() << "Wrote sequence " << DataName.getValue() << " to file "
                     << FileName.getValue() << std::endl;
     } else if ((dataType == 'M') || (dataType == 'A')) {
-      DataMatrix Matrix;
-      string dataTypeName;
-      if (dataType == 'M') {
-        Matrix = SystemVar::getMatrix(DataName, FunctionName, ComL);
-        dataTypeName = "matrix";
-      } else {
-        Matrix = SystemVar::getAnalysis(DataName, FunctionName, ComL);
-        dataTypeName = "analysis";
-      }
-      if (MATLABFmt.getValue()) {
-        // MATLAB's .mat format is column major, whereas ASCII is row major
-        Matrix = transposeMatrix(Matrix);
-      }
+      const DenseMatrix &Matrix = (dataType == 'M') ?
+        SystemVar::getMatrix(DataName, FunctionName, ComL) :
+        SystemVar::getAnalysis(DataName, FunctionName, ComL);
+      const string dataTypeName = (dataType == 'M') ? "matrix" : "analysis";
       // Output the Matrix
-      int mrows = Matrix.size();
-      int ncols = findMaxSize(Matrix);
       if (MATLABFmt.getValue()) {
+        // MATLAB's .mat format is column major, whereas ASCII is row major,
+        // so the data are read through a transposed view (short rows are
+        // padded with zeros)
+        const MatrixView colMajor = Matrix.view().transpose();
+        const int mrows = colMajor.rows();
+        const int ncols = (mrows > 0) ? colMajor.cols() : 0;
         // isSparse is set to false because I can't figure out how to make
         // sparse matrices actually work. This means that to make a full
         // matrix you should use full(spconvert(x)) where x is the matrix
         // (A true sparse matrix would just use full(x) instead.)
-        WriteMATLABHeader(outFile, ncols, mrows, namlen, false, false);
-        outFile.write(DataName.getValue().c_str(), namlen);
-      }
-      for (DataMatrixCIt it = Matrix.begin(); it != Matrix.end(); it++) {
-        for (unsigned int i = 0; i < it->size(); i++) {
-          if (MATLABFmt.getValue()) {
-            double toWrite = static_cast<double>(it->at(i));
-            outFile.write(reinterpret_cast<char *>(&toWrite), 8);
-          } else {
-            outFile << it->at(i) << " ";
+        WriteMATLABHeader(text, ncols, mrows, namlen, false, false);
+        text.write(DataName.getValue().c_str(), namlen);
+        for (int r = 0; r < mrows; ++r) {
+          for (int c = 0; c < ncols; ++c) {
+            double toWrite = static_cast<double>(colMajor(r, c));
+            text.write(reinterpret_cast<char *>(&toWrite), 8);
           }
         }
-        if (DoPad.getValue()) {
-          for (int i = it->size(); i < ncols; i++) {
-            if (MATLABFmt.getValue()) {
-              double toWrite = 0.0L;
-              outFile.write(reinterpret_cast<char *>(&toWrite), 8);
-            } else {
-              outFile << 0.0f << " ";
+      } else {
+        const int ncols = Matrix.maxRowSize();
+        for (DenseMatrix::const_iterator it = Matrix.begin(); it != Matrix.end(); it++) {
+          for (unsigned int i = 0; i < it->size(); i++) {
+            text << (*it)[i] << " ";
+          }
+          if (DoPad.getValue()) {
+            for (int i = it->size(); i < ncols; i++) {
+              text << 0.0f << " ";
             }
           }
+          text << "\n";
         }
-        if (!MATLABFmt.getValue())
-          outFile << "\n";
       }
       Output::Out() << "Wrote " << dataTypeName << " "
                     << DataName.getValue() << " to file "
@@ -4571,24 +5648,24 @@ void SaveData (ArgListType& arg) {  // AT_FUN
     } else if (dataType == 'i') {
       int intVal = SystemVar::GetIntVar(DataName.getValue());
       if (MATLABFmt.getValue()) {
-        WriteMATLABHeader(outFile, 1, 1, namlen, false, false);
-        outFile.write(DataName.getValue().c_str(), namlen);
+        WriteMATLABHeader(text, 1, 1, namlen, false, false);
+        text.write(DataName.getValue().c_str(), namlen);
         double toWrite = static_cast<double>(intVal);
-        outFile.write(reinterpret_cast<char *>(&toWrite), 8);
+        text.write(reinterpret_cast<char *>(&toWrite), 8);
       } else {
-        outFile << intVal << std::endl;
+        text << intVal << "\n";
       }
       Output::Out() << "Wrote integer " << DataName.getValue() << " to file "
                     << FileName.getValue() << std::endl;
     } else if (dataType == 'f') {
       float floatVal = SystemVar::GetFloatVar(DataName.getValue());
       if (MATLABFmt.getValue()) {
-        WriteMATLABHeader(outFile, 1, 1, namlen, false, false);
-        outFile.write(DataName.getValue().c_str(), namlen);
+        WriteMATLABHeader(text, 1, 1, namlen, false, false);
+        text.write(DataName.getValue().c_str(), namlen);
         double toWrite = static_cast<double>(floatVal);
-        outFile.write(reinterpret_cast<char *>(&toWrite), 8);
+        text.write(reinterpret_cast<char *>(&toWrite), 8);
       } else {
-        outFile << floatVal << std::endl;
+        text << floatVal << "\n";
       }
       Output::Out() << "Wrote float " << DataName.getValue() << " to file "
                     << FileName.getValue() << std::endl;
@@ -4599,19 +5676,19 @@ void SaveData (ArgListType& arg) {  // AT_FUN
         int ncols = 1;
         if (isText)
           ncols = strVal.length();
-        WriteMATLABHeader(outFile, 1, ncols, namlen, false, isText);
-        outFile.write(DataName.getValue().c_str(), namlen);
+        WriteMATLABHeader(text, 1, ncols, namlen, false, isText);
+        text.write(DataName.getValue().c_str(), namlen);
         if (isText) {
           for (int c = 0; c < ncols; ++c) {
             double toWrite = static_cast<double>(strVal[c]);
-            outFile.write(reinterpret_cast<char *>(&toWrite), 8);
+            text.write(reinterpret_cast<char *>(&toWrite), 8);
           }
         } else {
           double toWrite = from_string<double>(strVal);
-          outFile.write(reinterpret_cast<char *>(&toWrite), 8);
+          text.write(reinterpret_cast<char *>(&toWrite), 8);
         }
       } else {
-        outFile << strVal << std::endl;
+        text << strVal << "\n";
       }
       if (isText)
         Output::Out() << "Wrote string ";
@@ -4625,7 +5702,7 @@ void SaveData (ArgListType& arg) {  // AT_FUN
       ComL.DisplayHelp(Output::Err());
       exit(EXIT_FAILURE);
     }
-    outFile.close();
+    text.flush();
 #if defined(MULTIPROC)
   }
 #endif
@@ -4639,113 +5716,346 @@ void SaveData (ArgListType& arg) {  // AT_FUN
 #endif
 }
 
-void SaveWeights(ArgListType& arg) {  // AT_FUN
+void SaveState(ArgListType& arg) {  // AT_FUN
   // process the function arguments
-  static string FunctionName = "SaveWeights";
+  static string FunctionName = "SaveState";
   static int argunset = true;
-  static int MadeMatlab = false;
-  // MakeMatlab defaults to -noMFiles(0)
-  static FlagArg MakeMatlab ("-MFiles", "-noMFiles",
-                             "make the mfile to\n\t\t\t load in weights and "
-                             "connections to Matlab\n\t\t\t only called once per script",
-                             0);
-  static FlagArg AddComments ("-Comments", "-noComments",
-                              "add comments to the weights file", 0);
-  static TArg<string> FileName("-to", "file name", "wij.dat");
+  static TArg<string> FileName("-to", "file name", "NeuroJet.state");
   static CommandLine ComL(FunctionName);
   if (argunset) {
-    ComL.HelpSet("@SaveWeights( ... ) saves the weights to file.\n");
+    ComL.HelpSet("@SaveState( ... ) saves everything the simulation has changed so\n"
+                 "\t\t\t far, for @LoadState to carry on from. With MULTIPROC each\n"
+                 "\t\t\t node saves to the file name followed by its number.\n");
     ComL.StrSet(1, &FileName);
-    ComL.FlagSet(2, &MakeMatlab, &AddComments);
     argunset = false;
   }
   ComL.Process(arg, Output::Err());
 
-  ofstream outFile(FileName.getValue().c_str());
-  if (!outFile) {
-    CALL_ERROR << "Error in " << FunctionName << " : Unable to open "
-               << FileName.getValue() << " for writing" << ERR_WHERE;
+  if (!program::Main().getNetworkCreated()) {
+    CALL_ERROR << "Error: You must call @CreateNetwork() before you can "
+               << "SaveState." << ERR_WHERE;
+    exit(EXIT_FAILURE);
+  }
+  IFROOTNODE Output::Out() << "Saving state to file " << FileName.getValue() << std::endl;
+  SimState state;
+  state.beginSection("VARS");
+  SystemVar::SaveVarState(state);
+  state.beginSection("DATA");
+  SystemVar::SaveDataState(state);
+  state.beginSection("RNG");
+  program::Main().saveNoise(state);
+  SaveNetworkState(state);
+  const string fileName = MULTIPROCFILESUFFIX(FileName.getValue());
+  if (!state.write(fileName)) {
+    CALL_ERROR << "Error in " << FunctionName << " : Unable to write "
+               << fileName << ERR_WHERE;
     ComL.DisplayHelp(Output::Err());
     exit(EXIT_FAILURE);
   }
-  // for i = 1:NumNodes, the node sends 1: how many neurons we're dealing with
-  // 2: connections(one array at a time) 3: weights(one array at a time)
-  // as soon as an array arrives, it gets dumped to a file
-  // there will be separate files for connections and weights, and I'll change
-  // the SaveWeights function such that there's an option to do it like that
+}
+
+// Everything the network changes as it runs, for @SaveState: first what
+// the network was created as, so @LoadState can tell it is loading into the
+// same one, then its firing, queues and inhibition (NET), its interneurons
+// (POPS) and each synapse (SYN). With MULTIPROC each node saves its own part.
+void SaveNetworkState(SimState &state) {
+  state.beginSection("NET");
+  state.put<uint32_t>(ni);
+  state.put<uint32_t>(NumNetworkCon);
+  state.put<uint32_t>(minAxonalDelay);
+  state.put<uint32_t>(maxAxonalDelay);
+  state.putVector(FanInCon);
+#if defined(MULTIPROC)
+  state.put<uint32_t>(ParallelInfo::getNumNodes());
+  state.put<uint32_t>(StartNeuron);
+  state.put<uint32_t>(EndNeuron);
+#endif
+  state.put<int32_t>(timeStep);
+  state.put<int32_t>(TotalNumTied);
+  state.putBool(TrainingNetwork);
+  UIVector onNeurons;
+  for (unsigned int n = zi.findFirst(); n < ni; n = zi.findNext(n)) onNeurons.push_back(n);
+  state.putVector(onNeurons);
+  state.put(Threshold);
+  state.putArray(Inhibition, ni);
+  state.putArray(VarKConductanceArray, ni);
+  state.putVector(sumwz);
+  state.putVector(sumwz_inhdiv);
+  state.putVector(sumwz_inhsub);
+  state.putVector(dendExc);
+  state.putVector(somaExc);
+  state.put<uint64_t>(dendriteQueue.size());
+  for (unsigned int i = 0; i < dendriteQueue.size(); ++i) {
+    state.putVector(dendriteQueue[i]);
+    state.putVector(dendriteQueue_inhdiv[i]);
+    state.putVector(dendriteQueue_inhsub[i]);
+  }
+  state.putVector(IzhV);
+  state.putVector(IzhU);
+  state.put<uint64_t>(Fired.size());
+  for (UIVectorDeque::const_iterator it = Fired.begin(); it != Fired.end(); ++it) state.putVector(*it);
+#if defined(MULTIPROC)
+  state.put<uint64_t>(FiredHere.size());
+  for (UIVectorDeque::const_iterator it = FiredHere.begin(); it != FiredHere.end(); ++it) {
+    state.putVector(*it);
+  }
+  state.putVector(NeuronWork);
+#endif
+  state.put<int32_t>(CellRecordingOrigin());
+
+  state.beginSection("POPS");
+  state.put<uint32_t>(Population::Member.size());
+  for (PopulationCIt it = Population::Member.begin(); it != Population::Member.end(); ++it) {
+    it->saveState(state);
+  }
+
+  state.beginSection("SYN");
+  for (unsigned int i = 0; i < ni; ++i) {
+    const DendriticSynapse *dendriticTree = inMatrix[i];
+    for (unsigned int c = 0; c < FanInCon[i]; ++c) {
+      state.put<uint32_t>(dendriticTree[c].getSrcNeuron());
+      dendriticTree[c].saveState(state);
+    }
+  }
+}
+
+// Fails the state if it is not of the network @CreateNetwork made
+void LoadNetworkState(SimState &state) {
+  state.section("NET");
+  uint32_t savedNi = 0;
+  uint32_t savedNumCon = 0;
+  uint32_t savedMinDelay = 0;
+  uint32_t savedMaxDelay = 0;
+  UIVector savedFanIn;
+  state.get(savedNi);
+  state.get(savedNumCon);
+  state.get(savedMinDelay);
+  state.get(savedMaxDelay);
+  state.getVector(savedFanIn);
+  if ((savedNi != ni) || (savedNumCon != NumNetworkCon) || (savedMinDelay != minAxonalDelay)
+      || (savedMaxDelay != maxAxonalDelay) || (savedFanIn != FanInCon)) {
+    state.fail();
+  }
+#if defined(MULTIPROC)
+  uint32_t savedNumNodes = 0;
+  uint32_t savedStart = 0;
+  uint32_t savedEnd = 0;
+  state.get(savedNumNodes);
+  state.get(savedStart);
+  state.get(savedEnd);
+  if ((savedNumNodes != ParallelInfo::getNumNodes()) || (savedStart != StartNeuron)
+      || (savedEnd != EndNeuron)) {
+    state.fail();
+  }
+#endif
+  if (state.failed()) return;
+  state.get(timeStep);
+  state.get(TotalNumTied);
+  TrainingNetwork = state.getBool();
+  UIVector onNeurons;
+  state.getVector(onNeurons);
+  zi.reset();
+  for (UIVectorCIt it = onNeurons.begin(); it != onNeurons.end(); ++it) {
+    if (*it >= ni) {
+      state.fail();
+      return;
+    }
+    zi.set(*it);
+  }
+  state.get(Threshold);
+  state.getArray(Inhibition, ni);
+  state.getArray(VarKConductanceArray, ni);
+  state.getVector(sumwz);
+  state.getVector(sumwz_inhdiv);
+  state.getVector(sumwz_inhsub);
+  state.getVector(dendExc);
+  state.getVector(somaExc);
+  uint64_t numQueues = 0;
+  state.get(numQueues);
+  if (numQueues > ni) state.fail();
+  if (state.failed()) return;
+  dendriteQueue.resize(numQueues);
+  dendriteQueue_inhdiv.resize(numQueues);
+  dendriteQueue_inhsub.resize(numQueues);
+  for (unsigned int i = 0; i < numQueues; ++i) {
+    state.getVector(dendriteQueue[i]);
+    state.getVector(dendriteQueue_inhdiv[i]);
+    state.getVector(dendriteQueue_inhsub[i]);
+  }
+  state.getVector(IzhV);
+  state.getVector(IzhU);
+  uint64_t numFired = 0;
+  state.get(numFired);
+  if (numFired > state.size()) state.fail();
+  if (state.failed()) return;
+  Fired.resize(numFired);
+  for (UIVectorDeque::iterator it = Fired.begin(); it != Fired.end(); ++it) state.getVector(*it);
+#if defined(MULTIPROC)
+  numFired = 0;
+  state.get(numFired);
+  if (numFired > state.size()) state.fail();
+  if (state.failed()) return;
+  FiredHere.resize(numFired);
+  for (UIVectorDeque::iterator it = FiredHere.begin(); it != FiredHere.end(); ++it) {
+    state.getVector(*it);
+  }
+  state.getVector(NeuronWork);
+#endif
+  state.get(CellRecordingOrigin());
+  if (!state.atSectionEnd()) state.fail();
+
+  state.section("POPS");
+  uint32_t numPops = 0;
+  state.get(numPops);
+  if (numPops != Population::Member.size()) state.fail();
+  for (PopulationIt it = Population::Member.begin();
+       (it != Population::Member.end()) && !state.failed(); ++it) {
+    it->loadState(state);
+  }
+  if (!state.atSectionEnd()) state.fail();
+
+  state.section("SYN");
+  for (unsigned int i = 0; (i < ni) && !state.failed(); ++i) {
+    DendriticSynapse *dendriticTree = inMatrix[i];
+    for (unsigned int c = 0; c < FanInCon[i]; ++c) {
+      uint32_t src = 0;
+      state.get(src);
+      if (src != dendriticTree[c].getSrcNeuron()) {
+        state.fail();
+        break;
+      }
+      dendriticTree[c].loadState(state);
+    }
+  }
+  if (!state.atSectionEnd()) state.fail();
+}
 
+// The fan-in of each neuron, then the source and weight of each connection,
+// neuron by neuron, as WriteWeights orders them. With MULTIPROC every node
+// must call this, but only the root node gets them; where each node's
+// weights went is kept for CollectWeightValues.
+void CollectWeights(UIVector &fanIn, UIVector &sources, DataList &weights) {
+  fanIn.clear();
+  sources.clear();
+  weights.clear();
 #if defined(MULTIPROC)
+  UIMatrix nrnConn;
+  DataMatrix nrnWij;
+  UIMatrix nrnAij;
+  ParallelInfo::gatherFanIn(Shuffle, UnShuffle, FanInCon, inMatrix, FanOutCon,
+                            outMatrix, minAxonalDelay, maxAxonalDelay,
+                            false, nrnConn, nrnWij, nrnAij, &WijHistoryLayout);
   IFROOTNODE {
-    Output::Out() << "Saving weights to file " << FileName.getValue() << std::endl;
-    outFile << ni << "\n";
-    if (AddComments.getValue()) {
-      outFile << "# Fan-in synaptic count per neuron:\n";
+    sources.reserve(NumNetworkCon);
+    weights.reserve(NumNetworkCon);
+    for (unsigned int i = 0; i < ni; i++) {
+      fanIn.push_back(nrnConn[i].size());
+      sources.insert(sources.end(), nrnConn[i].begin(), nrnConn[i].end());
+      weights.insert(weights.end(), nrnWij[i].begin(), nrnWij[i].end());
+    }
+  }
+#else
+  fanIn = FanInCon;
+  sources.reserve(NumNetworkCon);
+  weights.reserve(NumNetworkCon);
+  for (unsigned int i = 0; i < ni; ++i) {
+    const DendriticSynapse *dendriticTree = inMatrix[i];
+    for (unsigned int c = 0; c < FanInCon[i]; ++c) {
+      sources.push_back(dendriticTree[c].getSrcNeuron());
+      weights.push_back(dendriticTree[c].getWeight());
     }
+  }
+#endif
+}
 
-    // rows are neurons, columns are nodes
-    UIMatrix nodeConn = ParallelInfo::rcvNodeConn(Shuffle, FanInCon);
-    // sum over columns
-    UIVector totalConn = matrixSum(nodeConn);
+// The weights of CollectWeights alone. With MULTIPROC they are gathered
+// the way CollectWeights last found them, unless RebalanceNetwork has
+// moved them since.
+void CollectWeightValues(DataList &weights) {
+#if defined(MULTIPROC)
+  if (WijHistoryLayout.NodeTotals.empty()) {
+    UIVector fanIn;
+    UIVector sources;
+    CollectWeights(fanIn, sources, weights);
+    return;
+  }
+  ParallelInfo::gatherWeights(Shuffle, FanInCon, inMatrix, WijHistoryLayout, weights);
+#else
+  weights.clear();
+  weights.reserve(NumNetworkCon);
+  for (unsigned int i = 0; i < ni; ++i) {
+    const DendriticSynapse *dendriticTree = inMatrix[i];
+    for (unsigned int c = 0; c < FanInCon[i]; ++c) {
+      weights.push_back(dendriticTree[c].getWeight());
+    }
+  }
+#endif
+}
 
+// Writes the network in the format GetConnectivity reads. With MULTIPROC
+// every node must call this, but only the root node writes.
+void WriteWeights(TextWriter &outFile, const bool addComments) {
+#if defined(MULTIPROC)
+  // Each node holds part of every neuron's fan-in; all of it reaches the
+  // root in a few collective calls
+  const bool withDelays = (maxAxonalDelay > defMaxAxonalDelay);
+  UIMatrix nrnConn;
+  DataMatrix nrnWij;
+  UIMatrix nrnAij;
+  ParallelInfo::gatherFanIn(Shuffle, UnShuffle, FanInCon, inMatrix, FanOutCon,
+                            outMatrix, minAxonalDelay, maxAxonalDelay,
+                            withDelays, nrnConn, nrnWij, nrnAij);
+  IFROOTNODE {
+    outFile << ni << "\n";
+    if (addComments) {
+      outFile << "# Fan-in synaptic count per neuron:\n";
+    }
     for (unsigned int i = 0; i < ni; i++) {
-      outFile << totalConn[i] << " ";
+      outFile << nrnConn[i].size() << " ";
     }
     outFile << "\n";
-    if (AddComments.getValue()) {
+    if (addComments) {
       outFile << "# Fan-in synapses (pre-synaptic neuron number)\n";
     }
-
     for (unsigned int i = 0; i < ni; i++) {
-      UIVector nrnConn = ParallelInfo::rcvNrnConn(nodeConn.at(i), i, Shuffle, UnShuffle, FanInCon, inMatrix);
-      for (UIVectorCIt it = nrnConn.begin(); it != nrnConn.end(); ++it) {
+      for (UIVectorCIt it = nrnConn[i].begin(); it != nrnConn[i].end(); ++it) {
         outFile << *it << " ";
       }
       outFile << "\n";
     }
 
-    if (AddComments.getValue()) {
+    if (addComments) {
       outFile << "# Fan-in synaptic weights\n";
     }
     for (unsigned int i = 0; i < ni; i++) {
-      DataList nrnWij = ParallelInfo::rcvNrnWij(nodeConn.at(i), i, Shuffle, FanInCon, inMatrix);
-      for (DataListCIt it = nrnWij.begin(); it != nrnWij.end(); ++it) {
-        outFile << setprecision(15) << *it << " ";
+      for (DataListCIt it = nrnWij[i].begin(); it != nrnWij[i].end(); ++it) {
+        outFile << *it << " ";
       }
       outFile << "\n";
     }
 
-    if (maxAxonalDelay > defMaxAxonalDelay) {
-      if (AddComments.getValue()) {
+    if (withDelays) {
+      if (addComments) {
         outFile << "# Fan-in axonal delays\n";
       }
       for (unsigned int i = 0; i < ni; i++) {
-        UIVector nrnAij = ParallelInfo::rcvNrnAij(nodeConn.at(i), i, Shuffle, FanInCon, inMatrix, FanOutCon, outMatrix,
-                                                  minAxonalDelay, maxAxonalDelay);
-        for (UIVectorCIt it = nrnAij.begin(); it != nrnAij.end(); ++it) {
+        for (UIVectorCIt it = nrnAij[i].begin(); it != nrnAij[i].end(); ++it) {
           outFile << *it << " ";
         }
         outFile << "\n";
       }
     }
-  } else {        // I'm a computation node
-    // Tell the root node how many connections I have for each neuron
-    ParallelInfo::sendNodeConn(Shuffle, FanInCon);
-    ParallelInfo::sendNrnConn(Shuffle, UnShuffle, FanInCon, inMatrix);
-    ParallelInfo::sendNrnWij(Shuffle, FanInCon, inMatrix);
-    ParallelInfo::sendNrnAij(Shuffle, FanInCon, inMatrix, FanOutCon, outMatrix,
-                             minAxonalDelay, maxAxonalDelay);
   }
 #else
-  Output::Out() << "Saving weights to file " << FileName.getValue() << std::endl;
   outFile << ni << "\n";
-  if (AddComments.getValue()) {
+  if (addComments) {
     outFile << "# Fan-in synaptic count per neuron:\n";
   }
   for (unsigned int connectCol = 0; connectCol < ni; ++connectCol) {
     outFile << FanInCon.at(connectCol) << " ";
   }
   outFile << "\n";
-  if (AddComments.getValue()) {
+  if (addComments) {
     outFile << "# Fan-in synapses (pre-synaptic neuron number)\n";
   }
   for (unsigned int conRow = 0; conRow < ni; ++conRow) {
@@ -4754,18 +6064,18 @@ void SaveWeights(ArgListType& arg) {  // AT_FUN
     }
     outFile << "\n";
   }
-  if (AddComments.getValue()) {
+  if (addComments) {
     outFile << "# Fan-in synaptic weights\n";
   }
   for (unsigned int weightRow = 0; weightRow < ni; ++weightRow) {
     DendriticSynapse * dendriticTree = inMatrix[weightRow];
     for (unsigned int weightCol = 0; weightCol < FanInCon.at(weightRow); ++weightCol) {
-      outFile << setprecision(15) << dendriticTree[weightCol].getWeight() << ' ';
+      outFile << dendriticTree[weightCol].getWeight() << ' ';
     }
     outFile << "\n";
   }
   if (maxAxonalDelay > defMaxAxonalDelay) {
-    if (AddComments.getValue()) {
+    if (addComments) {
       outFile << "# Fan-in axonal delays\n";
     }
     // This ostensibly scales as n^3c^2, which could be bad
@@ -4791,8 +6101,51 @@ void SaveWeights(ArgListType& arg) {  // AT_FUN
     }
   }
 #endif
+}
+
+void SaveWeights(ArgListType& arg) {  // AT_FUN
+  // process the function arguments
+  static string FunctionName = "SaveWeights";
+  static int argunset = true;
+  static int MadeMatlab = false;
+  // MakeMatlab defaults to -noMFiles(0)
+  static FlagArg MakeMatlab ("-MFiles", "-noMFiles",
+                             "make the mfile to\n\t\t\t load in weights and "
+                             "connections to Matlab\n\t\t\t only called once per script",
+                             0);
+  static FlagArg AddComments ("-Comments", "-noComments",
+                              "add comments to the weights file", 0);
+  static TArg<string> FileName("-to", "file name", "wij.dat");
+  static TArg<int> Precision("-precision", "significant digits of the weights"
+                             " {0 for the fewest that read back exactly}", 15);
+  static CommandLine ComL(FunctionName);
+  if (argunset) {
+    ComL.HelpSet("@SaveWeights( ... ) saves the weights to file.\n");
+    ComL.StrSet(1, &FileName);
+    ComL.IntSet(1, &Precision);
+    ComL.FlagSet(2, &MakeMatlab, &AddComments);
+    argunset = false;
+  }
+  ComL.Process(arg, Output::Err());
+
+  if ((Precision.getValue() < 0) || (Precision.getValue() > TextWriter::MaxPrecision)) {
+    CALL_ERROR << "Error in " << FunctionName << " : -precision must be between 0 and "
+               << TextWriter::MaxPrecision << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+  if (!AsyncWriter::canWrite(FileName.getValue())) {
+    CALL_ERROR << "Error in " << FunctionName << " : Unable to open "
+               << FileName.getValue() << " for writing" << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+  IFROOTNODE Output::Out() << "Saving weights to file " << FileName.getValue() << std::endl;
+  {
+    TextWriter outFile(FileName.getValue(), true, Precision.getValue());
+    WriteWeights(outFile, AddComments.getValue());
+  }
   IFROOTNODE {
-    outFile.close();
     if (MakeMatlab.getValue() && !MadeMatlab) {
       MadeMatlab = true;
       Output::Out() <<
@@ -5055,6 +6408,97 @@ void SetVar(ArgListType& arg) {  // AT_FUN
   }
 }
 
+// State shared by the workers of @Sim. Worker w fills rows (y patterns)
+// FirstRow[w]..FirstRow[w+1]-1 of SimBuffer, comparing them with a block
+// of BlockLen x patterns at a time so that the block stays in cache.
+// Each element is computed exactly as a single worker would, so the
+// results do not depend on the number of workers.
+struct SimJob {
+  SimJob(const Sequence &xBits, const Sequence &yBits, const DenseMatrix &xMat,
+         const DenseMatrix &yMat, const DataList &xMag, const DataList &yMag,
+         DenseMatrix &simBuffer, const unsigned int numWorkers)
+    : XBits(xBits), YBits(yBits), XMat(xMat), YMat(yMat), XMag(xMag), YMag(yMag),
+      SimBuffer(simBuffer), FirstRow(partitionEvenly(yMag.size(), numWorkers)),
+      Worst(numWorkers, 0.0L), Found(numWorkers, 0), Method(0), UseBits(false),
+      StartN(1), EndN(0), BlockLen(1) { }
+  const Sequence &XBits;
+  const Sequence &YBits;
+  const DenseMatrix &XMat;
+  const DenseMatrix &YMat;
+  const DataList &XMag;
+  const DataList &YMag;
+  DenseMatrix &SimBuffer;
+  const UIVector FirstRow;
+  vector<double> Worst;       // the worst similarity each worker found,
+  vector<int> Found;          // if it found one
+  int Method;                 // 0 for cos, 1 for ham and -1 for nham
+  bool UseBits;
+  int StartN;
+  int EndN;
+  int BlockLen;
+};
+
+// About what a core's L2 cache holds
+const std::size_t SimBlockBytes = 256 * 1024;
+
+void SimWorker(const unsigned int worker, void *arg) {
+  SimJob &job = *static_cast<SimJob *>(arg);
+  const int meth = job.Method;
+  const int firstRow = job.FirstRow[worker];
+  const int endRow = job.FirstRow[worker + 1];
+  const int xSeqSize = job.XMag.size();
+  double worst = 0.0L;
+  bool found = false;
+  for (int blockStart = 0; blockStart < xSeqSize; blockStart += job.BlockLen) {
+    const int blockEnd = min(xSeqSize, blockStart + job.BlockLen);
+    for (int i = firstRow; i < endRow; ++i) {
+      DenseMatrix::Row simRow = job.SimBuffer[i];
+      const float yMag = job.YMag[i];
+      for (int j = blockStart; j < blockEnd; ++j) {
+        const float xMag = job.XMag[j];
+        double sim = 0.0f;
+        if ((fabs(xMag) < verySmallFloat) || (fabs(yMag) < verySmallFloat)) {
+          if (meth == -1) {
+            sim = 1.0f;
+          } else if (meth == 1) {
+            sim = xMag + yMag;
+          }
+        } else {
+          double dot_prod = 0.0f;
+          if (job.UseBits) {
+            dot_prod = static_cast<double>(job.XBits[j].countAnd(job.YBits[i]));
+          } else {
+            const DenseMatrix::ConstRow xRow = job.XMat[j];
+            const DenseMatrix::ConstRow yRow = job.YMat[i];
+            const int lastN = min(job.EndN, static_cast<int>(min(xRow.size(), yRow.size())));
+            for (int n = job.StartN-1; n < lastN; ++n) {
+              dot_prod += xRow[n] * yRow[n];
+            }
+          }
+          if (meth) {
+            sim = xMag + yMag - 2.0f * dot_prod;
+          } else {
+            sim = dot_prod / (sqrt(xMag * yMag));
+          }
+          if (meth == -1) {
+            sim /= (xMag + yMag);
+          }
+        }
+        simRow[j] = static_cast<float>(sim);
+        // The order of the comparisons only matters for a NaN, which is
+        // only the worst if it is the very first element
+        const bool worse = (meth) ? (sim > worst) : (sim < worst);
+        if (found ? worse : (((i == 0) && (j == 0)) || (sim == sim))) {
+          worst = sim;
+          found = true;
+        }
+      }
+    }
+  }
+  job.Worst[worker] = worst;
+  job.Found[worker] = found;
+}
+
 void Sim(ArgListType& arg) {  // AT_FUN
   // In the multi-processor version of Sim, there's no need for any data interchange;
   // All data that Sim needs is available on all nodes
@@ -5079,6 +6523,8 @@ void Sim(ArgListType& arg) {  // AT_FUN
                              "max length of x-axis in graph {-1 is seq len}", -1);
   static TArg<int> yGraphLen("-ygraph",
                              "max length of y-axis in graph {-1 is seq len}", -1);
+  static TArg<int> Precision("-precision", "significant digits in the -file output"
+                             " {0 for the fewest that read back exactly}", 6);
   static CommandLine ComL(FunctionName);
   if (argunset) {
     ComL.HelpSet
@@ -5087,13 +6533,15 @@ void Sim(ArgListType& arg) {  // AT_FUN
        "WinBuffer has a vector for each time step in the x data. Each\n"
        "of these vectors then has elements of the form:\n"
        "winner1 sim1 winner2 sim2 ... winnerN simN, where N is the number\n"
-       "of winners from the command line.\n");
+       "of winners from the command line.\n"
+       "The comparisons are shared between Threads workers.\n");
     // #if defined(MULTIPROC)
     // "The root node also keeps track of GlobalSimBuffer, which is an average\n"
     // "of SimBuffers from all nodes in the network.\n"
     // #endif
     ComL.StrSet(4, &FileName, &xSeqName, &ySeqName, &Method);
-    ComL.IntSet(5, &StartNeuron, &EndNeuron, &Winners, &xGraphLen, &yGraphLen);
+    ComL.IntSet(6, &StartNeuron, &EndNeuron, &Winners, &xGraphLen, &yGraphLen,
+                &Precision);
     ComL.FlagSet(3, &DoSummary, &DoDov, &DoGraph);
     argunset = false;
   }
@@ -5121,13 +6569,31 @@ void Sim(ArgListType& arg) {  // AT_FUN
     exit(EXIT_FAILURE);
   }
 
-  DataMatrix xMat = SystemVar::getData(xSeqName, FunctionName, ComL);
-  int xSeqSize = xMat.size();
-  int MaxSize = findMaxSize(xMat);
-
-  DataMatrix yMat = SystemVar::getData(ySeqName, FunctionName, ComL);
-  int ySeqSize = yMat.size();
-  MaxSize = findMaxSize(yMat, MaxSize);
+  // Two sequences are compared as bit patterns, a word of neurons at a time;
+  // anything else goes through the matrix form
+  const bool useBits = (xType == 'S') && (yType == 'S');
+  Sequence xBits;
+  Sequence yBits;
+  DenseMatrix xConverted;
+  DenseMatrix yConverted;
+  const DenseMatrix *xMatPtr = &xConverted;
+  const DenseMatrix *yMatPtr = &yConverted;
+  int xSeqSize, ySeqSize, MaxSize;
+  if (useBits) {
+    xBits = UISeqToPtnSeq(SystemVar::getSequence(xSeqName, FunctionName, ComL));
+    yBits = UISeqToPtnSeq(SystemVar::getSequence(ySeqName, FunctionName, ComL));
+    xSeqSize = xBits.size();
+    ySeqSize = yBits.size();
+    MaxSize = findMaxSize(yBits, findMaxSize(xBits));
+  } else {
+    xMatPtr = &SystemVar::getData(xSeqName, xConverted, FunctionName, ComL);
+    yMatPtr = &SystemVar::getData(ySeqName, yConverted, FunctionName, ComL);
+    xSeqSize = xMatPtr->size();
+    ySeqSize = yMatPtr->size();
+    MaxSize = findMaxSize(*yMatPtr, findMaxSize(*xMatPtr));
+  }
+  const DenseMatrix &xMat = *xMatPtr;
+  const DenseMatrix &yMat = *yMatPtr;
 
   int startN = StartNeuron.getValue();
   int endN = EndNeuron.getValue();
@@ -5144,65 +6610,69 @@ void Sim(ArgListType& arg) {  // AT_FUN
 
   // Precalculate the magnitudes
   DataList xMag(xSeqSize);
-  DataMatrixCIt xDMCIt = xMat.begin();
-  for (int ix = 0; ix < xSeqSize; ++ix, ++xDMCIt) {
-    double sum = 0.0L;
-    int stopN = min(endN, static_cast<int>(xDMCIt->size()));
-    for (int j = startN-1; j < stopN; ++j) {
-      sum += xDMCIt->at(j) * xDMCIt->at(j);
-    }
-    xMag.at(ix) = static_cast<float>(sum);
-  }
   DataList yMag(ySeqSize);
-  DataMatrixCIt yDMCIt = yMat.begin();
-  for (int iy = 0; iy < ySeqSize; ++iy, ++yDMCIt) {
-    double sum = 0.0L;
-    int stopN = min(endN, static_cast<int>(yDMCIt->size()));
-    for (int j = startN-1; j < stopN; ++j) {
-      sum += yDMCIt->at(j) * yDMCIt->at(j);
+  if (useBits) {
+    // Keep only the neurons in range, so that magnitudes are popcounts and
+    // dot products are popcounts of intersections
+    Pattern inRange(MaxSize);
+    for (int n = startN-1; n < endN; ++n) {
+      inRange.set(n);
     }
-    yMag.at(iy) = static_cast<float>(sum);
-  }
-
-  DataMatrix SimBuffer;
-
-  // Perform the calculation
-  yDMCIt = yMat.begin();
+    for (int ix = 0; ix < xSeqSize; ++ix) {
+      xBits[ix] &= inRange;
+      xMag.at(ix) = static_cast<float>(xBits[ix].count());
+    }
+    for (int iy = 0; iy < ySeqSize; ++iy) {
+      yBits[iy] &= inRange;
+      yMag.at(iy) = static_cast<float>(yBits[iy].count());
+    }
+  } else {
+    for (int ix = 0; ix < xSeqSize; ++ix) {
+      const DenseMatrix::ConstRow xRow = xMat[ix];
+      double sum = 0.0L;
+      const int stopN = min(endN, static_cast<int>(xRow.size()));
+      for (int j = startN-1; j < stopN; ++j) {
+        sum += xRow[j] * xRow[j];
+      }
+      xMag[ix] = static_cast<float>(sum);
+    }
+    for (int iy = 0; iy < ySeqSize; ++iy) {
+      const DenseMatrix::ConstRow yRow = yMat[iy];
+      double sum = 0.0L;
+      const int stopN = min(endN, static_cast<int>(yRow.size()));
+      for (int j = startN-1; j < stopN; ++j) {
+        sum += yRow[j] * yRow[j];
+      }
+      yMag[iy] = static_cast<float>(sum);
+    }
+  }
+
+  DenseMatrix SimBuffer(ySeqSize, xSeqSize);
+
+  // Perform the calculation. @Sim draws no random numbers, so unlike the
+  // simulation it can use all Threads workers whatever the RNGType.
+  const unsigned int numThreads = SystemVar::GetIntVar("Threads");
+  if (Workers.size() < numThreads) Workers.resize(numThreads);
+  const std::size_t rowBytes = useBits ?
+    std::max<std::size_t>(xBits.empty() ? 0 : xBits[0].numWords(), 1) * sizeof(Pattern::word_type) :
+    std::max(MaxSize, 1) * sizeof(float);
+  SimJob job(xBits, yBits, xMat, yMat, xMag, yMag, SimBuffer, Workers.size());
+  job.Method = meth;
+  job.UseBits = useBits;
+  job.StartN = startN;
+  job.EndN = endN;
+  job.BlockLen = static_cast<int>(std::max<std::size_t>(SimBlockBytes / rowBytes, 1));
+  Workers.run(SimWorker, &job);
+  // The first element compared sets worst, as if one worker had done them all
   double worst = 0.0L;
-  for (int i = 0; i < ySeqSize; ++i, ++yDMCIt) {
-    DataList temp_vect(xSeqSize);
-    xDMCIt = xMat.begin();
-    for (int j = 0; j < xSeqSize; ++j, ++xDMCIt) {
-      double sim = 0.0f;
-      if ((fabs(xMag.at(j)) < verySmallFloat) || (fabs(yMag.at(i)) < verySmallFloat)) {
-        if (meth == -1) {
-          sim = 1.0f;
-        } else if (meth == 1) {
-          sim = xMag.at(j) + yMag.at(i);
-        }
-      } else {
-        double dot_prod = 0.0f;
-        int lastN = static_cast<int>(min(xDMCIt->size(), yDMCIt->size()));
-        for (int n = startN-1; n < min(endN, lastN); ++n) {
-          dot_prod += xDMCIt->at(n) * yDMCIt->at(n);
-        }
-        sim = 0.0f;
-        if (meth) {
-          sim = xMag.at(j) + yMag.at(i) - 2.0f * dot_prod;
-        } else {
-          sim = dot_prod / (sqrt(xMag.at(j) * yMag.at(i)));
-        }
-        if (meth == -1) {
-          sim /= (xMag.at(j) + yMag.at(i));
-        }
-      }
-      temp_vect.at(j) = static_cast<float>(sim);
-      bool worse = (meth) ? (sim > worst) : (sim < worst);
-      if (((i == 0) && (j == 0)) || worse) {
-        worst = sim;
-      }
+  bool foundWorst = false;
+  for (unsigned int w = 0; w < Workers.size(); ++w) {
+    if (!job.Found[w]) continue;
+    const bool worse = (meth) ? (job.Worst[w] > worst) : (job.Worst[w] < worst);
+    if (!foundWorst || worse) {
+      worst = job.Worst[w];
+      foundWorst = true;
     }
-    SimBuffer.push_back(temp_vect);
   }
   SystemVar::insertData("SimBuffer", SimBuffer, DLT_matrix);
 
@@ -5259,16 +6729,14 @@ void Sim(ArgListType& arg) {  // AT_FUN
       winvalues = DataList(numWinners, static_cast<float>(worst));
       // loop through the number of summaries
       for (int j = 0; j < numWinners; ++j) {
-        // loop through the rest of the ys (begin in reverse is the end)
-        DataMatrix::reverse_iterator sDMRevCIt = SimBuffer.rbegin();
         // so we always find one better
         double best = (meth) ? (worst + 1.0f) : (worst - 1.0f);
-        //            for (int k = ySeqSize - 1; k >= 0; --k, --sDMRevCIt) {
-        for (int k = ySeqSize - 1; k >= 0; --k, ++sDMRevCIt) {
+        // loop through the rest of the ys, from the end
+        for (int k = ySeqSize - 1; k >= 0; --k) {
+          const float simVal = SimBuffer[k][i1];
           // if one wins, then check against past winners and update if
           // necessary
-          bool better = (meth) ? (sDMRevCIt->at(i1) <= best)
-            : (sDMRevCIt->at(i1) >= best);
+          bool better = (meth) ? (simVal <= best) : (simVal >= best);
           if (better) {
             bool found = false;
             for (int m = 0; m < j; ++m) {
@@ -5279,7 +6747,7 @@ void Sim(ArgListType& arg) {  // AT_FUN
             }
             // if not already in our winners list
             if (!found) {
-              best = sDMRevCIt->at(i1);
+              best = simVal;
               winlist.at(j) = k;
               winvalues.at(j) = static_cast<float>(best);
             }
@@ -5351,8 +6819,7 @@ void Sim(ArgListType& arg) {  // AT_FUN
           }
           double yLen = yNext - yStart;
           int  yIndex = ySeqSize - ifloor(yStart) - 1;
-          DataMatrixCIt sDMCIt = SimBuffer.begin();
-          for (int inc = 1; inc < yIndex; ++inc, ++sDMCIt) {}
+          DenseMatrix::const_iterator sDMCIt = SimBuffer.begin() + max(yIndex - 1, 0);
           while (xStart < xEnd) {
             double xNext = xStart + 1.0L;
             if (xNext > xEnd) {
@@ -5377,15 +6844,15 @@ void Sim(ArgListType& arg) {  // AT_FUN
   }
   // OutPut the matrix
   if (FileName.getValue() != "{no file}") {
-    ofstream OutFile(FileName.getValue().c_str());
-    if (OutFile == NULL) {
+    if (!AsyncWriter::canWrite(FileName.getValue())) {
       CALL_ERROR << "Error in " << FunctionName << " : Could not open file "
                  << FileName.getValue() << " for writing" << ERR_WHERE;
       ComL.DisplayHelp(Output::Err());
       exit(EXIT_FAILURE);
     }
     IFROOTNODE {
-      for (DataMatrixCIt sDMCIt = SimBuffer.begin(); sDMCIt != SimBuffer.end(); ++sDMCIt) {
+      TextWriter OutFile(FileName.getValue(), true, Precision.getValue());
+      for (DenseMatrix::const_iterator sDMCIt = SimBuffer.begin(); sDMCIt != SimBuffer.end(); ++sDMCIt) {
         for (int j = 0; j < xSeqSize; j++) {
           OutFile << sDMCIt->at(j) << " ";
         }
@@ -5418,12 +6885,19 @@ void Test(ArgListType& arg) {  // AT_FUN
                                   "specific neuron.(with weight) Format of the "
                                   "parameter: # in list (2*# of neurons) and "
                                   "[cell#, filename]*", true);
+  static TArg<string> SpikeLogFile("-spikelog", "binary log of spikes {see @ReadSpikeLog}",
+                                   "{no log}");
+  static StrArgList SpikeCells("-spikecells", "# in list and neurons to log, numbered as "
+                               "for -cellrec {default: all}", true);
+  static FlagArg SpikeSyn("-spikesyn", "-nospikesyn",
+                          "also log the active synapses onto the logged neurons", 0);
   static StrArgList NoRecordList("-norecord",
                                  "List of datatypes to not get data for. This "
                                  "is useful only for reducing memory usage.",
                                  true);
   static FlagArg InhLearn("-inhlearn", "-noinhlearn", "inhibitory weight modification", 0);
-  static FlagArg SaveState("-savestate", "-nosavestate", "preserve ALL state", 3);
+  static FlagArg SaveState("-savestate", "-nosavestate",
+                           "leave the network as the test found it", 0);
   static CommandLine ComL(FunctionName);
   if (argunset) {
     ComL.HelpSet
@@ -5446,52 +6920,46 @@ void Test(ArgListType& arg) {  // AT_FUN
        "Sets TestingIzhU to a matrix containing the Izhikevich u values of\n"
        "\teach neuron for each timestep of the last training trial.\n"
        "Sets AveThreshold to the average threshold.\n"
-       "Sets AveTestAct to the average activity.\n");
-    ComL.StrSet(2, &SeqName, &Analysis);
+       "Sets AveTestAct to the average activity.\n"
+       "With -savestate, the network is put back as it was before the test\n"
+       "\t(other than the random number generators), at a cost that goes\n"
+       "\twith what the test changed rather than with the network's size.\n");
+    ComL.StrSet(3, &SeqName, &Analysis, &SpikeLogFile);
     ComL.IntSet(4, &TimeSteps, &StartPat, &EndPat, &StartStep);
-    ComL.FlagSet(3, &NetType, &InhLearn, &SaveState);
-    ComL.StrListSet(2, &CellRecording, &NoRecordList);
+    ComL.FlagSet(4, &NetType, &InhLearn, &SaveState, &SpikeSyn);
+    ComL.StrListSet(3, &CellRecording, &NoRecordList, &SpikeCells);
     argunset = false;
   }
   ComL.Process(arg, Output::Err());
 
-  // State* netState;
-  // if (SaveState.getValue()) {
-  //   netState = new State(ni, timeStep, Fired, FanInCon, dendriteQueue,
-  //                        dendriteQueue_inhdiv, dendriteQueue_inhsub,
-  //                        IzhV, IzhU, inMatrix);
-  // }
-
   const int ntst = TimeSteps.getValue();
   const int StartPrompt = StartStep.getValue();
   const bool davesRule = InhLearn.getValue();
   int StartLocation = StartPat.getValue();
   int EndLocation = EndPat.getValue();
 
-  TrainingNetwork = false;
-
-  // Save w_iI values
-  if (davesRule) {
-    for (PopulationIt pIt = Population::Member.begin();
-         pIt != Population::Member.end(); ++pIt) {
-      pIt->saveInhState();
-    }
-  }
-
   // check to make sure that CreateNetwork was called
   if (!program::Main().getNetworkCreated()) {
     CALL_ERROR << "Error: You must call @CreateNetwork() before you can "
                << "Train or Test." << ERR_WHERE;
     exit(EXIT_FAILURE);
   }
-  UIPtnSequence Seq;
-  bool useSeq = false;
-  if (SeqName.getValue() == "{zeros}") {
+
+  // Save w_iI values, or with -savestate whatever the test changes
+  if (davesRule || SaveState.getValue()) {
+    StartTestUndo(SaveState.getValue());
+  }
+
+  TrainingNetwork = false;
+
+  static const PackedSequence noSeq;
+  const bool useSeq = (SeqName.getValue() != "{zeros}");
+  const PackedSequence &Seq = useSeq ?
+    SystemVar::getSequence(SeqName.getValue(), FunctionName, ComL) : noSeq;
+  if (!useSeq) {
     StartLocation = 1;
     EndLocation = ntst;
   } else {
-    useSeq = true;
-    Seq = SystemVar::getSequence(SeqName.getValue(), FunctionName, ComL);
     if (EndLocation == -1) {
       EndLocation = Seq.size();
     }
@@ -5524,16 +6992,15 @@ void Test(ArgListType& arg) {  // AT_FUN
     exit(EXIT_FAILURE);
   }
   int  DoAnalysis = false;
-  ofstream analysisFile;
+  std::ostringstream analysisFile;
+  const string analysisFileName = MULTIPROCFILESUFFIX(Analysis.getValue());
 
   // NetType's default property is competitive, meaning that it will
   // return true if it is set to competitive.
   bool CompTest = NetType.getValue();
 
   if (Analysis.getValue() != "{no analysis}") {
-    string FileToOpen = MULTIPROCFILESUFFIX(Analysis.getValue());
-    analysisFile.open(FileToOpen.c_str(), ios::app);
-    if (!analysisFile) {
+    if (!AsyncWriter::canWrite(analysisFileName)) {
       CALL_ERROR << "Error in " << FunctionName << " : Could not open file "
                  << Analysis.getValue() << " for writing." << ERR_WHERE;
       ComL.DisplayHelp(Output::Err());
@@ -5542,16 +7009,10 @@ void Test(ArgListType& arg) {  // AT_FUN
     DoAnalysis = true;
   }
   // begin testing
-  UIPtnSequence Testing;
-  UIPtnSequence Externals;
-  DataMatrix BusLines;
-  DataMatrix IntBusLines;
-  DataMatrix KWeights;
-  DataMatrix Inhibitions;
+  PackedSequence Testing;
+  PackedSequence Externals;
   DataMatrix IzhVValues;
   DataMatrix IzhUValues;
-  DataMatrix FBInternrnExcs;
-  DataMatrix FFInternrnExcs;
   DataList TestActVect(TimeSteps.getValue());
   DataList TestThreshVect(TimeSteps.getValue());
 
@@ -5585,6 +7046,13 @@ void Test(ArgListType& arg) {  // AT_FUN
   if (SystemVar::GetIntVar("Reset")) {
     ResetSTM();
   }
+  SpikeLog spikeLog;
+  IFROOTNODE {
+    if (SpikeLogFile.getValue() != "{no log}") {
+      OpenSpikeLog(spikeLog, SpikeLogFile.getValue(), SpikeCells, SpikeSyn.getValue(),
+                   FunctionName, ComL);
+    }
+  }
   xInput curPattern;
   xInputListCIt ptnIt = xin.begin();
   if (StartLocation > int(xin.size())) {
@@ -5616,6 +7084,13 @@ void Test(ArgListType& arg) {  // AT_FUN
       RecordIdxList[9] = false;
     }
   }
+  // Where each per-neuron buffer goes (see @Record)
+  Recorder BusLines(Recorder::getSpec("TestingBusLines", RecordIdxList[2]));
+  Recorder IntBusLines(Recorder::getSpec("TestingIntBusLines", RecordIdxList[3]));
+  Recorder KWeights(Recorder::getSpec("TestingKWeights", RecordIdxList[4]));
+  Recorder Inhibitions(Recorder::getSpec("TestingInhibitions", RecordIdxList[5]));
+  Recorder FBInternrnExcs(Recorder::getSpec("TestingFBInternrnExc", RecordIdxList[6]));
+  Recorder FFInternrnExcs(Recorder::getSpec("TestingFFInternrnExc", RecordIdxList[7]));
   // Advance the current input pattern to the starting location
   for (int i3 = 1; i3 < StartLocation ; i3++, ptnIt++) {}
 #if !defined(TIMING_MODE)
@@ -5670,6 +7145,7 @@ void Test(ArgListType& arg) {  // AT_FUN
       // Do the recording
       for (int i = 0; i < SCRArgs; i += 2)
         RecordSynapticFiring(atoi(CellRecording[i].c_str()), CellRecording[i+1]);
+      if (spikeLog.isOpen()) LogSpikes(spikeLog);
     }
 
     // Update the various buffers
@@ -5680,6 +7156,7 @@ void Test(ArgListType& arg) {  // AT_FUN
     SumThresh += Threshold;
     if (DoAnalysis) {
       analysisFile << i4 << "\t" << TestActVect.at(i4 - 1) << "\n";
+      AsyncWriter::write(analysisFileName, analysisFile);
     }
   }
 
@@ -5708,12 +7185,12 @@ void Test(ArgListType& arg) {  // AT_FUN
 
   if (RecordIdxList[0]) SystemVar::insertSequence("TestingBuffer", Testing);
   if (RecordIdxList[1]) SystemVar::insertSequence("TestingExtBuffer", Externals);
-  if (RecordIdxList[2]) SystemVar::insertData("TestingBusLines", BusLines, DLT_matrix);
-  if (RecordIdxList[3]) SystemVar::insertData("TestingIntBusLines", IntBusLines, DLT_matrix);
-  if (RecordIdxList[4]) SystemVar::insertData("TestingKWeights", KWeights, DLT_matrix);
-  if (RecordIdxList[5]) SystemVar::insertData("TestingInhibitions", Inhibitions, DLT_matrix);
-  if (RecordIdxList[6]) SystemVar::insertData("TestingFBInternrnExc", FBInternrnExcs, DLT_matrix);
-  if (RecordIdxList[7]) SystemVar::insertData("TestingFFInternrnExc", FFInternrnExcs, DLT_matrix);
+  FinishRecording(BusLines, "TestingBusLines");
+  FinishRecording(IntBusLines, "TestingIntBusLines");
+  FinishRecording(KWeights, "TestingKWeights");
+  FinishRecording(Inhibitions, "TestingInhibitions");
+  FinishRecording(FBInternrnExcs, "TestingFBInternrnExc");
+  FinishRecording(FFInternrnExcs, "TestingFFInternrnExc");
   const bool trackIzhBuffs = (SystemVar::GetIntVar("IzhTrackData") != 0);
   if (trackIzhBuffs) {
     SystemVar::insertData("TestingIzhV", IzhVValues, DLT_matrix);
@@ -5732,20 +7209,11 @@ void Test(ArgListType& arg) {  // AT_FUN
     SystemVar::insertData("TestingThresholds", TempTTMat, DLT_matrix);
   }
 
-  // Save w_iI values
-  if (davesRule) {
-    for (PopulationIt pIt = Population::Member.begin();
-         pIt != Population::Member.end(); ++pIt) {
-      pIt->restoreInhState();
-    }
+  // Restore w_iI values, or with -savestate everything the test changed
+  if (TestUndo.isRecording()) {
+    TestUndo.rollBack();
+    TestUndoAxons.clear();
   }
-
-  // if (SaveState.getValue()) {
-  //   netState->undoState(timeStep, dendriteQueue,
-  //                       dendriteQueue_inhdiv, dendriteQueue_inhsub,
-  //                       Fired, IzhV, IzhU, inMatrix);
-  //   delete netState;
-  // }
 #if defined(TIMING_MODE)
   finish = rdtsc();
   IFROOTNODE
@@ -5779,6 +7247,18 @@ void Train(ArgListType& arg) {  // AT_FUN
                                   "specific neuron.(with weight) Format of the "
                                   "parameter: # in list (2*# of neurons) and "
                                   "[cell#, filename]*", true);
+  static TArg<string> SpikeLogFile("-spikelog", "binary log of spikes {see @ReadSpikeLog}",
+                                   "{no log}");
+  static StrArgList SpikeCells("-spikecells", "# in list and neurons to log, numbered as "
+                               "for -cellrec {default: all}", true);
+  static FlagArg SpikeSyn("-spikesyn", "-nospikesyn",
+                          "also log the active synapses onto the logged neurons", 0);
+  static TArg<string> WijHistFile("-wijhist", "binary history of the weights "
+                                  "{see @ReadWeightHistory}", "{no history}");
+  static TArg<int> WijHistEvery("-wijhistevery", "time steps between weight snapshots "
+                                "{0: only at the end of each trial}", 0);
+  static TArg<double> WijHistMin("-wijhistmin", "smallest change of a weight that "
+                                 "-wijhist records", 0.0);
   static StrArgList NoRecordList("-norecord",
                                  "List of datatypes to not get data for. This "
                                  "is useful only for reducing memory usage.",
@@ -5815,11 +7295,16 @@ void Train(ArgListType& arg) {  // AT_FUN
                  "If Reset is nonzero, then the network is Reset before each trial.\n"
                  "In this case, if ResetPattern is \"\" then Reset picks a random\n"
                  "pattern with activity ResetAct, otherwise Reset uses the first\n"
-                 "pattern found in the sequence whose name is given by ResetPattern.\n");
-    ComL.StrSet(2, &SeqName, &AnaFile);
-    ComL.IntSet(2, &Trials, &SynModBegin);
-    ComL.FlagSet(2, &NetType, &DoWijAna);
-    ComL.StrListSet(3, &AnaCalls, &CellRecording, &NoRecordList);
+                 "pattern found in the sequence whose name is given by ResetPattern.\n"
+                 "-wijhist records the weights, then at the end of each trial (and\n"
+                 "\tevery -wijhistevery time steps) those that have changed by more\n"
+                 "\tthan -wijhistmin. Later @Train calls with the same file and\n"
+                 "\tnetwork carry on the same history.\n");
+    ComL.StrSet(4, &SeqName, &AnaFile, &SpikeLogFile, &WijHistFile);
+    ComL.IntSet(3, &Trials, &SynModBegin, &WijHistEvery);
+    ComL.DblSet(1, &WijHistMin);
+    ComL.FlagSet(3, &NetType, &DoWijAna, &SpikeSyn);
+    ComL.StrListSet(4, &AnaCalls, &CellRecording, &NoRecordList, &SpikeCells);
     argunset = false;
   }
   ComL.Process(arg, Output::Err());
@@ -5838,7 +7323,7 @@ void Train(ArgListType& arg) {  // AT_FUN
                << "Train or Test." << ERR_WHERE;
     exit(EXIT_FAILURE);
   }
-  UIPtnSequence Seq = SystemVar::getSequence(SeqName.getValue(), FunctionName, ComL);
+  const PackedSequence &Seq = SystemVar::getSequence(SeqName.getValue(), FunctionName, ComL);
   if (Trials.getValue() < 1) {
     CALL_ERROR << "Error in " << FunctionName <<
       " : invalid number of trials : " << Trials.getValue() << ERR_WHERE;
@@ -5846,20 +7331,28 @@ void Train(ArgListType& arg) {  // AT_FUN
     exit(EXIT_FAILURE);
   }
   int  DoAnalysis = false;
-  ofstream analysisFile;
+  std::ostringstream analysisFile;
+  // pfr 12/99 Concat the PE id to end of file so that each
+  //    PE writes to its own file
+  const string analysisFileName = MULTIPROCFILESUFFIX(AnaFile.getValue());
 
   IFROOTNODE {    // changed - dws - 7/17/2003
     if (AnaFile.getValue() != "{no analysis}") {
-      // pfr 12/99 Concat the PE id to end of file so that each
-      //    PE writes to its own file
-      string FileToOpen = MULTIPROCFILESUFFIX(AnaFile.getValue());
-      analysisFile.open(FileToOpen.c_str(), ios::app);
-      // end pfr 12/99
-      long fileSize = analysisFile.tellp();
+      if (!AsyncWriter::canWrite(analysisFileName)) {
+        CALL_ERROR << MSG << "Error in " << FunctionName <<
+          " : Could not open file " << AnaFile.getValue() << " for writing." << ERR_WHERE;
+        ComL.DisplayHelp(Output::Err());
+        exit(EXIT_FAILURE);
+      }
+      // Earlier rows may still be on their way to the file
+      AsyncWriter::flush();
+      ifstream sizeCheck(analysisFileName.c_str(), ios::in | ios::ate);
+      const long fileSize = sizeCheck.tellg();
       analysisFile.fill(' ');
       analysisFile.precision(10);
       analysisFile.setf(ios_base::showpoint, ios_base::floatfield);
-      if (fileSize == 0) {
+      // A file that is not there yet reads as -1
+      if (fileSize <= 0) {
         analysisFile << std::setw(6) << "Trial ";
         analysisFile << std::setw(16) << "AveTrainAct";
         analysisFile << std::setw(14) << "AvgWij";
@@ -5870,13 +7363,7 @@ void Train(ArgListType& arg) {  // AT_FUN
         analysisFile << std::setw(10) << "Num0s";
         analysisFile << std::setw(20) << "sumPyrToInternrnWt";
         analysisFile << std::setw(20) << "numPyrToInternrnWt0" << std::endl;
-      }
-
-      if (!analysisFile) {
-        CALL_ERROR << MSG << "Error in " << FunctionName <<
-          " : Could not open file " << AnaFile.getValue() << " for writing." << ERR_WHERE;
-        ComL.DisplayHelp(Output::Err());
-        exit(EXIT_FAILURE);
+        AsyncWriter::write(analysisFileName, analysisFile);
       }
       DoAnalysis = true;
 #if defined(MULTIPROC)
@@ -5886,22 +7373,33 @@ void Train(ArgListType& arg) {  // AT_FUN
 #endif
     }
   }
+  SpikeLog spikeLog;
+  IFROOTNODE {
+    if (SpikeLogFile.getValue() != "{no log}") {
+      OpenSpikeLog(spikeLog, SpikeLogFile.getValue(), SpikeCells, SpikeSyn.getValue(),
+                   FunctionName, ComL);
+    }
+  }
+  const bool recordWij = (WijHistFile.getValue() != "{no history}");
+  if (recordWij) {
+    if ((WijHistEvery.getValue() < 0) || (WijHistMin.getValue() < 0.0)) {
+      CALL_ERROR << "Error in " << FunctionName << " : -wijhistevery and -wijhistmin "
+        "cannot be negative" << ERR_WHERE;
+      ComL.DisplayHelp(Output::Err());
+      exit(EXIT_FAILURE);
+    }
+    OpenWeightHistory(WijHistFile.getValue(), WijHistMin.getValue(), FunctionName, ComL);
+  }
 
   // NetType's default property is competitive, meaning that it will
   // return true if it is set to competitive.
   int  CompTrain = NetType.getValue();
 
   const int ntrn = Trials.getValue();
-  UIPtnSequence Training;
-  UIPtnSequence Externals;
-  DataMatrix BusLines;
-  DataMatrix IntBusLines;
-  DataMatrix KWeights;
-  DataMatrix Inhibitions;
+  PackedSequence Training;
+  PackedSequence Externals;
   DataMatrix IzhVValues;
   DataMatrix IzhUValues;
-  DataMatrix FBInternrnExcs;
-  DataMatrix FFInternrnExcs;
   DataList TrainThreshVect;
   DataList TrainingAct;
 
@@ -5968,10 +7466,18 @@ void Train(ArgListType& arg) {  // AT_FUN
       RecordIdxList[9] = false;
     }
   }
+  // Where each per-neuron buffer goes (see @Record)
+  Recorder BusLines(Recorder::getSpec("TrainingBusLines", RecordIdxList[2]));
+  Recorder IntBusLines(Recorder::getSpec("TrainingIntBusLines", RecordIdxList[3]));
+  Recorder KWeights(Recorder::getSpec("TrainingKWeights", RecordIdxList[4]));
+  Recorder Inhibitions(Recorder::getSpec("TrainingInhibitions", RecordIdxList[5]));
+  Recorder FBInternrnExcs(Recorder::getSpec("TrainingFBInternrnExc", RecordIdxList[6]));
+  Recorder FFInternrnExcs(Recorder::getSpec("TrainingFFInternrnExc", RecordIdxList[7]));
 
 #if defined(TIMING_P2P)
   trials = 0;
   total_time = 0;
+  total_overlap = 0;
 #endif
 
   int synModBegin = SynModBegin.getValue();
@@ -5981,6 +7487,12 @@ void Train(ArgListType& arg) {  // AT_FUN
     // reset before each training trial
     if (SystemVar::GetIntVar("Reset")) {
       ResetSTM();
+#if defined(PEER_TO_PEER)
+      // Nothing but the weights carries over, so nodes can trade neurons
+      const int rebalance = SystemVar::GetIntVar("Rebalance");
+      if ((rebalance > 0) && (i3 > 1) && ((i3 - 1) % rebalance == 0) && !SpikeExchange)
+        RebalanceNetwork(rebalance * PatternCount);
+#endif
     }
 
     SystemVar::IncIntVar("TrainingCount");  // increment the training count
@@ -6016,10 +7528,6 @@ void Train(ArgListType& arg) {  // AT_FUN
 #endif
       }
 
-#if defined(MULTIPROC)
-
-#endif
-
       bool doCompPresent = CompTrain;
 #if defined(PARENT_CHILD)
       // For parent/child mode, parent figures out who fires
@@ -6054,6 +7562,7 @@ void Train(ArgListType& arg) {  // AT_FUN
           // Do the recording
           for (int i = 0; i < SCRArgs; i += 2)
             RecordSynapticFiring(atoi(CellRecording[i].c_str()), CellRecording[i+1]);
+          if (spikeLog.isOpen()) LogSpikes(spikeLog);
         }
       }
 
@@ -6071,6 +7580,14 @@ void Train(ArgListType& arg) {  // AT_FUN
       SumThresh += Threshold;
       SumNumFired += Fired[justNow].size();
       SumNumTies += TotalNumTied;
+      if (recordWij && (WijHistEvery.getValue() > 0)
+          && (withinTrialTimestep % WijHistEvery.getValue() == 0)) {
+        SnapshotWeights(withinTrialTimestep);
+      }
+    }
+    if (recordWij && ((WijHistEvery.getValue() == 0)
+                      || (withinTrialTimestep % WijHistEvery.getValue() != 0))) {
+      SnapshotWeights(withinTrialTimestep);
     }
 #  if defined(TIMING_MODE2)
     t1 = 0;
@@ -6153,6 +7670,7 @@ void Train(ArgListType& arg) {  // AT_FUN
                      << std::setw(10) << TotalNumberOfZeros
                      << std::setw(20) << sumPyrToInternrnWt
                      << std::setw(20) << numPyrToInternrnWt0 << std::endl;
+        AsyncWriter::write(analysisFileName, analysisFile);
       }
     }
 
@@ -6170,14 +7688,15 @@ void Train(ArgListType& arg) {  // AT_FUN
   }
 #endif
 
+  IFROOTNODE WijHistory.flush();
   if (RecordIdxList[0]) SystemVar::insertSequence("TrainingBuffer", Training);
   if (RecordIdxList[1]) SystemVar::insertSequence("TrainingExtBuffer", Externals);
-  if (RecordIdxList[2]) SystemVar::insertData("TrainingBusLines", BusLines, DLT_matrix);
-  if (RecordIdxList[3]) SystemVar::insertData("TrainingIntBusLines", IntBusLines, DLT_matrix);
-  if (RecordIdxList[4]) SystemVar::insertData("TrainingKWeights", KWeights, DLT_matrix);
-  if (RecordIdxList[5]) SystemVar::insertData("TrainingInhibitions", Inhibitions, DLT_matrix);
-  if (RecordIdxList[6]) SystemVar::insertData("TrainingFBInternrnExc", FBInternrnExcs, DLT_matrix);
-  if (RecordIdxList[7]) SystemVar::insertData("TrainingFFInternrnExc", FFInternrnExcs, DLT_matrix);
+  FinishRecording(BusLines, "TrainingBusLines");
+  FinishRecording(IntBusLines, "TrainingIntBusLines");
+  FinishRecording(KWeights, "TrainingKWeights");
+  FinishRecording(Inhibitions, "TrainingInhibitions");
+  FinishRecording(FBInternrnExcs, "TrainingFBInternrnExc");
+  FinishRecording(FFInternrnExcs, "TrainingFFInternrnExc");
   const bool trackIzhBuffs = (SystemVar::GetIntVar("IzhTrackData") != 0);
   if (trackIzhBuffs) {
     SystemVar::insertData("TrainingIzhV", IzhVValues, DLT_matrix);
@@ -6208,6 +7727,8 @@ void Train(ArgListType& arg) {  // AT_FUN
 #if defined(TIMING_P2P)
   Output::Out() << "Average exchange time  = " << (total_time) / (double)trials
                 << " seconds over " << trials << " trials" << endl;
+  Output::Out() << "Average overlapped time = " << (total_overlap) / (double)trials
+                << " seconds" << endl;
 #endif
 
   return;
@@ -6375,11 +7896,7 @@ void Context(ArgListType& arg) {  // AT_FUN
     // figure out the longest possible context
     unsigned int ctxlen = 0;
     for (SequenceCIt nrnIt = InvSeq.begin(); nrnIt != InvSeq.end(); ++nrnIt) {
-      unsigned int numfires = 0;
-      for (unsigned int t = 0; t < TotalTimeSteps; ++t) {
-        if (nrnIt->at(t)) numfires++;
-      }
-      updateMax(ctxlen, numfires);
+      updateMax(ctxlen, static_cast<unsigned int>(nrnIt->count()));
     }
     ++ctxlen;
 
@@ -6533,8 +8050,10 @@ void FileReset(ArgListType& arg) {  // AT_FUN
                     << std::endl << std::endl;
       exit(EXIT_FAILURE);
     }
+    // Through the AsyncWriter, which may still have writes queued for a
+    // file, or hold it open
     for (ArgListTypeIt it = arg.begin(); it != arg.end(); it++) {
-      ofstream fset(it->first.c_str());
+      AsyncWriter::empty(it->first);
     }
   }
 #if defined(MULTIPROC)
@@ -6581,6 +8100,158 @@ void SeedRNG(ArgListType& arg) {  // AT_FUN
   program::Main().setAllSeeds();
 }
 
+#if !defined(WIN32)
+// A forked @Sweep worker: takes its value of the swept variable (and its
+// seed), runs the script with its output going to logName and exits
+// without returning to the parent's script.
+void RunSweepWorker(const string &script, const unsigned int index,
+                    const string &varName, const string &value,
+                    const string &seed, const string &logName) {
+  std::ofstream log(logName.c_str());
+  if (log) Output::setStreams(log, log);
+  SystemVar::SetIntVar("SweepIndex", index);
+  ArgListType setArgs;
+  setArgs.push_back(ArgType(varName, false));
+  setArgs.push_back(ArgType(value, false));
+  if (!seed.empty()) {
+    setArgs.push_back(ArgType("seed", false));
+    setArgs.push_back(ArgType(seed, false));
+  }
+  SetVar(setArgs);
+  if (!seed.empty()) program::Main().setAllSeeds();
+  Parser::ParseScript(script);
+  AsyncWriter::flush();
+  log.flush();
+  exit(log ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+#endif
+
+void Sweep(ArgListType& arg) {  // AT_FUN
+  // process the function arguments
+  static string FunctionName = "Sweep";
+  static int argunset = true;
+  static TArg<string> Script("-script", "script each worker runs");
+  static TArg<string> VarName("-var", "variable to sweep");
+  static StrArgList Values("-values", "# in list and the values of -var, one a worker");
+  static StrArgList Seeds("-seeds", "# in list and each worker's seed "
+                          "(default: keep the current rng state)", true);
+  static TArg<int> Jobs("-jobs", "most workers at once (0: one a processor)", 0);
+  static TArg<string> LogName("-log", "each worker's output goes to this "
+                              "followed by its SweepIndex and .log", "Sweep");
+  static CommandLine ComL(FunctionName);
+  if (argunset) {
+    ComL.HelpSet("@Sweep( ... ) runs a script once for each value of a variable,\n"
+                 "\t\t\t in worker processes forked from this one, so the\n"
+                 "\t\t\t network built so far is shared rather than built\n"
+                 "\t\t\t again. Each worker sets the variable (and seed) as\n"
+                 "\t\t\t @SetVar would and sets SweepIndex to its place in\n"
+                 "\t\t\t -values, from 1, to name its output files by. The\n"
+                 "\t\t\t script goes on after the sweep as if it had not run.\n");
+    ComL.StrSet(3, &Script, &VarName, &LogName);
+    ComL.StrListSet(2, &Values, &Seeds);
+    ComL.IntSet(1, &Jobs);
+    argunset = false;
+  }
+  ComL.Process(arg, Output::Err());
+
+#if defined(MULTIPROC) || defined(WIN32)
+  CALL_ERROR << "Error in " << FunctionName << " : Not available in this build."
+             << ERR_WHERE;
+  exit(EXIT_FAILURE);
+#else
+  if (!std::ifstream(Script.getValue().c_str())) {
+    CALL_ERROR << "Error in " << FunctionName << " : Unable to read "
+               << Script.getValue() << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+  const unsigned int numWorkers = Values.size();
+  if (numWorkers == 0) {
+    CALL_ERROR << "Error in " << FunctionName << " : -values is empty." << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+  if ((Seeds.size() > 0) && (Seeds.size() != numWorkers)) {
+    CALL_ERROR << "Error in " << FunctionName << " : -seeds has " << Seeds.size()
+               << " entries for " << numWorkers << " values." << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+  long maxJobs = Jobs.getValue();
+  if (maxJobs < 0) {
+    CALL_ERROR << "Error in " << FunctionName << " : -jobs must be non-negative."
+               << ERR_WHERE;
+    ComL.DisplayHelp(Output::Err());
+    exit(EXIT_FAILURE);
+  }
+  if (maxJobs == 0) maxJobs = std::max(sysconf(_SC_NPROCESSORS_ONLN), 1L);
+
+  IFROOTNODE Output::Out() << "Sweeping " << VarName.getValue() << " over "
+                           << numWorkers << " value(s), " << maxJobs
+                           << " at a time:" << std::endl;
+  // Nothing may be left half-written, or be written twice, and a forked
+  // process has only the thread that called fork
+  AsyncWriter::flush();
+  Output::Out().flush();
+  Output::Err().flush();
+  fflush(NULL);
+  program::Main().stopPrefetch();
+  const unsigned int numThreads = Workers.size();
+  Workers.resize(1);
+
+  map<pid_t, unsigned int> running;
+  vector<unsigned int> failed;
+  unsigned int nextWorker = 0;
+  while ((nextWorker < numWorkers) || !running.empty()) {
+    if ((nextWorker < numWorkers) && (static_cast<long>(running.size()) < maxJobs)) {
+      const unsigned int index = nextWorker + 1;
+      ostringstream logName;
+      logName << LogName.getValue() << index << ".log";
+      const pid_t pid = fork();
+      if (pid == 0) {
+        AsyncWriter::forked();
+        program::Main().restartPrefetch();
+        Workers.resize(numThreads);
+        RunSweepWorker(Script.getValue(), index, VarName.getValue(),
+                       Values[nextWorker],
+                       (Seeds.size() > 0) ? Seeds[nextWorker] : EMPTYSTR,
+                       logName.str());
+      }
+      if (pid < 0) {
+        failed.push_back(index);
+      } else {
+        running[pid] = index;
+      }
+      ++nextWorker;
+      continue;
+    }
+    int status;
+    const pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0) break;
+    map<pid_t, unsigned int>::iterator it = running.find(pid);
+    if (it == running.end()) continue;
+    if (!WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+      failed.push_back(it->second);
+    }
+    IFROOTNODE Output::Out() << it->second << " " << std::flush;
+    running.erase(it);
+  }
+  IFROOTNODE Output::Out() << std::endl;
+
+  program::Main().restartPrefetch();
+  Workers.resize(numThreads);
+  if (!failed.empty()) {
+    std::sort(failed.begin(), failed.end());
+    CALL_ERROR << "Error in " << FunctionName << " : Worker(s)";
+    for (vector<unsigned int>::const_iterator it = failed.begin(); it != failed.end(); ++it) {
+      Output::Err() << " " << *it;
+    }
+    Output::Err() << " failed; see " << LogName.getValue() << "*.log" << ERR_WHERE;
+    exit(EXIT_FAILURE);
+  }
+#endif
+}
+
 void CreateAnalysis(ArgListType& arg) {  // AT_FUN
   int num = arg.size();
   if (num == 0) {
@@ -6659,22 +8330,22 @@ void UpdateAnalysis(const string& name) {
   CommandLine ComL(FunctionName);
 
   StrList AnaName;
-  DataMatrix &AnaList =
+  DenseMatrix &AnaList =
     SystemVar::getAnalysis(name, AnaName, FunctionName, ComL);
   StrListCIt nameIt = AnaName.begin();   // doesn't change here
-  DataMatrixIt dataIt = AnaList.begin();  // does change here
-  for (; nameIt != AnaName.end(); nameIt++, dataIt++) {
-    if (dataIt == AnaList.end()) {
+  unsigned int dataRow = 0;  // one row per name, each gaining a column here
+  for (; nameIt != AnaName.end(); nameIt++, dataRow++) {
+    if (dataRow == AnaList.size()) {
       CALL_ERROR << "Error in Analysis Algorithm!!" << ERR_WHERE;
       exit(EXIT_FAILURE);
     }
     char varType = SystemVar::GetVarType(*nameIt);
     if (varType == 'i') {
-      dataIt->push_back(static_cast<float>(SystemVar::GetIntVar(*nameIt)));
+      AnaList.append(dataRow, static_cast<float>(SystemVar::GetIntVar(*nameIt)));
     } else if (varType == 'f') {
-      dataIt->push_back(SystemVar::GetFloatVar(*nameIt));
+      AnaList.append(dataRow, SystemVar::GetFloatVar(*nameIt));
     } else if (varType == 's') {
-      dataIt->push_back(from_string<float>(SystemVar::GetStrVar(*nameIt)));
+      AnaList.append(dataRow, from_string<float>(SystemVar::GetStrVar(*nameIt)));
     } else {
       CALL_ERROR << "Analysis did not find " << *nameIt << ERR_WHERE;
       exit(EXIT_FAILURE);
@@ -6724,7 +8395,8 @@ string SumData(ArgListType& arg) {  // CARET_FUN
   }
   ComL.Process(arg, Output::Err());
 
-  DataMatrix Mat = SystemVar::getData(SeqName, FunctionName, ComL);
+  DenseMatrix converted;
+  const DenseMatrix &Mat = SystemVar::getData(SeqName, converted, FunctionName, ComL);
   const int MatSize = Mat.size();
   if ((FirstPat.getValue() > MatSize) || (FirstPat.getValue() < 1)) {
     CALL_ERROR << "Error in " << FunctionName << ": pattern " << FirstPat.getValue()
@@ -6739,8 +8411,7 @@ string SumData(ArgListType& arg) {  // CARET_FUN
     ComL.DisplayHelp(Output::Err());
     exit(EXIT_FAILURE);
   }
-  DataMatrixCIt it = Mat.begin();
-  for (int inc = 1; inc < FirstPat.getValue(); ++inc, ++it) {}
+  DenseMatrix::const_iterator it = Mat.begin() + (FirstPat.getValue() - 1);
   int endN = EndNeuron.getValue();
   int startN = StartNeuron.getValue();
   double sum = 0.0L;
@@ -6780,8 +8451,8 @@ string PatternLength(ArgListType& arg) {  // CARET_FUN
   }
   ComL.Process(arg, Output::Err());
 
-  DataMatrix Mat = SystemVar::getData(SeqName.getValue(), FunctionName, ComL);
-  DataMatrixCIt it = Mat.begin();
+  DenseMatrix converted;
+  const DenseMatrix &Mat = SystemVar::getData(SeqName.getValue(), converted, FunctionName, ComL);
   const int MatSize = Mat.size();
   if ((Pat.getValue() > MatSize) || (Pat.getValue() < 1)) {
     CALL_ERROR << "Error in " << FunctionName
@@ -6790,8 +8461,7 @@ string PatternLength(ArgListType& arg) {  // CARET_FUN
     ComL.DisplayHelp(Output::Err());
     exit(EXIT_FAILURE);
   }
-  for (int inc = 1; inc < Pat.getValue(); ++inc, ++it) {}
-  return to_string(it->size());
+  return to_string(Mat[Pat.getValue() - 1].size());
 }
 
 string SequenceLength(ArgListType &arg) {  // CARET_FUN
@@ -6807,6 +8477,10 @@ string SequenceLength(ArgListType &arg) {  // CARET_FUN
   }
   ComL.Process(arg, Output::Err());
 
-  DataMatrix Mat = SystemVar::getData(SeqName.getValue(), FunctionName, ComL);
+  // A sequence need not be converted just to count its patterns
+  if (SystemVar::GetVarType(SeqName.getValue()) == 'S')
+    return to_string(SystemVar::getSequence(SeqName, FunctionName, ComL).size());
+  DenseMatrix converted;
+  const DenseMatrix &Mat = SystemVar::getData(SeqName.getValue(), converted, FunctionName, ComL);
   return to_string(Mat.size());
 }
@@ -38,6 +38,9 @@
 #include <vector>
 
 // NeuroJet header files
+#if !defined(CHUNKEDFILE_HPP)
+#  include "ChunkedFile.hpp"
+#endif
 #if !defined(MATLAB_HPP)
 #  include "Matlab.hpp"
 #endif
@@ -47,6 +50,33 @@
 #if !defined(PARALLEL_HPP)
 #   include "Parallel.hpp"
 #endif
+#if !defined(PARTITION_HPP)
+#   include "Partition.hpp"
+#endif
+#if !defined(RECORDER_HPP)
+#   include "Recorder.hpp"
+#endif
+#if !defined(SIMSTATE_HPP)
+#   include "SimState.hpp"
+#endif
+#if !defined(SPIKELOG_HPP)
+#   include "SpikeLog.hpp"
+#endif
+#if !defined(TEXTLOADER_HPP)
+#   include "TextLoader.hpp"
+#endif
+#if !defined(TEXTWRITER_HPP)
+#   include "TextWriter.hpp"
+#endif
+#if !defined(THREADTEAM_HPP)
+#   include "ThreadTeam.hpp"
+#endif
+#if !defined(UNDOLOG_HPP)
+#   include "UndoLog.hpp"
+#endif
+#if !defined(WEIGHTHISTORY_HPP)
+#   include "WeightHistory.hpp"
+#endif
 #if !defined(NEURONTYPE_HPP)
 #  include "neural/NeuronType.hpp"
 #endif
@@ -176,11 +206,30 @@ AxonalSynapse ***outMatrix;     // Fan-out synapses (per axonal delay/segment)
 
 unsigned int StartNeuron;       // Index of first Neuron on a node
 unsigned int EndNeuron;         // Index of last Neuron on a node
+ThreadTeam Workers;             // shared-memory workers (Threads)
+bool ReproSum;                  // order-independent bus sums (ReproSum)
+FixedBus FixedSumwz;            // sumwz, sumwz_inhdiv and sumwz_inhsub as
+FixedBus FixedSumwz_inhdiv;     // they are accumulated with ReproSum
+FixedBus FixedSumwz_inhsub;
+WeightHistory WijHistory;       // @Train -wijhist, which goes on from one
+                                // @Train to the next
+UndoLog TestUndo;               // what @Test -savestate or -inhlearn
+                                // puts back when it is done
+vector<bool> TestUndoAxons;     // the neurons whose outgoing synapses
+                                // TestUndo holds (empty without -savestate)
+bool TestUndoLastActivates;     // whether TestUndo holds the last
+                                // activations of every synapse
 
 #if defined(MULTIPROC)
 UIVectorDeque FiredHere;  // what neurons fired on this node last timestep
 UIVector Shuffle;         // used so that externals are distributed randomly
 UIVector UnShuffle;       // used to make firing diagrams look nice
+bool SpikeExchange;       // nodes hold the fan-in of their own neurons and
+                          // exchange fired neurons instead of sumwz
+vector<double> NeuronWork;  // synapses activated by each neuron on this
+                            // node since the last rebalance
+ParallelInfo::FanInLayout WijHistoryLayout;  // where CollectWeights found
+                                             // each node's weights
 #   if defined(CHECK_BOUNDS)
 #      define SHUFFLEIFMULTIPROC(x) Shuffle.at(x)
 #      define UNSHUFFLEIFMULTIPROC(x) UnShuffle.at(x)
@@ -189,12 +238,15 @@ UIVector UnShuffle;       // used to make firing diagrams look nice
 #      define UNSHUFFLEIFMULTIPROC(x) UnShuffle[x]
 #   endif
 #   define MULTIPROCFILESUFFIX(x) x + to_string(ParallelInfo::getRank())
-#   define LOCALFIRED FiredHere
+// The fired neurons whose synapses are on this node
+#   define LOCALFIRED (SpikeExchange ? Fired : FiredHere)
+#   define SPIKEEXCHANGE SpikeExchange
 #else
 #   define SHUFFLEIFMULTIPROC(x) (x)
 #   define UNSHUFFLEIFMULTIPROC(x) (x)
 #   define MULTIPROCFILESUFFIX(x) x
 #   define LOCALFIRED Fired
+#   define SPIKEEXCHANGE false
 #endif
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -223,12 +275,17 @@ void CalcDendriticExcitation();
 void CalcDendriticToSomaInput(const xInput& curPattern, const bool isComp);
 double CalcFBInternrnExcitation();
 double CalcFFInternrnExcitation(const xInput &curPattern);
+void CalcInternrnInhibition(const xInput &curPattern);
 void CalcSomaResponse(const xInput &curPattern, DataMatrix &IzhVValues,
                       DataMatrix &IzhUValues);
 void CalcSynapticActivation(const UIVectorDeque &FiredArray,
                             const Pattern &inPattern);
+void SynActReduce(const unsigned int worker, void *arg);
+void SynActWorker(const unsigned int worker, void *arg);
 void CalcSynapticActivation(const UIVectorDeque &FiredArray,
                             const xInput &curPattern);
+float CellRecordingDt();
+int &CellRecordingOrigin();
 bool chkDataExists(const TArg<std::string> &DataName,
                    const DataListType newDataType,
                    const std::string& FunctionName, const CommandLine &ComL);
@@ -239,15 +296,24 @@ void DeAllocateMemory();
 void enqueueDendriticResponse(const DataList& dendriticResponse,
                               const DataList& dendResp_inhdiv,
                               const DataList& dendResp_inhsub);
+#if defined(MULTIPROC)
+vector<double> EstimateNeuronCosts();
+void ExchangeCandidates(vector<IxSumwz> &excSort,
+                        const unsigned int numLeft2Fire);
+void ExchangeFired();
+#endif
 const NeuronType* findNeuronType(const unsigned int nrn);
 void FireNonTiedNeurons(const unsigned int numLeft2Fire,
                         const vector<IxSumwz> &excSort);
+void FinishRecording(Recorder &rec, const std::string &bufferName);
 void FireSingleNeuron(const int nrn);
 void FireTiedNeurons(const unsigned int numLeft2Fire, const double cutOff,
                      vector<IxSumwz> &excSort);
-vector<xInput> GenerateInputSequence(UIPtnSequence &Seq, const float inputNoise,
+vector<xInput> GenerateInputSequence(const PackedSequence &Seq, const float inputNoise,
                                      const float exactNoise, int& SumExtFired,
                                      int& PatternCount);
+void BuildConnectivity(const UIMatrix &conn, const DataMatrix &wij,
+                       const UIMatrix &aij);
 void GetConnectivity(const std::string& filename);
 
 inline void eat_whitespace(std::istream &in) {
@@ -265,6 +331,8 @@ template <class T> void read_without_comments(std::istream &in, T &var) {
   in >> var;
 }
 
+void CollectWeights(UIVector &fanIn, UIVector &sources, DataList &weights);
+void CollectWeightValues(DataList &weights);
 void checkNextChar(bool& inIt, unsigned int& depthIn, const bool inString,
                    const char nextChar, const char deeperChar,
                    const char shallowerChar);
@@ -279,8 +347,22 @@ void getThetaSettings(const NeuronType& NeurType, int& Period, float& Amplitude,
                       float& MidPoint, float& Phase, bool& UseSin);
 inline void InitCurBucketStats();
 bool isNJNetworkFileType(const std::string& filename);
+inline bool IsRecordedActive(const DendriticSynapse &synapse);
 bool isNumeric(const std::string& toCheck);
 inline bool isLocalNeuron(const unsigned int nrn);
+inline bool isLocalSynapse(const unsigned int pre, const unsigned int post);
+void LoadChunkedData(const TArg<std::string> &dataName, const std::string &fileName,
+                     const DataListType dataType, const std::string &typeName,
+                     const std::string &subTypeName, const int startPat,
+                     const int endPat, const std::string &FunctionName,
+                     const CommandLine &ComL);
+void LoadNetworkState(SimState &state);
+void LogSpikes(SpikeLog &spikeLog);
+void OpenSpikeLog(SpikeLog &spikeLog, const std::string &fileName,
+                  const StrArgList &cells, const bool logSynapses,
+                  const std::string &FunctionName, const CommandLine &ComL);
+void OpenWeightHistory(const std::string &fileName, const float threshold,
+                       const std::string &FunctionName, const CommandLine &ComL);
 std::map<std::string, std::string> ParseStruct(const std::string& toParse);
 void Present(const xInput &curPattern, DataMatrix &IzhVValues,
              DataMatrix &IzhUValues, const bool modifyInhWeights,
@@ -294,18 +376,31 @@ MatlabCommand ReadMATLABcommand(std::ifstream& mfile,
                                 const std::string& filename);
 void ReadNJNetworkFile(const std::string& filename);
 void ReadPopulationFile(const std::string& filename, UIMatrix& effDelays);
+#if defined(MULTIPROC)
+void RebalanceNetwork(const unsigned int numSteps);
+#endif
 inline void RecordSynapticFiring(const int neuron, const std::string &);
 void resetDendriticQueues();
 void ResetSTM();
+#if !defined(WIN32)
+void RunSweepWorker(const string &script, const unsigned int index,
+                    const string &varName, const string &value,
+                    const string &seed, const string &logName);
+#endif
+void SaveFiredAxons(const UIVectorDeque &FiredArray);
+void SaveLastActivates();
+void SaveNetworkState(SimState &state);
 double selectCutOff(unsigned int k, unsigned int n, vector<IxSumwz> &arr);
 void SetConnectivity(const int &AllowSelf = true, const char &dType = 'p',
                      const float &p1 = 0.0f, const float &p2 = 1.0f,
                      const float &p3 = 0.0f, const float &p4 = 1.0f);
+void SnapshotWeights(const int step);
+void StartTestUndo(const bool allState);
 inline void UpdateBucketStats();
-void UpdateBuffers(UIPtnSequence &FiringPtns, UIPtnSequence &ExtPtns,
-                   DataMatrix &BusLines, DataMatrix &IntBusLines,
-                   DataMatrix &KWeights, DataMatrix &Inhibitions,
-                   DataMatrix &FBInternrnExcs, DataMatrix &FFInternrnExcs,
+void UpdateBuffers(PackedSequence &FiringPtns, PackedSequence &ExtPtns,
+                   Recorder &BusLines, Recorder &IntBusLines,
+                   Recorder &KWeights, Recorder &Inhibitions,
+                   Recorder &FBInternrnExcs, Recorder &FFInternrnExcs,
                    DataList &ActVect, DataList &ThreshVect,
                    const unsigned int ndx, const xInput &curPattern,
                    const vector<bool> &RecordIdxList);
@@ -314,8 +409,9 @@ void UpdateParams(const std::string &varName, const std::string &varValue,
                   const std::string &FunctionName);
 void UpdateAnalysis(const std::string& name);
 inline void UpdateWeights();
-void WriteMATLABHeader(std::ofstream &MATfile, int mrows, int ncols, int namlen,
+void WriteMATLABHeader(TextWriter &MATfile, int mrows, int ncols, int namlen,
                        bool isSparse, bool isText);
+void WriteWeights(TextWriter &outFile, const bool addComments);
 
 // AtFunctions
 void AddInterneuron(ArgListType &arg);
@@ -333,16 +429,22 @@ void ExportVars(ArgListType &arg);
 void DeleteData(ArgListType &arg);
 void FileReset(ArgListType &arg);
 void LoadData(ArgListType &arg);
+void LoadState(ArgListType &arg);
 void MakeSequence(ArgListType &arg);
 void MakeRandSequence(ArgListType &arg);
+void ReadSpikeLog(ArgListType &arg);
+void ReadWeightHistory(ArgListType &arg);
+void Record(ArgListType &arg);
 void ResetFiring(ArgListType &arg);
 void SaveData(ArgListType &arg);
+void SaveState(ArgListType &arg);
 void SaveWeights(ArgListType &arg);
 void SeedRNG(ArgListType &arg);
 void SetLoopVar(ArgListType &arg);
 void SetStream(ArgListType &arg);
 void SetVar(ArgListType &arg);
 void Sim(ArgListType &arg);
+void Sweep(ArgListType &arg);
 void Test(ArgListType &arg);
 void Train(ArgListType &arg);
 
@@ -357,10 +459,9 @@ std::string SumData(ArgListType &arg);
 void InitializeProgram();
 void BindUserFunctions();
 
-// T=Pattern => Sequence, T=Vector => Matrix, T=DataList => Analysis
-// T=UIVector => UIPtnSequence
-template<class S, class T>
-S **Convert2Mat(const vector<T> &Seq, int patstart,
+// M=Sequence, DataMatrix, DenseMatrix or UIPtnSequence
+template<class S, class M>
+S **Convert2Mat(const M &Seq, int patstart,
                 int patend, int bitstart, int bitend,
                 const bool transpose = false,
                 const S &fillval = 0) {
@@ -382,19 +483,18 @@ S **Convert2Mat(const vector<T> &Seq, int patstart,
       RetMat[fillRow][col] = fillval;
     }
   }
-  typename vector<T>::const_iterator it = Seq.begin() + patstart;
+  typename M::const_iterator it = Seq.begin() + patstart;
   for (int row = 0; row < pattot; row++, it++) {
-    const T temppat = *it;
-    int patlen = temppat.size();
+    int patlen = it->size();
     if (patlen > bitend) {
       patlen = bitend;
     }
     int col = 0;
     for (int j = bitstart; j < patlen; j++, col++) {
       if (transpose) {
-        RetMat[col][row] = static_cast<S>(temppat.at(j));
+        RetMat[col][row] = static_cast<S>(it->at(j));
       } else {
-        RetMat[row][col] = static_cast<S>(temppat.at(j));
+        RetMat[row][col] = static_cast<S>(it->at(j));
       }
     }
   }
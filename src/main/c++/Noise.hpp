@@ -32,10 +32,32 @@
 // is provided for use with arrays of Noises. Calling any
 // of the distribution functions before initializing the Noise
 // with Reset is undefined.
-// The type is always 't' and indicates the underlying
-// pseudo-random number generator being used.
-// 't' corresponds to the TT800 algorithm and 'm' used to correspond
-// to the algorithm found in Numerical Recipes in C.
+// The type indicates the underlying pseudo-random number generator
+// being used. 't' corresponds to the TT800 algorithm, 'p' to the
+// counter-based Philox4x32-10 algorithm and 'x' to four interleaved
+// xoshiro256** generators. 'm' used to correspond to the algorithm
+// found in Numerical Recipes in C.
+// Every type generates a block of values at a time, so the vector and
+// matrix functions below are much cheaper per value than repeated calls
+// to the scalar ones, while returning exactly the same numbers.
+//
+// void ResetStream(unsigned int seed, unsigned int purpose,
+//                  unsigned int neuron = 0, unsigned int timeStep = 0,
+//                  unsigned int sub = 0)
+// void SetStream(unsigned int neuron, unsigned int timeStep,
+//                unsigned int sub = 0)
+//
+// ResetStream makes the Noise a Philox generator keyed by (seed, purpose)
+// and positions it at the start of the substream (neuron, timeStep, sub).
+// SetStream moves to another substream under the same key. Because the
+// draws of a substream depend only on its coordinates, work can be split
+// across threads or nodes without changing the numbers each neuron sees.
+// purpose is normally one of the NoiseStream values below.
+//
+// void NextEpoch()
+//
+// Rekeys the Philox generator so that substreams which are revisited,
+// e.g. the same time step in the next trial, get fresh numbers.
 //
 // The Uniform functions return doubles on [low,high]
 //
@@ -54,6 +76,19 @@
 // void Normal(double **matrix, int rows, int cols, double mu, double sigma)
 // void Normal(float **matrix, int rows, int cols, double mu, double sigma)
 //
+// double TruncNormal(double mu, double sigma, double low, double high)
+//
+// TruncNormal returns a Normal(mu,sigma) value conditioned to lie on
+// [low,high].
+//
+// void SetNormalMethod(char method)
+//
+// Selects how normals are generated. 'b' (the default) is Box-Muller,
+// with TruncNormal rejecting values until one falls on [low,high], which
+// reproduces the numbers of earlier versions. 'z' uses the ziggurat
+// method, which avoids log, sqrt and cos for nearly all values, and has
+// TruncNormal sample inside the bounds directly.
+//
 // The RandInt functions return intgers from the set of integers:
 // {low, low+1, low+2, ... , high-2, high-1, high}
 // The syntax is identical to the Uniform functions except that
@@ -71,6 +106,37 @@
 // void Bernoulli(int **matrix, int rows, int cols, double rate)
 // void Bernoulli(bool *vec, int rows, double rate)
 // void Bernoulli(bool **matrix, int rows, int cols, double rate)
+// void Bernoulli(int *vec, const float *rates, int rows)
+//
+// The last form uses a separate rate for each element. Like the scalar
+// Bernoulli, it only consumes a random number where the rate is below one.
+//
+// bool StartPrefetch(int blocks)
+// void StopPrefetch()
+//
+// StartPrefetch starts a producer thread that generates up to blocks
+// steps of the generator ahead into a lock-free ring, so the caller only
+// copies values out. The numbers are exactly those the Noise would have
+// produced without it, and stay so after StopPrefetch, which joins the
+// thread and lets the caller use up what is left in the ring. Reset and
+// ResetStream drop the ring. It returns false, and does nothing, for
+// counter-based Noises (their substreams are chosen by the caller) and
+// when built without RNG_PREFETCH.
+//
+// unsigned long PrefetchUsed()
+// unsigned long PrefetchStarved()
+//
+// Number of blocks taken from the ring, and how many of those the caller
+// had to wait for, since the Noise was constructed.
+//
+// void SaveState(SimState &state)
+// void LoadState(SimState &state)
+//
+// SaveState puts everything that decides the numbers still to come into
+// state, including the blocks a prefetch has generated but not handed
+// out, and LoadState takes it back, so the Noise goes on exactly where
+// the saved one left off. A prefetch running when either is called keeps
+// running.
 //
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -79,6 +145,7 @@
 
 #include <cmath>
 #include <limits>
+#include <stdint.h>
 
 #if defined(WIN32) || defined(NONUMERICLIMITS)
 #define EPSILON 0.00000001
@@ -88,32 +155,106 @@
 
 #include "ArgFuncts.hpp"
 
+// Purposes used to key the counter-based streams. Each simulation rng
+// gets its own so that, e.g., synaptic failures never reuse connectivity
+// draws for the same neuron.
+enum NoiseStream {
+  NS_Default = 0,
+  NS_Connect,
+  NS_External,
+  NS_Pick,
+  NS_Reset,
+  NS_Shuffle,
+  NS_SynFail,
+  NS_TieBreak,
+  NS_Weight,
+  NS_User
+};
+
+// Ring and thread of a prefetching Noise, defined in Noise.cpp
+struct NoisePrefetch;
+class SimState;
+
 class Noise {
  private:
+  // Largest number of values produced by one step of any generator
+  static const int BlockSize = 25;
+  // Number of independent xoshiro256** generators advanced together
+  static const int XLanes = 4;
+
   bool IsInit;
-  int QNNumber;
+  char RNGType;
+  char NormMethod;
   int64_t QNArray[25];
   int64_t mag01[2];
   double r[98];
   float gen_time;
+  uint32_t PhiloxPurpose;
+  uint32_t PhiloxEpoch;
+  uint32_t PhiloxKey[2];
+  uint32_t PhiloxCtr[4];
+  uint64_t XState[4][XLanes];
+  // Values generated by the last step but not yet handed out
+  double Block[BlockSize];
+  int BlockNdx;
+  int BlockLen;
+  // Copies of a Noise never share its producer thread
+  struct PrefetchHandle {
+    NoisePrefetch *Ring;
+    PrefetchHandle() : Ring(NULL) { }
+    PrefetchHandle(const PrefetchHandle &) : Ring(NULL) { }
+    PrefetchHandle &operator=(const PrefetchHandle &) { return *this; }
+  } Prefetch;
+  unsigned long PrefetchUsedCnt;
+  unsigned long PrefetchStarvedCnt;
 
   void TRandInit(unsigned int Seed);
-  double TRandDbl();
-  void TRandDblVect(double *vec, int rows);
-  void TRandDblMat(double **matrix, int rows, int cols);
-  void TRandFltVect(float *vec, int rows);
-  void TRandFltMat(float **matrix, int rows, int cols);
+  int TRandBlock(double *out);
+  int TTemperBlock(double *out);
+  int PRandBlock(double *out);
+  void XRandInit(unsigned int Seed);
+  int XRandBlock(double *out);
+  int GenBlock(double *out);
+  void NextBlock();
+  bool PopPrefetch();
+  void DropPrefetch();
+  static void *PrefetchMain(void *arg);
 
   inline double RandDbl();
-  inline void RandDblVect(double *vec, int rows);
+  double ZigNormal();
+  double ZigNormalTail(double min, bool negative);
+  void RandDblVect(double *vec, int rows);
+  void RandFltVect(float *vec, int rows);
+  void RandDblMat(double **matrix, int rows, int cols);
+  void RandFltMat(float **matrix, int rows, int cols);
 
  public:
   inline Noise()
-    : IsInit(false), gen_time(0) { }
+    : IsInit(false), RNGType('t'), NormMethod('b'), gen_time(0),
+      BlockNdx(0), BlockLen(0), PrefetchUsedCnt(0), PrefetchStarvedCnt(0) { }
   Noise(unsigned int seed, char type = 't');
-  inline ~Noise() { }
+  ~Noise();
 
   void Reset(unsigned int seed, char type = 't');
+  void ResetStream(unsigned int seed, unsigned int purpose,
+                   unsigned int neuron = 0, unsigned int timeStep = 0,
+                   unsigned int sub = 0);
+  void SetStream(unsigned int neuron, unsigned int timeStep,
+                 unsigned int sub = 0);
+  void NextEpoch();
+  // Takes other's counter-based key, so that SetStream draws the same
+  // numbers other would, without copying the rest of its state
+  void ShareStreams(const Noise &other);
+  inline char Type() const { return RNGType; }
+  inline bool IsCounterBased() const { return RNGType == 'p'; }
+  void SetNormalMethod(char method);
+  inline char NormalMethod() const { return NormMethod; }
+  bool StartPrefetch(int blocks);
+  void StopPrefetch();
+  inline unsigned long PrefetchUsed() const { return PrefetchUsedCnt; }
+  inline unsigned long PrefetchStarved() const { return PrefetchStarvedCnt; }
+  void SaveState(SimState &state);
+  void LoadState(SimState &state);
 
   inline double Uniform(double low, double high);
   void Uniform(double *vec, int rows, double low,
@@ -134,6 +275,7 @@ class Noise {
               double mu, double sigma);
   void Normal(float **matrix, int rows, int cols,
               double mu, double sigma);
+  double TruncNormal(double mu, double sigma, double low, double high);
 
   inline int RandInt(int low, int high);
   void RandInt(int *vec, int rows, int low, int high);
@@ -150,6 +292,7 @@ class Noise {
   void Bernoulli(int **matrix, int rows, int cols, double rate);
   void Bernoulli(bool * vec, int rows, double rate);
   void Bernoulli(bool ** matrix, int rows, int cols, double rate);
+  void Bernoulli(int *vec, const float *rates, int rows);
   inline bool Initialized() const { return IsInit; }
 };
 
@@ -158,9 +301,10 @@ inline double Noise::Uniform(double low, double high) {
 }
 
 inline double Noise::Normal(double mu, double sigma) {
-  double U[2];
-  RandDblVect(U, 2);
-  return((sqrt(-2.0 * log(U[0])) * cos(6.28318530718 * U[1])) * sigma) + mu;
+  if (NormMethod == 'z') return (ZigNormal() * sigma) + mu;
+  const double U0 = RandDbl();
+  const double U1 = RandDbl();
+  return((sqrt(-2.0 * log(U0)) * cos(6.28318530718 * U1)) * sigma) + mu;
 }
 
 inline int Noise::RandInt(int low, int high) {
@@ -211,11 +355,8 @@ inline int Noise::RandInt(int low, int high) {
 }
 
 inline double Noise::RandDbl() {
-  return TRandDbl();
-}
-
-inline void Noise::RandDblVect(double *vec, int rows) {
-  TRandDblVect(vec, rows);
+  if (BlockNdx == BlockLen) NextBlock();
+  return Block[BlockNdx++];
 }
 
 #endif
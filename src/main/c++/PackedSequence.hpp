@@ -0,0 +1,323 @@
+/***************************************************************************
+ * PackedSequence.hpp
+ *
+ *  A sequence of firing patterns packed into one byte buffer
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#if !defined(PACKEDSEQUENCE_HPP)
+#define PACKEDSEQUENCE_HPP
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+#if !defined(DATATYPES_HPP)
+#  include "DataTypes.hpp"
+#endif
+#if !defined(DENSEMATRIX_HPP)
+#  include "DenseMatrix.hpp"
+#endif
+
+// PackedSequence holds what a UIPtnSequence would, in compressed sparse
+// row form: pattern t is the bytes Bytes[Offsets[t]] .. Bytes[Offsets[t+1]].
+// Each neuron number is stored as its difference from the one before it
+// (from 0 for the first), zigzag encoded so that unsorted patterns survive,
+// in a little-endian base-128 varint. Sorted patterns with neurons less
+// than 64 apart take one byte per spike, and a time step costs one offset
+// rather than a separately allocated vector.
+//
+// Reading pattern t ([t], *it, it->) decodes it into a UIVector, so code
+// written against a UIPtnSequence compiles unchanged (it-> keeps the
+// pattern until the iterator moves); spikesBegin(t) and spikesEnd(t)
+// walk the neurons without decoding into a vector at all.
+class PackedSequence {
+ public:
+  typedef std::size_t size_type;
+  typedef UIVector value_type;
+
+  // The neurons of one pattern, decoded as they are read
+  class SpikeIterator {
+   public:
+    SpikeIterator(): Pos(0), Value(0) {}
+    explicit SpikeIterator(const unsigned char *pos): Pos(pos), Value(0) {}
+    // Only valid before the end of the pattern
+    inline unsigned int operator* () const {
+      const unsigned char *p = Pos;
+      return Value + unzigzag(readVarint(p));
+    }
+    inline SpikeIterator &operator++ () {
+      Value += unzigzag(readVarint(Pos));
+      return *this;
+    }
+    inline bool operator== (const SpikeIterator &other) const {
+      return Pos == other.Pos;
+    }
+    inline bool operator!= (const SpikeIterator &other) const {
+      return Pos != other.Pos;
+    }
+
+   private:
+    const unsigned char *Pos;
+    unsigned int Value;  // the neuron before Pos
+  };
+
+  // Walks the patterns; it->size() and (*it)[n] work as for a
+  // UIPtnSequenceCIt
+  class const_iterator {
+   public:
+    const_iterator(): Seq(0), Ndx(0), CurrentNdx(NotDecoded) {}
+    const_iterator(const PackedSequence *seq, const size_type ndx)
+      : Seq(seq), Ndx(ndx), CurrentNdx(NotDecoded) {}
+    inline UIVector operator* () const { return (*Seq)[Ndx]; }
+    // Decodes the pattern the first time only, so it->size() followed by
+    // (*it)[n] or it->begin() costs one decode
+    inline const UIVector *operator-> () const {
+      if (CurrentNdx != Ndx) {
+        Seq->decode(Ndx, Current);
+        CurrentNdx = Ndx;
+      }
+      return &Current;
+    }
+    inline const_iterator &operator++ () { ++Ndx; return *this; }
+    inline const_iterator operator++ (int) {
+      const_iterator old = *this;
+      ++Ndx;
+      return old;
+    }
+    inline const_iterator &operator-- () { --Ndx; return *this; }
+    inline const_iterator operator+ (const int n) const {
+      return const_iterator(Seq, Ndx + n);
+    }
+    inline const_iterator &operator+= (const int n) { Ndx += n; return *this; }
+    inline std::ptrdiff_t operator- (const const_iterator &other) const {
+      return static_cast<std::ptrdiff_t>(Ndx) - other.Ndx;
+    }
+    inline bool operator== (const const_iterator &other) const {
+      return Ndx == other.Ndx;
+    }
+    inline bool operator!= (const const_iterator &other) const {
+      return Ndx != other.Ndx;
+    }
+
+   private:
+    const PackedSequence *Seq;
+    size_type Ndx;
+    static const size_type NotDecoded = static_cast<size_type>(-1);
+    mutable UIVector Current;
+    mutable size_type CurrentNdx;  // the pattern in Current
+  };
+
+  PackedSequence(): Offsets(1, 0) {}
+  // numPatterns empty patterns
+  explicit PackedSequence(const size_type numPatterns)
+    : Offsets(numPatterns + 1, 0) {}
+  // Adaptors to and from the vector-of-patterns form
+  explicit PackedSequence(const UIPtnSequence &seq): Offsets(1, 0) {
+    *this = seq;
+  }
+  PackedSequence &operator= (const UIPtnSequence &seq) {
+    clear();
+    Offsets.reserve(seq.size() + 1);
+    for (UIPtnSequenceCIt it = seq.begin(); it != seq.end(); ++it) push_back(*it);
+    return *this;
+  }
+  UIPtnSequence toUIPtnSequence() const {
+    UIPtnSequence toReturn(size());
+    for (size_type t = 0; t < size(); ++t) decode(t, toReturn[t]);
+    return toReturn;
+  }
+
+  inline size_type size() const { return Offsets.size() - 1; }
+  inline bool empty() const { return size() == 0; }
+  // Bytes held for the spikes themselves
+  inline size_type packedBytes() const { return Bytes.size(); }
+
+  inline SpikeIterator spikesBegin(const size_type t) const {
+    return SpikeIterator(bytes() + Offsets[t]);
+  }
+  inline SpikeIterator spikesEnd(const size_type t) const {
+    return SpikeIterator(bytes() + Offsets[t + 1]);
+  }
+  // The bytes of pattern t in the form described above, for copying it
+  // without decoding
+  inline const unsigned char *encodedBegin(const size_type t) const {
+    return bytes() + Offsets[t];
+  }
+  inline const unsigned char *encodedEnd(const size_type t) const {
+    return bytes() + Offsets[t + 1];
+  }
+  // Number of neurons in pattern t, counted without decoding them
+  size_type numSpikes(const size_type t) const {
+    size_type count = 0;
+    for (size_type b = Offsets[t]; b < Offsets[t + 1]; ++b) {
+      if ((Bytes[b] & 0x80) == 0) ++count;
+    }
+    return count;
+  }
+  void decode(const size_type t, UIVector &pat) const {
+    pat.clear();
+    for (SpikeIterator it = spikesBegin(t); it != spikesEnd(t); ++it) {
+      pat.push_back(*it);
+    }
+  }
+
+  inline UIVector operator[] (const size_type t) const {
+    UIVector toReturn;
+    decode(t, toReturn);
+    return toReturn;
+  }
+  inline UIVector front() const { return (*this)[0]; }
+  inline UIVector back() const { return (*this)[size() - 1]; }
+  inline const_iterator begin() const { return const_iterator(this, 0); }
+  inline const_iterator end() const { return const_iterator(this, size()); }
+
+  void clear() {
+    Bytes.clear();
+    Offsets.assign(1, 0);
+  }
+  void push_back(const UIVector &pat) {
+    unsigned int prev = 0;
+    for (UIVectorCIt it = pat.begin(); it != pat.end(); ++it) {
+      appendVarint(Bytes, zigzag(static_cast<int64_t>(*it) - prev));
+      prev = *it;
+    }
+    Offsets.push_back(Bytes.size());
+  }
+  // Adds a pattern already in the form described above; first..last must
+  // hold whole varints
+  void pushEncoded(const unsigned char *first, const unsigned char *last) {
+    Bytes.insert(Bytes.end(), first, last);
+    Offsets.push_back(Bytes.size());
+  }
+  // Adds the patterns of other to the end
+  void append(const PackedSequence &other) {
+    const size_type base = Bytes.size();
+    Bytes.insert(Bytes.end(), other.Bytes.begin(), other.Bytes.end());
+    for (size_type t = 1; t < other.Offsets.size(); ++t) {
+      Offsets.push_back(base + other.Offsets[t]);
+    }
+  }
+  void swap(PackedSequence &other) {
+    Bytes.swap(other.Bytes);
+    Offsets.swap(other.Offsets);
+  }
+
+  inline bool operator== (const PackedSequence &other) const {
+    return (Offsets == other.Offsets) && (Bytes == other.Bytes);
+  }
+
+  // Appends v to out as a little-endian base-128 varint
+  template<class ByteVector>
+  static inline void appendVarint(ByteVector &out, uint64_t v) {
+    typedef typename ByteVector::value_type Byte;
+    while (v >= 0x80) {
+      out.push_back(static_cast<Byte>((v & 0x7F) | 0x80));
+      v >>= 7;
+    }
+    out.push_back(static_cast<Byte>(v));
+  }
+
+ private:
+  inline const unsigned char *bytes() const {
+    return Bytes.empty() ? 0 : &Bytes[0];
+  }
+  static inline uint64_t zigzag(const int64_t v) {
+    return (static_cast<uint64_t>(v) << 1) ^
+      static_cast<uint64_t>(v >> 63);
+  }
+  static inline unsigned int unzigzag(const uint64_t v) {
+    return static_cast<unsigned int>((v >> 1) ^ (~(v & 1) + 1));
+  }
+  static inline uint64_t readVarint(const unsigned char *&p) {
+    uint64_t v = *p & 0x7F;
+    int shift = 7;
+    while (*p++ & 0x80) {
+      v |= static_cast<uint64_t>(*p & 0x7F) << shift;
+      shift += 7;
+    }
+    return v;
+  }
+
+  std::vector<unsigned char> Bytes;
+  std::vector<size_type> Offsets;  // size() + 1 entries
+};
+
+// Conversions that read the packed form directly
+
+// As UISeqToPtnSeq(seq.toUIPtnSequence(), defaultNi)
+inline Sequence UISeqToPtnSeq(const PackedSequence &s,
+                              const unsigned int defaultNi = 0) {
+  Sequence toReturn(s.size());
+  for (PackedSequence::size_type t = 0; t < s.size(); ++t) {
+    const PackedSequence::SpikeIterator first = s.spikesBegin(t);
+    const PackedSequence::SpikeIterator last = s.spikesEnd(t);
+    unsigned int numNeurons = defaultNi;
+    if ((defaultNi == 0) && (first != last)) {
+      // assumes the pattern is sorted
+      for (PackedSequence::SpikeIterator it = first; it != last; ++it) {
+        numNeurons = *it + 1;
+      }
+    }
+    toReturn[t] = Pattern(numNeurons, false);
+    for (PackedSequence::SpikeIterator it = first; it != last; ++it) {
+      toReturn[t].set(*it);
+    }
+  }
+  return toReturn;
+}
+
+// As UISeqToMatrix(seqIn, defaultNi), row for row
+inline void UISeqToMatrix(const PackedSequence &seqIn, DenseMatrix &mtxOut,
+                          const unsigned int defaultNi = 0) {
+  // assumes the patterns are sorted, so a row's length is its last neuron
+  std::vector<unsigned int> rowLen(seqIn.size(), defaultNi);
+  unsigned int maxLen = defaultNi;
+  for (PackedSequence::size_type t = 0; t < seqIn.size(); ++t) {
+    for (PackedSequence::SpikeIterator it = seqIn.spikesBegin(t);
+         it != seqIn.spikesEnd(t); ++it) {
+      rowLen[t] = std::max(*it + 1, defaultNi);
+    }
+    updateMax(maxLen, rowLen[t]);
+  }
+  mtxOut.clear();
+  mtxOut.reserve(seqIn.size(), maxLen);
+  for (PackedSequence::size_type t = 0; t < seqIn.size(); ++t) {
+    DenseMatrix::Row row = mtxOut.addRow(rowLen[t]);
+    for (PackedSequence::SpikeIterator it = seqIn.spikesBegin(t);
+         it != seqIn.spikesEnd(t); ++it) {
+      row[*it] = 1.0f;
+    }
+  }
+}
+
+// As MatrixToUISeq, without building the UIPtnSequence
+inline PackedSequence MatrixToPackedSeq(const DenseMatrix &mtxIn) {
+  PackedSequence toReturn;
+  UIVector pat;
+  for (unsigned int t = 0; t < mtxIn.size(); ++t) {
+    const DenseMatrix::ConstRow row = mtxIn[t];
+    pat.clear();
+    for (unsigned int i = 0; i < row.size(); ++i) {
+      if (fabs(row[i]) > verySmallFloat) pat.push_back(i);
+    }
+    toReturn.push_back(pat);
+  }
+  return toReturn;
+}
+
+#endif  // PACKEDSEQUENCE_HPP
@@ -21,6 +21,9 @@
  *  You should have received a copy of the GNU Lesser General Public License
  *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
  ******************************************************************************/
+#include <algorithm>
+#include <cstdlib>
+
 #if !defined(PARALLEL_HPP)
 #   include "Parallel.hpp"
 #endif
@@ -40,6 +43,8 @@ unsigned int ParallelInfo::P_NumNodes;
 unsigned int ParallelInfo::P_MyRank;
 ParallelInfo * ParallelInfo::P_Nodes;
 ParallelRand * ParallelInfo::P_RandComm;
+MPI_Request ParallelInfo::P_SumwzReq[3];
+UIVector ParallelInfo::P_FirstNeuron;
 
 void ParallelInfo::staticInitialize(int argc, char *argv[],
                                     ParallelRand &pRandComm) {
@@ -68,135 +73,22 @@ void ParallelInfo::Barrier() {
   MPI_Barrier(MPI_COMM_WORLD);
 }
 
-UIMatrix ParallelInfo::rcvNodeConn(const UIVector &Shuffle, const UIVector &FanInCon) {
-  int  P_Tag = 0;
-  MPI_Status P_Status;
-  // rows are neurons, columns are nodes
-  UIMatrix toReturn(totalNumNrns);
-  for (unsigned int i = 0; i < totalNumNrns; i++) {
-    toReturn.at(i) = UIVector(P_NumNodes);
-#if !defined(PARENT_CHLD)
-    //Get Root Data
-    const unsigned int shuffRow = Shuffle.at(i);
-    toReturn.at(i).at(0) = FanInCon.at(shuffRow);
-#endif
-    for (unsigned int j = 1; j < P_NumNodes; j++) {
-      int  NumCon;
-      MPI_Recv(&NumCon, 1, MPI_INT, j, P_Tag, MPI_COMM_WORLD, &P_Status);
-      toReturn.at(i).at(j) = NumCon;
-    }
-  }
-  return toReturn;
+void ParallelInfo::setPartition(const UIVector &firstNeurons) {
+  P_FirstNeuron = firstNeurons;
 }
 
-UIVector ParallelInfo::rcvNrnConn(const UIVector &nrnNodeConn, const int nrn,
-                                  const UIVector &Shuffle,
-                                  const UIVector &UnShuffle,
-                                  const UIVector &FanInCon,
-                                  const DendriticSynapse * const * const inMatrix) {
-  int  P_Tag = 0;
-  MPI_Status P_Status;
-  // the cmatrix data!!! (receive one row of cmatrix)
-  UIVector toReturn;
-  
-#if !defined(PARENT_CHLD)
-  //Root node accounts for its own data
-  const unsigned int shuffRow = Shuffle.at(nrn);
-  const DendriticSynapse * const dendriticTree = inMatrix[shuffRow];
-  for (unsigned int c = 0; c < FanInCon.at(shuffRow); ++c) {
-    toReturn.push_back(UnShuffle.at( dendriticTree[c].getSrcNeuron()) );
-  }
-#endif
-  
-  
-  //Now get data from all other nodes 
-  for (unsigned int nodeNum = 1; nodeNum < P_NumNodes; nodeNum++) {
-    int NumConPerNode = nrnNodeConn.at(nodeNum);
-    int *tmp_cin = new int[NumConPerNode];
-    MPI_Recv(&tmp_cin[0], NumConPerNode, MPI_INT, nodeNum, P_Tag,
-             MPI_COMM_WORLD, &P_Status);
-    for (int i = 0; i < NumConPerNode; i++)
-      toReturn.push_back(tmp_cin[i]);
-    delete[] tmp_cin;
-  }
-  return toReturn;
+unsigned int ParallelInfo::getNodeOf(const unsigned int nrn) {
+  // The last node whose first neuron is at or below nrn
+  return std::upper_bound(P_FirstNeuron.begin(), P_FirstNeuron.end() - 1, nrn)
+    - P_FirstNeuron.begin() - 1;
 }
 
-UIVector ParallelInfo::rcvNrnAij(const UIVector &nrnNodeConn, const int nrn,
-                                 const UIVector &Shuffle,
-                                 const UIVector &FanInCon,
-                                 const DendriticSynapse * const * const inMatrix,
-                                 const UIMatrix &FanOutCon,
-                                 const AxonalSynapse * const * const * const outMatrix, 
-                                 const unsigned int minAxonalDelay,
-                                 const unsigned int maxAxonalDelay) {
-  int  P_Tag = 0;
-  MPI_Status P_Status;
-  // the cmatrix data!!! (receive one row of cmatrix)
-  UIVector toReturn;
-  
-#if !defined(PARENT_CHLD)
-  //Root node needs to account for its own data
-  const unsigned int shuffRow = Shuffle.at(nrn);
-  const DendriticSynapse * const dendriticTree = inMatrix[shuffRow];
-  for (unsigned int axonalCol = 0; axonalCol < FanInCon[shuffRow]; ++axonalCol) {
-    unsigned int inNeuron = dendriticTree[axonalCol].getSrcNeuron();
-    const AxonalSynapse * const * const inAxon = outMatrix[inNeuron];
-    unsigned int axonalDelay = 0; // not a valid value!
-    for (unsigned int refTime = minAxonalDelay-1; refTime < maxAxonalDelay; ++refTime) {
-      const AxonalSynapse * const axonalSegment = inAxon[refTime];
-      for (unsigned int outNeuron = 0; outNeuron < FanOutCon[inNeuron][refTime]; ++outNeuron) {
-        // Pointer comparsion, not value comparison
-        if (axonalSegment[outNeuron].connectsTo(dendriticTree[axonalCol])) {
-          axonalDelay = refTime + 1;
-          break;
-        }
-      }
-    }
-    toReturn.push_back(axonalDelay);
-  }
-#endif
-  
-  //Now get data from all other nodes
-  for (unsigned int nodeNum = 1; nodeNum < P_NumNodes; nodeNum++) {
-    int NumConPerNode = nrnNodeConn.at(nodeNum);
-    int *tmp_ain = new int[NumConPerNode];
-    MPI_Recv(&tmp_ain[0], NumConPerNode, MPI_INT, nodeNum, P_Tag,
-             MPI_COMM_WORLD, &P_Status);
-    for (int i = 0; i < NumConPerNode; i++)
-      toReturn.push_back(tmp_ain[i]);
-    delete[] tmp_ain;
-  }
-  return toReturn;
-}
-
-DataList ParallelInfo::rcvNrnWij(const UIVector &nrnNodeConn, const int nrn,
-                                 const UIVector &Shuffle,
-                                 const UIVector &FanInCon,
-                                 const DendriticSynapse * const * const inMatrix) {
-  int  P_Tag = 0;
-  MPI_Status P_Status;
-  // the wmatrix data!!! (receive one row of wmatrix)
-  DataList toReturn;
-  
-#if !defined(PARENT_CHLD)
-  //Root node needs to account for its own data
-  const unsigned int shuffRow = Shuffle.at(nrn);
-  const DendriticSynapse * const dendriticTree = inMatrix[shuffRow];
-  for (unsigned int c = 0; c < FanInCon[shuffRow]; ++c)
-    toReturn.push_back( dendriticTree[c].getWeight() );
-#endif
-  
-  //Now get data from all other nodes
-  for (unsigned int nodeNum = 1; nodeNum < P_NumNodes; nodeNum++) {
-    int NumConPerNode = nrnNodeConn.at(nodeNum);
-    float *tmp_win = new float[NumConPerNode];
-    MPI_Recv(&tmp_win[0], NumConPerNode, MPI_FLOAT, nodeNum, P_Tag,
-             MPI_COMM_WORLD, &P_Status);
-    for (int i = 0; i < NumConPerNode; i++)
-      toReturn.push_back(tmp_win[i]);
-    delete[] tmp_win;            
-  }
+// Sums each neuron's cost over the nodes, for repartitioning
+vector<double> ParallelInfo::sumCosts(const vector<double> &myCost) {
+  vector<double> toSend(myCost);
+  vector<double> toReturn(myCost.size(), 0.0);
+  MPI_Allreduce(&toSend[0], &toReturn[0], toSend.size(), MPI_DOUBLE, MPI_SUM,
+                MPI_COMM_WORLD);
   return toReturn;
 }
 
@@ -247,6 +139,244 @@ DataList ParallelInfo::rcvSumwz() {
   return toReturn;
 }
 
+// The axonal delay of each of a dendritic tree's synapses. A synapse that
+// no axon reaches means the fan-in and fan-out tables disagree, and there
+// is no delay to give it.
+static void findAxonalDelays(const unsigned int nrn,
+                             const DendriticSynapse * const dendriticTree,
+                             const unsigned int numCon,
+                             const UIMatrix &FanOutCon,
+                             const AxonalSynapse * const * const * const outMatrix,
+                             const unsigned int minAxonalDelay,
+                             const unsigned int maxAxonalDelay,
+                             UIVector &delays) {
+  for (unsigned int axonalCol = 0; axonalCol < numCon; ++axonalCol) {
+    unsigned int inNeuron = dendriticTree[axonalCol].getSrcNeuron();
+    const AxonalSynapse * const * const inAxon = outMatrix[inNeuron];
+    unsigned int axonalDelay = 0; // not a valid value!
+    for (unsigned int refTime = minAxonalDelay-1; refTime < maxAxonalDelay; ++refTime) {
+      const AxonalSynapse * const axonalSegment = inAxon[refTime];
+      for (unsigned int outNeuron = 0; outNeuron < FanOutCon[inNeuron][refTime]; ++outNeuron) {
+        // Pointer comparsion, not value comparison
+        if (axonalSegment[outNeuron].connectsTo(dendriticTree[axonalCol])) {
+          axonalDelay = refTime + 1;
+          break;
+        }
+      }
+    }
+    if (axonalDelay == 0) {
+      CALL_ERROR << MSG << "No axonal segment of neuron " << inNeuron
+                 << " reaches synapse " << axonalCol << " of neuron " << nrn
+                 << ERR_WHERE;
+      exit(EXIT_FAILURE);
+    }
+    delays.push_back(axonalDelay);
+  }
+}
+
+// Every node holds part of each neuron's fan-in. Each node packs its part
+// of all neurons into one array per quantity, and the root collects them
+// with one gather per array (rather than one message per neuron per
+// node), then splits them back into rows, node 0's synapses first.
+void ParallelInfo::gatherFanIn(const UIVector &Shuffle,
+                               const UIVector &UnShuffle,
+                               const UIVector &FanInCon,
+                               const DendriteConst * const inMatrix,
+                               const UIMatrix &FanOutCon,
+                               const AxonConst * const outMatrix,
+                               const unsigned int minAxonalDelay,
+                               const unsigned int maxAxonalDelay,
+                               const bool withDelays, UIMatrix &conn,
+                               DataMatrix &wij, UIMatrix &aij,
+                               FanInLayout *layout) {
+#if defined(TIMING_MODE)
+  long long elapsed, start;
+  start = rdtsc();
+#endif
+
+  const bool isRoot = (P_MyRank == P_ROOT_NODE_NUM);
+  vector<int> myCounts(totalNumNrns);
+  UIVector myConn;
+  DataList myWij;
+  UIVector myAij;
+  for (unsigned int nrn = 0; nrn < totalNumNrns; ++nrn) {
+    const unsigned int shuffRow = Shuffle.at(nrn);
+    const unsigned int numCon = FanInCon.at(shuffRow);
+    const DendriticSynapse * const dendriticTree = inMatrix[shuffRow];
+    myCounts[nrn] = numCon;
+    for (unsigned int c = 0; c < numCon; ++c) {
+      myConn.push_back(UnShuffle.at(dendriticTree[c].getSrcNeuron()));
+      myWij.push_back(dendriticTree[c].getWeight());
+    }
+    if (withDelays) {
+      findAxonalDelays(nrn, dendriticTree, numCon, FanOutCon, outMatrix,
+                       minAxonalDelay, maxAxonalDelay, myAij);
+    }
+  }
+
+  // rows are nodes, columns are neurons
+  vector<int> allCounts(isRoot ? totalNumNrns * P_NumNodes : 0);
+  MPI_Gather(&myCounts[0], totalNumNrns, MPI_INT,
+             isRoot ? &allCounts[0] : NULL, totalNumNrns, MPI_INT,
+             P_ROOT_NODE_NUM, MPI_COMM_WORLD);
+  vector<int> nodeTotals(P_NumNodes, 0);
+  vector<int> displs(P_NumNodes, 0);
+  int total = 0;
+  if (isRoot) {
+    for (unsigned int node = 0; node < P_NumNodes; ++node) {
+      for (unsigned int nrn = 0; nrn < totalNumNrns; ++nrn) {
+        nodeTotals[node] += allCounts[node * totalNumNrns + nrn];
+      }
+      displs[node] = total;
+      total += nodeTotals[node];
+    }
+  }
+
+  const int myTotal = myConn.size();
+  UIVector allConn(total);
+  DataList allWij(total);
+  UIVector allAij(withDelays ? total : 0);
+  MPI_Gatherv(myTotal ? &myConn[0] : NULL, myTotal, MPI_UNSIGNED,
+              total ? &allConn[0] : NULL, &nodeTotals[0], &displs[0],
+              MPI_UNSIGNED, P_ROOT_NODE_NUM, MPI_COMM_WORLD);
+  MPI_Gatherv(myTotal ? &myWij[0] : NULL, myTotal, MPI_FLOAT,
+              total ? &allWij[0] : NULL, &nodeTotals[0], &displs[0],
+              MPI_FLOAT, P_ROOT_NODE_NUM, MPI_COMM_WORLD);
+  if (withDelays) {
+    MPI_Gatherv(myTotal ? &myAij[0] : NULL, myTotal, MPI_UNSIGNED,
+                total ? &allAij[0] : NULL, &nodeTotals[0], &displs[0],
+                MPI_UNSIGNED, P_ROOT_NODE_NUM, MPI_COMM_WORLD);
+  }
+
+  if (isRoot) {
+    conn.assign(totalNumNrns, UIVector());
+    wij.assign(totalNumNrns, DataList());
+    aij.assign(withDelays ? totalNumNrns : 0, UIVector());
+    for (unsigned int node = 0; node < P_NumNodes; ++node) {
+      unsigned int pos = displs[node];
+      for (unsigned int nrn = 0; nrn < totalNumNrns; ++nrn) {
+        const unsigned int numCon = allCounts[node * totalNumNrns + nrn];
+        conn[nrn].insert(conn[nrn].end(), allConn.begin() + pos,
+                         allConn.begin() + pos + numCon);
+        wij[nrn].insert(wij[nrn].end(), allWij.begin() + pos,
+                        allWij.begin() + pos + numCon);
+        if (withDelays) {
+          aij[nrn].insert(aij[nrn].end(), allAij.begin() + pos,
+                          allAij.begin() + pos + numCon);
+        }
+        pos += numCon;
+      }
+    }
+  }
+  if (layout != NULL) {
+    layout->Counts.swap(allCounts);
+    layout->NodeTotals.swap(nodeTotals);
+    layout->Displs.swap(displs);
+  }
+
+#if defined(TIMING_MODE)
+  elapsed = rdtsc() - start;
+  Output::Out() << MSG << "Elapsed fan-in gather time = "
+                << elapsed * 1.0 / TICKS_PER_SEC << " seconds" << endl;
+#endif
+}
+
+// One gather of the weights; the root puts them back in neuron order with
+// the counts gatherFanIn left in layout.
+void ParallelInfo::gatherWeights(const UIVector &Shuffle, const UIVector &FanInCon,
+                                 const DendriteConst * const inMatrix,
+                                 const FanInLayout &layout, DataList &weights) {
+  const bool isRoot = (P_MyRank == P_ROOT_NODE_NUM);
+  DataList myWij;
+  for (unsigned int nrn = 0; nrn < totalNumNrns; ++nrn) {
+    const unsigned int shuffRow = Shuffle.at(nrn);
+    const DendriticSynapse * const dendriticTree = inMatrix[shuffRow];
+    for (unsigned int c = 0; c < FanInCon.at(shuffRow); ++c) {
+      myWij.push_back(dendriticTree[c].getWeight());
+    }
+  }
+
+  // MPI-2 count arrays are not const
+  vector<int> nodeTotals(layout.NodeTotals);
+  vector<int> displs(layout.Displs);
+  const int total = isRoot ? (displs.back() + nodeTotals.back()) : 0;
+  const int myTotal = myWij.size();
+  DataList allWij(total);
+  MPI_Gatherv(myTotal ? &myWij[0] : NULL, myTotal, MPI_FLOAT,
+              total ? &allWij[0] : NULL, &nodeTotals[0], &displs[0],
+              MPI_FLOAT, P_ROOT_NODE_NUM, MPI_COMM_WORLD);
+
+  weights.clear();
+  if (!isRoot) return;
+  weights.reserve(total);
+  for (unsigned int nrn = 0; nrn < totalNumNrns; ++nrn) {
+    for (unsigned int node = 0; node < P_NumNodes; ++node) {
+      const unsigned int numCon = layout.Counts[node * totalNumNrns + nrn];
+      weights.insert(weights.end(), allWij.begin() + displs[node],
+                     allWij.begin() + displs[node] + numCon);
+      displs[node] += numCon;
+    }
+  }
+}
+
+// The root flattens the rows into one array per quantity, so the whole
+// network goes out in a few broadcasts rather than one per neuron.
+void ParallelInfo::broadcastFanIn(const bool withDelays, UIMatrix &conn,
+                                  DataMatrix &wij, UIMatrix &aij) {
+  const bool isRoot = (P_MyRank == P_ROOT_NODE_NUM);
+  vector<int> counts(totalNumNrns, 0);
+  int total = 0;
+  if (isRoot) {
+    for (unsigned int nrn = 0; nrn < totalNumNrns; ++nrn) {
+      counts[nrn] = conn[nrn].size();
+      total += counts[nrn];
+    }
+  }
+  MPI_Bcast(&counts[0], totalNumNrns, MPI_INT, P_ROOT_NODE_NUM, MPI_COMM_WORLD);
+  MPI_Bcast(&total, 1, MPI_INT, P_ROOT_NODE_NUM, MPI_COMM_WORLD);
+
+  UIVector allConn;
+  DataList allWij;
+  UIVector allAij;
+  if (isRoot) {
+    allConn.reserve(total);
+    allWij.reserve(total);
+    allAij.reserve(withDelays ? total : 0);
+    for (unsigned int nrn = 0; nrn < totalNumNrns; ++nrn) {
+      allConn.insert(allConn.end(), conn[nrn].begin(), conn[nrn].end());
+      allWij.insert(allWij.end(), wij[nrn].begin(), wij[nrn].end());
+      if (withDelays) {
+        allAij.insert(allAij.end(), aij[nrn].begin(), aij[nrn].end());
+      }
+    }
+  } else {
+    allConn.resize(total);
+    allWij.resize(total);
+    allAij.resize(withDelays ? total : 0);
+  }
+  if (total > 0) {
+    MPI_Bcast(&allConn[0], total, MPI_UNSIGNED, P_ROOT_NODE_NUM, MPI_COMM_WORLD);
+    MPI_Bcast(&allWij[0], total, MPI_FLOAT, P_ROOT_NODE_NUM, MPI_COMM_WORLD);
+    if (withDelays) {
+      MPI_Bcast(&allAij[0], total, MPI_UNSIGNED, P_ROOT_NODE_NUM, MPI_COMM_WORLD);
+    }
+  }
+  if (isRoot) return;
+
+  conn.assign(totalNumNrns, UIVector());
+  wij.assign(totalNumNrns, DataList());
+  aij.assign(withDelays ? totalNumNrns : 0, UIVector());
+  unsigned int pos = 0;
+  for (unsigned int nrn = 0; nrn < totalNumNrns; ++nrn) {
+    conn[nrn].assign(allConn.begin() + pos, allConn.begin() + pos + counts[nrn]);
+    wij[nrn].assign(allWij.begin() + pos, allWij.begin() + pos + counts[nrn]);
+    if (withDelays) {
+      aij[nrn].assign(allAij.begin() + pos, allAij.begin() + pos + counts[nrn]);
+    }
+    pos += counts[nrn];
+  }
+}
+
 // This function replaces rcvSumwz() and sendSumwz() for PEER_TO_PEER
 DataList ParallelInfo::exchangeSumwz(DataList &mySumwz) {
   
@@ -272,6 +402,104 @@ DataList ParallelInfo::exchangeSumwz(DataList &mySumwz) {
   
 }
 
+// Posts the sums of the three excitation vectors and returns at once, so
+// the caller can do work that doesn't need them. The vectors are summed in
+// place and mustn't be touched until finishExchangeSumwz returns. MPI
+// before 3.0 has no non-blocking collectives, so there the sums complete
+// here and nothing overlaps.
+void ParallelInfo::startExchangeSumwz(DataList &sumwz, DataList &sumwz_inhdiv,
+                                      DataList &sumwz_inhsub) {
+  DataList * const toSum[3] = { &sumwz, &sumwz_inhdiv, &sumwz_inhsub };
+  for (int i = 0; i < 3; ++i) {
+#if MPI_VERSION >= 3
+    MPI_Iallreduce(MPI_IN_PLACE, &(*toSum[i])[0], totalNumNrns, MPI_FLOAT,
+                   MPI_SUM, MPI_COMM_WORLD, &P_SumwzReq[i]);
+#else
+    MPI_Allreduce(MPI_IN_PLACE, &(*toSum[i])[0], totalNumNrns, MPI_FLOAT,
+                  MPI_SUM, MPI_COMM_WORLD);
+    P_SumwzReq[i] = MPI_REQUEST_NULL;
+#endif
+  }
+}
+
+void ParallelInfo::finishExchangeSumwz() {
+  MPI_Waitall(3, P_SumwzReq, MPI_STATUSES_IGNORE);
+}
+
+void ParallelInfo::sumFixedBuses(FixedBus &bus, FixedBus &bus_inhdiv,
+                                 FixedBus &bus_inhsub) {
+  FixedBus * const toSum[3] = { &bus, &bus_inhdiv, &bus_inhsub };
+  for (int i = 0; i < 3; ++i) {
+    MPI_Allreduce(MPI_IN_PLACE, &toSum[i]->getSums()[0], totalNumNrns,
+                  MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+  }
+}
+
+// Shares the number of items each node contributes to an Allgatherv and
+// returns the total
+int ParallelInfo::gatherCounts(const int myCount, vector<int> &counts,
+                               vector<int> &displs) {
+  counts.assign(P_NumNodes, 0);
+  displs.assign(P_NumNodes, 0);
+  int count = myCount;
+  MPI_Allgather(&count, 1, MPI_INT, &counts[0], 1, MPI_INT, MPI_COMM_WORLD);
+  int total = 0;
+  for (unsigned int i = 0; i < P_NumNodes; i++) {
+    displs[i] = total;
+    total += counts[i];
+  }
+  return total;
+}
+
+// Replaces exchangeSumwz when SpikeExchange is set: only the indices of
+// the neurons that fired travel, so the traffic scales with activity
+// instead of with ni
+UIVector ParallelInfo::exchangeFired(const UIVector &myFired) {
+#if defined(TIMING_MODE)
+  long long elapsed, start;
+  start = rdtsc();
+#endif
+
+  vector<int> counts, displs;
+  const int myCount = myFired.size();
+  const int total = gatherCounts(myCount, counts, displs);
+  UIVector toReturn(total);
+  if (total > 0) {
+    // MPI-2 send buffers are not const
+    UIVector toSend(myFired);
+    MPI_Allgatherv(myCount ? &toSend[0] : NULL, myCount, MPI_UNSIGNED,
+                   &toReturn[0], &counts[0], &displs[0], MPI_UNSIGNED,
+                   MPI_COMM_WORLD);
+  }
+
+#if defined(TIMING_MODE)
+  elapsed = rdtsc() - start;
+  Output::Out() << MSG << "Elapsed fired exchange time = "
+                << elapsed * 1.0 / TICKS_PER_SEC << " seconds" << endl;
+#endif
+  return toReturn;
+}
+
+// Competitive firing with SpikeExchange: replaces each node's candidate
+// neurons (ix) and their excitation (y) with those of all nodes
+void ParallelInfo::exchangeCandidates(UIVector &ix, vector<double> &y) {
+  vector<int> counts, displs;
+  const int myCount = ix.size();
+  const int total = gatherCounts(myCount, counts, displs);
+  UIVector allIx(total);
+  vector<double> allY(total);
+  if (total > 0) {
+    MPI_Allgatherv(myCount ? &ix[0] : NULL, myCount, MPI_UNSIGNED,
+                   &allIx[0], &counts[0], &displs[0], MPI_UNSIGNED,
+                   MPI_COMM_WORLD);
+    MPI_Allgatherv(myCount ? &y[0] : NULL, myCount, MPI_DOUBLE,
+                   &allY[0], &counts[0], &displs[0], MPI_DOUBLE,
+                   MPI_COMM_WORLD);
+  }
+  ix.swap(allIx);
+  y.swap(allY);
+}
+
 Pattern ParallelInfo::rcvZi() {
   int  P_Tag = 0;
   MPI_Status P_Status;
@@ -325,85 +553,6 @@ string ParallelInfo::ChildRcv() {
   return toReturn;
 }
 
-void ParallelInfo::sendNodeConn(const UIVector &Shuffle, const UIVector &FanInCon) {
-  int  P_Tag = 0;
-  for (unsigned int nrn = 0; nrn < totalNumNrns; nrn++) {
-    const unsigned int shuffRow = Shuffle.at(nrn);
-    int  NumCon = FanInCon.at(shuffRow);
-    MPI_Send(&NumCon, 1, MPI_INT, P_ROOT_NODE_NUM, P_Tag, MPI_COMM_WORLD);
-  }
-}
-
-void ParallelInfo::sendNrnConn(const UIVector &Shuffle,
-                               const UIVector &UnShuffle,
-                               const UIVector &FanInCon,
-                               const DendriticSynapse * const * const inMatrix) {
-  int  P_Tag = 0;
-  for (unsigned int nrn = 0; nrn < totalNumNrns; nrn++) {
-    const unsigned int shuffRow = Shuffle.at(nrn);
-    // send the cmatrix data
-    unsigned int *tmp_cin = new unsigned int[FanInCon.at(shuffRow)];
-    const DendriticSynapse * const dendriticTree = inMatrix[shuffRow];
-    for (unsigned int c = 0; c < FanInCon.at(shuffRow); ++c) {
-      tmp_cin[c] = UnShuffle.at(dendriticTree[c].getSrcNeuron());
-    }
-    MPI_Send(&tmp_cin[0], FanInCon.at(shuffRow), MPI_INT, P_ROOT_NODE_NUM, P_Tag,
-             MPI_COMM_WORLD);
-    delete[] tmp_cin;
-  }
-}
-
-//FIXME: This needs to be tested!
-void ParallelInfo::sendNrnAij(const UIVector &Shuffle,
-                              const UIVector &FanInCon,
-                              const DendriticSynapse * const * const inMatrix,
-                              const UIMatrix &FanOutCon,
-                              const AxonalSynapse * const * const * const outMatrix,
-                              const unsigned int minAxonalDelay,
-                              const unsigned int maxAxonalDelay) {
-  int  P_Tag = 0;
-  for (unsigned int nrn = 0; nrn < totalNumNrns; ++nrn) {
-    const unsigned int shuffRow = Shuffle.at(nrn);
-    // send the cmatrix data
-    unsigned int *tmp_ain = new unsigned int[FanInCon.at(shuffRow)];
-    const DendriticSynapse * const dendriticTree = inMatrix[shuffRow];
-    for (unsigned int axonalCol = 0; axonalCol < FanInCon[shuffRow]; ++axonalCol) {
-      unsigned int inNeuron = dendriticTree[axonalCol].getSrcNeuron();
-      const AxonalSynapse * const * const inAxon = outMatrix[inNeuron];
-      unsigned int axonalDelay = 0; // not a valid value!
-      for (unsigned int refTime = minAxonalDelay-1; refTime < maxAxonalDelay; ++refTime) {
-        const AxonalSynapse * const axonalSegment = inAxon[refTime];
-        for (unsigned int outNeuron = 0; outNeuron < FanOutCon[inNeuron][refTime]; ++outNeuron) {
-          // Pointer comparsion, not value comparison
-          if (axonalSegment[outNeuron].connectsTo(dendriticTree[axonalCol])) {
-            axonalDelay = refTime + 1;
-            break;
-          }
-        }
-      }
-      tmp_ain[axonalCol] = axonalDelay;
-    }
-    MPI_Send(&tmp_ain[0], FanInCon.at(shuffRow), MPI_INT, P_ROOT_NODE_NUM, P_Tag,
-             MPI_COMM_WORLD);
-    delete[] tmp_ain;
-  }
-}
-
-void ParallelInfo::sendNrnWij(const UIVector &Shuffle, const UIVector &FanInCon,
-                              const DendriticSynapse * const * const inMatrix) {
-  int  P_Tag = 0;
-  for (unsigned int nrn = 0; nrn < totalNumNrns; nrn++) {
-    const unsigned int shuffRow = Shuffle.at(nrn);
-    float *tmp_wij = new float[FanInCon.at(shuffRow)];
-    const DendriticSynapse * const dendriticTree = inMatrix[shuffRow];
-    for (unsigned int c = 0; c < FanInCon[shuffRow]; ++c)
-      tmp_wij[c] = dendriticTree[c].getWeight();
-    // send the wmatrix data
-    MPI_Send(&tmp_wij[0], FanInCon.at(shuffRow), MPI_FLOAT,
-             P_ROOT_NODE_NUM, P_Tag, MPI_COMM_WORLD);
-  }
-}
-
 void ParallelInfo::sendSumwz(const DataList &toSend) {
   int P_Tag = 0;
   
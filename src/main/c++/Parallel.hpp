@@ -28,13 +28,9 @@
 
 ///////////////////////////////
 //
-// Important assumption--Portions of the code below ASSUME
-//                       that all nodes have the same number of neurons
-//                       (ni)--this can be rectified, but it implies
-//                       the following: 1) all nodes will have to
-//                       know how many neurons are on their afferent
-//                       neighbors; 2) the root node has to know
-//                       how many neurons are on ALL nodes
+// Nodes need not hold the same number of neurons. Every node knows the
+// whole partition (see setPartition), so any node can tell which node a
+// neuron belongs to and how many neurons every other node holds.
 //
 ///////////////////////////////
 
@@ -49,13 +45,19 @@
 #    if !defined(PARALLELRAND_HPP)
 #      include "ParallelRand.hpp"
 #    endif
+#    if !defined(FIXEDSUM_HPP)
+#      include "FixedSum.hpp"
+#    endif
+#    if !defined(AXONALSYNAPSE_HPP)
+#      include "neural/AxonalSynapse.hpp"
+#    endif
 
 using std::string;
 using std::vector;
 
 // This message prefaces everything written when running in
 // multi-processor mode
-const char P_StdMsg[] P_StdMsg = "PE: ";
+const char P_StdMsg[] = "PE: ";
 
 // This contains the node rank ID of the root processing node
 const unsigned int P_ROOT_NODE_NUM = 0;
@@ -65,7 +67,7 @@ const unsigned int P_ROOT_NODE_NUM = 0;
 #    endif
 
 #    define IFROOTNODE if (ParallelInfo::getRank() == P_ROOT_NODE_NUM)
-#    define IFCHILDNODE if (ParallelInfo::getRank() <> P_ROOT_NODE_NUM)
+#    define IFCHILDNODE if (ParallelInfo::getRank() != P_ROOT_NODE_NUM)
 
 // Structure type ParallelInfo tracks all the information a node
 // needs to store about 1 of its neighbors
@@ -92,38 +94,62 @@ class ParallelInfo {
   static void Barrier();
   static inline unsigned int getRank() { return P_MyRank; }
   static inline unsigned int getNumNodes() { return P_NumNodes; }
-  static UIMatrix rcvNodeConn(const UIVector &Shuffle,
-                              const UIVector &FanInCon);
-  static UIVector rcvNrnConn(const UIVector &nrnNodeConn, const int nrn,
-                             const UIVector &Shuffle, const UIVector &UnShuffle,
-                             const UIVector &FanInCon,
-                             const DendriteConst * const InMatrix);
-  static UIVector rcvNrnAij(const UIVector &nrnNodeConn, const int nrn,
-                            const UIVector &Shuffle, const UIVector &FanInCon,
+  // The neurons of compute node i are firstNeurons[i]..firstNeurons[i+1]-1
+  static void setPartition(const UIVector &firstNeurons);
+  static inline const UIVector& getPartition() { return P_FirstNeuron; }
+  static inline unsigned int getFirstNeuron(const unsigned int node) {
+    return P_FirstNeuron[node];
+  }
+  static inline unsigned int getNumNeurons(const unsigned int node) {
+    return P_FirstNeuron[node + 1] - P_FirstNeuron[node];
+  }
+  static unsigned int getNodeOf(const unsigned int nrn);
+  static vector<double> sumCosts(const vector<double> &myCost);
+  // Where gatherFanIn put each node's share of the fan-in: on the root,
+  // Counts[node * ni + nrn] of nrn's synapses came from node, whose share
+  // starts at Displs[node] and holds NodeTotals[node] synapses
+  struct FanInLayout {
+    vector<int> Counts;
+    vector<int> NodeTotals;
+    vector<int> Displs;
+  };
+  // Collects each neuron's fan-in connections, weights and (if withDelays)
+  // axonal delays from all nodes; conn, wij and aij are filled on the root,
+  // and layout too if given
+  static void gatherFanIn(const UIVector &Shuffle, const UIVector &UnShuffle,
+                          const UIVector &FanInCon,
+                          const DendriteConst * const inMatrix,
+                          const UIMatrix &FanOutCon,
+                          const AxonConst * const outMatrix,
+                          const unsigned int minAxonalDelay,
+                          const unsigned int maxAxonalDelay,
+                          const bool withDelays, UIMatrix &conn,
+                          DataMatrix &wij, UIMatrix &aij,
+                          FanInLayout *layout = NULL);
+  // Collects only the weights, neuron by neuron as gatherFanIn orders them,
+  // into weights on the root. The connections must not have changed since
+  // gatherFanIn filled layout.
+  static void gatherWeights(const UIVector &Shuffle, const UIVector &FanInCon,
                             const DendriteConst * const inMatrix,
-                            const UIMatrix &FanOutCon,
-                            const AxonConst * const outMatrix,
-                            const unsigned int minAxonalDelay,
-                            const unsigned int maxAxonalDelay);
-  static DataList rcvNrnWij(const UIVector &nrnNodeConn, const int nrn,
-                            const UIVector &Shuffle, const UIVector &FanInCon,
-                            const DendriteConst * const inMatrix);
+                            const FanInLayout &layout, DataList &weights);
+  // Sends the root's conn, wij and (if withDelays) aij to every node
+  static void broadcastFanIn(const bool withDelays, UIMatrix &conn,
+                             DataMatrix &wij, UIMatrix &aij);
   static DataList exchangeSumwz(DataList &mySumwz);  // Peer-to-peer
+  // Split-phase exchangeSumwz: the sums are valid once finish returns
+  static void startExchangeSumwz(DataList &sumwz, DataList &sumwz_inhdiv,
+                                 DataList &sumwz_inhsub);
+  static void finishExchangeSumwz();
+  // ReproSum: sums the integer buses, which gives the same bits however
+  // the neurons are divided among the nodes
+  static void sumFixedBuses(FixedBus &bus, FixedBus &bus_inhdiv,
+                            FixedBus &bus_inhsub);
+  // SpikeExchange: every node gets the concatenation of all nodes' lists
+  static UIVector exchangeFired(const UIVector &myFired);
+  static void exchangeCandidates(UIVector &ix, vector<double> &y);
   static DataList rcvSumwz();
   static Pattern rcvZi();
   static void RootSend(const string msg);
-  static void sendNodeConn(const UIVector &Shuffle, const UIVector &FanInCon);
-  static void sendNrnConn(const UIVector &Shuffle, const UIVector &UnShuffle,
-                          const UIVector &FanInCon,
-                          const DendriteConst * const InMatrix);
-  static void sendNrnAij(const UIVector &Shuffle, const UIVector &FanInCon,
-                         const DendriteConst * const inMatrix,
-                         const UIMatrix &FanOutCon,
-                         const AxonConst * const outMatrix,
-                         const unsigned int minAxonalDelay,
-                         const unsigned int maxAxonalDelay);
-  static void sendNrnWij(const UIVector &Shuffle, const UIVector &FanInCon,
-                         const DendriteConst * const inMatrix);
   static void sendSumwz(const DataList &toSend);
   static void sendZi(const Pattern &toSend);
 
@@ -135,6 +161,10 @@ class ParallelInfo {
   static unsigned int P_MyRank;
   static ParallelInfo *P_Nodes;
   static ParallelRand *P_RandComm;
+  static MPI_Request P_SumwzReq[3];
+  static UIVector P_FirstNeuron;
+  static int gatherCounts(const int myCount, vector<int> &counts,
+                          vector<int> &displs);
   int *P_zi;
   double *P_sumwz;
 };
@@ -41,6 +41,9 @@
 #if !defined(PARALLELRAND_HPP)
 #include "ParallelRand.hpp"
 #endif
+#if !defined(SIMSTATE_HPP)
+#include "SimState.hpp"
+#endif
 
 #if defined(MULTIPROC)
 ParallelRand ParallelRand::RandComm;
@@ -144,5 +147,41 @@ void ParallelRand::GenUniform(MPI_Request * request, MPI_Status * status) {
     MPI_Test(request, &flag, status);
   }
 }
+
+void ParallelRand::saveState(SimState &state) {
+  LocalSynNoise.SaveState(state);
+  // The bucket is used up in order before LocalSynNoise is drawn from again
+  state.put<int32_t>(m_rng_available);
+  for (int i = 0; i < m_rng_available; ++i) {
+    const int ndx = (m_rng_next_available + i) % m_rng_max_available;
+    if (m_rng_type == PR_BERNOULLI) {
+      state.putBool(m_rng_bool_bucket[ndx]);
+    } else {
+      state.put(m_rng_double_bucket[ndx]);
+    }
+  }
+}
+
+void ParallelRand::loadState(SimState &state) {
+  LocalSynNoise.LoadState(state);
+  int32_t available = 0;
+  state.get(available);
+  const bool haveBucket = (m_rng_type == PR_BERNOULLI) ? (m_rng_bool_bucket != NULL)
+    : (m_rng_double_bucket != NULL);
+  if ((available < 0) || ((available > 0) && (!haveBucket || (available > m_rng_max_available)))) {
+    state.fail();
+  }
+  m_rng_available = 0;
+  m_rng_next_available = 0;
+  if (state.failed()) return;
+  for (int i = 0; i < available; ++i) {
+    if (m_rng_type == PR_BERNOULLI) {
+      m_rng_bool_bucket[i] = state.getBool();
+    } else {
+      state.get(m_rng_double_bucket[i]);
+    }
+  }
+  m_rng_available = available;
+}
 #endif //MULTIPROC
 
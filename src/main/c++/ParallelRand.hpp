@@ -64,6 +64,8 @@
 // Number of random numbers to generate between status checks
 const int RNG_MAX_GEN = 1000;
 
+class SimState;
+
 class ParallelRand {
  public:
   ParallelRand(): m_rng_bool_bucket(NULL), m_rng_double_bucket(NULL) { }
@@ -166,6 +168,11 @@ class ParallelRand {
 #      endif
   }
 
+  // The generator and the numbers waiting in the bucket, for @SaveState
+  // and @LoadState
+  void saveState(SimState &state);
+  void loadState(SimState &state);
+
   static ParallelRand RandComm;
 
  private:
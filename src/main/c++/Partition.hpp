@@ -0,0 +1,84 @@
+/***************************************************************************
+ * Partition.hpp
+ *
+ *  Splits the neurons into contiguous ranges, one per compute node, so
+ *  that each node gets about the same amount of work
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#if !defined(PARTITION_HPP)
+#define PARTITION_HPP
+
+#include <algorithm>
+#include <vector>
+
+// A partition of n neurons into numParts ranges is given by numParts + 1
+// bounds: part p holds neurons bounds[p] .. bounds[p+1]-1.
+
+// Equal numbers of neurons, the first n % numParts parts getting one more
+inline std::vector<unsigned int> partitionEvenly(const unsigned int n,
+                                                 const unsigned int numParts) {
+  std::vector<unsigned int> bounds(numParts + 1, 0);
+  for (unsigned int part = 0; part < numParts; ++part) {
+    bounds[part + 1] = bounds[part] + n / numParts + ((part < n % numParts) ? 1 : 0);
+  }
+  return bounds;
+}
+
+// Contiguous ranges of about equal total cost. Each boundary is put at the
+// neuron edge nearest to its share of the total, and every part keeps at
+// least one neuron as long as there are enough to go around.
+inline std::vector<unsigned int> partitionByCost(const std::vector<double> &cost,
+                                                 const unsigned int numParts) {
+  const unsigned int n = cost.size();
+  std::vector<unsigned int> bounds(numParts + 1, n);
+  bounds[0] = 0;
+  double total = 0.0;
+  for (unsigned int i = 0; i < n; ++i) total += cost[i];
+  double sumSoFar = 0.0;
+  unsigned int nrn = 0;
+  for (unsigned int part = 1; part < numParts; ++part) {
+    const double target = total * part / numParts;
+    const unsigned int maxEnd = n - std::min(n, numParts - part);
+    const unsigned int minEnd = std::min(bounds[part - 1] + 1, maxEnd);
+    while ((nrn < maxEnd) &&
+           ((nrn < minEnd) || (sumSoFar + cost[nrn] / 2 <= target))) {
+      sumSoFar += cost[nrn];
+      ++nrn;
+    }
+    bounds[part] = nrn;
+  }
+  return bounds;
+}
+
+// The cost of the busiest part relative to the average part (1 is perfect)
+inline double partitionImbalance(const std::vector<double> &cost,
+                                 const std::vector<unsigned int> &bounds) {
+  const unsigned int numParts = bounds.size() - 1;
+  double total = 0.0;
+  double busiest = 0.0;
+  for (unsigned int part = 0; part < numParts; ++part) {
+    double partCost = 0.0;
+    for (unsigned int i = bounds[part]; i < bounds[part + 1]; ++i) {
+      partCost += cost[i];
+    }
+    total += partCost;
+    busiest = std::max(busiest, partCost);
+  }
+  return (total > 0.0) ? busiest * numParts / total : 1.0;
+}
+#endif  // PARTITION_HPP
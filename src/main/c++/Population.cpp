@@ -21,6 +21,9 @@
 #  include "Population.hpp"
 #endif
 
+#if !defined(SIMSTATE_HPP)
+#  include "SimState.hpp"
+#endif
 #if !defined(SYSTEMVAR_HPP)
 #  include "SystemVar.hpp"
 #endif
@@ -107,6 +110,34 @@ void Population::initInterneurons() {
   updateInterneuronDecay(static_cast<double>(decay));
 }
 
+namespace {
+  void saveInterneurons(SimState &state, const InterneuronVec &inters) {
+    state.put<uint32_t>(inters.size());
+    for (InterneuronVecCIt it = inters.begin(); it != inters.end(); ++it) {
+      it->saveState(state);
+    }
+  }
+  // The interneurons themselves are added by the script
+  void loadInterneurons(SimState &state, InterneuronVec &inters) {
+    uint32_t num = 0;
+    state.get(num);
+    if (num != inters.size()) state.fail();
+    for (InterneuronVecIt it = inters.begin(); (it != inters.end()) && !state.failed(); ++it) {
+      it->loadState(state);
+    }
+  }
+}
+
+void Population::saveState(SimState &state) const {
+  saveInterneurons(state, m_feedbackInterneurons);
+  saveInterneurons(state, m_feedforwardInterneurons);
+}
+
+void Population::loadState(SimState &state) {
+  loadInterneurons(state, m_feedbackInterneurons);
+  loadInterneurons(state, m_feedforwardInterneurons);
+}
+
 float Population::getFeedbackInhibition() const {
   return for_each(m_feedbackInterneurons.begin(), m_feedbackInterneurons.end(), WeightedAverager()).result();
 }
@@ -25,6 +25,9 @@
 #  if !defined(DATATYPES_HPP)
 #    include "DataTypes.hpp"
 #  endif
+#  if !defined(UNDOLOG_HPP)
+#    include "UndoLog.hpp"
+#  endif
 #  if !defined(INTERNEURON_HPP)
 #    include "neural/Interneuron.hpp"
 #  endif
@@ -32,6 +35,8 @@
 #    include "neural/NeuronType.hpp"
 #  endif
 
+class SimState;
+
 class Population {
  public:
   Population(unsigned int f, unsigned int l, NeuronType& nType):
@@ -87,6 +92,10 @@ class Population {
   unsigned int getLastNeuron() const {return m_lastNeuron;}
   NeuronType* getNeuronType() const {return m_neuronType;}
   void initInterneurons();
+  // The interneurons, for @SaveState and @LoadState; loadState fails the
+  // state if it holds a different number of them
+  void saveState(SimState &state) const;
+  void loadState(SimState &state);
   void loadSynapseFilterValues(const DataList &filterVals) {
     if (SystemVar::GetIntVar("WtFiltIsGeneric")) {
       m_neuronType->loadSynapseFilterValues(filterVals);
@@ -110,29 +119,10 @@ class Population {
       it->reset();
     }
   }
-  void restoreInhState() {
-    for (InterneuronVecIt it = m_feedbackInterneurons.begin();
-         it != m_feedbackInterneurons.end(); ++it) {
-      it->copy(m_feedbackInterneurons_dup.back());
-      m_feedbackInterneurons_dup.pop_back();
-    }
-    for (InterneuronVecIt it = m_feedforwardInterneurons.begin();
-         it != m_feedforwardInterneurons.end(); ++it) {
-      it->copy(m_feedforwardInterneurons_dup.back());
-      m_feedforwardInterneurons_dup.pop_back();
-    }
-  }
-  void saveInhState() {
-    for (InterneuronVecIt it = m_feedbackInterneurons.begin();
-         it != m_feedbackInterneurons.end(); ++it) {
-      m_feedbackInterneurons_dup.insert(m_feedbackInterneurons_dup.begin(),
-                                        *it);
-    }
-    for (InterneuronVecIt it = m_feedforwardInterneurons.begin();
-         it != m_feedforwardInterneurons.end(); ++it) {
-      m_feedforwardInterneurons_dup
-        .insert(m_feedforwardInterneurons_dup.begin(), *it);
-    }
+  // Keeps the interneurons as they are until log is rolled back
+  void saveInhState(UndoLog &log) {
+    log.save(m_feedbackInterneurons);
+    log.save(m_feedforwardInterneurons);
   }
   void setActivityAveragingRate(float actAvgRate) {
     for (InterneuronVecIt it = m_feedbackInterneurons.begin();
@@ -233,8 +223,6 @@ class Population {
   unsigned int m_lastNeuron;
   InterneuronVec m_feedbackInterneurons;
   InterneuronVec m_feedforwardInterneurons;
-  InterneuronVec m_feedbackInterneurons_dup;
-  InterneuronVec m_feedforwardInterneurons_dup;
   NeuronType* m_neuronType;
   bool m_forceExt;
 };
@@ -23,6 +23,9 @@
 #  if !defined(PROGRAM_HPP)
 #    include "Program.hpp"
 #  endif
+#  if !defined(ASYNCWRITER_HPP)
+#    include "AsyncWriter.hpp"
+#  endif
 #  if !defined(PARALLEL_HPP)
 #    include "Parallel.hpp"
 #  endif
@@ -38,6 +41,9 @@
 #  if !defined(DENDRITICSYNAPSE_HPP)
 #     include "neural/DendriticSynapse.hpp"
 #  endif
+#  if !defined(SIMSTATE_HPP)
+#     include "SimState.hpp"
+#  endif
 #  include <iostream>
 #  include <fstream>
 #  include <cmath>
@@ -246,33 +252,122 @@ void program::PrintHelp(const string& str, const string& funct) const {
 }
 
 void program::setAllSeeds() {
-  // First seed the rngs that must match from node to node
   const int tmpseed = SystemVar::GetIntVar("seed");
-  ExternalNoise.Reset(tmpseed);
-  PickNoise.Reset(tmpseed);
-  ResetNoise.Reset(tmpseed);
-  WeightNoise.Reset(tmpseed);
+  const char rngType = parseRNGType(SystemVar::GetStrVar("RNGType"));
+  if (rngType == 'p') {
+    // Counter-based streams are keyed by purpose instead of by node, so
+    // every node draws the same numbers for the same neuron and time step
+    ExternalNoise.ResetStream(tmpseed, NS_External);
+    PickNoise.ResetStream(tmpseed, NS_Pick);
+    ResetNoise.ResetStream(tmpseed, NS_Reset);
+    WeightNoise.ResetStream(tmpseed, NS_Weight);
+#if defined(MULTIPROC)
+    ShuffleNoise.ResetStream(tmpseed, NS_Shuffle);
+    ParallelInfo::resetRandComm((tmpseed + ParallelInfo::getRank() * 102) % 32000);
+#endif
+    TieBreakNoise.ResetStream(tmpseed, NS_TieBreak);
+    Calc::ResetUserNoise(tmpseed);
+    DendriticSynapse::SynNoise.ResetStream(tmpseed, NS_SynFail);
+    ConnectNoise.ResetStream(tmpseed, NS_Connect);
+  } else {
+    // First seed the rngs that must match from node to node
+    ExternalNoise.Reset(tmpseed, rngType);
+    PickNoise.Reset(tmpseed, rngType);
+    ResetNoise.Reset(tmpseed, rngType);
+    WeightNoise.Reset(tmpseed, rngType);
 #if defined(MULTIPROC)
-  ShuffleNoise.Reset(tmpseed);
+    ShuffleNoise.Reset(tmpseed, rngType);
 #endif
-  TieBreakNoise.Reset(tmpseed);
-  Calc::ResetUserNoise(tmpseed);
-  // Then seed the rngs that must differ from node to node
+    TieBreakNoise.Reset(tmpseed, rngType);
+    Calc::ResetUserNoise(tmpseed);
+    // Then seed the rngs that must differ from node to node
 #if defined(MULTIPROC)
-  // here, I initialize the node-specific random number generator
-  // the magic #, 102, is totally arbitrary -- so if you can think of a better way to space the seeds, go for it
-  const int specseed = (tmpseed + ParallelInfo::getRank() * 102) % 32000;
-  Output::Out() << MSG << "NeuroJet node seed: " << specseed << std::endl;
-  DendriticSynapse::SynNoise.Reset(specseed);
-  ConnectNoise.Reset(specseed);
-  ParallelInfo::resetRandComm(specseed);
+    // here, I initialize the node-specific random number generator
+    // the magic #, 102, is totally arbitrary -- so if you can think of a better way to space the seeds, go for it
+    const int specseed = (tmpseed + ParallelInfo::getRank() * 102) % 32000;
+    Output::Out() << MSG << "NeuroJet node seed: " << specseed << std::endl;
+    DendriticSynapse::SynNoise.Reset(specseed, rngType);
+    ConnectNoise.Reset(specseed, rngType);
+    ParallelInfo::resetRandComm(specseed);
 #else
-  DendriticSynapse::SynNoise.Reset(tmpseed);
-  ConnectNoise.Reset(tmpseed);
+    DendriticSynapse::SynNoise.Reset(tmpseed, rngType);
+    ConnectNoise.Reset(tmpseed, rngType);
 #endif
+  }
+  // Only weight initialization draws normals here
+  WeightNoise.SetNormalMethod(parseNormalMethod(SystemVar::GetStrVar("NormalMethod")));
+  // Generate the numbers used during simulation on another thread
+  const int prefetch = SystemVar::GetIntVar("RNGPrefetch");
+  if (prefetch > 0) {
+    // Both prefetch or neither does
+    const bool synStarted = DendriticSynapse::SynNoise.StartPrefetch(prefetch);
+    const bool extStarted = ExternalNoise.StartPrefetch(prefetch);
+    if (!synStarted || !extStarted) {
+      stopPrefetch();
+      Output::Err() << "Warning: RNGPrefetch needs a threaded build and "
+                    << "RNGType TT800 or Xoshiro; ignored." << std::endl;
+    }
+  }
   isNoiseInit = true;
 }
 
+void program::printPrefetchStats() const {
+  if (SystemVar::GetIntVar("RNGPrefetch") <= 0) return;
+  const Noise &syn = DendriticSynapse::SynNoise;
+  Output::Out() << MSG << "RNG blocks prefetched for synaptic failures: "
+                << syn.PrefetchUsed() << " (waited for "
+                << syn.PrefetchStarved() << ")" << std::endl;
+  Output::Out() << MSG << "RNG blocks prefetched for external noise: "
+                << ExternalNoise.PrefetchUsed() << " (waited for "
+                << ExternalNoise.PrefetchStarved() << ")" << std::endl;
+}
+
+void program::stopPrefetch() {
+  DendriticSynapse::SynNoise.StopPrefetch();
+  ExternalNoise.StopPrefetch();
+}
+
+void program::restartPrefetch() {
+  const int prefetch = SystemVar::GetIntVar("RNGPrefetch");
+  if (!isNoiseInit || (prefetch <= 0)) return;
+  // setAllSeeds has already warned if these cannot prefetch
+  const bool synStarted = DendriticSynapse::SynNoise.StartPrefetch(prefetch);
+  const bool extStarted = ExternalNoise.StartPrefetch(prefetch);
+  if (!synStarted || !extStarted) stopPrefetch();
+}
+
+void program::saveNoise(SimState &state) {
+  state.putBool(isNoiseInit);
+  ConnectNoise.SaveState(state);
+  ExternalNoise.SaveState(state);
+  PickNoise.SaveState(state);
+  ResetNoise.SaveState(state);
+#if defined(MULTIPROC)
+  ShuffleNoise.SaveState(state);
+  ParallelRand::RandComm.saveState(state);
+#endif
+  TieBreakNoise.SaveState(state);
+  WeightNoise.SaveState(state);
+  DendriticSynapse::SynNoise.SaveState(state);
+  Calc::SaveUserNoise(state);
+}
+
+void program::loadNoise(SimState &state) {
+  isNoiseInit = state.getBool();
+  ConnectNoise.LoadState(state);
+  ExternalNoise.LoadState(state);
+  PickNoise.LoadState(state);
+  ResetNoise.LoadState(state);
+#if defined(MULTIPROC)
+  ShuffleNoise.LoadState(state);
+  ParallelRand::RandComm.loadState(state);
+#endif
+  TieBreakNoise.LoadState(state);
+  WeightNoise.LoadState(state);
+  DendriticSynapse::SynNoise.LoadState(state);
+  Calc::LoadUserNoise(state);
+}
+
 LearningRuleType program::parseLearningRuleType(string lrt) {
   // Defined in SynapseType.hpp
   LearningRuleType retval = LRT_Undef;
@@ -288,6 +383,30 @@ LearningRuleType program::parseLearningRuleType(string lrt) {
   return retval;
 }
 
+char program::parseRNGType(string rt) {
+  // Same type codes as Noise::Reset
+  char retval = '\0';
+  if (rt == "TT800") {
+    retval = 't';
+  } else if (rt == "Philox") {
+    retval = 'p';
+  } else if (rt == "Xoshiro") {
+    retval = 'x';
+  }
+  return retval;
+}
+
+char program::parseNormalMethod(string nm) {
+  // Same method codes as Noise::SetNormalMethod
+  char retval = '\0';
+  if (nm == "BoxMuller") {
+    retval = 'b';
+  } else if (nm == "Ziggurat") {
+    retval = 'z';
+  }
+  return retval;
+}
+
 ThresholdType program::parseThresholdType(string tt) {
   // Defined in NeuronType.hpp
   ThresholdType retval = TT_Undef;
@@ -406,6 +525,8 @@ void System(ArgListType &arg) //AT_FUN
                   << std::endl;
     exit(EXIT_FAILURE);
   }
+  // The command may read what the script has written
+  AsyncWriter::flush();
   system(arg.at(0).first.c_str());
 }
 #  endif
@@ -39,6 +39,9 @@
 #  if !defined(NEURONTYPE_HPP)
 #    include "neural/NeuronType.hpp"
 #  endif
+#  if defined(MULTIPROC) && !defined(PARALLEL_HPP)
+#    include "Parallel.hpp"
+#  endif
 #  if !defined(PARALLELRAND_HPP)
 #    include "ParallelRand.hpp"
 #  endif
@@ -111,6 +114,10 @@ class program {
     chkNoiseInit();
     return ConnectNoise.RandInt(start, end);
   }
+  inline void getConnectNoise(int *vec, int rows, unsigned int start, unsigned end) {
+    chkNoiseInit();
+    ConnectNoise.RandInt(vec, rows, start, end);
+  }
   inline unsigned int getExtRandInt(unsigned int start, unsigned end) {
     chkNoiseInit();
     return ExternalNoise.RandInt(start, end);
@@ -119,6 +126,14 @@ class program {
     chkNoiseInit();
     return ExternalNoise.Bernoulli(p);
   }
+  inline void getExtBernoulli(int *vec, int rows, double p) {
+    chkNoiseInit();
+    ExternalNoise.Bernoulli(vec, rows, p);
+  }
+  inline void getExtBernoulli(int *vec, const float *rates, int rows) {
+    chkNoiseInit();
+    ExternalNoise.Bernoulli(vec, rates, rows);
+  }
   inline unsigned int getResetNeuron(unsigned int numNeurons) {
     chkNoiseInit();
     return ResetNoise.RandInt(0, numNeurons - 1);
@@ -127,16 +142,52 @@ class program {
     chkNoiseInit();
     return WeightNoise.Normal(mu, sigma);
   }
+  // Normal(mu, sigma) restricted to [low, high]
+  inline double getWeightTruncNormal(double mu, double sigma, double low, double high) {
+    chkNoiseInit();
+    return WeightNoise.TruncNormal(mu, sigma, low, high);
+  }
   inline double getWeightUniform(double low, double high) {
     chkNoiseInit();
     return WeightNoise.Uniform(low, high);
   }
+  inline void getWeightUniform(double *vec, int rows, double low, double high) {
+    chkNoiseInit();
+    WeightNoise.Uniform(vec, rows, low, high);
+  }
   inline unsigned int pickTie(unsigned int numTies) {
     chkNoiseInit();
     return TieBreakNoise.RandInt(0, numTies - 1);
   }
+  // With RNGType Philox, moves the connectivity and weight rngs to the
+  // substream of post-synaptic neuron n so its connections do not depend
+  // on how many neurons were connected before it. Otherwise does nothing.
+  // A node that draws only its share of n's fan-in gives its rank as
+  // sub; one that draws all of it gives 0, so that n's connections do
+  // not depend on the number of nodes either.
+  // Returns whether the streams moved, i.e., whether any values drawn
+  // in advance for the previous neuron must be thrown away.
+  inline bool setConnectStream(unsigned int n, unsigned int sub = 0) {
+    chkNoiseInit();
+    if (!ConnectNoise.IsCounterBased()) return false;
+    ConnectNoise.SetStream(n, 0, sub);
+    WeightNoise.SetStream(n, 0, sub);
+    return true;
+  }
   void setAllSeeds();
+  // Every rng of the simulation, for @SaveState and @LoadState
+  void saveNoise(SimState &state);
+  void loadNoise(SimState &state);
+  // Reports how often the RNGPrefetch threads kept ahead of the simulation
+  void printPrefetchStats() const;
+  // fork does not copy the RNGPrefetch threads, so @Sweep stops them
+  // before forking and starts them again on both sides; the numbers
+  // already generated are kept
+  void stopPrefetch();
+  void restartPrefetch();
   static LearningRuleType parseLearningRuleType(string lrt);
+  static char parseNormalMethod(string nm);
+  static char parseRNGType(string rt);
   static ThresholdType parseThresholdType(string tt);
   static void setDefaults(unsigned int ni);
 
@@ -0,0 +1,192 @@
+/***************************************************************************
+ * Recorder.cpp
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#if !defined(RECORDER_HPP)
+#  include "Recorder.hpp"
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <stdint.h>
+
+#if !defined(OUTPUT_HPP)
+#  include "Output.hpp"
+#endif
+
+using std::ios;
+using std::map;
+using std::string;
+
+namespace {
+  const char RecTag[8] = { 'N', 'J', 'R', 'E', 'C', '0', '0', '1' };
+
+  map<string, Recorder::Spec> &specList() {
+    static map<string, Recorder::Spec> specs;
+    return specs;
+  }
+
+  inline void writeUInt(std::ofstream &out, const uint32_t value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+  }
+  inline bool readUInt(std::ifstream &in, uint32_t &value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(&value),
+                                     sizeof(value)));
+  }
+}
+
+Recorder::Recorder(const Spec &spec)
+  : TheSpec(spec), NumSteps(0), NumKept(0), NumCols(0), RingNext(0) {
+  if (TheSpec.Every < 1) TheSpec.Every = 1;
+  if (TheSpec.FirstN < 1) TheSpec.FirstN = 1;
+  if (TheSpec.Sink == SINK_FILE) {
+    if (TheSpec.ChunkSize < 1) TheSpec.ChunkSize = 1;
+    OutFile.open(TheSpec.FileName.c_str(), ios::out | ios::binary | ios::trunc);
+    if (!OutFile) {
+      CALL_ERROR << "Error in Recorder : Unable to open " << TheSpec.FileName
+                 << " for writing" << ERR_WHERE;
+      exit(EXIT_FAILURE);
+    }
+  } else if ((TheSpec.Sink == SINK_RING) && (TheSpec.RingSize < 1)) {
+    TheSpec.Sink = SINK_NONE;
+  }
+}
+
+Recorder::~Recorder() {
+  if (OutFile.is_open()) {
+    writeChunk();
+    OutFile.close();
+  }
+}
+
+void Recorder::record(const DataList &row) {
+  if (TheSpec.Sink == SINK_NONE) return;
+  if (NumSteps++ % TheSpec.Every != 0) return;
+
+  const unsigned int rowSize = row.size();
+  const unsigned int first = std::min(TheSpec.FirstN - 1, rowSize);
+  const unsigned int last = (TheSpec.LastN < 0) ? rowSize
+    : std::min(static_cast<unsigned int>(TheSpec.LastN), rowSize);
+  const unsigned int len = (last > first) ? (last - first) : 0;
+  if (NumKept == 0) {
+    NumCols = len;
+  } else if ((len != NumCols) && (TheSpec.Sink != SINK_MEMORY)) {
+    CALL_ERROR << "Error in Recorder : Row of " << len << " values after rows of "
+               << NumCols << ERR_WHERE;
+    exit(EXIT_FAILURE);
+  }
+  ++NumKept;
+
+  DataListCIt from = row.begin() + first;
+  if ((TheSpec.Sink == SINK_RING) && (Kept.size() == TheSpec.RingSize)) {
+    std::copy(from, from + len, Kept[RingNext].begin());
+    RingNext = (RingNext + 1) % TheSpec.RingSize;
+  } else {
+    if (Kept.empty() && (TheSpec.Sink != SINK_MEMORY)) {
+      Kept.reserve((TheSpec.Sink == SINK_RING) ? TheSpec.RingSize
+                   : TheSpec.ChunkSize, len);
+    }
+    std::copy(from, from + len, Kept.addRow(len).begin());
+  }
+  if ((TheSpec.Sink == SINK_FILE) && (Kept.size() == TheSpec.ChunkSize)) {
+    writeChunk();
+  }
+}
+
+bool Recorder::finish(DenseMatrix &kept) {
+  kept.clear();
+  switch (TheSpec.Sink) {
+  case SINK_MEMORY:
+    Kept.swap(kept);
+    return true;
+  case SINK_RING:
+    kept.reserve(Kept.size(), NumCols);
+    for (unsigned int r = 0; r < Kept.size(); ++r) {
+      const DenseMatrix::Row from = Kept[(RingNext + r) % Kept.size()];
+      std::copy(from.begin(), from.end(), kept.addRow(NumCols).begin());
+    }
+    Kept.clear();
+    return true;
+  case SINK_FILE:
+    writeChunk();
+    OutFile.flush();
+    return false;
+  default:
+    return false;
+  }
+}
+
+void Recorder::writeChunk() {
+  if (!OutFile.is_open()) return;
+  if (OutFile.tellp() == std::streampos(0)) {
+    OutFile.write(RecTag, sizeof(RecTag));
+    writeUInt(OutFile, NumCols);
+    writeUInt(OutFile, TheSpec.FirstN);
+    writeUInt(OutFile, TheSpec.Every);
+  }
+  if (!Kept.empty()) {
+    writeUInt(OutFile, Kept.size());
+    // Every row has NumCols values, so the chunk is already contiguous
+    OutFile.write(reinterpret_cast<const char *>(Kept.data()),
+                  static_cast<std::streamsize>(Kept.size()) * NumCols * sizeof(float));
+    Kept.clear();
+  }
+  if (!OutFile) {
+    CALL_ERROR << "Error in Recorder : Unable to write to " << TheSpec.FileName
+               << ERR_WHERE;
+    exit(EXIT_FAILURE);
+  }
+}
+
+Recorder::Spec Recorder::getSpec(const string &bufferName, const bool doRecord) {
+  Spec toReturn;
+  map<string, Spec>::const_iterator it = specList().find(bufferName);
+  if (it != specList().end()) toReturn = it->second;
+  if (!doRecord) toReturn.Sink = SINK_NONE;
+  return toReturn;
+}
+
+void Recorder::setSpec(const string &bufferName, const Spec &spec) {
+  specList()[bufferName] = spec;
+}
+
+bool Recorder::readFile(const string &fileName, DenseMatrix &rows) {
+  rows.clear();
+  std::ifstream inFile(fileName.c_str(), ios::in | ios::binary);
+  char tag[sizeof(RecTag)];
+  uint32_t numCols, firstN, every;
+  if (!inFile.read(tag, sizeof(tag)) || !std::equal(tag, tag + sizeof(tag), RecTag)
+      || !readUInt(inFile, numCols) || !readUInt(inFile, firstN)
+      || !readUInt(inFile, every)) {
+    return false;
+  }
+  uint32_t numRows;
+  while (readUInt(inFile, numRows)) {
+    rows.reserve(rows.size() + numRows, numCols);
+    for (uint32_t r = 0; r < numRows; ++r) {
+      DenseMatrix::Row row = rows.addRow(numCols);
+      if (numCols > 0 &&
+          !inFile.read(reinterpret_cast<char *>(&row[0]),
+                       static_cast<std::streamsize>(numCols) * sizeof(float))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
@@ -0,0 +1,111 @@
+/***************************************************************************
+ * Recorder.hpp
+ *
+ *  Where the per-time-step buffers of @Train and @Test go
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+///////////////////////////////////////////////////////////////////////////////
+//
+// A Recorder takes one row per time step and sends it to a sink:
+//
+//   memory  keeps every row, as the buffers always have
+//   ring    keeps only the last RingSize rows
+//   file    writes rows to a binary file ChunkSize rows at a time
+//   none    drops them (what -norecord asks for)
+//
+// Before reaching the sink a row can be cut down to the neurons
+// FirstN..LastN (1-based, LastN of -1 meaning the end of the row), and
+// only every Every-th time step is kept. So memory is bounded by the ring
+// or chunk size rather than by the length of the run.
+//
+// The spec for each named buffer (TestingBusLines, etc.) is set from the
+// script with @Record and kept until it is changed.
+//
+// A file holds the 8 byte tag "NJREC001", then the unsigned 32 bit
+// integers NumCols, FirstN and Every, then chunks, each of which is an
+// unsigned 32 bit row count followed by that many rows of NumCols 32 bit
+// floats, all in the byte order of the machine that wrote it.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#if !defined(RECORDER_HPP)
+#  define RECORDER_HPP
+
+#  include <fstream>
+#  include <string>
+
+#  if !defined(DATATYPES_HPP)
+#    include "DataTypes.hpp"
+#  endif
+#  if !defined(DENSEMATRIX_HPP)
+#    include "DenseMatrix.hpp"
+#  endif
+
+class Recorder {
+ public:
+  enum SinkType { SINK_MEMORY, SINK_RING, SINK_FILE, SINK_NONE };
+
+  struct Spec {
+    Spec(): Sink(SINK_MEMORY), RingSize(0), ChunkSize(1024), Every(1),
+            FirstN(1), LastN(-1) {}
+    SinkType Sink;
+    unsigned int RingSize;    // ring only
+    std::string FileName;     // file only
+    unsigned int ChunkSize;   // file only
+    unsigned int Every;
+    unsigned int FirstN;
+    int LastN;
+  };
+
+  explicit Recorder(const Spec &spec = Spec());
+  ~Recorder();
+
+  inline bool isRecording() const { return TheSpec.Sink != SINK_NONE; }
+  inline const Spec &spec() const { return TheSpec; }
+  // Number of rows that reached the sink
+  inline unsigned long numKept() const { return NumKept; }
+
+  void record(const DataList &row);
+  // Ends the recording. Returns true, with the rows kept in order, for the
+  // memory and ring sinks; a file sink writes out what it still holds.
+  bool finish(DenseMatrix &kept);
+
+  // The spec @Record gave bufferName, or the memory sink if none; the
+  // none sink if doRecord is false
+  static Spec getSpec(const std::string &bufferName, const bool doRecord = true);
+  static void setSpec(const std::string &bufferName, const Spec &spec);
+  // Reads a file written by a file sink
+  static bool readFile(const std::string &fileName, DenseMatrix &rows);
+
+ private:
+  // Not copyable
+  Recorder(const Recorder &);
+  Recorder &operator=(const Recorder &);
+
+  void writeChunk();
+
+  Spec TheSpec;
+  unsigned long NumSteps;
+  unsigned long NumKept;
+  unsigned int NumCols;
+  DenseMatrix Kept;          // all rows, the ring or the unwritten chunk
+  unsigned int RingNext;     // the oldest row once the ring is full
+  std::ofstream OutFile;
+};
+
+#endif  // RECORDER_HPP
@@ -0,0 +1,151 @@
+/***************************************************************************
+ * SimState.cpp
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#if !defined(SIMSTATE_HPP)
+#  include "SimState.hpp"
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+using std::string;
+
+namespace {
+  const char StateTag[8] = { 'N', 'J', 'S', 'T', 'A', 'T', 'E', '\0' };
+  const std::size_t TagBytes = 4;
+  const std::size_t HeaderBytes = sizeof(StateTag) + 2 * sizeof(uint32_t);
+  const std::size_t SectionHeaderBytes = TagBytes + sizeof(uint64_t);
+}
+
+void SimState::beginSection(const char *tag) {
+  endSection();
+  if (Data.empty()) {
+    Data.append(StateTag, sizeof(StateTag));
+    // Copied, as the constants have no storage of their own
+    const uint32_t version = Version;
+    const uint32_t mark = ByteOrderMark;
+    put(version);
+    put(mark);
+  }
+  char padded[TagBytes] = { 0, 0, 0, 0 };
+  memcpy(padded, tag, std::min(strlen(tag), TagBytes));
+  Data.append(padded, TagBytes);
+  SectionAt = Data.size();
+  put<uint64_t>(0);
+}
+
+void SimState::endSection() {
+  if (SectionAt == string::npos) return;
+  const uint64_t len = Data.size() - SectionAt - sizeof(uint64_t);
+  memcpy(&Data[SectionAt], &len, sizeof(len));
+  SectionAt = string::npos;
+}
+
+bool SimState::write(const string &fileName) {
+  endSection();
+  // Written beside the old file, which it only replaces once complete
+  const string tmpName = fileName + ".tmp";
+  {
+    std::ofstream outFile(tmpName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!outFile) return false;
+    outFile.write(Data.data(), Data.size());
+    outFile.close();
+    if (!outFile) {
+      remove(tmpName.c_str());
+      return false;
+    }
+  }
+  if (rename(tmpName.c_str(), fileName.c_str()) != 0) {
+    remove(tmpName.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool SimState::read(const string &fileName) {
+  Data.clear();
+  Sections.clear();
+  Pos = SectionEnd = 0;
+  Failed = true;
+  std::ifstream inFile(fileName.c_str(), std::ios::in | std::ios::binary);
+  if (!inFile) return false;
+  inFile.seekg(0, std::ios::end);
+  const std::streamoff fileSize = inFile.tellg();
+  inFile.seekg(0, std::ios::beg);
+  if (fileSize < static_cast<std::streamoff>(HeaderBytes)) return false;
+  Data.resize(static_cast<std::size_t>(fileSize));
+  if (!inFile.read(&Data[0], fileSize)) return false;
+
+  uint32_t version, mark;
+  memcpy(&version, &Data[sizeof(StateTag)], sizeof(version));
+  memcpy(&mark, &Data[sizeof(StateTag) + sizeof(version)], sizeof(mark));
+  if (!std::equal(StateTag, StateTag + sizeof(StateTag), Data.begin())
+      || (version != Version) || (mark != ByteOrderMark)) {
+    return false;
+  }
+  std::size_t at = HeaderBytes;
+  while (at < Data.size()) {
+    if (Data.size() - at < SectionHeaderBytes) return false;
+    // Tags shorter than TagBytes are padded with zeros
+    const char *tagAt = Data.data() + at;
+    const string tag(tagAt, std::find(tagAt, tagAt + TagBytes, '\0'));
+    uint64_t len;
+    memcpy(&len, &Data[at + TagBytes], sizeof(len));
+    at += SectionHeaderBytes;
+    if (len > Data.size() - at) return false;
+    Sections[tag] = std::make_pair(at, at + static_cast<std::size_t>(len));
+    at += static_cast<std::size_t>(len);
+  }
+  Failed = false;
+  return true;
+}
+
+bool SimState::section(const char *tag) {
+  const string key(tag, std::min(TagBytes, strlen(tag)));
+  std::map<string, std::pair<std::size_t, std::size_t> >::const_iterator it = Sections.find(key);
+  if (it == Sections.end()) {
+    Failed = true;
+    return false;
+  }
+  Pos = it->second.first;
+  SectionEnd = it->second.second;
+  return true;
+}
+
+std::size_t SimState::getCount(const std::size_t elemSize) {
+  uint64_t num = 0;
+  get(num);
+  // A count larger than the rest of the section is a damaged file
+  if (Failed || (num > (SectionEnd - Pos) / std::max<std::size_t>(elemSize, 1))) {
+    Failed = true;
+    return 0;
+  }
+  return static_cast<std::size_t>(num);
+}
+
+void SimState::getString(string &str) {
+  const std::size_t len = getCount(1);
+  if ((len > 0) && take(len)) {
+    str.assign(&Data[Pos - len], len);
+  } else {
+    str.clear();
+  }
+}
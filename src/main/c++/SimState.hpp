@@ -1,6 +1,8 @@
 /***************************************************************************
  * SimState.hpp
  *
+ *  A binary snapshot of everything a simulation changes as it runs
+ *
  *  Copyright 2011 Informed Simplifications, LLC
  *  This file is part of NeuroJet.
  *
@@ -17,50 +19,136 @@
  *  You should have received a copy of the GNU Lesser General Public License
  *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
  ****************************************************************************/
+///////////////////////////////////////////////////////////////////////////////
+//
+// @SaveState and @LoadState write and read a SimState. Each part of the
+// simulation puts its state into a section of its own with the put
+// functions, and gets it back, in the same order, with the get functions.
+// Sections are found by their tag, so they may be read in any order, and
+// a reader can tell a missing section from one that is cut short.
+//
+// A file starts with the 8 byte tag "NJSTATE\0", the unsigned 32 bit
+// Version and ByteOrderMark, followed by the sections: a 4 byte tag, the
+// unsigned 64 bit length of what follows and then that many bytes. Values
+// are stored as they are held in memory, so floats keep every bit and a
+// file can only be read on a machine of the same byte order (which the
+// mark checks). A file of another Version is refused rather than guessed
+// at.
+//
+// write replaces the file only once the new one is complete, so a run
+// stopped partway through writing keeps its last good snapshot.
+//
+///////////////////////////////////////////////////////////////////////////////
+
 #if !defined(SIMSTATE_HPP)
 #  define SIMSTATE_HPP
 
+#  include <cstring>
+#  include <deque>
+#  include <map>
+#  include <string>
 #  include <vector>
-
-#  if !defined(DATATYPES_HPP)
-#    include "DataTypes.hpp"
-#  endif
-#  if !defined(NOISE_HPP)
-#    include "Noise.hpp"
-#  endif
-#  if !defined(INTERNEURON_HPP)
-#    include "neural/Interneuron.hpp"
-#  endif
+#  include <stdint.h>
 
 class SimState {
+ public:
+  static const uint32_t Version = 1;
+  static const uint32_t ByteOrderMark = 0x01020304;
+
+  SimState(): SectionAt(std::string::npos), Pos(0), SectionEnd(0), Failed(false) {}
+
+  //////////////
+  // Writing  //
+  //////////////
+  // Ends the section being written, if any, and starts a new one
+  void beginSection(const char *tag);
+  template<class T> inline void put(const T &val) {
+    Data.append(reinterpret_cast<const char *>(&val), sizeof(T));
+  }
+  template<class T> inline void putArray(const T *vals, const std::size_t num) {
+    if (num > 0) Data.append(reinterpret_cast<const char *>(vals), num * sizeof(T));
+  }
+  // A count followed by the values
+  template<class T> inline void putVector(const std::vector<T> &vals) {
+    put<uint64_t>(vals.size());
+    if (!vals.empty()) putArray(&vals[0], vals.size());
+  }
+  template<class T> void putDeque(const std::deque<T> &vals) {
+    put<uint64_t>(vals.size());
+    for (typename std::deque<T>::const_iterator it = vals.begin(); it != vals.end(); ++it) {
+      put(*it);
+    }
+  }
+  inline void putString(const std::string &str) {
+    put<uint64_t>(str.size());
+    Data.append(str);
+  }
+  inline void putBool(const bool val) { put<uint8_t>(val ? 1 : 0); }
+  // Returns false if the file could not be written
+  bool write(const std::string &fileName);
+
+  //////////////
+  // Reading  //
+  //////////////
+  // Returns false if fileName is not a state file of this Version
+  bool read(const std::string &fileName);
+  // Starts reading the section with the tag, returning false if there is none
+  bool section(const char *tag);
+  template<class T> inline void get(T &val) {
+    if (take(sizeof(T))) memcpy(&val, &Data[Pos - sizeof(T)], sizeof(T));
+  }
+  template<class T> inline void getArray(T *vals, const std::size_t num) {
+    if ((num > 0) && take(num * sizeof(T))) {
+      memcpy(vals, &Data[Pos - num * sizeof(T)], num * sizeof(T));
+    }
+  }
+  template<class T> void getVector(std::vector<T> &vals) {
+    const std::size_t num = getCount(sizeof(T));
+    vals.resize(num);
+    if (num > 0) getArray(&vals[0], num);
+  }
+  template<class T> void getDeque(std::deque<T> &vals) {
+    const std::size_t num = getCount(sizeof(T));
+    vals.resize(num);
+    for (typename std::deque<T>::iterator it = vals.begin(); it != vals.end(); ++it) {
+      get(*it);
+    }
+  }
+  void getString(std::string &str);
+  inline bool getBool() {
+    uint8_t val = 0;
+    get(val);
+    return val != 0;
+  }
+  // Marks the state as bad, e.g. when it does not fit the network
+  inline void fail() { Failed = true; }
+  // Whether anything was read past the end of its section, or fail called
+  inline bool failed() const { return Failed; }
+  // Whether everything in the section has been read
+  inline bool atSectionEnd() const { return Pos == SectionEnd; }
+
+  inline std::size_t size() const { return Data.size(); }
+
  private:
-  UIVectorDeque Fired;  // Not just last time step, but enough for
-  // axonal delays
-  Interneuron feedbackInterneuron;
-  Interneuron feedforwardInterneuron;
-  float* IzhV;    // Only necessary for Izh model
-  float* IzhU;    // Only necessary for Izh model
-  std::vector<DataList> lastActivate;  // Time that synapse was last activated
-                                       // (Necessary for zbar)
-  int timeStep;   // Don't want to mess up periodic functions
-                  // or lastActivate!
-  // Dendritic queues are only necessary with dendritic filter
-  std::vector<float*> dendriteQueue;
-  std::vector<float*> dendriteQueue_inhdiv;
-  std::vector<float*> dendriteQueue_inhsub;
-  DataList somaExc;             // Only necessary for old I&F model
-  // I.e., when (fabs(yDecay) > verySmallFloat)
-  float* VarKConductanceArray;  // Only necessary for old I&F model
-#if defined(MULTIPROC)
-  Noise LocalSynNoise;
-#endif
-  Noise ExternalNoise;
-  Noise PickNoise;
-  Noise ResetNoise;
-  Noise SynNoise;
-  Noise TieBreakNoise;
-  // Not include ConnectNoise, ShuffleNoise, WeightNoise
-  // These Noises should affect initial setup only
+  // Moves past num bytes of the section, failing if it has fewer
+  inline bool take(const std::size_t num) {
+    if (Failed || (num > SectionEnd - Pos)) {
+      Failed = true;
+      return false;
+    }
+    Pos += num;
+    return true;
+  }
+  // A count of values each elemSize bytes long, checked against what is left
+  std::size_t getCount(const std::size_t elemSize);
+  void endSection();
+
+  std::string Data;
+  std::string::size_type SectionAt;             // length of the section being written
+  std::map<std::string, std::pair<std::size_t, std::size_t> > Sections;  // start, end
+  std::size_t Pos;
+  std::size_t SectionEnd;
+  bool Failed;
 };
 
-#endif
+#endif  // SIMSTATE_HPP
@@ -0,0 +1,175 @@
+/***************************************************************************
+ * SpikeLog.cpp
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#if !defined(SPIKELOG_HPP)
+#  include "SpikeLog.hpp"
+#endif
+
+#include <algorithm>
+#include <fstream>
+
+#if !defined(ASYNCWRITER_HPP)
+#  include "AsyncWriter.hpp"
+#endif
+#if !defined(BINARYRECORD_HPP)
+#  include "BinaryRecord.hpp"
+#endif
+
+using std::string;
+using std::vector;
+using BinaryRecord::BufferBytes;
+using BinaryRecord::bitsFloat;
+using BinaryRecord::floatBits;
+using BinaryRecord::getWord;
+using BinaryRecord::putWord;
+
+namespace {
+  const char LogTag[8] = { 'N', 'J', 'S', 'P', 'K', '0', '0', '1' };
+}
+
+void SpikeLog::open(const string &fileName, const Header &header) {
+  close();
+  FileName = fileName;
+  Info = header;
+  IsLogged.clear();
+  if (!Info.Cells.empty()) {
+    IsLogged.assign(Info.NumNeurons, false);
+    for (UIVectorCIt it = Info.Cells.begin(); it != Info.Cells.end(); ++it) {
+      IsLogged[*it] = true;
+    }
+  }
+  LastStep = Info.FirstStep;
+  IsOpen = true;
+
+  Buffer.append(LogTag, sizeof(LogTag));
+  putWord(Buffer, Info.NumNeurons);
+  putWord(Buffer, Info.HasSynapses ? 1 : 0);
+  putWord(Buffer, static_cast<uint32_t>(Info.Origin));
+  putWord(Buffer, static_cast<uint32_t>(Info.FirstStep));
+  putWord(Buffer, floatBits(Info.Dt));
+  putWord(Buffer, Info.Cells.size());
+  for (UIVectorCIt it = Info.Cells.begin(); it != Info.Cells.end(); ++it) {
+    putWord(Buffer, *it);
+  }
+}
+
+void SpikeLog::beginStep(const int step) {
+  addRecord(REC_STEP, 0, static_cast<uint32_t>(static_cast<int32_t>(step - LastStep)));
+  LastStep = step;
+}
+
+void SpikeLog::synapse(const unsigned int srcNeuron, const float weight) {
+  addRecord(REC_SYNAPSE, srcNeuron, floatBits(weight));
+}
+
+void SpikeLog::close() {
+  if (!IsOpen) return;
+  addRecord(REC_STEP, 1, 0);
+  AsyncWriter::write(FileName, Buffer);
+  IsOpen = false;
+}
+
+void SpikeLog::addRecord(const RecordType type, const unsigned int index,
+                         const uint32_t value) {
+  putWord(Buffer, (static_cast<uint32_t>(type) << 30) | (index & MaxIndex));
+  putWord(Buffer, value);
+  if (Buffer.size() >= BufferBytes) AsyncWriter::write(FileName, Buffer);
+}
+
+bool SpikeLog::read(const string &fileName, vector<Run> &runs) {
+  runs.clear();
+  std::ifstream inFile(fileName.c_str(), std::ios::in | std::ios::binary);
+  if (!inFile) return false;
+  char tag[sizeof(LogTag)];
+  while (inFile.read(tag, sizeof(tag))) {
+    if (!std::equal(tag, tag + sizeof(tag), LogTag)) return false;
+    runs.push_back(Run());
+    Run &run = runs.back();
+    Header &info = run.Info;
+    uint32_t flags, origin, firstStep, dt, numCells;
+    if (!getWord(inFile, info.NumNeurons) || !getWord(inFile, flags)
+        || !getWord(inFile, origin) || !getWord(inFile, firstStep)
+        || !getWord(inFile, dt) || !getWord(inFile, numCells)) {
+      return false;
+    }
+    info.HasSynapses = ((flags & 1) != 0);
+    info.Origin = static_cast<int>(origin);
+    info.FirstStep = static_cast<int>(firstStep);
+    info.Dt = bitsFloat(dt);
+    info.Cells.resize(numCells);
+    for (uint32_t c = 0; c < numCells; ++c) {
+      if (!getWord(inFile, info.Cells[c])) return false;
+    }
+
+    int curStep = info.FirstStep;
+    uint32_t head, value;
+    for (;;) {
+      if (!getWord(inFile, head) || !getWord(inFile, value)) return false;
+      const unsigned int index = head & MaxIndex;
+      switch (head >> 30) {
+      case REC_STEP:
+        if (index == 1) break;
+        curStep += static_cast<int32_t>(value);
+        run.Steps.push_back(Step());
+        run.Steps.back().Time = curStep;
+        continue;
+      case REC_SPIKE:
+        if (run.Steps.empty()) return false;
+        run.Steps.back().Spikes.push_back(index);
+        continue;
+      case REC_CELL:
+        if (run.Steps.empty()) return false;
+        run.Steps.back().Cells.push_back(CellStep());
+        run.Steps.back().Cells.back().Cell = index;
+        run.Steps.back().Cells.back().Active.reserve(value);
+        continue;
+      default:
+        if (run.Steps.empty() || run.Steps.back().Cells.empty()) return false;
+        Synapse syn;
+        syn.Src = index;
+        syn.Weight = bitsFloat(value);
+        run.Steps.back().Cells.back().Active.push_back(syn);
+        continue;
+      }
+      break;
+    }
+  }
+  return inFile.eof();
+}
+
+void SpikeLog::writeCellText(const vector<Run> &runs, const unsigned int cell,
+                             std::ostream &out) {
+  for (vector<Run>::const_iterator run = runs.begin(); run != runs.end(); ++run) {
+    const Header &info = run->Info;
+    for (vector<Step>::const_iterator step = run->Steps.begin();
+         step != run->Steps.end(); ++step) {
+      for (vector<CellStep>::const_iterator it = step->Cells.begin();
+           it != step->Cells.end(); ++it) {
+        if (it->Cell != cell) continue;
+        // Output in the format of <time> (<weight> <synapse>)* -1 \n
+        out << (step->Time - info.Origin) * info.Dt << " ";
+        for (vector<Synapse>::const_iterator syn = it->Active.begin();
+             syn != it->Active.end(); ++syn) {
+          out << syn->Weight << " " << syn->Src << " ";
+        }
+        out << "-1" << std::endl;
+      }
+    }
+  }
+}
@@ -0,0 +1,140 @@
+/***************************************************************************
+ * SpikeLog.hpp
+ *
+ *  A binary log of spikes and synaptic activations
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+///////////////////////////////////////////////////////////////////////////////
+//
+// -cellrec writes a line of text per recorded cell per time step, which
+// only scales to a few cells. A SpikeLog records the same information, for
+// any set of neurons or all of them, as fixed-width binary records:
+//
+//   STEP     the time step moved on by Value steps (Index of 1 ends a run)
+//   SPIKE    neuron Index fired
+//   CELL     Value SYNAPSE records follow for logged neuron Index
+//   SYNAPSE  the synapse from neuron Index, of weight Value, was active
+//
+// Each record is two unsigned 32 bit words, the first holding the type in
+// its top two bits and Index in the rest, the second holding Value (a
+// float's bits for SYNAPSE). Every step logged has a STEP, even one in
+// which none of the logged neurons fired, so that readers see the quiet
+// steps and trials too. STEP holds the number of steps since the previous
+// STEP, as a signed number since @Train starts each trial back at step 1.
+//
+// Every @Train or @Test with -spikelog adds a run to the end of the file:
+// the 8 byte tag "NJSPK001", the unsigned 32 bit NumNeurons, Flags (1 if
+// synapses are logged), the signed 32 bit Origin and FirstStep, the float
+// Dt, NumCells and NumCells neurons (none meaning all of them), then the
+// records, then the STEP that ends the run. All are in the byte order of
+// the machine that wrote them.
+//
+// read gives back every run in a file, and writeCellText the lines that
+// -cellrec would have written for one of the logged cells, their time
+// being (step - Origin) * Dt.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#if !defined(SPIKELOG_HPP)
+#  define SPIKELOG_HPP
+
+#  include <ostream>
+#  include <string>
+#  include <vector>
+#  include <stdint.h>
+
+#  if !defined(DATATYPES_HPP)
+#    include "DataTypes.hpp"
+#  endif
+
+class SpikeLog {
+ public:
+  enum RecordType { REC_STEP = 0, REC_SPIKE = 1, REC_CELL = 2, REC_SYNAPSE = 3 };
+  static const unsigned int MaxIndex = 0x3FFFFFFF;
+
+  struct Header {
+    Header(): NumNeurons(0), HasSynapses(false), Origin(0), FirstStep(0),
+              Dt(0.0f) {}
+    unsigned int NumNeurons;
+    bool HasSynapses;
+    int Origin;             // the step -cellrec times are measured from
+    int FirstStep;          // the step before the first one logged
+    float Dt;
+    UIVector Cells;         // empty for all neurons
+  };
+
+  struct Synapse {
+    unsigned int Src;
+    float Weight;
+  };
+  struct CellStep {
+    unsigned int Cell;
+    std::vector<Synapse> Active;
+  };
+  struct Step {
+    int Time;
+    UIVector Spikes;
+    std::vector<CellStep> Cells;
+  };
+  struct Run {
+    Header Info;
+    std::vector<Step> Steps;
+  };
+
+  SpikeLog(): IsOpen(false), LastStep(0) {}
+  ~SpikeLog() { close(); }
+
+  // Starts a run at the end of fileName
+  void open(const std::string &fileName, const Header &header);
+  inline bool isOpen() const { return IsOpen; }
+  inline const Header &header() const { return Info; }
+  // Whether neuron is one of those logged
+  inline bool logs(const unsigned int neuron) const {
+    return IsLogged.empty() || IsLogged[neuron];
+  }
+
+  // Called once a time step, before any of the others below
+  void beginStep(const int step);
+  inline void spike(const unsigned int neuron) { addRecord(REC_SPIKE, neuron, 0); }
+  inline void cell(const unsigned int neuron, const unsigned int numActive) {
+    addRecord(REC_CELL, neuron, numActive);
+  }
+  void synapse(const unsigned int srcNeuron, const float weight);
+  // Ends the run and hands what is left to the writer
+  void close();
+
+  static bool read(const std::string &fileName, std::vector<Run> &runs);
+  static void writeCellText(const std::vector<Run> &runs, const unsigned int cell,
+                            std::ostream &out);
+
+ private:
+  // Not copyable
+  SpikeLog(const SpikeLog &);
+  SpikeLog &operator=(const SpikeLog &);
+
+  void addRecord(const RecordType type, const unsigned int index, const uint32_t value);
+
+  bool IsOpen;
+  std::string FileName;
+  Header Info;
+  std::vector<bool> IsLogged;
+  std::string Buffer;         // records not yet handed to the writer
+  int LastStep;
+};
+
+#endif  // SPIKELOG_HPP
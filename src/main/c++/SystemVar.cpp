@@ -24,6 +24,12 @@
 #if !defined(OUTPUT_HPP)
 #  include "Output.hpp"
 #endif
+#if !defined(SIMSTATE_HPP)
+#  include "SimState.hpp"
+#endif
+
+#include <cstring>
+#include <iterator>
 
 #if !defined(IOS)
 #  if defined(WIN32)
@@ -41,9 +47,9 @@ SysMapIntData SystemVar::IntVar;
 SysMapFloatData SystemVar::FloatVar;
 SysMapStrData SystemVar::StrVar;
 SysMapStrData SystemVar::SavedFileList;
-BindList<UIPtnSequence> SystemVar::SequenceList;   // list of sequences
-BindList<DataMatrix> SystemVar::MatrixList;   // list of matrixes
-BindList<DataMatrix> SystemVar::AnalysisList; // list of data anlayses
+BindList<PackedSequence> SystemVar::SequenceList;   // list of sequences
+BindList<DenseMatrix> SystemVar::MatrixList;   // list of matrixes
+BindList<DenseMatrix> SystemVar::AnalysisList; // list of data anlayses
 BindList<StrList> SystemVar::AnalysisNames;   // names of analyses
 
 /* Function lists */
@@ -139,8 +145,8 @@ void SystemVar::exportVars(const string &fileName) {
   outFile.close();
 }
 
-DataMatrix SystemVar::getAnalysis(const string &SeqName, const string &FunctionName,
-                                  const CommandLine &ComL) {
+const DenseMatrix& SystemVar::getAnalysis(const string &SeqName, const string &FunctionName,
+                                          const CommandLine &ComL) {
   if (!AnalysisList.exists(SeqName)) {
     CALL_ERROR << "Error in " << FunctionName << ": Could not find Analysis "
                << SeqName << ERR_WHERE;
@@ -150,8 +156,8 @@ DataMatrix SystemVar::getAnalysis(const string &SeqName, const string &FunctionN
   return AnalysisList.GetEntry(SeqName);
 }
 
-DataMatrix & SystemVar::getAnalysis(const string &SeqName, StrList &anaDesc, 
-                                    const string &FunctionName, const CommandLine &ComL) {
+DenseMatrix & SystemVar::getAnalysis(const string &SeqName, StrList &anaDesc, 
+                                     const string &FunctionName, const CommandLine &ComL) {
   if (!AnalysisList.exists(SeqName)) {
     CALL_ERROR << "Error in " << FunctionName << ": " << SeqName
                << " was not created with CreateAnalysis" << endl << ERR_WHERE;
@@ -168,30 +174,14 @@ DataMatrix & SystemVar::getAnalysis(const string &SeqName, StrList &anaDesc,
   return AnalysisList.GetEntry(SeqName);
 }
 
-void SystemVar::getAnalysis(const string &SeqName, DataMatrix &anaList,
-                            StrList &anaDesc, const string &FunctionName,
-                            const CommandLine &ComL) {
-  if (!AnalysisList.exists(SeqName)) {
-    CALL_ERROR << "Error in " << FunctionName << ": " << SeqName
-               << " was not created with CreateAnalysis" << endl << ERR_WHERE;
-    ComL.DisplayHelp(Output::Err());
-    exit(EXIT_FAILURE);
-  }
-  if (!AnalysisNames.exists(SeqName)) {
-    CALL_ERROR << "Error in " << FunctionName << ": Could not find Analysis Description "
-               << SeqName << ERR_WHERE;
-    ComL.DisplayHelp(Output::Err());
-    exit(EXIT_FAILURE);
-  }   
-  anaList = AnalysisList.GetEntry(SeqName);
-  anaDesc = AnalysisNames.GetEntry(SeqName);
-}
-
-DataMatrix SystemVar::getData(const string &SeqName, const string &FunctionName,
-                              const CommandLine &ComL) {
+const DenseMatrix& SystemVar::getData(const string &SeqName, DenseMatrix &converted,
+                                      const string &FunctionName,
+                                      const CommandLine &ComL) {
   const char dataType = GetVarType(SeqName);
-  if (dataType == 'S')
-    return UISeqToMatrix(SequenceList.GetEntry(SeqName));
+  if (dataType == 'S') {
+    UISeqToMatrix(SequenceList.GetEntry(SeqName), converted);
+    return converted;
+  }
   else if (dataType == 'M')
     return MatrixList.GetEntry(SeqName);
   else if (dataType == 'A')
@@ -202,8 +192,8 @@ DataMatrix SystemVar::getData(const string &SeqName, const string &FunctionName,
   exit(EXIT_FAILURE);   
 }
 
-DataMatrix SystemVar::getMatrix(const string &SeqName, const string &FunctionName,
-                                const CommandLine &ComL) {
+const DenseMatrix& SystemVar::getMatrix(const string &SeqName, const string &FunctionName,
+                                        const CommandLine &ComL) {
   if (!MatrixList.exists(SeqName)) {
     CALL_ERROR << "Error in " << FunctionName << ": Could not find Matrix "
                << SeqName << ERR_WHERE;
@@ -213,8 +203,8 @@ DataMatrix SystemVar::getMatrix(const string &SeqName, const string &FunctionNam
   return MatrixList.GetEntry(SeqName);
 }
 
-UIPtnSequence SystemVar::getSequence(const string &SeqName, const string &FunctionName,
-                                     const CommandLine &ComL) {
+const PackedSequence& SystemVar::getSequence(const string &SeqName, const string &FunctionName,
+                                             const CommandLine &ComL) {
   if (!SequenceList.exists(SeqName)) {
     CALL_ERROR << "Error in " << FunctionName << ": Could not find Sequence "
                << SeqName << ERR_WHERE;
@@ -286,10 +276,24 @@ void SystemVar::insertData(const string &insertName, const DataMatrix &toInsert,
     AnalysisList.insert(insertName, toInsert);
 }
 
+void SystemVar::insertData(const string &insertName, const DenseMatrix &toInsert,
+                           DataListType insertType) {
+  if (insertType == DLT_sequence)
+    SequenceList.insert(insertName, MatrixToPackedSeq(toInsert));
+  else if (insertType == DLT_matrix)
+    MatrixList.insert(insertName, toInsert);
+  else
+    AnalysisList.insert(insertName, toInsert);
+}
+
 void SystemVar::insertSequence(const string &seqName, const UIPtnSequence &toInsert) {
   SequenceList.insert(seqName, toInsert);
 }
 
+void SystemVar::insertSequence(const string &seqName, const PackedSequence &toInsert) {
+  SequenceList.insert(seqName, toInsert);
+}
+
 bool SystemVar::IsReadOnly(const string &varName) {
   if (IntVar.find(varName) != IntVar.end()) {
     return IntVar.find(varName)->second.IsReadOnly;
@@ -337,6 +341,172 @@ void SystemVar::OutputStrVars() {
   }
 }
 
+namespace {
+  inline void putVarData(SimState &state, const int val) { state.put(val); }
+  inline void putVarData(SimState &state, const float val) { state.put(val); }
+  inline void putVarData(SimState &state, const string &val) { state.putString(val); }
+  template<class T> void saveVarMap(SimState &state,
+                                    const std::map<string, SystemData<T> > &vars) {
+    state.put<uint64_t>(vars.size());
+    for (typename std::map<string, SystemData<T> >::const_iterator it = vars.begin();
+         it != vars.end(); ++it) {
+      state.putString(it->first);
+      putVarData(state, it->second.Data);
+      state.putBool(it->second.IsReadOnly);
+    }
+  }
+
+  inline void getVarData(SimState &state, int &val) { state.get(val); }
+  inline void getVarData(SimState &state, float &val) { state.get(val); }
+  inline void getVarData(SimState &state, string &val) { state.getString(val); }
+  // Floats are compared bit for bit, so a change of sign of zero counts
+  template<class T> inline bool sameData(const T &a, const T &b) { return a == b; }
+  inline bool sameData(const float a, const float b) {
+    return memcmp(&a, &b, sizeof(a)) == 0;
+  }
+
+  template<class T> void loadVarMap(SimState &state, std::map<string, SystemData<T> > &vars,
+                                    StrList &changed) {
+    uint64_t num = 0;
+    state.get(num);
+    for (uint64_t i = 0; (i < num) && !state.failed(); ++i) {
+      string name;
+      SystemData<T> val;
+      state.getString(name);
+      getVarData(state, val.Data);
+      val.IsReadOnly = state.getBool();
+      if (state.failed()) return;
+      typename std::map<string, SystemData<T> >::iterator it = vars.find(name);
+      if (!val.IsReadOnly && ((it == vars.end()) || !sameData(it->second.Data, val.Data))) {
+        changed.push_back(name);
+      }
+      vars[name] = val;
+    }
+  }
+
+  void saveMatrix(SimState &state, const DenseMatrix &mtx) {
+    state.put<uint64_t>(mtx.size());
+    for (DenseMatrix::size_type r = 0; r < mtx.size(); ++r) {
+      const DenseMatrix::ConstRow row = mtx[r];
+      state.put<uint64_t>(row.size());
+      state.putArray(row.begin(), row.size());
+    }
+  }
+  void loadMatrix(SimState &state, DenseMatrix &mtx) {
+    uint64_t numRows = 0;
+    state.get(numRows);
+    mtx.clear();
+    for (uint64_t r = 0; (r < numRows) && !state.failed(); ++r) {
+      uint64_t len = 0;
+      state.get(len);
+      if (len > state.size() / sizeof(float)) state.fail();
+      if (state.failed()) return;
+      state.getArray(mtx.addRow(static_cast<DenseMatrix::size_type>(len)).begin(),
+                     static_cast<std::size_t>(len));
+    }
+  }
+}
+
+void SystemVar::SaveVarState(SimState &state) {
+  saveVarMap(state, IntVar);
+  saveVarMap(state, FloatVar);
+  saveVarMap(state, StrVar);
+}
+
+void SystemVar::LoadVarState(SimState &state, StrList &changed) {
+  changed.clear();
+  loadVarMap(state, IntVar, changed);
+  loadVarMap(state, FloatVar, changed);
+  loadVarMap(state, StrVar, changed);
+}
+
+void SystemVar::SaveDataState(SimState &state) {
+  state.put<uint64_t>(std::distance(SequenceList.begin(), SequenceList.end()));
+  for (BindList<PackedSequence>::const_iterator it = SequenceList.begin();
+       it != SequenceList.end(); ++it) {
+    state.putString(it->first);
+    state.putBool(it->second.second);
+    const PackedSequence &seq = it->second.first;
+    state.put<uint64_t>(seq.size());
+    UIVector pat;
+    for (PackedSequence::size_type t = 0; t < seq.size(); ++t) {
+      seq.decode(t, pat);
+      state.putVector(pat);
+    }
+  }
+  state.put<uint64_t>(std::distance(MatrixList.begin(), MatrixList.end()));
+  for (BindList<DenseMatrix>::const_iterator it = MatrixList.begin();
+       it != MatrixList.end(); ++it) {
+    state.putString(it->first);
+    state.putBool(it->second.second);
+    saveMatrix(state, it->second.first);
+  }
+  state.put<uint64_t>(std::distance(AnalysisList.begin(), AnalysisList.end()));
+  for (BindList<DenseMatrix>::const_iterator it = AnalysisList.begin();
+       it != AnalysisList.end(); ++it) {
+    state.putString(it->first);
+    state.putBool(it->second.second);
+    saveMatrix(state, it->second.first);
+    const StrList noNames;
+    const StrList &names = AnalysisNames.exists(it->first)
+      ? AnalysisNames.GetEntry(it->first) : noNames;
+    state.put<uint64_t>(names.size());
+    for (StrListCIt nameIt = names.begin(); nameIt != names.end(); ++nameIt) {
+      state.putString(*nameIt);
+    }
+  }
+}
+
+void SystemVar::LoadDataState(SimState &state) {
+  uint64_t num = 0;
+  state.get(num);
+  for (uint64_t i = 0; (i < num) && !state.failed(); ++i) {
+    string name;
+    state.getString(name);
+    const bool readOnly = state.getBool();
+    uint64_t numPatterns = 0;
+    state.get(numPatterns);
+    PackedSequence seq;
+    UIVector pat;
+    for (uint64_t t = 0; (t < numPatterns) && !state.failed(); ++t) {
+      state.getVector(pat);
+      seq.push_back(pat);
+    }
+    if (state.failed()) return;
+    SequenceList.insert(name, seq, readOnly);
+  }
+  num = 0;
+  state.get(num);
+  for (uint64_t i = 0; (i < num) && !state.failed(); ++i) {
+    string name;
+    state.getString(name);
+    const bool readOnly = state.getBool();
+    DenseMatrix mtx;
+    loadMatrix(state, mtx);
+    if (state.failed()) return;
+    MatrixList.insert(name, mtx, readOnly);
+  }
+  num = 0;
+  state.get(num);
+  for (uint64_t i = 0; (i < num) && !state.failed(); ++i) {
+    string name;
+    state.getString(name);
+    const bool readOnly = state.getBool();
+    DenseMatrix mtx;
+    loadMatrix(state, mtx);
+    uint64_t numNames = 0;
+    state.get(numNames);
+    StrList names;
+    for (uint64_t n = 0; (n < numNames) && !state.failed(); ++n) {
+      names.push_back(string());
+      state.getString(names.back());
+    }
+    if (state.failed()) return;
+    AnalysisList.insert(name, mtx, readOnly);
+    AnalysisNames.insert(name, names);
+  }
+}
+
 void SystemVar::SetIntVar(const string& varName, int varValue) {
   IntVar[varName].Data = varValue;
 }
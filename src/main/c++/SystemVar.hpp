@@ -32,6 +32,12 @@
 #  if !defined(DATATYPES_HPP)
 #    include "DataTypes.hpp"
 #  endif
+#  if !defined(DENSEMATRIX_HPP)
+#    include "DenseMatrix.hpp"
+#  endif
+#  if !defined(PACKEDSEQUENCE_HPP)
+#    include "PackedSequence.hpp"
+#  endif
 #  if !defined(SIMSTATE_HPP)
 #    include "SimState.hpp"
 #  endif
@@ -89,20 +95,25 @@ class SystemVar {
 
   static void exportVars(const std::string& fileName);
 
-  static DataMatrix getAnalysis(const std::string& SeqName,
-                                const std::string& FunctionName,
-                                const CommandLine &ComL);
-  inline static DataMatrix getAnalysis(const TArg<string>& SeqName,
-                                       const std::string& FunctionName,
-                                       const CommandLine &ComL) {
+  // getAnalysis, getData, getMatrix and getSequence return the stored data
+  // itself rather than a copy. The reference stays valid until the data is
+  // deleted, and sees the new data if it is replaced, so callers that
+  // change the data (or replace it while still reading it) take a copy.
+  // Matrices and analyses are stored as DenseMatrix, whose rows read like
+  // DataLists; toDataMatrix() gives the vector-of-rows form where needed.
+  // Sequences are stored as PackedSequence, whose patterns are decoded
+  // into UIVectors as they are read.
+  static const DenseMatrix& getAnalysis(const std::string& SeqName,
+                                        const std::string& FunctionName,
+                                        const CommandLine &ComL);
+  inline static const DenseMatrix& getAnalysis(const TArg<string>& SeqName,
+                                              const std::string& FunctionName,
+                                              const CommandLine &ComL) {
     return getAnalysis(SeqName.getValue(), FunctionName, ComL);
   }
-  static DataMatrix & getAnalysis(const std::string& SeqName, StrList &anaDesc,
-                                  const std::string& FunctionName,
-                                  const CommandLine &ComL);
-  static void getAnalysis(const std::string& SeqName, DataMatrix &anaList,
-                          StrList &anaDesc, const std::string& FunctionName,
-                          const CommandLine& ComL);
+  static DenseMatrix & getAnalysis(const std::string& SeqName, StrList &anaDesc,
+                                   const std::string& FunctionName,
+                                   const CommandLine &ComL);
 
   inline static AT_FUN GetAtFun(const std::string& s) {
     return AtFunList.find(s)->second.Data;
@@ -112,13 +123,16 @@ class SystemVar {
     return CaretFunList.find(s)->second.Data;
   };
 
-  static DataMatrix getData(const std::string& SeqName,
-                            const std::string& FunctionName,
-                            const CommandLine& ComL);
-  inline static DataMatrix getData(const TArg<std::string>& SeqName,
-                                   const std::string& FunctionName,
-                                   const CommandLine& ComL) {
-    return getData(SeqName.getValue(), FunctionName, ComL);
+  // A sequence has to be converted to a matrix, which is done in converted
+  static const DenseMatrix& getData(const std::string& SeqName,
+                                    DenseMatrix &converted,
+                                    const std::string& FunctionName,
+                                    const CommandLine& ComL);
+  inline static const DenseMatrix& getData(const TArg<std::string>& SeqName,
+                                           DenseMatrix &converted,
+                                          const std::string& FunctionName,
+                                          const CommandLine& ComL) {
+    return getData(SeqName.getValue(), converted, FunctionName, ComL);
   }
 
   inline static int GetIntVar(const std::string& s) {
@@ -133,17 +147,17 @@ class SystemVar {
     return FloatVar.find(s)->second.Data;
   };
 
-  static DataMatrix getMatrix(const std::string& SeqName,
-                              const std::string& FunctionName,
-                              const CommandLine& ComL);
-  inline static DataMatrix getMatrix(const TArg<std::string>& SeqName,
-                                     const std::string& FunctionName,
-                                     const CommandLine& ComL) {
+  static const DenseMatrix& getMatrix(const std::string& SeqName,
+                                      const std::string& FunctionName,
+                                      const CommandLine& ComL);
+  inline static const DenseMatrix& getMatrix(const TArg<std::string>& SeqName,
+                                             const std::string& FunctionName,
+                                             const CommandLine& ComL) {
     return getMatrix(SeqName.getValue(), FunctionName, ComL);
   }
-  inline static DataMatrix getMatrixOrAnalysis(const std::string& varName,
-                                               const std::string& FunctionName,
-                                               const CommandLine& ComL) {
+  inline static const DenseMatrix& getMatrixOrAnalysis(const std::string& varName,
+                                                       const std::string& FunctionName,
+                                                       const CommandLine& ComL) {
     const char varType = GetVarType(varName);
     if (varType == 'M') {
       return getMatrix(varName, FunctionName, ComL);
@@ -151,12 +165,12 @@ class SystemVar {
     return getAnalysis(varName, FunctionName, ComL);
   }
 
-  static UIPtnSequence getSequence(const std::string& SeqName,
-                                   const std::string& FunctionName,
-                                   const CommandLine& ComL);
-  inline static UIPtnSequence getSequence(const TArg<std::string>& SeqName,
-                                          const std::string& FunctionName,
-                                          const CommandLine& ComL) {
+  static const PackedSequence& getSequence(const std::string& SeqName,
+                                           const std::string& FunctionName,
+                                           const CommandLine& ComL);
+  inline static const PackedSequence& getSequence(const TArg<std::string>& SeqName,
+                                                  const std::string& FunctionName,
+                                                  const CommandLine& ComL) {
     return getSequence(SeqName.getValue(), FunctionName, ComL);
   }
 
@@ -186,6 +200,14 @@ class SystemVar {
                                 DataListType insertType) {
     insertData(insertName.getValue(), toInsert, insertType);
   }
+  static void insertData(const std::string& insertName,
+                         const DenseMatrix& toInsert,
+                         DataListType insertType);
+  inline static void insertData(const TArg<std::string>& insertName,
+                                const DenseMatrix& toInsert,
+                                DataListType insertType) {
+    insertData(insertName.getValue(), toInsert, insertType);
+  }
 
   static void insertSequence(const std::string& seqName,
                              const UIPtnSequence& toInsert);
@@ -193,6 +215,12 @@ class SystemVar {
                                     const UIPtnSequence& toInsert) {
     insertSequence(seqName.getValue(), toInsert);
   }
+  static void insertSequence(const std::string& seqName,
+                             const PackedSequence& toInsert);
+  inline static void insertSequence(const TArg<std::string>& seqName,
+                                    const PackedSequence& toInsert) {
+    insertSequence(seqName.getValue(), toInsert);
+  }
 
   static bool IsReadOnly(const std::string& s);
 
@@ -202,6 +230,15 @@ class SystemVar {
   static void OutputIntVars();
   static void OutputStrVars();
 
+  // For @SaveState and @LoadState. LoadVarState sets every saved variable
+  // as it was and lists the writable ones whose values it changed, so the
+  // caller can carry out what setting them would have done.
+  static void SaveVarState(SimState &state);
+  static void LoadVarState(SimState &state, StrList &changed);
+  // The sequences, matrices and analyses; others are left as they are
+  static void SaveDataState(SimState &state);
+  static void LoadDataState(SimState &state);
+
   static void SetIntVar(const std::string& varName, int val);
   inline static void SetIterator(const std::string& VarName,
                                  const Iterator& iter) {
@@ -215,11 +252,10 @@ class SystemVar {
   static SysMapFloatData FloatVar;
   static SysMapStrData StrVar;
   static SysMapStrData SavedFileList;
-  static BindList<UIPtnSequence> SequenceList;  // list of sequences
-  static BindList<DataMatrix> MatrixList;    // list of matrixes
-  static BindList<DataMatrix> AnalysisList;  // list of data anlayses
+  static BindList<PackedSequence> SequenceList;  // list of sequences
+  static BindList<DenseMatrix> MatrixList;    // list of matrixes
+  static BindList<DenseMatrix> AnalysisList;  // list of data anlayses
   static BindList<StrList> AnalysisNames;    // names of analyses
-  static BindList<SimState> SimStates;       // list of saved simulation states
 
   /* Function lists */
   static SysMapAtData AtFunList;
@@ -0,0 +1,342 @@
+/***************************************************************************
+ * TextLoader.cpp
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#if !defined(TEXTLOADER_HPP)
+#  include "TextLoader.hpp"
+#endif
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#if !defined(WIN32)
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+#if !defined(THREADTEAM_HPP)
+#  include "ThreadTeam.hpp"
+#endif
+
+using std::size_t;
+using std::string;
+using std::vector;
+
+// Single float operations round correctly only if floats are not held
+// at a higher precision
+#if (defined(FLT_EVAL_METHOD) && (FLT_EVAL_METHOD == 0)) \
+  || (defined(__FLT_EVAL_METHOD__) && (__FLT_EVAL_METHOD__ == 0))
+#  define FAST_FLOAT_PATH
+#endif
+
+namespace {
+  // isspace in the "C" locale
+  inline bool isSpace(const char c) {
+    return (c == ' ') || ((c >= '\t') && (c <= '\r'));
+  }
+  inline bool isDigit(const char c) {
+    return (c >= '0') && (c <= '9');
+  }
+
+  // Lines of a piece of the file, as std::getline would give them
+  class LineReader {
+   public:
+    LineReader(const char *begin, const char *end): Pos(begin), End(end) {}
+    bool next(const char *&lineBegin, const char *&lineEnd) {
+      if (Pos == End) return false;
+      lineBegin = Pos;
+      const void *eol = memchr(Pos, '\n', End - Pos);
+      lineEnd = eol ? static_cast<const char *>(eol) : End;
+      Pos = eol ? (lineEnd + 1) : End;
+      return true;
+    }
+
+   private:
+    const char *Pos;
+    const char *End;
+  };
+
+  struct Piece {
+    Piece(): NumLongLines(0), HasBadChar(false), BadChar('\0') {}
+    unsigned int NumLongLines;
+    bool HasBadChar;
+    char BadChar;
+  };
+
+  struct LoadJob {
+    const char *Data;
+    vector<size_t> Starts;        // one more than the number of pieces
+    unsigned int LongLine;
+    vector<Piece> Pieces;
+    vector<PackedSequence> Seqs;
+    vector<DenseMatrix> Rows;
+  };
+
+  void loadSequencePiece(const unsigned int worker, void *arg) {
+    LoadJob &job = *static_cast<LoadJob *>(arg);
+    Piece &piece = job.Pieces[worker];
+    PackedSequence &seq = job.Seqs[worker];
+    LineReader lines(job.Data + job.Starts[worker], job.Data + job.Starts[worker + 1]);
+    const char *lineBegin;
+    const char *lineEnd;
+    UIVector pat;
+    while (lines.next(lineBegin, lineEnd)) {
+      if (static_cast<size_t>(lineEnd - lineBegin) >= job.LongLine) ++piece.NumLongLines;
+      pat.clear();
+      unsigned int numValues = 0;
+      for (const char *p = lineBegin; (p != lineEnd) && (*p != '\0'); ++p) {
+        if (isSpace(*p)) continue;
+        if (*p == '1') {
+          pat.push_back(numValues);
+        } else if (*p != '0') {
+          piece.HasBadChar = true;
+          piece.BadChar = *p;
+          return;
+        }
+        ++numValues;
+      }
+      if (numValues > 0) seq.push_back(pat);
+    }
+  }
+
+  void loadMatrixPiece(const unsigned int worker, void *arg) {
+    LoadJob &job = *static_cast<LoadJob *>(arg);
+    Piece &piece = job.Pieces[worker];
+    DenseMatrix &rows = job.Rows[worker];
+    LineReader lines(job.Data + job.Starts[worker], job.Data + job.Starts[worker + 1]);
+    const char *lineBegin;
+    const char *lineEnd;
+    DataList values;
+    while (lines.next(lineBegin, lineEnd)) {
+      if (static_cast<size_t>(lineEnd - lineBegin) >= job.LongLine) ++piece.NumLongLines;
+      values.clear();
+      const char *p = lineBegin;
+      while ((p != lineEnd) && (*p != '\0')) {
+        if (isSpace(*p)) {
+          ++p;
+          continue;
+        }
+        const char *tokenEnd = p;
+        while ((tokenEnd != lineEnd) && !isSpace(*tokenEnd)) ++tokenEnd;
+        values.push_back(TextLoader::parseFloat(p, tokenEnd));
+        p = tokenEnd;
+      }
+      if (!values.empty()) rows.push_back(values);
+    }
+  }
+}
+
+TextLoader::TextLoader(const string &fileName)
+  : IsOpen(false), Data(0), Size(0), Mapped(0), NumLongLines(0), HasBadChar(false),
+    BadChar('\0') {
+#if !defined(WIN32)
+  const int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd < 0) return;
+  struct stat info;
+  if ((fstat(fd, &info) == 0) && S_ISREG(info.st_mode)) {
+    if (info.st_size == 0) {
+      IsOpen = true;
+    } else {
+      void *addr = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr != MAP_FAILED) {
+#  if defined(MADV_SEQUENTIAL)
+        madvise(addr, info.st_size, MADV_SEQUENTIAL);
+#  endif
+        Mapped = addr;
+        Data = static_cast<const char *>(addr);
+        Size = info.st_size;
+        IsOpen = true;
+      }
+    }
+  }
+  ::close(fd);
+  if (IsOpen) return;
+#endif
+  // Not a file that can be mapped, so read it all in
+  std::ifstream inFile(fileName.c_str(), std::ios::in | std::ios::binary);
+  if (!inFile) return;
+  std::ostringstream contents;
+  contents << inFile.rdbuf();
+  const string text = contents.str();
+  Copy.assign(text.begin(), text.end());
+  Data = Copy.empty() ? 0 : &Copy[0];
+  Size = Copy.size();
+  IsOpen = true;
+}
+
+TextLoader::~TextLoader() {
+#if !defined(WIN32)
+  if (Mapped) munmap(Mapped, Size);
+#endif
+}
+
+unsigned int TextLoader::pieceCount(const unsigned int numThreads) const {
+  return std::max<size_t>(1, std::min<size_t>(numThreads, Size / MinBytesPerThread));
+}
+
+vector<size_t> TextLoader::splitLines(const unsigned int numPieces) const {
+  vector<size_t> starts(numPieces + 1, Size);
+  starts[0] = 0;
+  for (unsigned int piece = 1; piece < numPieces; ++piece) {
+    size_t pos = std::max(starts[piece - 1], Size / numPieces * piece);
+    while ((pos > 0) && (pos < Size) && (Data[pos - 1] != '\n')) ++pos;
+    starts[piece] = pos;
+  }
+  return starts;
+}
+
+void TextLoader::readSequence(const unsigned int longLine, const unsigned int numThreads,
+                              PackedSequence &seq) {
+  ThreadTeam team;
+  team.resize(pieceCount(numThreads));
+  LoadJob job;
+  job.Data = Data;
+  job.Starts = splitLines(team.size());
+  job.LongLine = longLine;
+  const unsigned int numPieces = team.size();
+  job.Pieces.resize(numPieces);
+  job.Seqs.resize(numPieces);
+  team.run(loadSequencePiece, &job);
+
+  seq.clear();
+  NumLongLines = 0;
+  HasBadChar = false;
+  for (unsigned int p = 0; p < numPieces; ++p) {
+    NumLongLines += job.Pieces[p].NumLongLines;
+    if (job.Pieces[p].HasBadChar) {
+      HasBadChar = true;
+      BadChar = job.Pieces[p].BadChar;
+      return;
+    }
+    seq.append(job.Seqs[p]);
+  }
+}
+
+void TextLoader::readMatrix(const unsigned int longLine, const unsigned int numThreads,
+                            DenseMatrix &rows) {
+  ThreadTeam team;
+  team.resize(pieceCount(numThreads));
+  LoadJob job;
+  job.Data = Data;
+  job.Starts = splitLines(team.size());
+  job.LongLine = longLine;
+  const unsigned int numPieces = team.size();
+  job.Pieces.resize(numPieces);
+  job.Rows.resize(numPieces);
+  team.run(loadMatrixPiece, &job);
+
+  rows.clear();
+  NumLongLines = 0;
+  HasBadChar = false;
+  unsigned int numRows = 0;
+  unsigned int rowLen = 0;
+  for (unsigned int p = 0; p < numPieces; ++p) {
+    NumLongLines += job.Pieces[p].NumLongLines;
+    numRows += job.Rows[p].size();
+    rowLen = std::max(rowLen, job.Rows[p].maxRowSize());
+  }
+  if (numPieces == 1) {
+    rows.swap(job.Rows[0]);
+    return;
+  }
+  rows.reserve(numRows, rowLen);
+  for (unsigned int p = 0; p < numPieces; ++p) {
+    const DenseMatrix &piece = job.Rows[p];
+    for (unsigned int r = 0; r < piece.size(); ++r) rows.push_back(piece[r]);
+    DenseMatrix().swap(job.Rows[p]);
+  }
+}
+
+float TextLoader::parseFloat(const char *begin, const char *end) {
+  // The characters an istream takes as part of a float: a sign, digits
+  // with at most one point, then (after a digit) an exponent
+  const char *p = begin;
+  bool negative = false;
+  if ((p != end) && ((*p == '+') || (*p == '-'))) negative = (*p++ == '-');
+  unsigned long mantissa = 0;
+  int numDigits = 0;            // in mantissa, not counting leading zeros
+  int numFracDigits = 0;
+  bool foundDigit = false;
+  for (; (p != end) && isDigit(*p); ++p) {
+    foundDigit = true;
+    if ((numDigits > 0) || (*p != '0')) {
+      if (++numDigits <= 9) mantissa = mantissa * 10 + (*p - '0');
+    }
+  }
+  if ((p != end) && (*p == '.')) {
+    for (++p; (p != end) && isDigit(*p); ++p) {
+      foundDigit = true;
+      ++numFracDigits;
+      if ((numDigits > 0) || (*p != '0')) {
+        if (++numDigits <= 9) mantissa = mantissa * 10 + (*p - '0');
+      }
+    }
+  }
+  bool badExponent = false;
+  int exponent = 0;
+  if (foundDigit && (p != end) && ((*p == 'e') || (*p == 'E'))) {
+    ++p;
+    bool negExponent = false;
+    if ((p != end) && ((*p == '+') || (*p == '-'))) negExponent = (*p++ == '-');
+    badExponent = ((p == end) || !isDigit(*p));
+    for (; (p != end) && isDigit(*p); ++p) {
+      if (exponent < 100000) exponent = exponent * 10 + (*p - '0');
+    }
+    if (negExponent) exponent = -exponent;
+  }
+  // A sign or point alone, or an exponent without digits, reads as 0
+  if (!foundDigit || badExponent) return 0.0f;
+
+#if defined(FAST_FLOAT_PATH)
+  // Both the mantissa and the power of ten are exact floats, so one
+  // multiplication or division rounds as strtof would
+  static const float PowersOfTen[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+  };
+  const int scale = exponent - numFracDigits;
+  if ((numDigits <= 7) && (scale >= -10) && (scale <= 10)) {
+    const float value = (scale < 0) ?
+      static_cast<float>(mantissa) / PowersOfTen[-scale] :
+      static_cast<float>(mantissa) * PowersOfTen[scale];
+    return negative ? -value : value;
+  }
+#endif
+
+  const size_t len = p - begin;
+  char buffer[64];
+  string longToken;
+  const char *text = buffer;
+  if (len < sizeof(buffer)) {
+    memcpy(buffer, begin, len);
+    buffer[len] = '\0';
+  } else {
+    longToken.assign(begin, p);
+    text = longToken.c_str();
+  }
+  char *parsed;
+  const float value = strtof(text, &parsed);
+  if (parsed != text + len) return 0.0f;
+  if (value > FLT_MAX) return FLT_MAX;
+  if (value < -FLT_MAX) return -FLT_MAX;
+  return value;
+}
@@ -0,0 +1,97 @@
+/***************************************************************************
+ * TextLoader.hpp
+ *
+ *  Reads whitespace separated text files of patterns or numbers
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+///////////////////////////////////////////////////////////////////////////////
+//
+// The text files read by @LoadData have a pattern (row) a line, lines with
+// nothing on them being skipped. A sequence file has a 0 or 1 per neuron;
+// a matrix (or analysis) file has numbers.
+//
+// A TextLoader maps the whole file into memory (or reads it in one go
+// where it cannot be mapped), splits it at line breaks into a piece per
+// thread and parses the pieces side by side, straight into a
+// PackedSequence or DenseMatrix. Numbers are read by parseFloat, which
+// gives what reading a float from an istream would, without a string or
+// stream per number.
+//
+// The loader also counts the lines of at least LongLine characters, for
+// @LoadData's buffer size warning, and a sequence file's first character
+// that is neither 0, 1 nor white space (counting only the long lines
+// before it).
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#if !defined(TEXTLOADER_HPP)
+#  define TEXTLOADER_HPP
+
+#  include <cstddef>
+#  include <string>
+#  include <vector>
+
+#  if !defined(DENSEMATRIX_HPP)
+#    include "DenseMatrix.hpp"
+#  endif
+#  if !defined(PACKEDSEQUENCE_HPP)
+#    include "PackedSequence.hpp"
+#  endif
+
+class TextLoader {
+ public:
+  // Files smaller than this are parsed on one thread
+  static const std::size_t MinBytesPerThread = 1 << 20;
+
+  explicit TextLoader(const std::string &fileName);
+  ~TextLoader();
+  inline bool isOpen() const { return IsOpen; }
+
+  void readSequence(const unsigned int longLine, const unsigned int numThreads,
+                    PackedSequence &seq);
+  void readMatrix(const unsigned int longLine, const unsigned int numThreads,
+                  DenseMatrix &rows);
+  inline unsigned int numLongLines() const { return NumLongLines; }
+  inline bool hasBadChar() const { return HasBadChar; }
+  inline char badChar() const { return BadChar; }
+
+  // The number at the start of [begin, end), as an istream would read it
+  // (0 if there is none, the largest float if it is too large)
+  static float parseFloat(const char *begin, const char *end);
+
+ private:
+  // Not copyable
+  TextLoader(const TextLoader &);
+  TextLoader &operator=(const TextLoader &);
+
+  // Pieces of the file worth a thread each, up to numThreads
+  unsigned int pieceCount(const unsigned int numThreads) const;
+  // Where each piece starts, at the start of a line, then the end
+  std::vector<std::size_t> splitLines(const unsigned int numPieces) const;
+
+  bool IsOpen;
+  const char *Data;
+  std::size_t Size;
+  void *Mapped;                 // Data, if the file was mapped
+  std::vector<char> Copy;       // Data, if it was not
+  unsigned int NumLongLines;
+  bool HasBadChar;
+  char BadChar;
+};
+
+#endif  // TEXTLOADER_HPP
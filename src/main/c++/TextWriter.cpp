@@ -0,0 +1,304 @@
+/***************************************************************************
+ * TextWriter.cpp
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#if !defined(TEXTWRITER_HPP)
+#  include "TextWriter.hpp"
+#endif
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <stdint.h>
+
+#if !defined(ASYNCWRITER_HPP)
+#  include "AsyncWriter.hpp"
+#endif
+#if !defined(TEXTLOADER_HPP)
+#  include "TextLoader.hpp"
+#endif
+
+using std::string;
+using std::vector;
+
+namespace {
+  const uint32_t LimbBase = 1000000000;  // nine decimal digits a limb
+
+  // limbs (least significant first) *= factor, for factor < 2^32
+  void multiplyLimbs(vector<uint32_t> &limbs, const uint32_t factor) {
+    uint64_t carry = 0;
+    for (vector<uint32_t>::iterator it = limbs.begin(); it != limbs.end(); ++it) {
+      const uint64_t product = static_cast<uint64_t>(*it) * factor + carry;
+      *it = static_cast<uint32_t>(product % LimbBase);
+      carry = product / LimbBase;
+    }
+    while (carry > 0) {
+      limbs.push_back(static_cast<uint32_t>(carry % LimbBase));
+      carry /= LimbBase;
+    }
+  }
+
+  // The exact decimal digits of |value| (finite, non-zero), and the power
+  // of ten of the first of them
+  void exactDigits(const float value, string &digits, int &exponent) {
+    int binExp;
+    const double fraction = frexp(fabs(static_cast<double>(value)), &binExp);
+    uint32_t mantissa = static_cast<uint32_t>(ldexp(fraction, 24));
+    binExp -= 24;
+    while (((mantissa & 1) == 0) && (binExp < 0)) {
+      mantissa >>= 1;
+      ++binExp;
+    }
+    // |value| = mantissa * 2^binExp = limbs * 10^decExp
+    vector<uint32_t> limbs(1, mantissa);  // below 2^24, so one limb
+    int decExp = 0;
+    if (binExp >= 0) {
+      for (int e = binExp; e > 0; e -= 29) multiplyLimbs(limbs, 1U << std::min(e, 29));
+    } else {
+      // 2^-n = 5^n / 10^n
+      decExp = binExp;
+      int e = -binExp;
+      for (; e >= 13; e -= 13) multiplyLimbs(limbs, 1220703125U);
+      uint32_t rest = 1;
+      for (; e > 0; --e) rest *= 5;
+      multiplyLimbs(limbs, rest);
+    }
+    digits.clear();
+    TextWriter::appendUnsigned(limbs.back(), digits);
+    for (vector<uint32_t>::reverse_iterator it = limbs.rbegin() + 1; it != limbs.rend();
+         ++it) {
+      char limbText[9];
+      uint32_t limb = *it;
+      for (int d = 8; d >= 0; --d, limb /= 10) limbText[d] = static_cast<char>('0' + limb % 10);
+      digits.append(limbText, sizeof(limbText));
+    }
+    exponent = static_cast<int>(digits.size()) - 1 + decExp;
+  }
+
+  // Rounds exact to numDigits, halves to even, without trailing zeros
+  void roundDigits(const string &exact, const int exactExp, const unsigned int numDigits,
+                   char *digits, int &length, int &exponent) {
+    length = std::min(exact.size(), static_cast<string::size_type>(numDigits));
+    memcpy(digits, exact.data(), length);
+    exponent = exactExp;
+    if (exact.size() > numDigits) {
+      bool roundUp = (exact[numDigits] > '5');
+      if (exact[numDigits] == '5') {
+        roundUp = (exact.find_first_not_of('0', numDigits + 1) != string::npos)
+          || ((digits[numDigits - 1] - '0') % 2 == 1);
+      }
+      if (roundUp) {
+        int d = numDigits - 1;
+        while ((d >= 0) && (digits[d] == '9')) digits[d--] = '0';
+        if (d >= 0) {
+          ++digits[d];
+        } else {
+          digits[0] = '1';
+          ++exponent;
+        }
+      }
+    }
+    while ((length > 1) && (digits[length - 1] == '0')) --length;
+  }
+
+  // The powers of ten a double holds exactly
+  const double ExactPowers[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  const int MaxExactPower = 22;
+  // At most this many digits are rounded in double arithmetic, where the
+  // scaled value (below 10^9) is within 10^-6 of its exact value
+  const int MaxFastDigits = 9;
+
+  // value * 10^power, with at most three roundings
+  double scaleByTen(double value, int power) {
+    for (; power > MaxExactPower; power -= MaxExactPower) value *= ExactPowers[MaxExactPower];
+    for (; power < -MaxExactPower; power += MaxExactPower) value /= ExactPowers[MaxExactPower];
+    return (power < 0) ? (value / ExactPowers[-power]) : (value * ExactPowers[power]);
+  }
+
+  // roundDigits without the exact digits: absValue is scaled to an integer
+  // of numDigits digits in double arithmetic and rounded. That is right
+  // unless the scaled value is too near a half for its rounding errors to
+  // be ruled out, when this returns false.
+  bool fastDigits(const double absValue, const int numDigits, char *digits,
+                  int &length, int &exponent) {
+    const double low = ExactPowers[numDigits - 1];
+    const double high = ExactPowers[numDigits];
+    exponent = static_cast<int>(floor(log10(absValue)));
+    double scaled = scaleByTen(absValue, numDigits - 1 - exponent);
+    if (scaled < low) {
+      scaled = scaleByTen(absValue, numDigits - 1 - --exponent);
+    } else if (scaled >= high) {
+      scaled = scaleByTen(absValue, numDigits - 1 - ++exponent);
+    }
+    if ((scaled < low) || (scaled >= high)) return false;
+    const double whole = floor(scaled);
+    const double fraction = scaled - whole;
+    if (fabs(fraction - 0.5) < 1e-6) return false;
+    uint32_t rounded = static_cast<uint32_t>(whole) + ((fraction > 0.5) ? 1 : 0);
+    if (rounded == static_cast<uint32_t>(high)) {
+      rounded /= 10;
+      ++exponent;
+    }
+    for (int d = numDigits - 1; d >= 0; --d, rounded /= 10) {
+      digits[d] = static_cast<char>('0' + rounded % 10);
+    }
+    length = numDigits;
+    while ((length > 1) && (digits[length - 1] == '0')) --length;
+    return true;
+  }
+
+  // Whether the digits read back as absValue, when double arithmetic can
+  // tell: they are a whole number times an exact power of ten, so one
+  // multiplication or division rounds them correctly to a double, which
+  // rounds to the float strtof would give unless it lies exactly halfway
+  // between two floats. Otherwise decided is false.
+  bool readsBack(const char *digits, const int length, const int exponent,
+                 const float absValue, bool &decided) {
+    const int power = exponent - (length - 1);
+    decided = false;
+    if ((power > MaxExactPower) || (power < -MaxExactPower)) return false;
+    uint32_t whole = 0;
+    for (int d = 0; d < length; ++d) whole = whole * 10 + (digits[d] - '0');
+    const double read = (power < 0) ? (whole / ExactPowers[-power])
+                                    : (whole * ExactPowers[power]);
+    int binExp;
+    const double floatBits = ldexp(frexp(read, &binExp), 25);
+    if ((floatBits == floor(floatBits)) && (fmod(floatBits, 2.0) == 1.0)) return false;
+    decided = true;
+    return static_cast<float>(read) == absValue;
+  }
+
+  // As printf's %g at precision, given the rounded digits
+  void appendGeneral(const bool negative, const char *digits, const int numDigits,
+                     const int exponent, const int precision, string &out) {
+    if (negative) out.push_back('-');
+    if ((exponent < -4) || (exponent >= precision)) {
+      out.push_back(digits[0]);
+      if (numDigits > 1) {
+        out.push_back('.');
+        out.append(digits + 1, numDigits - 1);
+      }
+      out.push_back('e');
+      out.push_back((exponent < 0) ? '-' : '+');
+      const int absExp = (exponent < 0) ? -exponent : exponent;
+      if (absExp < 10) out.push_back('0');
+      TextWriter::appendUnsigned(absExp, out);
+    } else if (exponent < 0) {
+      out.append("0.");
+      out.append(-exponent - 1, '0');
+      out.append(digits, numDigits);
+    } else if (numDigits <= exponent + 1) {
+      out.append(digits, numDigits);
+      out.append(exponent + 1 - numDigits, '0');
+    } else {
+      out.append(digits, exponent + 1);
+      out.push_back('.');
+      out.append(digits + exponent + 1, numDigits - exponent - 1);
+    }
+  }
+}
+
+TextWriter::TextWriter(const string &fileName, const bool truncate, const int precision)
+  : FileName(fileName), Out(0), Truncate(truncate), Written(false), Precision(precision) {
+  Buffer.reserve(ChunkBytes + ChunkBytes / 8);
+}
+
+TextWriter::TextWriter(std::ostream &out, const int precision)
+  : Out(&out), Truncate(false), Written(false), Precision(precision) {
+  Buffer.reserve(ChunkBytes + ChunkBytes / 8);
+}
+
+void TextWriter::flush() {
+  if (Out) {
+    Out->write(Buffer.data(), Buffer.size());
+    Buffer.clear();
+  } else if (!Buffer.empty() || !Written) {
+    // The buffer is moved into the queue, so the next chunk needs its own
+    AsyncWriter::write(FileName, Buffer, Truncate);
+    Buffer.reserve(ChunkBytes + ChunkBytes / 8);
+    Truncate = false;
+    Written = true;
+  }
+}
+
+void TextWriter::appendUnsigned(unsigned long value, string &out) {
+  char text[24];
+  char *pos = text + sizeof(text);
+  do {
+    *--pos = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value > 0);
+  out.append(pos, text + sizeof(text));
+}
+
+void TextWriter::appendFloat(const float value, const int precision, string &out) {
+  if ((value != value) || (fabs(value) > FLT_MAX)) {
+    // Not a number, or infinite
+    char text[16];
+    snprintf(text, sizeof(text), "%g", static_cast<double>(value));
+    out.append(text);
+    return;
+  }
+  const bool negative = (value < 0.0f) || ((value == 0.0f) && (1.0f / value < 0.0f));
+  if (value == 0.0f) {
+    out.append(negative ? "-0" : "0");
+    return;
+  }
+  const double absValue = fabs(static_cast<double>(value));
+  char digits[MaxPrecision];
+  int length;
+  int exponent;
+  // The exact digits are only worked out when double arithmetic cannot
+  // be sure of the rounding
+  string exact;
+  int exactExp = 0;
+  if (precision != Shortest) {
+    const int numDigits = std::min(std::max(precision, 1), static_cast<int>(MaxPrecision));
+    if ((numDigits > MaxFastDigits)
+        || !fastDigits(absValue, numDigits, digits, length, exponent)) {
+      exactDigits(value, exact, exactExp);
+      roundDigits(exact, exactExp, numDigits, digits, length, exponent);
+    }
+    appendGeneral(negative, digits, length, exponent, numDigits, out);
+    return;
+  }
+  // Nine digits always read back as the same float
+  for (int numDigits = 6; numDigits <= 9; ++numDigits) {
+    if (!fastDigits(absValue, numDigits, digits, length, exponent)) {
+      if (exact.empty()) exactDigits(value, exact, exactExp);
+      roundDigits(exact, exactExp, numDigits, digits, length, exponent);
+    }
+    bool decided;
+    const bool same = readsBack(digits, length, exponent, static_cast<float>(absValue),
+                                decided);
+    if (decided && !same && (numDigits < 9)) continue;
+    const string::size_type start = out.size();
+    appendGeneral(negative, digits, length, exponent, numDigits, out);
+    if (decided || (numDigits == 9)
+        || (TextLoader::parseFloat(out.data() + start, out.data() + out.size()) == value)) {
+      return;
+    }
+    out.resize(start);
+  }
+}
@@ -0,0 +1,131 @@
+/***************************************************************************
+ * TextWriter.hpp
+ *
+ *  Buffered text output of numbers
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+///////////////////////////////////////////////////////////////////////////////
+//
+// A TextWriter formats numbers and text into a buffer and hands the buffer
+// on ChunkBytes at a time, either to the AsyncWriter for a file or to an
+// ostream, so a large matrix costs one write per chunk rather than a
+// stream insertion per number.
+//
+// A float is written as an ostream set to the same precision would write
+// it (the shortest of fixed or scientific notation, no trailing zeros),
+// digit for digit, rounded halves to even as printf does. Up to 9 digits
+// are rounded in double arithmetic; only more digits, or a value too
+// near a half for that to be certain, need its exact decimal value, which
+// is worked out with integer arithmetic. A precision of Shortest writes
+// the fewest digits (at least 6, at most 9) that read back as the same
+// float, and one above MaxPrecision is taken as MaxPrecision.
+//
+// Whatever is left in the buffer is handed on by flush, which the
+// destructor calls. A writer for a file always writes to it at least
+// once, so even an empty one creates (or, with truncate, empties) it.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#if !defined(TEXTWRITER_HPP)
+#  define TEXTWRITER_HPP
+
+#  include <cstddef>
+#  include <ostream>
+#  include <string>
+
+class TextWriter {
+ public:
+  static const std::size_t ChunkBytes = 1 << 20;
+  static const int Shortest = 0;
+  static const int MaxPrecision = 17;
+
+  // Text for the end of fileName, emptied first if truncate is set
+  TextWriter(const std::string &fileName, const bool truncate, const int precision = 6);
+  // Text for out
+  explicit TextWriter(std::ostream &out, const int precision = 6);
+  ~TextWriter() { flush(); }
+
+  inline int precision() const { return Precision; }
+  inline void setPrecision(const int precision) { Precision = precision; }
+
+  inline TextWriter &operator<<(const float value) {
+    appendFloat(value, Precision, Buffer);
+    return chunkDone();
+  }
+  inline TextWriter &operator<<(const int value) {
+    if (value < 0) {
+      Buffer.push_back('-');
+      appendUnsigned(0UL - static_cast<unsigned long>(value), Buffer);
+    } else {
+      appendUnsigned(value, Buffer);
+    }
+    return chunkDone();
+  }
+  inline TextWriter &operator<<(const unsigned int value) {
+    appendUnsigned(value, Buffer);
+    return chunkDone();
+  }
+  inline TextWriter &operator<<(const unsigned long value) {
+    appendUnsigned(value, Buffer);
+    return chunkDone();
+  }
+  inline TextWriter &operator<<(const char c) {
+    Buffer.push_back(c);
+    return chunkDone();
+  }
+  inline TextWriter &operator<<(const char *text) {
+    Buffer.append(text);
+    return chunkDone();
+  }
+  inline TextWriter &operator<<(const std::string &text) {
+    Buffer.append(text);
+    return chunkDone();
+  }
+
+  // Appends size bytes as they are, for the binary parts of a file
+  inline TextWriter &write(const char *data, const std::size_t size) {
+    Buffer.append(data, size);
+    return chunkDone();
+  }
+
+  // Hands on what is in the buffer
+  void flush();
+
+  // Appends value as an ostream set to precision (or Shortest) would
+  static void appendFloat(const float value, const int precision, std::string &out);
+  static void appendUnsigned(unsigned long value, std::string &out);
+
+ private:
+  // Not copyable
+  TextWriter(const TextWriter &);
+  TextWriter &operator=(const TextWriter &);
+
+  inline TextWriter &chunkDone() {
+    if (Buffer.size() >= ChunkBytes) flush();
+    return *this;
+  }
+
+  std::string FileName;
+  std::ostream *Out;
+  bool Truncate;                // for the next write to FileName
+  bool Written;                 // to FileName
+  int Precision;
+  std::string Buffer;
+};
+
+#endif  // TEXTWRITER_HPP
@@ -0,0 +1,142 @@
+/***************************************************************************
+ * ThreadTeam.cpp
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#if !defined(THREADTEAM_HPP)
+#  include "ThreadTeam.hpp"
+#endif
+#include <vector>
+#if defined(MULTITHREAD)
+#  include <pthread.h>
+#endif
+
+#if defined(MULTITHREAD)
+struct ThreadTeamImpl {
+  ThreadTeamImpl() : CurJob(0), CurArg(0), Generation(0), NumBusy(0),
+                     Quit(false) {
+    pthread_mutex_init(&Lock, NULL);
+    pthread_cond_init(&Start, NULL);
+    pthread_cond_init(&Done, NULL);
+  }
+  ~ThreadTeamImpl() {
+    pthread_cond_destroy(&Done);
+    pthread_cond_destroy(&Start);
+    pthread_mutex_destroy(&Lock);
+  }
+  pthread_mutex_t Lock;
+  pthread_cond_t Start;         // signalled when a job is posted
+  pthread_cond_t Done;          // signalled when the last worker finishes
+  ThreadTeam::Job CurJob;
+  void *CurArg;
+  unsigned long Generation;     // number of jobs posted
+  unsigned int NumBusy;         // helper workers still on the current job
+  bool Quit;
+  std::vector<pthread_t> Threads;
+};
+
+namespace {
+  struct WorkerStart {
+    ThreadTeamImpl *Team;
+    unsigned int Worker;
+  };
+
+  void *workerLoop(void *arg) {
+    WorkerStart *start = static_cast<WorkerStart *>(arg);
+    ThreadTeamImpl &team = *start->Team;
+    const unsigned int worker = start->Worker;
+    delete start;
+    // Workers are all started before the first job is posted
+    unsigned long seen = 0;
+    pthread_mutex_lock(&team.Lock);
+    for (;;) {
+      while (!team.Quit && (team.Generation == seen)) {
+        pthread_cond_wait(&team.Start, &team.Lock);
+      }
+      if (team.Quit) break;
+      seen = team.Generation;
+      ThreadTeam::Job job = team.CurJob;
+      void *jobArg = team.CurArg;
+      pthread_mutex_unlock(&team.Lock);
+      job(worker, jobArg);
+      pthread_mutex_lock(&team.Lock);
+      if (--team.NumBusy == 0) pthread_cond_signal(&team.Done);
+    }
+    pthread_mutex_unlock(&team.Lock);
+    return NULL;
+  }
+}
+#else
+struct ThreadTeamImpl { };
+#endif
+
+bool ThreadTeam::resize(const unsigned int numWorkers) {
+  const unsigned int wanted = (numWorkers < 1) ? 1 : numWorkers;
+  if (wanted == NumWorkers) return true;
+#if defined(MULTITHREAD)
+  if (Impl) {
+    pthread_mutex_lock(&Impl->Lock);
+    Impl->Quit = true;
+    pthread_cond_broadcast(&Impl->Start);
+    pthread_mutex_unlock(&Impl->Lock);
+    for (unsigned int i = 0; i < Impl->Threads.size(); ++i) {
+      pthread_join(Impl->Threads[i], NULL);
+    }
+    delete Impl;
+    Impl = 0;
+  }
+  NumWorkers = 1;
+  if (wanted == 1) return true;
+  Impl = new ThreadTeamImpl;
+  for (unsigned int worker = 1; worker < wanted; ++worker) {
+    WorkerStart *start = new WorkerStart;
+    start->Team = Impl;
+    start->Worker = worker;
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, workerLoop, start) != 0) {
+      delete start;
+      break;
+    }
+    Impl->Threads.push_back(thread);
+  }
+  NumWorkers = Impl->Threads.size() + 1;
+  return NumWorkers == wanted;
+#else
+  NumWorkers = 1;
+  return false;
+#endif
+}
+
+void ThreadTeam::run(Job job, void *arg) {
+#if defined(MULTITHREAD)
+  if (Impl) {
+    pthread_mutex_lock(&Impl->Lock);
+    Impl->CurJob = job;
+    Impl->CurArg = arg;
+    Impl->NumBusy = NumWorkers - 1;
+    ++Impl->Generation;
+    pthread_cond_broadcast(&Impl->Start);
+    pthread_mutex_unlock(&Impl->Lock);
+    job(0, arg);
+    pthread_mutex_lock(&Impl->Lock);
+    while (Impl->NumBusy > 0) pthread_cond_wait(&Impl->Done, &Impl->Lock);
+    pthread_mutex_unlock(&Impl->Lock);
+    return;
+  }
+#endif
+  job(0, arg);
+}
@@ -0,0 +1,63 @@
+/***************************************************************************
+ * ThreadTeam.hpp
+ *
+ *  A fixed team of worker threads for shared-memory parallel steps
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+///////////////////////////////////////////////////////////////////////////////
+//
+// bool resize(unsigned int numWorkers)
+// unsigned int size()
+// void run(Job job, void *arg)
+//
+// resize starts (or stops) threads so that the team has numWorkers
+// workers, the calling thread always being worker 0. It returns false,
+// leaving a team of one, if more than one worker is asked for in a build
+// without threads.
+//
+// run calls job(worker, arg) once for every worker and returns when all
+// of them have finished, so each call is a barrier. Workers wait on a
+// condition variable between calls rather than spinning.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#if !defined(THREADTEAM_HPP)
+#  define THREADTEAM_HPP
+
+struct ThreadTeamImpl;
+
+class ThreadTeam {
+ public:
+  typedef void (*Job)(const unsigned int worker, void *arg);
+
+  ThreadTeam() : Impl(0), NumWorkers(1) { }
+  ~ThreadTeam() { resize(1); }
+  bool resize(const unsigned int numWorkers);
+  unsigned int size() const { return NumWorkers; }
+  void run(Job job, void *arg);
+
+ private:
+  // Not copyable
+  ThreadTeam(const ThreadTeam &);
+  ThreadTeam &operator=(const ThreadTeam &);
+
+  ThreadTeamImpl *Impl;
+  unsigned int NumWorkers;
+};
+
+#endif  // THREADTEAM_HPP
@@ -0,0 +1,52 @@
+/***************************************************************************
+ * UndoLog.cpp
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#if !defined(UNDOLOG_HPP)
+#  include "UndoLog.hpp"
+#endif
+
+void UndoLog::start() {
+  forget();
+  Recording = true;
+}
+
+void UndoLog::add(Entry *entry) {
+  if (Recording) {
+    Entries.push_back(entry);
+  } else {
+    delete entry;
+  }
+}
+
+void UndoLog::rollBack() {
+  for (std::vector<Entry *>::reverse_iterator it = Entries.rbegin(); it != Entries.rend(); ++it) {
+    (*it)->undo();
+    delete *it;
+  }
+  Entries.clear();
+  Recording = false;
+}
+
+void UndoLog::forget() {
+  for (std::vector<Entry *>::iterator it = Entries.begin(); it != Entries.end(); ++it) {
+    delete *it;
+  }
+  Entries.clear();
+  Recording = false;
+}
@@ -0,0 +1,102 @@
+/***************************************************************************
+ * UndoLog.hpp
+ *
+ *  Puts back what was changed since a point in a simulation
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+///////////////////////////////////////////////////////////////////////////////
+//
+// @Test -savestate (and -inhlearn) leave the network as they found it.
+// Rather than copying the whole network first, they start an UndoLog and
+// save each part of the state just before it is first changed; rollBack
+// then puts the parts back, newest first, so the cost of a test is
+// proportional to what it changed rather than to the size of the network.
+//
+// save keeps a copy of an object (or of num values of an array) to be
+// assigned back to it. Anything else is kept by an Entry of its own,
+// which add takes ownership of. Nothing is kept unless the log is
+// recording, i.e. between start and rollBack or forget, so callers on
+// a hot path only need to check isRecording first.
+//
+// Objects saved must stay where they are until the log is rolled back.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#if !defined(UNDOLOG_HPP)
+#  define UNDOLOG_HPP
+
+#  include <algorithm>
+#  include <cstddef>
+#  include <vector>
+
+class UndoLog {
+ public:
+  class Entry {
+   public:
+    virtual ~Entry() {}
+    virtual void undo() = 0;
+  };
+
+  UndoLog(): Recording(false) {}
+  ~UndoLog() { forget(); }
+
+  // Forgets anything already saved and starts recording
+  void start();
+  inline bool isRecording() const { return Recording; }
+  template<class T> inline void save(T &obj) {
+    if (Recording) Entries.push_back(new Copy<T>(obj));
+  }
+  template<class T> inline void save(T *vals, const std::size_t num) {
+    if (Recording) Entries.push_back(new ArrayCopy<T>(vals, num));
+  }
+  // Takes ownership of entry, which is deleted even when not recording
+  void add(Entry *entry);
+  // Undoes everything saved, newest first, and stops recording
+  void rollBack();
+  // Keeps the changes and stops recording
+  void forget();
+  inline std::size_t size() const { return Entries.size(); }
+
+ private:
+  template<class T> class Copy : public Entry {
+   public:
+    explicit Copy(T &obj): At(obj), Old(obj) {}
+    // Nothing needs the copy afterwards, so containers just swap back
+    void undo() { std::swap(At, Old); }
+   private:
+    T &At;
+    T Old;
+  };
+  template<class T> class ArrayCopy : public Entry {
+   public:
+    ArrayCopy(T *vals, const std::size_t num): At(vals), Old(vals, vals + num) {}
+    void undo() { std::copy(Old.begin(), Old.end(), At); }
+   private:
+    T *At;
+    std::vector<T> Old;
+  };
+
+  // Not copyable
+  UndoLog(const UndoLog &);
+  UndoLog &operator=(const UndoLog &);
+
+  std::vector<Entry *> Entries;
+  bool Recording;
+};
+
+#endif  // UNDOLOG_HPP
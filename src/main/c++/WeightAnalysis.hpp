@@ -233,12 +233,9 @@ void WeightAnalysis(ArgListType &arg) {  // AT_FUN
   } else if (UsedOnly.getValue()) {
     SequenceCIt InvSCit = InvSeq.begin();
     for (int nrn = 0; InvSCit != InvSeq.end(); ++InvSCit, ++nrn) {
-      for (int tt = 0; tt < SeqSize; tt++) {
-        if (InvSCit->at(tt)) {
-          NeuronsToAnalyze.at(NumToAnalyze) = nrn;
-          NumToAnalyze++;
-          break;
-        }
+      if (InvSCit->any()) {
+        NeuronsToAnalyze.at(NumToAnalyze) = nrn;
+        NumToAnalyze++;
       }
     }
   }
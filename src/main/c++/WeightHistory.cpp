@@ -0,0 +1,179 @@
+/***************************************************************************
+ * WeightHistory.cpp
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#if !defined(WEIGHTHISTORY_HPP)
+#  include "WeightHistory.hpp"
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#if !defined(ASYNCWRITER_HPP)
+#  include "AsyncWriter.hpp"
+#endif
+#if !defined(BINARYRECORD_HPP)
+#  include "BinaryRecord.hpp"
+#endif
+
+using std::string;
+using std::vector;
+using BinaryRecord::BufferBytes;
+using BinaryRecord::bitsFloat;
+using BinaryRecord::floatBits;
+using BinaryRecord::getWord;
+using BinaryRecord::putWord;
+
+namespace {
+  const char HistoryTag[8] = { 'N', 'J', 'W', 'H', 'I', 'S', 'T', '1' };
+}
+
+void WeightHistory::open(const string &fileName, const float threshold,
+                         const UIVector &fanIn, const UIVector &sources,
+                         const DataList &weights) {
+  flush();
+  FileName = fileName;
+  Threshold = threshold;
+  FanIn = fanIn;
+  Sources = sources;
+  Written = weights;
+  IsOpen = true;
+
+  Buffer.append(HistoryTag, sizeof(HistoryTag));
+  putWord(Buffer, FanIn.size());
+  putWord(Buffer, Sources.size());
+  putWord(Buffer, floatBits(Threshold));
+  for (UIVectorCIt it = FanIn.begin(); it != FanIn.end(); ++it) putWord(Buffer, *it);
+  for (UIVectorCIt it = Sources.begin(); it != Sources.end(); ++it) putWord(Buffer, *it);
+  for (DataListCIt it = Written.begin(); it != Written.end(); ++it) {
+    putWord(Buffer, floatBits(*it));
+  }
+}
+
+bool WeightHistory::sameNetwork(const UIVector &fanIn, const UIVector &sources) const {
+  return (fanIn == FanIn) && (sources == Sources);
+}
+
+unsigned int WeightHistory::snapshot(const int trial, const int step,
+                                     const DataList &weights) {
+  // The count is filled in once it is known
+  putWord(Buffer, SnapshotMark);
+  putWord(Buffer, static_cast<uint32_t>(trial));
+  putWord(Buffer, static_cast<uint32_t>(step));
+  const string::size_type countAt = Buffer.size();
+  putWord(Buffer, 0);
+  uint32_t numChanged = 0;
+  for (unsigned int c = 0; c < Written.size(); ++c) {
+    // With no threshold even a change of sign of zero is kept
+    const bool changed = (Threshold > 0.0f) ? (fabs(weights[c] - Written[c]) > Threshold)
+      : (floatBits(weights[c]) != floatBits(Written[c]));
+    if (changed) {
+      putWord(Buffer, c);
+      putWord(Buffer, floatBits(weights[c]));
+      Written[c] = weights[c];
+      ++numChanged;
+    }
+  }
+  memcpy(&Buffer[countAt], &numChanged, sizeof(numChanged));
+  if (Buffer.size() >= BufferBytes) flush();
+  return numChanged;
+}
+
+void WeightHistory::flush() {
+  if (Buffer.empty()) return;
+  AsyncWriter::write(FileName, Buffer);
+}
+
+bool WeightHistory::read(const string &fileName, vector<Run> &runs) {
+  runs.clear();
+  std::ifstream inFile(fileName.c_str(), std::ios::in | std::ios::binary);
+  if (!inFile) return false;
+  uint32_t mark;
+  while (getWord(inFile, mark)) {
+    if (mark != SnapshotMark) {
+      // A new run
+      char tag[sizeof(HistoryTag)];
+      memcpy(tag, &mark, sizeof(mark));
+      if (!inFile.read(tag + sizeof(mark), sizeof(tag) - sizeof(mark))
+          || !std::equal(tag, tag + sizeof(tag), HistoryTag)) {
+        return false;
+      }
+      runs.push_back(Run());
+      Run &run = runs.back();
+      uint32_t numNeurons, numConnections, threshold;
+      if (!getWord(inFile, numNeurons) || !getWord(inFile, numConnections)
+          || !getWord(inFile, threshold)) {
+        return false;
+      }
+      run.Threshold = bitsFloat(threshold);
+      run.FanIn.resize(numNeurons);
+      uint32_t totalFanIn = 0;
+      for (uint32_t n = 0; n < numNeurons; ++n) {
+        if (!getWord(inFile, run.FanIn[n])) return false;
+        totalFanIn += run.FanIn[n];
+      }
+      if (totalFanIn != numConnections) return false;
+      run.Sources.resize(numConnections);
+      run.Initial.resize(numConnections);
+      for (uint32_t c = 0; c < numConnections; ++c) {
+        if (!getWord(inFile, run.Sources[c])) return false;
+      }
+      for (uint32_t c = 0; c < numConnections; ++c) {
+        uint32_t bits;
+        if (!getWord(inFile, bits)) return false;
+        run.Initial[c] = bitsFloat(bits);
+      }
+      continue;
+    }
+    if (runs.empty()) return false;
+    Run &run = runs.back();
+    uint32_t trial, step, numChanged;
+    if (!getWord(inFile, trial) || !getWord(inFile, step) || !getWord(inFile, numChanged)
+        || (numChanged > run.Sources.size())) {
+      return false;
+    }
+    run.Snapshots.push_back(Snapshot());
+    Snapshot &snap = run.Snapshots.back();
+    snap.Trial = static_cast<int>(trial);
+    snap.Step = static_cast<int>(step);
+    snap.Changed.resize(numChanged);
+    snap.Weights.resize(numChanged);
+    for (uint32_t i = 0; i < numChanged; ++i) {
+      uint32_t bits;
+      if (!getWord(inFile, snap.Changed[i]) || !getWord(inFile, bits)
+          || (snap.Changed[i] >= run.Sources.size())) {
+        return false;
+      }
+      snap.Weights[i] = bitsFloat(bits);
+    }
+  }
+  return inFile.eof();
+}
+
+void WeightHistory::weightsAt(const Run &run, const unsigned int snapshot, DataList &weights) {
+  weights = run.Initial;
+  const unsigned int last = std::min<unsigned int>(snapshot, run.Snapshots.size());
+  for (unsigned int s = 0; s < last; ++s) {
+    const Snapshot &snap = run.Snapshots[s];
+    for (unsigned int i = 0; i < snap.Changed.size(); ++i) {
+      weights[snap.Changed[i]] = snap.Weights[i];
+    }
+  }
+}
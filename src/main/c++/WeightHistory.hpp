@@ -0,0 +1,111 @@
+/***************************************************************************
+ * WeightHistory.hpp
+ *
+ *  A binary record of how the weights change during training
+ *
+ *  Copyright 2011 Informed Simplifications, LLC
+ *  This file is part of NeuroJet.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+///////////////////////////////////////////////////////////////////////////////
+//
+// Calling @SaveWeights after every trial writes every connection and
+// weight out as text each time. A WeightHistory writes the connections and
+// weights once, then at each snapshot only the weights that have moved by
+// more than Threshold since they were last written.
+//
+// A run starts with the 8 byte tag "NJWHIST1", the unsigned 32 bit
+// NumNeurons and NumConnections, the float Threshold, then the fan-in
+// count of each neuron, the source of each connection (neuron by neuron,
+// in fan-in order) and the weight of each connection. Each snapshot is the
+// word SnapshotMark, the signed 32 bit Trial and Step, the number of
+// weights that follow, and that many pairs of connection number and
+// weight (as a float's bits). All are in the byte order of the machine
+// that wrote them. Runs follow one another in a file.
+//
+// read gives back every run in a file, and weightsAt the weights at one
+// of a run's snapshots: exactly the weights at the time with a Threshold of
+// 0, otherwise each within Threshold of them.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#if !defined(WEIGHTHISTORY_HPP)
+#  define WEIGHTHISTORY_HPP
+
+#  include <string>
+#  include <vector>
+#  include <stdint.h>
+
+#  if !defined(DATATYPES_HPP)
+#    include "DataTypes.hpp"
+#  endif
+
+class WeightHistory {
+ public:
+  static const uint32_t SnapshotMark = 0x50414E53;  // "SNAP"
+
+  struct Snapshot {
+    int Trial;
+    int Step;
+    UIVector Changed;       // connection numbers
+    DataList Weights;       // their new weights
+  };
+  struct Run {
+    Run(): Threshold(0.0f) {}
+    float Threshold;
+    UIVector FanIn;
+    UIVector Sources;
+    DataList Initial;
+    std::vector<Snapshot> Snapshots;
+  };
+
+  WeightHistory(): IsOpen(false), Threshold(0.0f) {}
+
+  // Starts a run at the end of fileName from the network's connections
+  // (sources grouped by neuron, fanIn[n] of them for neuron n) and weights
+  void open(const std::string &fileName, const float threshold, const UIVector &fanIn,
+            const UIVector &sources, const DataList &weights);
+  inline bool isOpen() const { return IsOpen; }
+  inline const std::string &fileName() const { return FileName; }
+  inline float threshold() const { return Threshold; }
+  // Whether the run is of a network with these connections
+  bool sameNetwork(const UIVector &fanIn, const UIVector &sources) const;
+
+  // Writes the weights that moved by more than the threshold, returning
+  // how many
+  unsigned int snapshot(const int trial, const int step, const DataList &weights);
+  // Hands what is buffered to the writer; the run goes on, so this is
+  // left to the caller rather than done on destruction
+  void flush();
+
+  static bool read(const std::string &fileName, std::vector<Run> &runs);
+  // The weights at snapshot (0 for those the run started with)
+  static void weightsAt(const Run &run, const unsigned int snapshot, DataList &weights);
+
+ private:
+  // Not copyable
+  WeightHistory(const WeightHistory &);
+  WeightHistory &operator=(const WeightHistory &);
+
+  bool IsOpen;
+  std::string FileName;
+  float Threshold;
+  UIVector FanIn;
+  UIVector Sources;
+  DataList Written;           // each weight as last written
+  std::string Buffer;         // not yet handed to the writer
+};
+
+#endif  // WEIGHTHISTORY_HPP
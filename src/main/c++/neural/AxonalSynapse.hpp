@@ -48,10 +48,16 @@ class AxonalSynapse {
   inline bool connectsTo(const DendriticSynapse &dendritic) const {
     return synapse == &dendritic;
   }
+  inline DendriticSynapse &getDendritic() const { return *synapse; }
   inline void activate(DataList &bus, DataList &bus_inhdiv,
                        DataList &bus_inhsub, const int timeStep) {
     synapse->activate(bus, bus_inhdiv, bus_inhsub, timeStep);
   }
+  template <class Bus>
+  inline void activate(Bus &bus, Bus &bus_inhdiv, Bus &bus_inhsub,
+                       const int timeStep, Noise &noise) {
+    synapse->activate(bus, bus_inhdiv, bus_inhsub, timeStep, noise);
+  }
   inline float getWeight() const { return synapse->getWeight(); }
   inline void setWeight(const float toSet) { synapse->setWeight(toSet); }
   inline int getLastActivate() const { return synapse->getLastActivate(); }
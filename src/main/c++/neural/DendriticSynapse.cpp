@@ -24,14 +24,61 @@
 #if !defined(SYNAPSETYPE_HPP)
 #   include "SynapseType.hpp"
 #endif
+#if !defined(SIMSTATE_HPP)
+#   include "SimState.hpp"
+#endif
 
 Noise DendriticSynapse::SynNoise;
 const int DendriticSynapse::NEVER_ACTIVATED =
   -1 - static_cast<int>(SynapseType::MAX_TIME_STEP);
 
+void DendriticSynapse::saveState(SimState &state) const {
+  state.put(m_weight);
+  state.put<int32_t>(m_oldZbar);
+  state.put<uint32_t>(m_riseUntil);
+  state.put<int32_t>(m_riseActivate);
+  state.put<int32_t>(m_lastActivate);
+  state.put<int32_t>(m_prevLastActivate);
+  state.put(m_mvgAvg);
+  state.putDeque(m_actHistory);
+}
+
+void DendriticSynapse::loadState(SimState &state) {
+  state.get(m_weight);
+  state.get(m_oldZbar);
+  state.get(m_riseUntil);
+  state.get(m_riseActivate);
+  state.get(m_lastActivate);
+  state.get(m_prevLastActivate);
+  state.get(m_mvgAvg);
+  state.getDeque(m_actHistory);
+}
+
+void DendriticSynapse::getActivity(Activity &act, std::vector<unsigned int> &history) const {
+  act.OldZbar = m_oldZbar;
+  act.RiseUntil = m_riseUntil;
+  act.RiseActivate = m_riseActivate;
+  act.LastActivate = m_lastActivate;
+  act.PrevLastActivate = m_prevLastActivate;
+  act.MvgAvg = m_mvgAvg;
+  act.HistorySize = m_actHistory.size();
+  history.insert(history.end(), m_actHistory.begin(), m_actHistory.end());
+}
+
+void DendriticSynapse::setActivity(const Activity &act, const unsigned int *history) {
+  m_oldZbar = act.OldZbar;
+  m_riseUntil = act.RiseUntil;
+  m_riseActivate = act.RiseActivate;
+  m_lastActivate = act.LastActivate;
+  m_prevLastActivate = act.PrevLastActivate;
+  m_mvgAvg = act.MvgAvg;
+  m_actHistory.assign(history, history + act.HistorySize);
+}
+
 // activate happens prior to ++timeStep
-void DendriticSynapse::activate(DataList &bus, DataList &bus_inhdiv,
-                                DataList &bus_inhsub, const int timeStep) {
+template <class Bus>
+void DendriticSynapse::activate(Bus &bus, Bus &bus_inhdiv, Bus &bus_inhsub,
+                                const int timeStep, Noise &noise) {
   // throw the coin
   // Whatever you do, don't do this:
   // const SynapseType mySynType = *m_synType;
@@ -39,7 +86,7 @@ void DendriticSynapse::activate(DataList &bus, DataList &bus_inhdiv,
   bool result = ParallelRand::RandComm.RandBernoulli();
 #else        // not RNG_BUCKET
   // relies on programmer to invoke chkNoiseInit in code before use
-  bool result = SynNoise.Bernoulli(m_synType->getSynSuccRate());
+  bool result = noise.Bernoulli(m_synType->getSynSuccRate());
 #endif       // RNG_BUCKET
   if (result) {
     const bool useMvgAvg = (m_synType->getLearningRule() == LRT_MvgAvg);
@@ -107,3 +154,10 @@ void DendriticSynapse::activate(DataList &bus, DataList &bus_inhdiv,
     m_actHistory.push_back(static_cast<unsigned int>(timeStep));
   }
 }
+
+template void DendriticSynapse::activate<DataList>(DataList &, DataList &,
+                                                   DataList &, const int,
+                                                   Noise &);
+template void DendriticSynapse::activate<FixedBus>(FixedBus &, FixedBus &,
+                                                   FixedBus &, const int,
+                                                   Noise &);
@@ -27,6 +27,9 @@
 #  if !defined(ARGFUNCTS_HPP)
 #    include "ArgFuncts.hpp"
 #  endif
+#  if !defined(FIXEDSUM_HPP)
+#    include "FixedSum.hpp"
+#  endif
 #  if !defined(NOISE_HPP)
 #    include "Noise.hpp"
 #  endif
@@ -37,6 +40,8 @@
 #    include "ParallelRand.hpp"
 #  endif
 
+class SimState;
+
 // DendriticSynapse = Synapse on dendritic tree
 class DendriticSynapse {
  public:
@@ -51,7 +56,14 @@ class DendriticSynapse {
   }
   // activate happens prior to ++timeStep
   virtual void activate(DataList &bus, DataList &bus_inhdiv,
-                        DataList &bus_inhsub, const int timeStep);
+                        DataList &bus_inhsub, const int timeStep) {
+    activate(bus, bus_inhdiv, bus_inhsub, timeStep, SynNoise);
+  }
+  // Worker threads each throw the coin with their own copy of SynNoise.
+  // Bus is a DataList, or a FixedBus for order-independent sums.
+  template <class Bus>
+  void activate(Bus &bus, Bus &bus_inhdiv, Bus &bus_inhsub,
+                const int timeStep, Noise &noise);
   inline void connectNeuron(unsigned int destNeuron, SynapseType const* synType,
                             bool isExc, bool isInhDiv) {
     m_destNeuron = destNeuron;
@@ -134,6 +146,30 @@ class DendriticSynapse {
     m_prevLastActivate = m_lastActivate;
     m_lastActivate = NEVER_ACTIVATED;
   }
+  inline int getPrevLastActivate() const { return m_prevLastActivate; }
+  inline void restoreLastActivate(const int lastActivate, const int prevLastActivate) {
+    m_lastActivate = lastActivate;
+    m_prevLastActivate = prevLastActivate;
+  }
+  // What activate changes; the activation history is kept separately so
+  // that the synapses of a whole axon can share one vector
+  struct Activity {
+    int OldZbar;
+    unsigned int RiseUntil;
+    int RiseActivate;
+    int LastActivate;
+    int PrevLastActivate;
+    float MvgAvg;
+    unsigned int HistorySize;
+  };
+  // Appends the activation history to history
+  void getActivity(Activity &act, std::vector<unsigned int> &history) const;
+  // history points to act.HistorySize activation times
+  void setActivity(const Activity &act, const unsigned int *history);
+  // The weight and activation history, for @SaveState and @LoadState; the
+  // connection itself is made by @CreateNetwork
+  void saveState(SimState &state) const;
+  void loadState(SimState &state);
   inline void setOldZbar(const float toSet) {
     m_oldZbar = static_cast<int>(toSet*1000);
   }
@@ -31,6 +31,9 @@
 #if !defined(PARSER_HPP)
 #  include "Parser.hpp"
 #endif
+#if !defined(SIMSTATE_HPP)
+#  include "SimState.hpp"
+#endif
 
 using std::length_error;
 
@@ -41,8 +44,8 @@ Interneuron::Interneuron(const float excitationDecay,
     m_PyrToInternrnWt(0), m_excitationDecay(excitationDecay),
     m_internalExcitation(-1.0f), m_axonalBuffSize(buffSize), m_firstNeuron(0),
     m_useWeightsForActivity(false), m_WeightedActAvgAdj(1.0f),
-    m_activityDeviation(0.0f), m_SynModRate(0.0f), m_actAvgRate(0.0f),
-    m_mult(1.0f) {
+    m_activityDeviation(0.0f), m_desiredActivity(0.0f), m_SynModRate(0.0f),
+    m_actAvgRate(0.0f), m_mult(1.0f) {
   if (m_axonalBuffSize == 0)
     throw length_error("Attempted to create an Interneuron with no buffer");
 }
@@ -57,6 +60,7 @@ Interneuron::Interneuron(const Interneuron& i)
     m_useWeightsForActivity(i.m_useWeightsForActivity),
     m_WeightedActAvgAdj(i.m_WeightedActAvgAdj),
     m_activityDeviation(i.m_activityDeviation),
+    m_desiredActivity(i.m_desiredActivity),
     m_SynModRate(i.m_SynModRate), m_actAvgRate(i.m_actAvgRate),
     m_mult(i.m_mult) {
   // Does nothing else
@@ -117,12 +121,51 @@ void Interneuron::copy(const Interneuron& i) {
   m_useWeightsForActivity = i.m_useWeightsForActivity;
   m_WeightedActAvgAdj = i.m_WeightedActAvgAdj;
   m_activityDeviation = i.m_activityDeviation;
+  m_desiredActivity = i.m_desiredActivity;
   m_SynModRate = i.m_SynModRate;
   m_actAvgRate = i.m_actAvgRate;
   m_mult = i.m_mult;
   m_synapticQueue = i.m_synapticQueue;
 }
 
+void Interneuron::saveState(SimState &state) const {
+  state.putVector(m_synapticFilter.getFilter());
+  state.putVector(m_synapticQueue);
+  state.putDeque(m_axonalBuffer);
+  state.putVector(m_PyrToInternrnWt);
+  state.put(m_excitationDecay);
+  state.put(m_internalExcitation);
+  state.put<uint32_t>(m_axonalBuffSize);
+  state.put<uint32_t>(m_firstNeuron);
+  state.putBool(m_useWeightsForActivity);
+  state.put(m_WeightedActAvgAdj);
+  state.put(m_activityDeviation);
+  state.put(m_desiredActivity);
+  state.put(m_SynModRate);
+  state.put(m_actAvgRate);
+  state.put(m_mult);
+}
+
+void Interneuron::loadState(SimState &state) {
+  DataList filterVals;
+  state.getVector(filterVals);
+  if (!filterVals.empty()) m_synapticFilter.setFilter(filterVals);
+  state.getVector(m_synapticQueue);
+  state.getDeque(m_axonalBuffer);
+  state.getVector(m_PyrToInternrnWt);
+  state.get(m_excitationDecay);
+  state.get(m_internalExcitation);
+  state.get(m_axonalBuffSize);
+  state.get(m_firstNeuron);
+  m_useWeightsForActivity = state.getBool();
+  state.get(m_WeightedActAvgAdj);
+  state.get(m_activityDeviation);
+  state.get(m_desiredActivity);
+  state.get(m_SynModRate);
+  state.get(m_actAvgRate);
+  state.get(m_mult);
+}
+
 void Interneuron::setMaxTimeOffset(const unsigned int buffSize) {
   if (buffSize == 0)
     throw length_error("Attempted to alter Interneuron to have no buffer");
@@ -43,6 +43,8 @@ using std::vector;
 #   include "Filter.hpp"
 #endif
 
+class SimState;
+
 class Interneuron {
  public:
   Interneuron(const float excitationDecay = 1.0f,
@@ -110,14 +112,9 @@ class Interneuron {
                              const UIVector &toModify,
                              const unsigned int firstN,
                              const unsigned int lastN);
-  string exportInterneuron() const {
-    // FIXME, eventually will have all information here
-    string toReturn(reinterpret_cast<const char *>(&m_internalExcitation));
-    return toReturn;
-  };
-  void importInterneuron(string& toImport) {
-    m_internalExcitation = m_internalExcitation;  // FIXME, to implement
-  };
+  // Everything about the interneuron, for @SaveState and @LoadState
+  void saveState(SimState &state) const;
+  void loadState(SimState &state);
 
  private:
   Filter m_synapticFilter;
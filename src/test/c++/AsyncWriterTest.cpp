@@ -0,0 +1,133 @@
+/***************************************************************************
+ * AsyncWriterTest.cpp
+ *
+ *  Copyright 2011 Ben Hocking
+ *  This file is part of the NeuroJet tester AllTests.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#if !defined(WIN32)
+#  include <sys/types.h>
+#  include <sys/wait.h>
+#  include <unistd.h>
+#endif
+
+#include "AsyncWriter.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+  std::string readAll(const std::string &fileName) {
+    std::ifstream inFile(fileName.c_str(), std::ios::in | std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(inFile),
+                       std::istreambuf_iterator<char>());
+  }
+
+  TEST(AsyncWriterTest, AppendsInOrder) {
+    const std::string fileName = "AsyncWriterTest1.txt";
+    ASSERT_TRUE(AsyncWriter::canWrite(fileName));
+    std::string text = "first\n";
+    AsyncWriter::write(fileName, text, true);
+    EXPECT_TRUE(text.empty());
+    std::ostringstream line;
+    line.precision(3);
+    for (int i = 0; i < 100; ++i) {
+      line << i << " " << i / 3.0 << "\n";
+      AsyncWriter::write(fileName, line);
+    }
+    AsyncWriter::flush();
+    const std::string written = readAll(fileName);
+    EXPECT_EQ(0U, written.find("first\n0 0\n1 0.333\n"));
+    EXPECT_EQ(written.size() - 6, written.rfind("99 33\n"));
+    std::remove(fileName.c_str());
+  }
+
+  TEST(AsyncWriterTest, TruncatesAnOpenFile) {
+    const std::string fileName = "AsyncWriterTest2.txt";
+    std::string text = "old contents\n";
+    AsyncWriter::write(fileName, text, true);
+    text = "new\n";
+    AsyncWriter::write(fileName, text, true);
+    text = "more\n";
+    AsyncWriter::write(fileName, text);
+    AsyncWriter::flush();
+    EXPECT_EQ("new\nmore\n", readAll(fileName));
+    std::remove(fileName.c_str());
+  }
+
+  TEST(AsyncWriterTest, EmptiesAFileWithWritesQueued) {
+    const std::string fileName = "AsyncWriterTest4.txt";
+    std::string text(706, 'x');
+    AsyncWriter::write(fileName, text, true);
+    for (int i = 0; i < 100; ++i) {
+      text = "a line still queued\n";
+      AsyncWriter::write(fileName, text);
+    }
+    AsyncWriter::empty(fileName);
+    EXPECT_EQ("", readAll(fileName));
+    // The next write starts the file afresh
+    text = "after\n";
+    AsyncWriter::write(fileName, text);
+    AsyncWriter::flush();
+    EXPECT_EQ("after\n", readAll(fileName));
+    std::remove(fileName.c_str());
+  }
+
+#if !defined(WIN32)
+  TEST(AsyncWriterTest, WritesFromAForkedChild) {
+    const std::string parentName = "AsyncWriterTest3.txt";
+    const std::string childName = "AsyncWriterTest4.txt";
+    std::string text = "before\n";
+    AsyncWriter::write(parentName, text, true);
+    AsyncWriter::flush();
+    const pid_t pid = fork();
+    ASSERT_LE(0, pid);
+    if (pid == 0) {
+      AsyncWriter::forked();
+      for (int i = 0; i < 3; ++i) {
+        text = "child\n";
+        AsyncWriter::write(childName, text, i == 0);
+      }
+      AsyncWriter::flush();
+      _exit(0);
+    }
+    int status;
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    EXPECT_TRUE(WIFEXITED(status) && (WEXITSTATUS(status) == 0));
+    EXPECT_EQ("child\nchild\nchild\n", readAll(childName));
+    // The parent's files are still its own
+    text = "after\n";
+    AsyncWriter::write(parentName, text);
+    AsyncWriter::flush();
+    EXPECT_EQ("before\nafter\n", readAll(parentName));
+    std::remove(parentName.c_str());
+    std::remove(childName.c_str());
+  }
+#endif
+
+  TEST(AsyncWriterTest, SpotsUnwritableFiles) {
+    EXPECT_FALSE(AsyncWriter::canWrite("no/such/directory/AsyncWriterTest.txt"));
+  }
+
+  TEST(AsyncWriterTest, ChecksWithoutCreatingTheFile) {
+    const std::string fileName = "AsyncWriterTest_check.txt";
+    std::remove(fileName.c_str());
+    EXPECT_TRUE(AsyncWriter::canWrite(fileName));
+    EXPECT_FALSE(std::ifstream(fileName.c_str()).is_open());
+  }
+}
@@ -0,0 +1,85 @@
+/***************************************************************************
+ * BitPatternTest.cpp
+ *
+ *  Copyright 2011 Ben Hocking
+ *  This file is part of the NeuroJet tester AllTests.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#include <stdexcept>
+
+#include "ArgFuncts.hpp"
+#include "BitPattern.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+  TEST(BitPatternTest, SetsAndCountsAcrossWords) {
+    BitPattern p(130);
+    EXPECT_EQ(3U, p.numWords());
+    p[0] = true;
+    p.set(63);
+    p.set(64);
+    p.at(129) = true;
+    EXPECT_TRUE(p[63]);
+    EXPECT_FALSE(p[62]);
+    EXPECT_EQ(4U, p.count());
+    p.reset(63);
+    EXPECT_EQ(3U, p.count());
+    EXPECT_THROW(p.at(130), std::out_of_range);
+    EXPECT_EQ(130U, BitPattern(130, true).count());
+  }
+
+  TEST(BitPatternTest, WalksSetBits) {
+    BitPattern p(200);
+    const unsigned int on[] = { 3, 64, 65, 127, 199 };
+    for (unsigned int i = 0; i < 5; ++i) p.set(on[i]);
+    unsigned int i = 0;
+    for (BitPattern::size_type n = p.findFirst(); n < p.size(); n = p.findNext(n), ++i) {
+      ASSERT_LT(i, 5U);
+      EXPECT_EQ(on[i], n);
+    }
+    EXPECT_EQ(5U, i);
+    EXPECT_EQ(64U, p.findFrom(4));
+    EXPECT_EQ(70U, BitPattern(70).findFirst());
+  }
+
+  TEST(BitPatternTest, CombinesWordsAtATime) {
+    BitPattern a(100);
+    BitPattern b(100);
+    a.set(1);
+    a.set(70);
+    a.set(99);
+    b.set(70);
+    b.set(98);
+    EXPECT_EQ(1U, a.countAnd(b));
+    EXPECT_EQ(1U, (a & b).count());
+    EXPECT_TRUE((a & b)[70]);
+    EXPECT_EQ(4U, (a | b).count());
+    EXPECT_FALSE(a == b);
+  }
+
+  TEST(BitPatternTest, TransposesSequences) {
+    UIPtnSequence seq(3);
+    seq[0].push_back(1);
+    seq[2].push_back(0);
+    seq[2].push_back(4);
+    const Sequence t = transposeMatrix(UISeqToPtnSeq(seq, 5));
+    ASSERT_EQ(5U, t.size());
+    EXPECT_EQ(3U, t[0].size());
+    EXPECT_TRUE(t[1][0]);
+    EXPECT_TRUE(t[0][2]);
+    EXPECT_TRUE(t[4][2]);
+    EXPECT_EQ(0U, t[3].count());
+  }
+}
@@ -0,0 +1,186 @@
+/***************************************************************************
+ * ChunkedFileTest.cpp
+ *
+ *  Copyright 2011 Ben Hocking
+ *  This file is part of the NeuroJet tester AllTests.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "AsyncWriter.hpp"
+#include "ChunkedFile.hpp"
+#include "TextWriter.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+  void writeFile(const std::string &fileName, const std::string &bytes) {
+    std::ofstream out(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), bytes.size());
+  }
+
+  PackedSequence makeSequence(const unsigned int numPatterns) {
+    PackedSequence seq;
+    UIVector pat;
+    for (unsigned int t = 0; t < numPatterns; ++t) {
+      pat.clear();
+      // Not in order, to check the order is kept
+      pat.push_back((t * 7) % 50);
+      if (t % 3 != 0) pat.push_back(t % 5);
+      if (t % 4 == 0) pat.push_back(49);
+      seq.push_back(pat);
+    }
+    return seq;
+  }
+
+  TEST(ChunkedFileTest, SequenceRoundTrip) {
+    const std::string fileName = "ChunkedFileTest.seq";
+    const PackedSequence seq = makeSequence(25);
+    std::string bytes;
+    ChunkedFile::encode("mySeq", seq, 50, 4, bytes);
+    writeFile(fileName, bytes);
+
+    EXPECT_TRUE(ChunkedFile::isChunked(fileName));
+    ChunkedFile::Info info;
+    ASSERT_TRUE(ChunkedFile::readInfo(fileName, info));
+    EXPECT_EQ('S', info.Kind);
+    EXPECT_EQ("mySeq", info.Name);
+    EXPECT_EQ(25U, info.NumRows);
+    EXPECT_EQ(50U, info.NumCols);
+    EXPECT_EQ(4U, info.RowsPerChunk);
+    EXPECT_EQ(7U, info.NumChunks);
+
+    PackedSequence readBack;
+    ASSERT_TRUE(ChunkedFile::read(fileName, 0, 1000, readBack));
+    ASSERT_EQ(seq.size(), readBack.size());
+    for (unsigned int t = 0; t < seq.size(); ++t) {
+      EXPECT_EQ(seq[t], readBack[t]) << "pattern " << t;
+    }
+
+    // Rows 6..13 span chunks 1 to 3
+    ASSERT_TRUE(ChunkedFile::read(fileName, 6, 13, readBack));
+    ASSERT_EQ(8U, readBack.size());
+    for (unsigned int t = 0; t < readBack.size(); ++t) {
+      EXPECT_EQ(seq[t + 6], readBack[t]) << "pattern " << t + 6;
+    }
+
+    // A sequence file is not a matrix
+    DenseMatrix rows;
+    EXPECT_FALSE(ChunkedFile::read(fileName, 0, 1, rows));
+    std::remove(fileName.c_str());
+  }
+
+  TEST(ChunkedFileTest, RaggedMatrixRoundTrip) {
+    const std::string fileName = "ChunkedFileTest.mat";
+    DenseMatrix rows;
+    for (unsigned int r = 0; r < 10; ++r) {
+      DenseMatrix::Row row = rows.addRow(2 + r % 3);
+      for (unsigned int c = 0; c < row.size(); ++c) {
+        row[c] = (c == 0) ? 1.5f : -0.125f * (r + c);
+      }
+    }
+    std::string bytes;
+    ChunkedFile::encode("myMat", 'A', rows, 3, bytes);
+    writeFile(fileName, bytes);
+
+    ChunkedFile::Info info;
+    ASSERT_TRUE(ChunkedFile::readInfo(fileName, info));
+    EXPECT_EQ('A', info.Kind);
+    EXPECT_EQ(10U, info.NumRows);
+    EXPECT_EQ(4U, info.NumCols);
+
+    DenseMatrix readBack;
+    ASSERT_TRUE(ChunkedFile::read(fileName, 2, 7, readBack));
+    ASSERT_EQ(6U, readBack.size());
+    for (unsigned int r = 0; r < readBack.size(); ++r) {
+      ASSERT_EQ(rows[r + 2].size(), readBack[r].size());
+      for (unsigned int c = 0; c < readBack[r].size(); ++c) {
+        EXPECT_EQ(rows[r + 2][c], readBack[r][c]);
+      }
+    }
+    // Past the end gives nothing
+    ASSERT_TRUE(ChunkedFile::read(fileName, 10, 12, readBack));
+    EXPECT_EQ(0U, readBack.size());
+    std::remove(fileName.c_str());
+  }
+
+  TEST(ChunkedFileTest, RepeatedValuesCompress) {
+    DenseMatrix rows;
+    for (unsigned int r = 0; r < 100; ++r) {
+      DenseMatrix::Row row = rows.addRow(100);
+      for (unsigned int c = 0; c < row.size(); ++c) row[c] = (c == r) ? 1.0f : 0.25f;
+    }
+    std::string bytes;
+    ChunkedFile::encode("m", 'M', rows, 50, bytes);
+    EXPECT_LT(bytes.size(), rows.size() * 100 * sizeof(float) / 10);
+  }
+
+  TEST(ChunkedFileTest, StreamsTheSameBytesToAFile) {
+    const std::string fileName = "ChunkedFileTest_stream.seq";
+    const PackedSequence seq = makeSequence(25);
+    std::string bytes;
+    ChunkedFile::encode("mySeq", seq, 50, 4, bytes);
+    {
+      TextWriter text(fileName, true);
+      ChunkedFile::encode("mySeq", seq, 50, 4, text);
+    }
+    AsyncWriter::flush();
+    std::ifstream in(fileName.c_str(), std::ios::in | std::ios::binary);
+    const std::string written((std::istreambuf_iterator<char>(in)),
+                              std::istreambuf_iterator<char>());
+    EXPECT_EQ(bytes, written);
+    std::remove(fileName.c_str());
+  }
+
+  TEST(ChunkedFileTest, RejectsBadHeaders) {
+    const std::string fileName = "ChunkedFileTest_bad.seq";
+    std::string bytes;
+    ChunkedFile::encode("mySeq", makeSequence(25), 50, 4, bytes);
+    // The tag, kind, name size, name, rows, columns, rows per chunk and
+    // number of chunks
+    const std::size_t nameSizeAt = 12;
+    const std::size_t numChunksAt = nameSizeAt + 4 + 5 + 12;
+    ChunkedFile::Info info;
+    PackedSequence seq;
+
+    std::string fewerChunks(bytes);
+    fewerChunks[numChunksAt] = 6;
+    writeFile(fileName, fewerChunks);
+    EXPECT_FALSE(ChunkedFile::readInfo(fileName, info));
+    EXPECT_FALSE(ChunkedFile::read(fileName, 0, 24, seq));
+
+    std::string longName(bytes);
+    longName[nameSizeAt + 3] = 0x7F;
+    writeFile(fileName, longName);
+    EXPECT_FALSE(ChunkedFile::readInfo(fileName, info));
+    EXPECT_FALSE(ChunkedFile::read(fileName, 0, 24, seq));
+
+    writeFile(fileName, bytes);
+    EXPECT_TRUE(ChunkedFile::readInfo(fileName, info));
+    EXPECT_EQ(7U, info.NumChunks);
+    std::remove(fileName.c_str());
+  }
+
+  TEST(ChunkedFileTest, OtherFilesAreNotChunked) {
+    const std::string fileName = "ChunkedFileTest.txt";
+    writeFile(fileName, "1 0 1\n");
+    EXPECT_FALSE(ChunkedFile::isChunked(fileName));
+    ChunkedFile::Info info;
+    EXPECT_FALSE(ChunkedFile::readInfo(fileName, info));
+    std::remove(fileName.c_str());
+  }
+}
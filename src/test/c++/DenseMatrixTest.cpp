@@ -0,0 +1,83 @@
+/***************************************************************************
+ * DenseMatrixTest.cpp
+ *
+ *  Copyright 2011 Ben Hocking
+ *  This file is part of the NeuroJet tester AllTests.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#include "DenseMatrix.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+  DataMatrix raggedMatrix() {
+    DataMatrix toReturn(3);
+    toReturn[0].push_back(1.0f);
+    toReturn[0].push_back(2.0f);
+    toReturn[1].push_back(3.0f);
+    toReturn[2].push_back(4.0f);
+    toReturn[2].push_back(5.0f);
+    toReturn[2].push_back(6.0f);
+    return toReturn;
+  }
+
+  TEST(DenseMatrixTest, RoundTripsRaggedDataMatrix) {
+    const DataMatrix original = raggedMatrix();
+    const DenseMatrix dense(original);
+    ASSERT_EQ(3U, dense.size());
+    EXPECT_EQ(3U, dense.stride());
+    EXPECT_FALSE(dense.isRectangular());
+    EXPECT_EQ(1U, dense[1].size());
+    EXPECT_EQ(6.0f, dense[2][2]);
+    EXPECT_TRUE(original == dense.toDataMatrix());
+  }
+
+  TEST(DenseMatrixTest, TransposedViewPadsShortRows) {
+    const DenseMatrix dense(raggedMatrix());
+    const MatrixView t = dense.view().transpose();
+    ASSERT_EQ(3U, t.rows());
+    ASSERT_EQ(3U, t.cols());
+    EXPECT_EQ(2.0f, t(1, 0));
+    EXPECT_EQ(0.0f, t(1, 1));
+    EXPECT_EQ(5.0f, t(1, 2));
+    const DenseMatrix copied(t.block(0, 2, 1, 2));
+    EXPECT_EQ(3.0f, copied[0][0]);
+    EXPECT_EQ(5.0f, copied[1][1]);
+  }
+
+  TEST(DenseMatrixTest, AppendGrowsRowsInPlace) {
+    DenseMatrix growing(DataMatrix(2));
+    for (unsigned int t = 0; t < 100; ++t) {
+      growing.append(0, static_cast<float>(t));
+      growing.append(1, static_cast<float>(2 * t));
+    }
+    EXPECT_EQ(100U, growing[0].size());
+    EXPECT_EQ(99.0f, growing[0].back());
+    EXPECT_EQ(198.0f, growing[1].back());
+    growing.shrinkToFit();
+    EXPECT_EQ(100U, growing.stride());
+    EXPECT_TRUE(growing.view().isContiguous());
+  }
+
+  TEST(DenseMatrixTest, ConvertsSequencesRowByRow) {
+    UIPtnSequence seq(2);
+    seq[0].push_back(1);
+    seq[1].push_back(0);
+    seq[1].push_back(4);
+    DenseMatrix dense;
+    UISeqToMatrix(seq, dense);
+    EXPECT_TRUE(UISeqToMatrix(seq) == dense.toDataMatrix());
+    EXPECT_TRUE(seq == MatrixToUISeq(dense));
+  }
+}
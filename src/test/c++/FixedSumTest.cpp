@@ -0,0 +1,58 @@
+/***************************************************************************
+ * FixedSumTest.cpp
+ *
+ *  Copyright 2011 Ben Hocking
+ *  This file is part of the NeuroJet tester AllTests.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#include "FixedSum.hpp"
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace {
+  TEST(FixedSumTest, SplitSumsMatchWholeSum) {
+    // Terms of very different sizes, where float sums depend on the order
+    std::vector<float> terms;
+    for (unsigned int i = 0; i < 1000; ++i) {
+      terms.push_back((i % 7 == 0) ? 1000.0f + i : 1.0f / (i + 3));
+    }
+    FixedBus whole;
+    whole.assign(1);
+    for (unsigned int i = 0; i < terms.size(); ++i) whole[0] += terms[i];
+
+    // Three parts, each summed backwards, then combined
+    FixedBus total;
+    total.assign(1);
+    const unsigned int bounds[4] = { 0, 123, 600, 1000 };
+    for (unsigned int part = 0; part < 3; ++part) {
+      FixedBus partial;
+      partial.assign(1);
+      for (unsigned int i = bounds[part + 1]; i > bounds[part]; --i) {
+        partial[0] += terms[i - 1];
+      }
+      total.add(partial, 0, 1);
+    }
+    std::vector<float> a, b;
+    whole.copyTo(a);
+    total.copyTo(b);
+    EXPECT_EQ(a[0], b[0]);
+  }
+
+  TEST(FixedSumTest, RoundTripsFloats) {
+    EXPECT_EQ(0.5f, fromFixedSum(toFixedSum(0.5f)));
+    EXPECT_EQ(-2.25f, fromFixedSum(toFixedSum(-2.25f)));
+    EXPECT_NEAR(0.1f, fromFixedSum(toFixedSum(0.1f)), 1e-9);
+  }
+}
@@ -34,4 +34,140 @@ namespace {
       EXPECT_LE(val, high) << "Generated value " << val << " should be less than or equal to " << high;
     }
   }
+
+  TEST(NoiseTest, VectorFillsMatchScalarDraws) {
+    const char types[3] = {'t', 'p', 'x'};
+    for (int t = 0; t < 3; ++t) {
+      Noise scalar(4380, types[t]);
+      Noise bulk(4380, types[t]);
+      // Odd sizes so that fills straddle the generators' block boundaries
+      double vec[77];
+      int coins[31];
+      for (int rep = 0; rep < 3; ++rep) {
+        bulk.Uniform(vec, 77, -1.0, 2.0);
+        for (int i = 0; i < 77; ++i) {
+          EXPECT_DOUBLE_EQ(scalar.Uniform(-1.0, 2.0), vec[i]) << types[t] << " uniform " << i;
+        }
+        bulk.Bernoulli(coins, 31, 0.25);
+        for (int i = 0; i < 31; ++i) {
+          EXPECT_EQ(scalar.Bernoulli(0.25), coins[i] != 0) << types[t] << " bernoulli " << i;
+        }
+      }
+    }
+  }
+
+  TEST(NoiseTest, PerElementBernoulliOnlyDrawsBelowOne) {
+    Noise scalar(4380);
+    Noise bulk(4380);
+    const float rates[6] = {0.5f, 1.0f, 0.1f, 1.0f, 1.0f, 0.9f};
+    int coins[6];
+    bulk.Bernoulli(coins, rates, 6);
+    for (int i = 0; i < 6; ++i) {
+      EXPECT_EQ(scalar.Bernoulli(rates[i]), coins[i] != 0);
+    }
+    // Both must have consumed the same number of values
+    EXPECT_DOUBLE_EQ(scalar.Uniform(0.0, 1.0), bulk.Uniform(0.0, 1.0));
+  }
+
+  TEST(NoiseTest, PhiloxMatchesKnownAnswer) {
+    // Philox4x32-10 with a zero key and counter (Random123 test vector)
+    Noise instance;
+    instance.ResetStream(0, 0);
+    const unsigned int expected[4] = {0x6627e8d5U, 0xe169c58dU, 0xbc57ac4cU, 0x9b00dbd8U};
+    for (int i = 0; i < 4; ++i) {
+      EXPECT_DOUBLE_EQ((expected[i] + 0.5) / 4294967296.0, instance.Uniform(0.0, 1.0));
+    }
+  }
+
+  TEST(NoiseTest, PhiloxSubstreamsAreRepeatable) {
+    Noise instance(4380, 'p');
+    EXPECT_TRUE(instance.IsCounterBased());
+    instance.ResetStream(4380, NS_SynFail, 17, 42);
+    double first[10];
+    instance.Uniform(first, 10, 0.0, 1.0);
+    // Visiting other substreams in between must not matter
+    instance.SetStream(18, 42);
+    EXPECT_NE(first[0], instance.Uniform(0.0, 1.0));
+    instance.SetStream(17, 42);
+    for (int i = 0; i < 10; ++i) {
+      EXPECT_DOUBLE_EQ(first[i], instance.Uniform(0.0, 1.0));
+    }
+    // A separately constructed generator agrees
+    Noise other;
+    other.ResetStream(4380, NS_SynFail, 17, 42);
+    EXPECT_DOUBLE_EQ(first[0], other.Uniform(0.0, 1.0));
+    // but not once it has moved to a new epoch
+    other.NextEpoch();
+    other.SetStream(17, 42);
+    EXPECT_NE(first[0], other.Uniform(0.0, 1.0));
+  }
+
+  TEST(NoiseTest, ZigguratHasUnitMoments) {
+    Noise instance(4380);
+    instance.SetNormalMethod('z');
+    const int n = 200000;
+    double sum = 0.0, sumSq = 0.0;
+    for (int i = 0; i < n; ++i) {
+      const double x = instance.Normal(0.0, 1.0);
+      sum += x;
+      sumSq += x * x;
+    }
+    EXPECT_NEAR(0.0, sum / n, 0.01);
+    EXPECT_NEAR(1.0, sumSq / n, 0.02);
+  }
+
+  TEST(NoiseTest, TruncNormalStaysInBounds) {
+    Noise instance(4380);
+    instance.SetNormalMethod('z');
+    // straddling the mean, narrow, and far out in either tail
+    const double bounds[4][2] = {{-0.5, 0.5}, {0.4, 0.45}, {4.0, 10.0}, {-8.0, -5.0}};
+    for (int b = 0; b < 4; ++b) {
+      for (int i = 0; i < 1000; ++i) {
+        const double x = instance.TruncNormal(0.0, 1.0, bounds[b][0], bounds[b][1]);
+        EXPECT_LE(bounds[b][0], x);
+        EXPECT_GE(bounds[b][1], x);
+      }
+    }
+  }
+
+  TEST(NoiseTest, BoxMullerTruncNormalMatchesRejection) {
+    Noise instance(4380);
+    Noise other(4380);
+    for (int i = 0; i < 100; ++i) {
+      double x = other.Normal(0.5, 0.2);
+      while ((x < 0.3) || (x > 0.6)) x = other.Normal(0.5, 0.2);
+      EXPECT_DOUBLE_EQ(x, instance.TruncNormal(0.5, 0.2, 0.3, 0.6));
+    }
+  }
+
+  TEST(NoiseTest, PrefetchDoesNotChangeDraws) {
+    const char types[2] = {'t', 'x'};
+    for (int t = 0; t < 2; ++t) {
+      Noise instance(4380, types[t]);
+      Noise other(4380, types[t]);
+#if defined(RNG_PREFETCH)
+      EXPECT_TRUE(instance.StartPrefetch(4));
+#else
+      EXPECT_FALSE(instance.StartPrefetch(4));
+#endif
+      double vec[37], vec2[37];
+      for (int i = 0; i < 2000; ++i) {
+        if (i == 1000) instance.StopPrefetch();  // the ring is used up first
+        if (i == 1500) instance.StartPrefetch(2);
+        EXPECT_DOUBLE_EQ(other.Uniform(0.0, 1.0), instance.Uniform(0.0, 1.0));
+        EXPECT_EQ(other.Bernoulli(0.3), instance.Bernoulli(0.3));
+        other.Uniform(vec, 37, 0.0, 1.0);
+        instance.Uniform(vec2, 37, 0.0, 1.0);
+        EXPECT_DOUBLE_EQ(vec[0], vec2[0]);
+        EXPECT_DOUBLE_EQ(vec[36], vec2[36]);
+      }
+#if defined(RNG_PREFETCH)
+      EXPECT_LT(0UL, instance.PrefetchUsed());
+#endif
+      EXPECT_GE(instance.PrefetchUsed(), instance.PrefetchStarved());
+    }
+    // Counter-based substreams are picked by the caller
+    Noise philox(4380, 'p');
+    EXPECT_FALSE(philox.StartPrefetch(4));
+  }
 }
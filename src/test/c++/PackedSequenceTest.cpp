@@ -0,0 +1,104 @@
+/***************************************************************************
+ * PackedSequenceTest.cpp
+ *
+ *  Copyright 2011 Ben Hocking
+ *  This file is part of the NeuroJet tester AllTests.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#include "PackedSequence.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+  UIPtnSequence sampleSequence() {
+    UIPtnSequence toReturn(4);
+    toReturn[0].push_back(2);
+    toReturn[0].push_back(5);
+    toReturn[0].push_back(300);
+    // toReturn[1] is empty
+    toReturn[2].push_back(0);
+    toReturn[2].push_back(4000000000U);
+    toReturn[3].push_back(7);
+    toReturn[3].push_back(3);  // out of order
+    return toReturn;
+  }
+
+  TEST(PackedSequenceTest, RoundTripsPatterns) {
+    const UIPtnSequence original = sampleSequence();
+    const PackedSequence packed(original);
+    ASSERT_EQ(original.size(), packed.size());
+    EXPECT_TRUE(original == packed.toUIPtnSequence());
+    EXPECT_TRUE(original[3] == packed[3]);
+    EXPECT_TRUE(packed[1].empty());
+    EXPECT_EQ(3U, packed.numSpikes(0));
+    EXPECT_EQ(2U, packed.numSpikes(2));
+  }
+
+  TEST(PackedSequenceTest, IteratesLikeUIPtnSequence) {
+    const UIPtnSequence original = sampleSequence();
+    const PackedSequence packed(original);
+    UIPtnSequenceCIt expected = original.begin();
+    for (PackedSequence::const_iterator it = packed.begin(); it != packed.end();
+         ++it, ++expected) {
+      EXPECT_EQ(expected->size(), it->size());
+      EXPECT_TRUE(*expected == *it);
+    }
+    EXPECT_EQ(300U, packed.front().back());
+  }
+
+  TEST(PackedSequenceTest, IteratorDecodesAgainOnlyAfterMoving) {
+    const UIPtnSequence original = sampleSequence();
+    const PackedSequence packed(original);
+    PackedSequence::const_iterator it = packed.begin();
+    EXPECT_EQ(original[0].size(), it->size());
+    EXPECT_EQ(original[0].back(), it->back());
+    PackedSequence::const_iterator next = it;
+    ++next;
+    EXPECT_TRUE(next->empty());
+    next += 2;
+    EXPECT_TRUE(original[3] == *next.operator->());
+    --next;
+    EXPECT_TRUE(original[2] == *next.operator->());
+    EXPECT_EQ(original[0].size(), it->size());
+  }
+
+  TEST(PackedSequenceTest, SortedSmallGapsTakeOneBytePerSpike) {
+    PackedSequence packed;
+    UIVector pat;
+    for (unsigned int i = 0; i < 1000; i += 10) pat.push_back(i);
+    packed.push_back(pat);
+    EXPECT_EQ(pat.size(), packed.packedBytes());
+  }
+
+  TEST(PackedSequenceTest, AppendsPatterns) {
+    const UIPtnSequence original = sampleSequence();
+    PackedSequence packed(UIPtnSequence(original.begin(), original.begin() + 2));
+    packed.append(PackedSequence(UIPtnSequence(original.begin() + 2, original.end())));
+    EXPECT_TRUE(packed == PackedSequence(original));
+  }
+
+  TEST(PackedSequenceTest, ConvertsWithoutUnpacking) {
+    UIPtnSequence original(3);
+    original[0].push_back(1);
+    original[2].push_back(0);
+    original[2].push_back(4);
+    const PackedSequence packed(original);
+    EXPECT_TRUE(UISeqToPtnSeq(original) == UISeqToPtnSeq(packed));
+    EXPECT_TRUE(UISeqToPtnSeq(original, 8) == UISeqToPtnSeq(packed, 8));
+    DenseMatrix fromPacked;
+    UISeqToMatrix(packed, fromPacked, 6);
+    EXPECT_TRUE(UISeqToMatrix(original, 6) == fromPacked.toDataMatrix());
+    EXPECT_TRUE(packed == MatrixToPackedSeq(fromPacked));
+  }
+}
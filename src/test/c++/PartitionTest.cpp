@@ -0,0 +1,56 @@
+/***************************************************************************
+ * PartitionTest.cpp
+ *
+ *  Copyright 2011 Ben Hocking
+ *  This file is part of the NeuroJet tester AllTests.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#include "Partition.hpp"
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace {
+  TEST(PartitionTest, EvenSplitGivesRemainderToFirstParts) {
+    std::vector<unsigned int> bounds = partitionEvenly(10, 3);
+    ASSERT_EQ(4u, bounds.size());
+    EXPECT_EQ(0u, bounds[0]);
+    EXPECT_EQ(4u, bounds[1]);
+    EXPECT_EQ(7u, bounds[2]);
+    EXPECT_EQ(10u, bounds[3]);
+  }
+
+  TEST(PartitionTest, CostSplitBalancesHeavyNeurons) {
+    // The first quarter of the neurons costs three times as much
+    std::vector<double> cost(100, 1.0);
+    for (unsigned int i = 0; i < 25; ++i) cost[i] = 3.0;
+    std::vector<unsigned int> even = partitionEvenly(cost.size(), 4);
+    std::vector<unsigned int> bounds = partitionByCost(cost, 4);
+    ASSERT_EQ(5u, bounds.size());
+    EXPECT_EQ(0u, bounds[0]);
+    EXPECT_EQ(100u, bounds[4]);
+    for (unsigned int p = 0; p < 4; ++p) EXPECT_LT(bounds[p], bounds[p + 1]);
+    EXPECT_LT(partitionImbalance(cost, bounds), 1.05);
+    EXPECT_GT(partitionImbalance(cost, even), 1.5);
+  }
+
+  TEST(PartitionTest, CostSplitKeepsEveryPartNonEmpty) {
+    // One neuron holds nearly all of the cost
+    std::vector<double> cost(6, 0.001);
+    cost[0] = 1000.0;
+    std::vector<unsigned int> bounds = partitionByCost(cost, 4);
+    for (unsigned int p = 0; p < 4; ++p) EXPECT_LT(bounds[p], bounds[p + 1]);
+    EXPECT_EQ(1u, bounds[1]);
+  }
+}
@@ -0,0 +1,48 @@
+/***************************************************************************
+ * ProgramTest.cpp
+ *
+ *  Copyright 2011 Ben Hocking
+ *  This file is part of the NeuroJet tester AllTests.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#include "Program.hpp"
+#include "gtest/gtest.h"
+
+#include "SystemVar.hpp"
+
+namespace {
+  TEST(ProgramTest, ConnectSubrangesDrawDifferentWeights) {
+    SystemVar::SetIntVar("seed", 4380);
+    SystemVar::SetStrVar("RNGType", "Philox");
+    SystemVar::SetStrVar("NormalMethod", "BoxMuller");
+    SystemVar::SetIntVar("RNGPrefetch", 0);
+    program pgm;
+    pgm.setAllSeeds();
+    // Each node draws its own share of neuron 5's fan-in
+    const int numWeights = 8;
+    double node0[numWeights], node1[numWeights], again[numWeights];
+    ASSERT_TRUE(pgm.setConnectStream(5, 0));
+    pgm.getWeightUniform(node0, numWeights, 0.0, 1.0);
+    ASSERT_TRUE(pgm.setConnectStream(5, 1));
+    pgm.getWeightUniform(node1, numWeights, 0.0, 1.0);
+    ASSERT_TRUE(pgm.setConnectStream(5, 0));
+    pgm.getWeightUniform(again, numWeights, 0.0, 1.0);
+    for (int i = 0; i < numWeights; ++i) {
+      EXPECT_NE(node0[i], node1[i]) << "at weight " << i;
+      EXPECT_DOUBLE_EQ(node0[i], again[i]) << "at weight " << i;
+    }
+    SystemVar::SetStrVar("RNGType", "TT800");
+  }
+}
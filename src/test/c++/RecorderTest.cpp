@@ -0,0 +1,106 @@
+/***************************************************************************
+ * RecorderTest.cpp
+ *
+ *  Copyright 2011 Ben Hocking
+ *  This file is part of the NeuroJet tester AllTests.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#include <cstdio>
+
+#include "Recorder.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+  // Records steps rows of 4 values, row t holding 10 * t + column
+  void recordSteps(Recorder &rec, const unsigned int steps) {
+    DataList row(4);
+    for (unsigned int t = 0; t < steps; ++t) {
+      for (unsigned int c = 0; c < row.size(); ++c) row[c] = 10.0f * t + c;
+      rec.record(row);
+    }
+  }
+
+  TEST(RecorderTest, MemoryKeepsEveryRow) {
+    Recorder rec;
+    recordSteps(rec, 5);
+    DenseMatrix kept;
+    ASSERT_TRUE(rec.finish(kept));
+    ASSERT_EQ(5U, kept.size());
+    EXPECT_EQ(4U, kept[0].size());
+    EXPECT_FLOAT_EQ(43.0f, kept[4][3]);
+    EXPECT_EQ(5UL, rec.numKept());
+  }
+
+  TEST(RecorderTest, RingKeepsLastRowsInOrder) {
+    Recorder::Spec spec;
+    spec.Sink = Recorder::SINK_RING;
+    spec.RingSize = 3;
+    Recorder rec(spec);
+    recordSteps(rec, 7);
+    DenseMatrix kept;
+    ASSERT_TRUE(rec.finish(kept));
+    ASSERT_EQ(3U, kept.size());
+    EXPECT_FLOAT_EQ(40.0f, kept[0][0]);
+    EXPECT_FLOAT_EQ(50.0f, kept[1][0]);
+    EXPECT_FLOAT_EQ(60.0f, kept[2][0]);
+  }
+
+  TEST(RecorderTest, DecimatesAndSlices) {
+    Recorder::Spec spec;
+    spec.Every = 2;
+    spec.FirstN = 2;
+    spec.LastN = 3;
+    Recorder rec(spec);
+    recordSteps(rec, 5);
+    DenseMatrix kept;
+    ASSERT_TRUE(rec.finish(kept));
+    ASSERT_EQ(3U, kept.size());
+    ASSERT_EQ(2U, kept[1].size());
+    EXPECT_FLOAT_EQ(21.0f, kept[1][0]);
+    EXPECT_FLOAT_EQ(42.0f, kept[2][1]);
+  }
+
+  TEST(RecorderTest, NoneKeepsNothing) {
+    Recorder rec(Recorder::getSpec("NoSuchBuffer", false));
+    EXPECT_FALSE(rec.isRecording());
+    recordSteps(rec, 3);
+    DenseMatrix kept;
+    EXPECT_FALSE(rec.finish(kept));
+    EXPECT_TRUE(kept.empty());
+  }
+
+  TEST(RecorderTest, FileRoundTrips) {
+    const std::string fileName = "RecorderTest.njrec";
+    Recorder::Spec spec;
+    spec.Sink = Recorder::SINK_FILE;
+    spec.FileName = fileName;
+    spec.ChunkSize = 2;
+    {
+      Recorder rec(spec);
+      recordSteps(rec, 5);
+      DenseMatrix kept;
+      EXPECT_FALSE(rec.finish(kept));
+      EXPECT_TRUE(kept.empty());
+    }
+    DenseMatrix rows;
+    ASSERT_TRUE(Recorder::readFile(fileName, rows));
+    ASSERT_EQ(5U, rows.size());
+    EXPECT_FLOAT_EQ(0.0f, rows[0][0]);
+    EXPECT_FLOAT_EQ(32.0f, rows[3][2]);
+    EXPECT_FLOAT_EQ(43.0f, rows[4][3]);
+    std::remove(fileName.c_str());
+    EXPECT_FALSE(Recorder::readFile(fileName, rows));
+  }
+}
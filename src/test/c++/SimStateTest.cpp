@@ -0,0 +1,128 @@
+/***************************************************************************
+ * SimStateTest.cpp
+ *
+ *  Copyright 2011 Ben Hocking
+ *  This file is part of the NeuroJet tester AllTests.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Noise.hpp"
+#include "SimState.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+  TEST(SimStateTest, ReadsSectionsInAnyOrder) {
+    const std::string fileName = "SimStateTest.state";
+    std::remove(fileName.c_str());
+    std::vector<float> weights;
+    weights.push_back(0.5f);
+    weights.push_back(-0.0f);
+    std::deque<unsigned int> history;
+    history.push_back(3);
+    history.push_back(7);
+    {
+      SimState state;
+      state.beginSection("ONE");
+      state.put<int>(-12);
+      state.putVector(weights);
+      state.putString("name");
+      state.beginSection("TWO");
+      state.putDeque(history);
+      state.putBool(true);
+      ASSERT_TRUE(state.write(fileName));
+    }
+
+    SimState state;
+    ASSERT_TRUE(state.read(fileName));
+    ASSERT_TRUE(state.section("TWO"));
+    std::deque<unsigned int> historyBack;
+    state.getDeque(historyBack);
+    EXPECT_TRUE(historyBack == history);
+    EXPECT_TRUE(state.getBool());
+    EXPECT_TRUE(state.atSectionEnd());
+    ASSERT_TRUE(state.section("ONE"));
+    int val = 0;
+    state.get(val);
+    EXPECT_EQ(-12, val);
+    std::vector<float> weightsBack;
+    state.getVector(weightsBack);
+    ASSERT_EQ(2U, weightsBack.size());
+    EXPECT_EQ(0.5f, weightsBack[0]);
+    EXPECT_LT(1.0f / weightsBack[1], 0.0f);
+    std::string name;
+    state.getString(name);
+    EXPECT_EQ("name", name);
+    EXPECT_FALSE(state.failed());
+
+    // Reading past the end of a section, or a section that is not there, fails
+    state.get(val);
+    EXPECT_TRUE(state.failed());
+    SimState other;
+    ASSERT_TRUE(other.read(fileName));
+    EXPECT_FALSE(other.section("SYN"));
+    EXPECT_TRUE(other.failed());
+
+    // A file cut short is refused
+    std::ifstream in(fileName.c_str(), std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    std::ofstream out(fileName.c_str(), std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), contents.size() - 1);
+    out.close();
+    EXPECT_FALSE(other.read(fileName));
+    std::remove(fileName.c_str());
+    EXPECT_FALSE(other.read(fileName));
+  }
+
+  TEST(SimStateTest, NoiseGoesOnWhereItWasSaved) {
+    const std::string fileName = "SimStateTest2.state";
+    const char types[3] = {'t', 'p', 'x'};
+    for (int t = 0; t < 3; ++t) {
+      Noise uninterrupted(2011, types[t]);
+      Noise saved(2011, types[t]);
+      // Prefetching both while saving and while loading
+      saved.StartPrefetch(3);
+      for (int i = 0; i < 100; ++i) {
+        EXPECT_DOUBLE_EQ(uninterrupted.Uniform(0.0, 1.0), saved.Uniform(0.0, 1.0));
+      }
+      {
+        SimState state;
+        state.beginSection("RNG");
+        saved.SaveState(state);
+        ASSERT_TRUE(state.write(fileName));
+      }
+      Noise loaded(17, 't');
+      loaded.StartPrefetch(2);
+      SimState state;
+      ASSERT_TRUE(state.read(fileName));
+      ASSERT_TRUE(state.section("RNG"));
+      loaded.LoadState(state);
+      EXPECT_FALSE(state.failed());
+      EXPECT_TRUE(state.atSectionEnd());
+      EXPECT_EQ(types[t], loaded.Type());
+      for (int i = 0; i < 1000; ++i) {
+        const double expected = uninterrupted.Normal(0.0, 1.0);
+        ASSERT_DOUBLE_EQ(expected, saved.Normal(0.0, 1.0)) << types[t] << " " << i;
+        ASSERT_DOUBLE_EQ(expected, loaded.Normal(0.0, 1.0)) << types[t] << " " << i;
+      }
+    }
+    std::remove(fileName.c_str());
+  }
+}
@@ -0,0 +1,131 @@
+/***************************************************************************
+ * SpikeLogTest.cpp
+ *
+ *  Copyright 2011 Ben Hocking
+ *  This file is part of the NeuroJet tester AllTests.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "AsyncWriter.hpp"
+#include "SpikeLog.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+  TEST(SpikeLogTest, ReadsBackSpikesAndSynapses) {
+    const std::string fileName = "SpikeLogTest.njspk";
+    std::remove(fileName.c_str());
+    SpikeLog::Header header;
+    header.NumNeurons = 10;
+    header.HasSynapses = true;
+    header.Origin = 1;
+    header.Dt = 2.5f;
+    header.Cells.push_back(3);
+    {
+      SpikeLog log;
+      log.open(fileName, header);
+      EXPECT_TRUE(log.logs(3));
+      EXPECT_FALSE(log.logs(4));
+      log.beginStep(1);
+      log.spike(3);
+      log.cell(3, 2);
+      log.synapse(7, 0.5f);
+      log.synapse(9, 0.25f);
+      log.beginStep(2);
+      log.cell(3, 0);
+      // A new trial starts back at step 1
+      log.beginStep(1);
+      log.cell(3, 1);
+      log.synapse(0, 1.0f);
+    }
+    AsyncWriter::flush();
+
+    std::vector<SpikeLog::Run> runs;
+    ASSERT_TRUE(SpikeLog::read(fileName, runs));
+    ASSERT_EQ(1U, runs.size());
+    EXPECT_FLOAT_EQ(2.5f, runs[0].Info.Dt);
+    ASSERT_EQ(1U, runs[0].Info.Cells.size());
+    const std::vector<SpikeLog::Step> &steps = runs[0].Steps;
+    ASSERT_EQ(3U, steps.size());
+    EXPECT_EQ(1, steps[0].Time);
+    EXPECT_EQ(2, steps[1].Time);
+    EXPECT_EQ(1, steps[2].Time);
+    ASSERT_EQ(1U, steps[0].Spikes.size());
+    EXPECT_EQ(3U, steps[0].Spikes[0]);
+    ASSERT_EQ(2U, steps[0].Cells[0].Active.size());
+    EXPECT_EQ(9U, steps[0].Cells[0].Active[1].Src);
+
+    std::ostringstream text;
+    SpikeLog::writeCellText(runs, 3, text);
+    EXPECT_EQ("0 0.5 7 0.25 9 -1\n2.5 -1\n0 1 0 -1\n", text.str());
+    std::remove(fileName.c_str());
+  }
+
+  TEST(SpikeLogTest, KeepsQuietStepsOfSparseCells) {
+    const std::string fileName = "SpikeLogTest3.njspk";
+    std::remove(fileName.c_str());
+    SpikeLog::Header header;
+    header.NumNeurons = 100;
+    header.Cells.push_back(17);
+    {
+      SpikeLog log;
+      log.open(fileName, header);
+      // Two trials of 4 steps; neuron 17 fires only on step 3 of the first
+      for (int trial = 0; trial < 2; ++trial) {
+        for (int step = 1; step <= 4; ++step) {
+          log.beginStep(step);
+          if ((trial == 0) && (step == 3)) log.spike(17);
+        }
+      }
+    }
+    AsyncWriter::flush();
+    std::vector<SpikeLog::Run> runs;
+    ASSERT_TRUE(SpikeLog::read(fileName, runs));
+    ASSERT_EQ(1U, runs.size());
+    const std::vector<SpikeLog::Step> &steps = runs[0].Steps;
+    ASSERT_EQ(8U, steps.size());
+    for (unsigned int s = 0; s < steps.size(); ++s) {
+      EXPECT_EQ(static_cast<int>(s % 4) + 1, steps[s].Time);
+      EXPECT_EQ((s == 2) ? 1U : 0U, steps[s].Spikes.size());
+    }
+    std::remove(fileName.c_str());
+  }
+
+  TEST(SpikeLogTest, AppendsRuns) {
+    const std::string fileName = "SpikeLogTest2.njspk";
+    std::remove(fileName.c_str());
+    SpikeLog::Header header;
+    header.NumNeurons = 100;
+    for (int run = 0; run < 2; ++run) {
+      SpikeLog log;
+      header.FirstStep = 10 * run;
+      log.open(fileName, header);
+      log.beginStep(header.FirstStep + 5);
+      log.spike(42 + run);
+    }
+    AsyncWriter::flush();
+    std::vector<SpikeLog::Run> runs;
+    ASSERT_TRUE(SpikeLog::read(fileName, runs));
+    ASSERT_EQ(2U, runs.size());
+    EXPECT_FALSE(runs[1].Info.HasSynapses);
+    EXPECT_EQ(15, runs[1].Steps[0].Time);
+    EXPECT_EQ(43U, runs[1].Steps[0].Spikes[0]);
+    std::remove(fileName.c_str());
+    EXPECT_FALSE(SpikeLog::read(fileName, runs));
+  }
+}
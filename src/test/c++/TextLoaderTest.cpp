@@ -0,0 +1,137 @@
+/***************************************************************************
+ * TextLoaderTest.cpp
+ *
+ *  Copyright 2011 Ben Hocking
+ *  This file is part of the NeuroJet tester AllTests.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "TextLoader.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+  void writeFile(const std::string &fileName, const std::string &text) {
+    std::ofstream out(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    out << text;
+  }
+
+  float streamFloat(const std::string &token) {
+    std::istringstream is(token);
+    float value = 0.0f;
+    is >> value;
+    return value;
+  }
+
+  float fastFloat(const std::string &token) {
+    return TextLoader::parseFloat(token.data(), token.data() + token.size());
+  }
+
+  TEST(TextLoaderTest, ParsesFloatsAsAStreamDoes) {
+    const char *tokens[] = {
+      "0", "1", "-1", "+2.5", "0.1", ".25", "-.75", "3.", "0.333333", "123456.7",
+      "1e3", "1.5E-7", "2.2250738e-38", "1e-45", "3.4028235e38", "1e39", "-1e39",
+      "16777217", "0.1234567890123", "1.2.3", "7abc", "abc", "-", ".", "1e", "1e+",
+      "0x10", "inf", "nan", "00012.50", "1e-400", "99999999999999999999"
+    };
+    for (unsigned int i = 0; i < sizeof(tokens) / sizeof(tokens[0]); ++i) {
+      const float expected = streamFloat(tokens[i]);
+      const float actual = fastFloat(tokens[i]);
+      EXPECT_EQ(0, memcmp(&expected, &actual, sizeof(float)))
+        << tokens[i] << " : " << expected << " != " << actual;
+    }
+    // Every value a pattern of digits can take
+    for (unsigned int i = 0; i < 20000; ++i) {
+      std::ostringstream os;
+      os << (i * 7919U % 100003U) << "." << (i * 104729U % 1000000U);
+      EXPECT_EQ(streamFloat(os.str()), fastFloat(os.str())) << os.str();
+    }
+  }
+
+  TEST(TextLoaderTest, ReadsSequences) {
+    const std::string fileName = "TextLoaderTest.seq";
+    writeFile(fileName, "1 0 1\n\n  \n0 0 0\r\n0 1\n0 0 1");
+    TextLoader loader(fileName);
+    ASSERT_TRUE(loader.isOpen());
+    PackedSequence seq;
+    loader.readSequence(5, 1, seq);
+    EXPECT_FALSE(loader.hasBadChar());
+    // "1 0 1", "0 0 0\r" and "0 0 1" have 5 characters or more
+    EXPECT_EQ(3U, loader.numLongLines());
+    ASSERT_EQ(4U, seq.size());
+    EXPECT_EQ(2U, seq.numSpikes(0));
+    EXPECT_EQ(2U, seq[0][1]);
+    EXPECT_TRUE(seq[1].empty());
+    EXPECT_EQ(1U, seq[2][0]);
+    EXPECT_EQ(2U, seq[3][0]);
+    std::remove(fileName.c_str());
+  }
+
+  TEST(TextLoaderTest, StopsAtABadCharacter) {
+    const std::string fileName = "TextLoaderTest.bad";
+    writeFile(fileName, "1 0\n1 2\n0 x\n");
+    TextLoader loader(fileName);
+    PackedSequence seq;
+    loader.readSequence(100, 1, seq);
+    EXPECT_TRUE(loader.hasBadChar());
+    EXPECT_EQ('2', loader.badChar());
+    std::remove(fileName.c_str());
+  }
+
+  TEST(TextLoaderTest, ReadsRaggedMatrices) {
+    const std::string fileName = "TextLoaderTest.mat";
+    writeFile(fileName, "1.5 -2 .5\n\n3e2\t4\n");
+    TextLoader loader(fileName);
+    DenseMatrix rows;
+    loader.readMatrix(100, 1, rows);
+    EXPECT_EQ(0U, loader.numLongLines());
+    ASSERT_EQ(2U, rows.size());
+    ASSERT_EQ(3U, rows[0].size());
+    EXPECT_EQ(1.5f, rows[0][0]);
+    EXPECT_EQ(-2.0f, rows[0][1]);
+    EXPECT_EQ(0.5f, rows[0][2]);
+    ASSERT_EQ(2U, rows[1].size());
+    EXPECT_EQ(300.0f, rows[1][0]);
+    std::remove(fileName.c_str());
+  }
+
+  TEST(TextLoaderTest, ThreadsReadWhatOneThreadReads) {
+    const std::string fileName = "TextLoaderTest.big";
+    std::ostringstream text;
+    for (unsigned int r = 0; text.tellp() < 3 * static_cast<int>(TextLoader::MinBytesPerThread);
+         ++r) {
+      for (unsigned int c = 0; c < 1 + r % 17; ++c) text << (r * 31 + c) * 0.001f << " ";
+      text << "\n";
+    }
+    writeFile(fileName, text.str());
+    TextLoader loader(fileName);
+    DenseMatrix oneThread;
+    DenseMatrix fourThreads;
+    loader.readMatrix(1000, 1, oneThread);
+    loader.readMatrix(1000, 4, fourThreads);
+    EXPECT_GT(oneThread.size(), 0U);
+    EXPECT_TRUE(oneThread.toDataMatrix() == fourThreads.toDataMatrix());
+    std::remove(fileName.c_str());
+  }
+
+  TEST(TextLoaderTest, MissingFileIsNotOpen) {
+    TextLoader loader("TextLoaderTest.none");
+    EXPECT_FALSE(loader.isOpen());
+  }
+}
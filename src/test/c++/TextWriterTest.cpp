@@ -0,0 +1,125 @@
+/***************************************************************************
+ * TextWriterTest.cpp
+ *
+ *  Copyright 2011 Ben Hocking
+ *  This file is part of the NeuroJet tester AllTests.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include "AsyncWriter.hpp"
+#include "TextWriter.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+  std::string streamed(const float value, const int precision) {
+    std::ostringstream os;
+    os << std::setprecision(precision) << value;
+    return os.str();
+  }
+
+  std::string written(const float value, const int precision) {
+    std::string out;
+    TextWriter::appendFloat(value, precision, out);
+    return out;
+  }
+
+  float bitsToFloat(const unsigned int bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  TEST(TextWriterTest, WritesFloatsAsAStreamDoes) {
+    const float values[] = {
+      0.0f, -0.0f, 1.0f, -1.0f, 0.5f, 2.5f, 0.1f, 1.0f / 3.0f, 123456.0f, 1234567.0f,
+      999999.5f, 9999995.0f, 0.0001f, 0.00001f, 1e-5f, 1e10f, 1e-38f, FLT_MIN,
+      FLT_MAX, -FLT_MAX, 1.4e-45f, 0.000123456f, 100.0f, 1e6f, 65536.0f,
+      // exactly halfway at some precision
+      1.5f, 0.125f, 0.375f, 1024.5f, 12345.5f,
+      std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity()
+    };
+    const int precisions[] = { 1, 2, 4, 6, 9, 15, 17 };
+    for (unsigned int v = 0; v < sizeof(values) / sizeof(values[0]); ++v) {
+      for (unsigned int p = 0; p < sizeof(precisions) / sizeof(precisions[0]); ++p) {
+        EXPECT_EQ(streamed(values[v], precisions[p]), written(values[v], precisions[p]))
+          << "precision " << precisions[p];
+      }
+    }
+    // Floats from all over the range
+    for (unsigned int i = 0; i < 50000; ++i) {
+      const float value = bitsToFloat(i * 2654435761U);
+      if ((value != value) || (value - value != 0.0f)) continue;
+      ASSERT_EQ(streamed(value, 3), written(value, 3));
+      ASSERT_EQ(streamed(value, 6), written(value, 6));
+      ASSERT_EQ(streamed(value, 8), written(value, 8));
+      ASSERT_EQ(streamed(value, 15), written(value, 15));
+    }
+  }
+
+  TEST(TextWriterTest, ShortestReadsBackExactly) {
+    EXPECT_EQ("0.1", written(0.1f, TextWriter::Shortest));
+    EXPECT_EQ("0.33333334", written(1.0f / 3.0f, TextWriter::Shortest));
+    EXPECT_EQ("1234567", written(1234567.0f, TextWriter::Shortest));
+    for (unsigned int i = 0; i < 50000; ++i) {
+      const float value = bitsToFloat(i * 2654435761U);
+      if ((value != value) || (value - value != 0.0f)) continue;
+      const std::string text = written(value, TextWriter::Shortest);
+      std::istringstream is(text);
+      float readBack;
+      is >> readBack;
+      ASSERT_EQ(value, readBack) << text;
+    }
+  }
+
+  TEST(TextWriterTest, WritesToStreamsAndFiles) {
+    std::ostringstream os;
+    {
+      TextWriter text(os, 4);
+      text << 1 << ' ' << -12 << " " << 7U << std::string("x") << 3.14159f << '\n';
+      EXPECT_EQ("", os.str());
+    }
+    EXPECT_EQ("1 -12 7x3.142\n", os.str());
+
+    const std::string fileName = "TextWriterTest.txt";
+    {
+      TextWriter text(fileName, true);
+      text << "old";
+    }
+    {
+      // An empty writer still empties the file
+      TextWriter text(fileName, true);
+    }
+    {
+      TextWriter text(fileName, false);
+      for (unsigned int i = 0; i < TextWriter::ChunkBytes; ++i) text << 'a';
+      text << "end";
+    }
+    AsyncWriter::flush();
+    std::ifstream in(fileName.c_str());
+    std::string contents;
+    std::getline(in, contents);
+    EXPECT_EQ(TextWriter::ChunkBytes + 3, contents.size());
+    EXPECT_EQ("end", contents.substr(contents.size() - 3));
+    std::remove(fileName.c_str());
+  }
+}
@@ -0,0 +1,47 @@
+/***************************************************************************
+ * ThreadTeamTest.cpp
+ *
+ *  Copyright 2011 Ben Hocking
+ *  This file is part of the NeuroJet tester AllTests.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#include "ThreadTeam.hpp"
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace {
+  void markWorker(const unsigned int worker, void *arg) {
+    std::vector<unsigned int> &calls = *static_cast<std::vector<unsigned int> *>(arg);
+    ++calls[worker];
+  }
+
+  TEST(ThreadTeamTest, RunCallsEveryWorkerOnce) {
+    ThreadTeam team;
+    EXPECT_EQ(1u, team.size());
+    if (!team.resize(4)) {
+      // Unthreaded build: a team of one still runs the job
+      EXPECT_EQ(1u, team.size());
+    }
+    std::vector<unsigned int> calls(team.size(), 0);
+    for (unsigned int rep = 0; rep < 100; ++rep) {
+      team.run(markWorker, &calls);
+    }
+    for (unsigned int worker = 0; worker < team.size(); ++worker) {
+      EXPECT_EQ(100u, calls[worker]);
+    }
+    EXPECT_TRUE(team.resize(1));
+    EXPECT_EQ(1u, team.size());
+  }
+}
@@ -0,0 +1,102 @@
+/***************************************************************************
+ * UndoLogTest.cpp
+ *
+ *  Copyright 2011 Ben Hocking
+ *  This file is part of the NeuroJet tester AllTests.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#include <vector>
+
+#include "UndoLog.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+  // Puts a value back, counting how often it was asked to
+  class Counted : public UndoLog::Entry {
+   public:
+    Counted(int &at, int &undone): At(at), Old(at), Undone(undone) {}
+    void undo() {
+      At = Old;
+      ++Undone;
+    }
+   private:
+    int &At;
+    int Old;
+    int &Undone;
+  };
+
+  TEST(UndoLogTest, PutsBackNewestFirst) {
+    UndoLog log;
+    int step = 5;
+    std::vector<float> bus(3, 1.0f);
+    float arr[4] = { 1.0f, 2.0f, 3.0f, 4.0f };
+    log.save(step);
+    EXPECT_FALSE(log.isRecording());
+    EXPECT_EQ(0U, log.size());
+
+    log.start();
+    log.save(step);
+    log.save(bus);
+    log.save(arr + 1, 2);
+    step = 6;
+    // Saved again after a change, the first value is the one kept
+    log.save(step);
+    step = 7;
+    bus.push_back(2.0f);
+    bus[0] = -1.0f;
+    arr[0] = arr[1] = arr[2] = arr[3] = 0.0f;
+    EXPECT_EQ(4U, log.size());
+    log.rollBack();
+    EXPECT_FALSE(log.isRecording());
+    EXPECT_EQ(0U, log.size());
+    EXPECT_EQ(5, step);
+    ASSERT_EQ(3U, bus.size());
+    EXPECT_EQ(1.0f, bus[0]);
+    EXPECT_EQ(0.0f, arr[0]);
+    EXPECT_EQ(2.0f, arr[1]);
+    EXPECT_EQ(3.0f, arr[2]);
+    EXPECT_EQ(0.0f, arr[3]);
+  }
+
+  TEST(UndoLogTest, ForgetKeepsTheChanges) {
+    UndoLog log;
+    int val = 1;
+    int undone = 0;
+    // Entries added while not recording are not kept
+    log.add(new Counted(val, undone));
+    EXPECT_EQ(0U, log.size());
+    log.start();
+    log.add(new Counted(val, undone));
+    val = 2;
+    log.forget();
+    log.rollBack();
+    EXPECT_EQ(2, val);
+    EXPECT_EQ(0, undone);
+
+    log.start();
+    log.add(new Counted(val, undone));
+    val = 3;
+    // Starting again forgets what was saved
+    log.start();
+    log.rollBack();
+    EXPECT_EQ(3, val);
+    log.start();
+    log.add(new Counted(val, undone));
+    val = 4;
+    log.rollBack();
+    EXPECT_EQ(3, val);
+    EXPECT_EQ(1, undone);
+  }
+}
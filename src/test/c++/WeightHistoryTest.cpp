@@ -0,0 +1,120 @@
+/***************************************************************************
+ * WeightHistoryTest.cpp
+ *
+ *  Copyright 2011 Ben Hocking
+ *  This file is part of the NeuroJet tester AllTests.
+ *
+ *  NeuroJet is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NeuroJet is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with NeuroJet.  If not, see <http://www.gnu.org/licenses/lgpl.txt>.
+ ****************************************************************************/
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "AsyncWriter.hpp"
+#include "WeightHistory.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+  void makeNetwork(UIVector &fanIn, UIVector &sources, DataList &weights) {
+    // Neuron 0 hears from 1 and 2, neuron 1 from 0, neuron 2 from 0 and 1
+    const unsigned int fanIns[] = { 2, 1, 2 };
+    const unsigned int srcs[] = { 1, 2, 0, 0, 1 };
+    fanIn.assign(fanIns, fanIns + 3);
+    sources.assign(srcs, srcs + 5);
+    weights.assign(5, 0.5f);
+  }
+
+  TEST(WeightHistoryTest, RebuildsEverySnapshot) {
+    const std::string fileName = "WeightHistoryTest.njwh";
+    std::remove(fileName.c_str());
+    UIVector fanIn;
+    UIVector sources;
+    DataList weights;
+    makeNetwork(fanIn, sources, weights);
+    std::vector<DataList> expected(1, weights);
+    {
+      WeightHistory history;
+      history.open(fileName, 0.0f, fanIn, sources, weights);
+      EXPECT_TRUE(history.sameNetwork(fanIn, sources));
+      weights[1] = 0.75f;
+      weights[4] = 0.0f;
+      EXPECT_EQ(2U, history.snapshot(1, 10, weights));
+      expected.push_back(weights);
+      EXPECT_EQ(0U, history.snapshot(2, 10, weights));
+      expected.push_back(weights);
+      // Even the sign of a zero is kept
+      weights[4] = -0.0f;
+      EXPECT_EQ(1U, history.snapshot(3, 10, weights));
+      expected.push_back(weights);
+      history.flush();
+    }
+    AsyncWriter::flush();
+
+    std::vector<WeightHistory::Run> runs;
+    ASSERT_TRUE(WeightHistory::read(fileName, runs));
+    ASSERT_EQ(1U, runs.size());
+    EXPECT_TRUE(runs[0].FanIn == fanIn);
+    EXPECT_TRUE(runs[0].Sources == sources);
+    ASSERT_EQ(3U, runs[0].Snapshots.size());
+    EXPECT_EQ(2, runs[0].Snapshots[1].Trial);
+    EXPECT_EQ(10, runs[0].Snapshots[1].Step);
+    for (unsigned int s = 0; s < expected.size(); ++s) {
+      DataList rebuilt;
+      WeightHistory::weightsAt(runs[0], s, rebuilt);
+      EXPECT_TRUE(rebuilt == expected[s]) << "snapshot " << s;
+    }
+    DataList last;
+    WeightHistory::weightsAt(runs[0], 3, last);
+    EXPECT_LT(1.0f / last[4], 0.0f);
+    std::remove(fileName.c_str());
+  }
+
+  TEST(WeightHistoryTest, KeepsOnlyChangesAboveTheThreshold) {
+    const std::string fileName = "WeightHistoryTest2.njwh";
+    std::remove(fileName.c_str());
+    UIVector fanIn;
+    UIVector sources;
+    DataList weights;
+    makeNetwork(fanIn, sources, weights);
+    {
+      WeightHistory history;
+      history.open(fileName, 0.1f, fanIn, sources, weights);
+      // Small steps add up until they pass the threshold
+      weights[0] = 0.55f;
+      EXPECT_EQ(0U, history.snapshot(1, 1, weights));
+      weights[0] = 0.65f;
+      EXPECT_EQ(1U, history.snapshot(1, 2, weights));
+      history.flush();
+      // A second run follows the first
+      history.open(fileName, 0.0f, fanIn, sources, weights);
+      history.flush();
+    }
+    AsyncWriter::flush();
+
+    std::vector<WeightHistory::Run> runs;
+    ASSERT_TRUE(WeightHistory::read(fileName, runs));
+    ASSERT_EQ(2U, runs.size());
+    EXPECT_FLOAT_EQ(0.1f, runs[0].Threshold);
+    DataList rebuilt;
+    WeightHistory::weightsAt(runs[0], 1, rebuilt);
+    EXPECT_EQ(0.5f, rebuilt[0]);
+    WeightHistory::weightsAt(runs[0], 2, rebuilt);
+    EXPECT_EQ(0.65f, rebuilt[0]);
+    EXPECT_TRUE(runs[1].Snapshots.empty());
+    EXPECT_TRUE(runs[1].Initial == weights);
+    std::remove(fileName.c_str());
+    EXPECT_FALSE(WeightHistory::read(fileName, runs));
+  }
+}